@@ -0,0 +1,174 @@
+/*
+ * 传感器->渲染 周期的零分配检查 (主机上运行)
+ *
+ * 用法:
+ *   g++ -std=gnu++17 -O2 -pthread -DCONFIG_IDF_TARGET_ESP32C3 \
+ *       -DMCOMPASS_ALLOC_TRACKER -I host -I ../include alloc_cycle_test.cpp \
+ *       host/host.cpp ../src/impl/alloc_tracker_impl.cpp \
+ *       ../src/impl/event_impl.cpp ../src/impl/context_impl.cpp \
+ *       ../src/impl/pixels_impl.cpp ../src/impl/utils_impl.cpp \
+ *       ../src/states/CompassState.cpp -static-libstdc++ \
+ *       -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc \
+ *       -Wl,--wrap=heap_caps_malloc,--wrap=heap_caps_calloc \
+ *       -Wl,--wrap=heap_caps_realloc -o alloc_cycle_test
+ *   ./alloc_cycle_test [每种模式的周期数]
+ *
+ * 与 alloc-tracker 环境一样用 -Wl,--wrap 包装分配函数, 固件的 alloc_tracker
+ * 原样编译; -static-libstdc++ 让 operator new 中的 malloc 也经过包装.
+ * 每个周期与固件相同: 传感器定时器调用 Event::postAzimuth, 事件循环中的
+ * azimuth_dispatcher(与 main.cpp 相同)取出方位角交给 CompassState, 渲染到
+ * LED 并 show(). 依次运行 SOUTH, SPAWN(有定位, 已到达, 无定位时的 Nether)
+ * 和 MOD 模式.
+ * arm() 之后每个周期的分配次数必须为0, ALLOC_GUARD 不能有违规, 每个周期都要
+ * 刷新一次 LED; 另外主动 malloc 一次, 确认追踪器确实在计数.
+ * 有错误时返回1, 可以作为回归检查.
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "alloc_tracker.h"
+#include "context.h"
+#include "event.h"
+#include "gps_def.h"
+#include "host/host.h"
+#include "pixel_def.h"
+#include "position_filter_def.h"
+#include "preference_def.h"
+#include "states/CalibratingState.h"
+#include "states/CompassState.h"
+#include "states/FactoryResetState.h"
+#include "waypoint_def.h"
+#include "web_server_def.h"
+
+using namespace mcompass;
+
+ESP_EVENT_DEFINE_BASE(MCOMPASS_EVENT);
+
+// ---- 固件其他模块的内存实现, 周期内不会调用 ----
+
+static bool arrived = false;
+
+void CalibratingState::onEnter(Context &context) {}
+void CalibratingState::onExit(Context &context) {}
+void CalibratingState::handleEvent(Context &context, Event::Body *evt) {}
+void FactoryResetState::onEnter(Context &context) {}
+void FactoryResetState::onExit(Context &context) {}
+void FactoryResetState::handleEvent(Context &context, Event::Body *evt) {}
+
+bool gps::isValidGPSLocation(Location location) { return true; }
+
+void preference::saveSpawnLocation(Location location) {}
+
+void preference::getBrightness(uint8_t &brightness) {}
+
+bool waypoint::select(int selection) { return true; }
+
+bool position_filter::updateArrival(const Location &target) { return false; }
+
+bool position_filter::isArrived() { return arrived; }
+
+void web_server::applyPendingColor() {}
+
+void web_server::onAzimuthShown() {}
+
+// ---- 测试 ----
+
+/**
+ * @brief 与 main.cpp 中的 azimuth_dispatcher 相同
+ */
+static void azimuth_dispatcher(void *handler_arg, esp_event_base_t base,
+                               int32_t id, void *event_data) {
+  ALLOC_GUARD("azimuth_dispatcher");
+  Event::Body evt;
+  Event::takeAzimuth(static_cast<Event::Source>(id), &evt);
+  Context &context = Context::getInstance();
+
+  if (context.getCurrentState()) {
+    context.getCurrentState()->handleEvent(context, &evt);
+  }
+}
+
+struct Mode {
+  const char *name;
+  WorkType workType;
+  Event::Source source;
+  bool fixed;
+  bool arrived;
+};
+
+static const Mode MODES[] = {
+    {"south", WorkType::SOUTH, Event::Source::SENSOR, false, false},
+    {"spawn", WorkType::SPAWN, Event::Source::SENSOR, true, false},
+    {"arrived", WorkType::SPAWN, Event::Source::SENSOR, true, true},
+    {"nether", WorkType::SPAWN, Event::Source::NETHER, false, false},
+    {"mod", WorkType::MOD, Event::Source::WEB_SERVER, false, false},
+};
+
+/**
+ * @brief 运行 cycles 个周期, 返回有分配或没有刷新 LED 的周期数
+ */
+static int runMode(const Mode &mode, int cycles) {
+  Context &context = Context::getInstance();
+  context.setWorkType(mode.workType);
+  context.setSubscribeSource(mode.source);
+  context.setIsGPSFixed(mode.fixed);
+  arrived = mode.arrived;
+
+  int failed = 0;
+  uint32_t allocations = 0;
+  for (int cycle = 0; cycle < cycles; cycle++) {
+    uint32_t before = alloc_tracker::count();
+    uint32_t shows = FastLED.shows();
+    // 与传感器定时器相同, 16.667ms 一个周期
+    host::advanceTo(host::now() + 16667);
+    Event::postAzimuth(context.getEventLoop(), mode.source, cycle * 7 % 360);
+    host::dispatchEvents();
+    uint32_t allocated = alloc_tracker::count() - before;
+    allocations += allocated;
+    if (allocated || FastLED.shows() != shows + 1) {
+      failed++;
+    }
+  }
+  printf("%-8s %5d cycles, %u allocations, %d failed\n", mode.name, cycles,
+         allocations, failed);
+  return failed;
+}
+
+int main(int argc, char **argv) {
+  int cycles = argc > 1 ? atoi(argv[1]) : 600;
+  static int loop; // 事件循环句柄只用来匹配处理函数
+  Context &context = Context::getInstance();
+  context.setEventLoop(&loop);
+  context.setDeviceState(State::COMPASS);
+  context.setCurrentLocation({39.9f, 116.4f});
+  context.setSpawnLocation({39.91f, 116.41f});
+  context.setState(new CompassState());
+  esp_event_handler_register_with(&loop, MCOMPASS_AZIMUTH_EVENT,
+                                  ESP_EVENT_ANY_ID, azimuth_dispatcher, NULL);
+  pixel::init(&context);
+
+  alloc_tracker::arm();
+  int errors = 0;
+  for (const Mode &mode : MODES) {
+    errors += runMode(mode, cycles);
+  }
+  if (alloc_tracker::violations()) {
+    printf("ALLOC_GUARD violations: %u\n", alloc_tracker::violations());
+    errors++;
+  }
+
+  // 追踪器本身必须生效, 否则上面的0没有意义
+  // 经过函数指针调用, 编译器不能省掉这对 malloc/free
+  void *(*volatile allocate)(size_t) = malloc;
+  uint32_t before = alloc_tracker::count();
+  void *probe = allocate(16);
+  bool counted = alloc_tracker::count() == before + 1;
+  free(probe);
+  if (!counted) {
+    printf("allocation tracker is not counting, check the --wrap flags\n");
+    errors++;
+  }
+  return errors ? 1 : 0;
+}
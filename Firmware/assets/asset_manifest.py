@@ -0,0 +1,70 @@
+"""生成网页静态资源清单 data/assets.manifest
+
+用法: python asset_manifest.py [data目录]
+打包文件系统(buildfs)前 extra_script.py 会自动调用, 保证清单和文件系统镜像一致.
+正常情况下网页资源打包进 webui 分区(见 webui_bundle.py, 同样使用这里的资源列表);
+没有资源包时才从 LittleFS 读取: data 中默认只有资源包缺失或损坏时使用的
+基础页面 index.html, 调试网页时可以把文件放进 data 后上传文件系统.
+
+每行一个文件, 以制表符分隔:
+  请求路径  文件路径  大小  是否gzip  是否不可变  ETag  Content-Type
+请求路径去掉 .gz 后缀; _next/static 下的文件名带内容哈希, 标记为不可变;
+ETag 取文件内容(压缩后) SHA-1 的前16位, 带引号, 内容不变 ETag 就不变.
+"""
+import hashlib
+import os
+import sys
+
+MANIFEST_NAME = "assets.manifest"
+IMMUTABLE_PREFIX = "/_next/static/"
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".htm": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".txt": "text/plain",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".gif": "image/gif",
+    ".jpg": "image/jpeg",
+    ".ico": "image/x-icon",
+    ".woff": "font/woff",
+    ".woff2": "font/woff2",
+}
+
+
+def content_type(path):
+    return CONTENT_TYPES.get(os.path.splitext(path)[1].lower(),
+                             "application/octet-stream")
+
+
+def entries(root):
+    for directory, _, files in os.walk(root):
+        for name in files:
+            full = os.path.join(directory, name)
+            file_path = "/" + os.path.relpath(full, root).replace(os.sep, "/")
+            if file_path == "/" + MANIFEST_NAME:
+                continue
+            gzip = file_path.endswith(".gz")
+            url = file_path[:-3] if gzip else file_path
+            with open(full, "rb") as f:
+                etag = '"%s"' % hashlib.sha1(f.read()).hexdigest()[:16]
+            yield (url, file_path, os.path.getsize(full), int(gzip),
+                   int(url.startswith(IMMUTABLE_PREFIX)), etag, content_type(url))
+
+
+def generate(root):
+    # 按请求路径排序, 固件中二分查找
+    lines = sorted("\t".join(str(field) for field in entry)
+                   for entry in entries(root))
+    with open(os.path.join(root, MANIFEST_NAME), "w", newline="\n") as f:
+        f.write("\n".join(lines) + "\n")
+    return len(lines)
+
+
+if __name__ == "__main__":
+    root = sys.argv[1] if len(sys.argv) > 1 else os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "..", "data")
+    print("%d assets -> %s" % (generate(root), os.path.join(root, MANIFEST_NAME)))
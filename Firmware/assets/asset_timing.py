@@ -0,0 +1,74 @@
+"""网页首次加载和重复加载耗时
+
+用法: python asset_timing.py [--host esp32.local] [--page /]
+
+首次加载: 不带缓存请求页面以及页面引用的所有资源.
+重复加载: 模拟浏览器缓存, 带 immutable 的资源直接使用缓存不发请求,
+          其余资源带 If-None-Match 重新验证, 期望得到304.
+每个请求使用一个新连接, 与浏览器连接数受限时的最坏情况一致.
+只依赖标准库.
+"""
+import argparse
+import http.client
+import re
+import time
+
+
+def fetch(host, path, etag=None):
+    conn = http.client.HTTPConnection(host, 80, timeout=10)
+    headers = {"Accept-Encoding": "gzip"}
+    if etag:
+        headers["If-None-Match"] = etag
+    start = time.perf_counter()
+    conn.request("GET", path, headers=headers)
+    response = conn.getresponse()
+    body = response.read()
+    elapsed = (time.perf_counter() - start) * 1000
+    conn.close()
+    return response.status, response.getheader("ETag"), \
+        response.getheader("Cache-Control") or "", len(body), elapsed
+
+
+def references(html):
+    # Next.js 导出的页面通过 src/href 引用 _next 下的资源
+    return sorted(set(re.findall(r'(?:src|href)="(/_next/[^"]+)"', html)))
+
+
+def run(host, page):
+    conn = http.client.HTTPConnection(host, 80, timeout=10)
+    conn.request("GET", page)
+    html = conn.getresponse().read().decode("utf-8", "replace")
+    conn.close()
+    paths = [page] + references(html)
+
+    cache = {}
+    first_ms = first_bytes = 0
+    for path in paths:
+        status, etag, cache_control, size, elapsed = fetch(host, path)
+        first_ms += elapsed
+        first_bytes += size
+        cache[path] = (etag, "immutable" in cache_control)
+        print("  %3d %7d B %7.1f ms %s" % (status, size, elapsed, path))
+    print("first load: %d requests, %d bytes, %.1f ms" % (
+        len(paths), first_bytes, first_ms))
+
+    repeat_ms = 0
+    requests = not_modified = 0
+    for path in paths:
+        etag, immutable = cache[path]
+        if immutable:
+            continue
+        status, _, _, _, elapsed = fetch(host, path, etag)
+        repeat_ms += elapsed
+        requests += 1
+        not_modified += status == 304
+    print("repeat load: %d requests (%d not modified), %d served from cache, %.1f ms" % (
+        requests, not_modified, len(paths) - requests, repeat_ms))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--host", default="esp32.local")
+    parser.add_argument("--page", default="/")
+    args = parser.parse_args()
+    run(args.host, args.page)
@@ -0,0 +1,80 @@
+"""POST /setAzimuth 洪泛压测
+
+用法: python azimuth_flood.py [--host esp32.local] [--connections 4] [--seconds 30]
+
+多个长连接同时尽可能快地发送方位角, 统计各状态码数量和请求延迟,
+结束后读取 /ingestStats 打印设备端的 接受/合并/限速 计数.
+设备在压测期间应保持响应, 超过限速的请求返回 429.
+只依赖标准库.
+"""
+import argparse
+import collections
+import http.client
+import json
+import threading
+import time
+
+
+def flood(host, port, deadline, worker, codes, latencies, lock):
+    conn = http.client.HTTPConnection(host, port, timeout=3)
+    sent = 0
+    while time.monotonic() < deadline:
+        angle = (worker * 90 + sent * 7) % 360
+        start = time.perf_counter()
+        try:
+            conn.request("POST", "/setAzimuth?azimuth=%d" % angle)
+            response = conn.getresponse()
+            response.read()
+            code = response.status
+        except (OSError, http.client.HTTPException) as e:
+            code = type(e).__name__
+            conn.close()
+            conn = http.client.HTTPConnection(host, port, timeout=3)
+        elapsed = (time.perf_counter() - start) * 1000
+        with lock:
+            codes[code] += 1
+            latencies.append(elapsed)
+        sent += 1
+    conn.close()
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--host", default="esp32.local")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--connections", type=int, default=4)
+    parser.add_argument("--seconds", type=float, default=30)
+    args = parser.parse_args()
+
+    codes = collections.Counter()
+    latencies = []
+    lock = threading.Lock()
+    deadline = time.monotonic() + args.seconds
+    workers = [threading.Thread(target=flood, args=(
+        args.host, args.port, deadline, i, codes, latencies, lock))
+        for i in range(args.connections)]
+    for worker in workers:
+        worker.start()
+    for worker in workers:
+        worker.join()
+
+    total = sum(codes.values())
+    print("%d requests in %.1f s, %.1f requests/s" % (
+        total, args.seconds, total / args.seconds))
+    for code, count in sorted(codes.items(), key=str):
+        print("  %s: %d" % (code, count))
+    if latencies:
+        latencies.sort()
+        print("latency ms: p50 %.1f, p95 %.1f, max %.1f" % (
+            latencies[len(latencies) // 2],
+            latencies[len(latencies) * 95 // 100], latencies[-1]))
+
+    # 设备仍然能响应才算通过
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=5)
+    conn.request("GET", "/ingestStats")
+    response = conn.getresponse()
+    print("device:", json.dumps(json.loads(response.read()), indent=2))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,147 @@
+/*
+ * 方位角计算的耗时和精度 (主机上运行)
+ *
+ * 用法:
+ *   g++ -std=gnu++17 -O2 -pthread -DCONFIG_IDF_TARGET_ESP32C3 -I host \
+ *       -I ../include bearing_bench.cpp host/host.cpp \
+ *       ../src/impl/utils_impl.cpp -o bearing_bench
+ *   ./bearing_bench [次数]
+ *
+ * 比较 utils 中的三种方式, 输入是随机的坐标对, 距离从1米到1000公里:
+ *   double  calculateBearing, 原来每帧调用的双精度版本
+ *   float   calculateBearingF, 单精度完整 atan2 公式
+ *   cache   NavigationCache 命中, 坐标不变时每帧实际的开销
+ * 精度以同一个 atan2 公式的双精度结果为准, 分别统计5米以上和5米以内的最大
+ * 误差. calculateBearing 按经纬度大小判断象限, 高纬度东西向时会偏离大圆
+ * 方位, 它的误差单独列出, 不作为基准.
+ * 主机有硬件双精度浮点, 两者的差距远小于 ESP32-C3(RV32IMC, 没有浮点单元,
+ * double 和 float 都是软件实现, 双精度的每次运算都更慢); 这里的结果只用来
+ * 确认 float 版本不比 double 慢, 缓存命中的开销可以忽略, 并检查精度.
+ */
+#include <Arduino.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "common.h"
+#include "utils.h"
+
+using namespace mcompass;
+
+struct Pair {
+  float lat1, lon1, lat2, lon2;
+  double distance; // 米
+};
+
+static uint32_t state = 0x12345678;
+
+static double uniform(double low, double high) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return low + (high - low) * (state / 4294967296.0);
+}
+
+static std::vector<Pair> makePairs(size_t count) {
+  std::vector<Pair> pairs;
+  for (size_t i = 0; i < count; i++) {
+    Pair pair;
+    pair.lat1 = uniform(-80, 80);
+    pair.lon1 = uniform(-180, 180);
+    // 距离按对数均匀分布在 1m ~ 1000km
+    double distance = pow(10, uniform(0, 6));
+    double course = uniform(0, 2 * PI);
+    double dLat = distance * cos(course) / (EARTH_RADIUS * 1000) * 180 / PI;
+    double dLon = distance * sin(course) /
+                  (EARTH_RADIUS * 1000 * cos(pair.lat1 * PI / 180)) * 180 / PI;
+    pair.lat2 = pair.lat1 + dLat;
+    pair.lon2 = pair.lon1 + dLon;
+    pair.distance = utils::complexDistance(pair.lat1, pair.lon1, pair.lat2,
+                                           pair.lon2) *
+                    1000;
+    pairs.push_back(pair);
+  }
+  return pairs;
+}
+
+template <typename F> static double timeNs(const std::vector<Pair> &pairs,
+                                           int rounds, F function) {
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (const Pair &pair : pairs) {
+      sink = sink + function(pair);
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         ((double)rounds * pairs.size());
+}
+
+/**
+ * @brief 与 calculateBearingF 相同的公式, 全程双精度, 作为精度基准
+ */
+static double referenceBearing(double lat1, double lon1, double lat2,
+                               double lon2) {
+  double toRad = PI / 180;
+  double deltaLon = (lon2 - lon1) * toRad;
+  double numerator = sin(deltaLon) * cos(lat2 * toRad);
+  double denominator = cos(lat1 * toRad) * sin(lat2 * toRad) -
+                       sin(lat1 * toRad) * cos(lat2 * toRad) * cos(deltaLon);
+  double result = atan2(numerator, denominator) * 180 / PI;
+  return result < 0 ? result + 360 : result;
+}
+
+static double angleDifference(double a, double b) {
+  double delta = fabs(a - b);
+  return delta > 180 ? 360 - delta : delta;
+}
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 200;
+  std::vector<Pair> pairs = makePairs(10000);
+
+  double maxFar = 0, maxNear = 0, legacyFar = 0;
+  for (const Pair &pair : pairs) {
+    double reference =
+        referenceBearing(pair.lat1, pair.lon1, pair.lat2, pair.lon2);
+    float single =
+        utils::calculateBearingF(pair.lat1, pair.lon1, pair.lat2, pair.lon2);
+    double error = angleDifference(reference, single);
+    double &worst = pair.distance >= 5 ? maxFar : maxNear;
+    if (error > worst) {
+      worst = error;
+    }
+    double legacy = angleDifference(
+        reference,
+        utils::calculateBearing(pair.lat1, pair.lon1, pair.lat2, pair.lon2));
+    if (pair.distance >= 5 && legacy > legacyFar) {
+      legacyFar = legacy;
+    }
+  }
+
+  double doubleNs = timeNs(pairs, rounds, [](const Pair &p) {
+    return (float)utils::calculateBearing(p.lat1, p.lon1, p.lat2, p.lon2);
+  });
+  double floatNs = timeNs(pairs, rounds, [](const Pair &p) {
+    return utils::calculateBearingF(p.lat1, p.lon1, p.lat2, p.lon2);
+  });
+  // 一帧内坐标不变, 缓存总是命中
+  utils::NavigationCache cache;
+  Location from = {pairs[0].lat1, pairs[0].lon1};
+  Location to = {pairs[0].lat2, pairs[0].lon2};
+  double cacheNs = timeNs(pairs, rounds, [&](const Pair &) {
+    return cache.bearing(from, to);
+  });
+
+  printf("%zu pairs x %d rounds\n", pairs.size(), rounds);
+  printf("double  %7.1f ns/call\n", doubleNs);
+  printf("float   %7.1f ns/call  (%.2fx)\n", floatNs, doubleNs / floatNs);
+  printf("cache   %7.1f ns/call  (%.2fx)\n", cacheNs, doubleNs / cacheNs);
+  printf("float error: max %.6f deg beyond 5 m, %.6f deg within 5 m\n",
+         maxFar, maxNear);
+  printf("calculateBearing error: max %.6f deg beyond 5 m\n", legacyFar);
+  return 0;
+}
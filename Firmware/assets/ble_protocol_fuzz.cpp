@@ -0,0 +1,316 @@
+/*
+ * 蓝牙二进制配置协议解码的模糊测试 (主机上运行)
+ *
+ * 用法:
+ *   独立运行, 用随机变异的合法帧测试:
+ *     g++ -O1 -g -fsanitize=address,undefined -DCONFIG_IDF_TARGET_ESP32C3 \
+ *         -I host -I ../include \
+ *         ble_protocol_fuzz.cpp ../src/impl/ble_protocol_impl.cpp -o ble_protocol_fuzz
+ *     ./ble_protocol_fuzz [次数] [随机种子]
+ *   libFuzzer:
+ *     clang++ -O1 -g -fsanitize=fuzzer,address,undefined -DLIBFUZZER \
+ *         -DCONFIG_IDF_TARGET_ESP32C3 -I host -I ../include \
+ *         ble_protocol_fuzz.cpp ../src/impl/ble_protocol_impl.cpp -o ble_protocol_fuzz
+ *     ./ble_protocol_fuzz
+ *
+ * 每个输入检查:
+ *   - 解码不越界读取(由 AddressSanitizer 检查)
+ *   - 解码成功时字符串以'\0'结尾, 取值在协议范围内
+ *   - 解码成功的消息重新编码后再次解码, 结果与第一次一致
+ *   - 失败时出错记录序号指向帧内的记录
+ *   - 坐标与配置文件一样经过 gps::isValidGPSLocation, (0,0) 被拒绝
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ble_protocol.h"
+#include "gps_def.h"
+
+using namespace mcompass;
+using namespace mcompass::ble_protocol;
+
+// 与 gps_impl.cpp 相同, GPS模块的其余部分不参与测试
+bool gps::isValidGPSLocation(Location location) {
+  if (location.latitude == 0 && location.longitude == 0) {
+    return false;
+  }
+  return location.latitude >= -90 && location.latitude <= 90 &&
+         location.longitude >= -180 && location.longitude <= 180;
+}
+
+static void fail(const char *what) {
+  fprintf(stderr, "check failed: %s\n", what);
+  abort();
+}
+
+static void check(bool condition, const char *what) {
+  if (!condition) {
+    fail(what);
+  }
+}
+
+/**
+ * @brief 主机端编码器, 与设备端解码器互为逆过程
+ */
+class Encoder {
+public:
+  explicit Encoder(uint8_t sequence) {
+    m_data[0] = VERSION;
+    m_data[1] = sequence;
+    m_length = 2;
+  }
+
+  void record(Type type, const void *value, size_t length) {
+    m_data[m_length++] = type;
+    m_data[m_length++] = (uint8_t)length;
+    if (length) {
+      memcpy(m_data + m_length, value, length);
+    }
+    m_length += length;
+  }
+
+  void u8(Type type, uint8_t value) { record(type, &value, 1); }
+
+  void color(Type type, uint32_t rgb) {
+    uint8_t value[3] = {(uint8_t)(rgb >> 16), (uint8_t)(rgb >> 8),
+                        (uint8_t)rgb};
+    record(type, value, 3);
+  }
+
+  void location(Type type, int32_t latitudeE7, int32_t longitudeE7,
+                const char *name = "") {
+    uint8_t value[8 + NAME_CAPACITY];
+    writeInt32(value, latitudeE7);
+    writeInt32(value + 4, longitudeE7);
+    size_t nameLength = strlen(name);
+    memcpy(value + 8, name, nameLength);
+    record(type, value, 8 + nameLength);
+  }
+
+  void string(Type type, const char *value) {
+    record(type, value, strlen(value));
+  }
+
+  const uint8_t *data() const { return m_data; }
+  size_t length() const { return m_length; }
+
+private:
+  static void writeInt32(uint8_t *out, int32_t value) {
+    for (int i = 0; i < 4; i++) {
+      out[i] = (uint8_t)((uint32_t)value >> (8 * i));
+    }
+  }
+
+  uint8_t m_data[512];
+  size_t m_length;
+};
+
+static void encode(const Message &message, Encoder &encoder) {
+  if (message.has(TYPE_BRIGHTNESS)) {
+    encoder.u8(TYPE_BRIGHTNESS, message.brightness);
+  }
+  if (message.has(TYPE_SPAWN_COLOR)) {
+    encoder.color(TYPE_SPAWN_COLOR, message.spawnColor);
+  }
+  if (message.has(TYPE_SOUTH_COLOR)) {
+    encoder.color(TYPE_SOUTH_COLOR, message.southColor);
+  }
+  if (message.has(TYPE_SPAWN)) {
+    encoder.location(TYPE_SPAWN, message.latitudeE7, message.longitudeE7);
+  }
+  if (message.has(TYPE_SERVER_MODE)) {
+    encoder.u8(TYPE_SERVER_MODE, message.serverMode);
+  }
+  if (message.has(TYPE_MODEL)) {
+    encoder.u8(TYPE_MODEL, message.model);
+  }
+  if (message.has(TYPE_WIFI_SSID)) {
+    encoder.string(TYPE_WIFI_SSID, message.ssid);
+  }
+  if (message.has(TYPE_WIFI_PASSWORD)) {
+    encoder.string(TYPE_WIFI_PASSWORD, message.password);
+  }
+  if (message.has(TYPE_WAYPOINT_ADD)) {
+    encoder.location(TYPE_WAYPOINT_ADD, message.waypointLatitudeE7,
+                     message.waypointLongitudeE7, message.addName);
+  }
+  if (message.has(TYPE_WAYPOINT_DELETE)) {
+    encoder.string(TYPE_WAYPOINT_DELETE, message.deleteName);
+  }
+  if (message.has(TYPE_WAYPOINT_SELECT)) {
+    encoder.u8(TYPE_WAYPOINT_SELECT, (uint8_t)message.selection);
+  }
+  if (message.has(TYPE_CALIBRATE)) {
+    encoder.record(TYPE_CALIBRATE, nullptr, 0);
+  }
+  if (message.has(TYPE_FACTORY_RESET)) {
+    encoder.record(TYPE_FACTORY_RESET, nullptr, 0);
+  }
+}
+
+static bool terminated(const char *text, size_t capacity) {
+  return memchr(text, 0, capacity) != nullptr;
+}
+
+static void checkInput(const uint8_t *data, size_t length) {
+  // 复制到刚好大小的堆缓冲区, 越界读取会被 AddressSanitizer 发现
+  uint8_t *frame = (uint8_t *)malloc(length ? length : 1);
+  if (length) {
+    memcpy(frame, data, length);
+  }
+  Message message;
+  uint8_t record;
+  Status status = decode(frame, length, message, record);
+  free(frame);
+  if (status != STATUS_OK) {
+    check(status <= STATUS_UNKNOWN_TYPE, "status in range");
+    // 每条记录至少2字节
+    check(record == NO_RECORD || record < (length - 2) / 2 + 1,
+          "record index inside frame");
+    return;
+  }
+  check(record == NO_RECORD, "no record on success");
+  check(terminated(message.ssid, sizeof(message.ssid)), "ssid terminated");
+  check(terminated(message.password, sizeof(message.password)),
+        "password terminated");
+  check(terminated(message.addName, sizeof(message.addName)),
+        "name terminated");
+  check(terminated(message.deleteName, sizeof(message.deleteName)),
+        "name terminated");
+  check(message.serverMode <= 1 && message.model <= 1, "mode in range");
+  check(message.selection >= -2, "selection in range");
+  check(message.spawnColor <= 0xFFFFFF && message.southColor <= 0xFFFFFF,
+        "color in range");
+  check(message.has(TYPE_WIFI_SSID) == message.has(TYPE_WIFI_PASSWORD),
+        "wifi pair");
+  check(!message.has(TYPE_SPAWN) ||
+            message.latitudeE7 != 0 || message.longitudeE7 != 0,
+        "spawn is not (0,0)");
+
+  Encoder encoder(message.sequence);
+  encode(message, encoder);
+  Message again;
+  check(decode(encoder.data(), encoder.length(), again, record) == STATUS_OK,
+        "round trip decodes");
+  check(memcmp(&message, &again, sizeof(message)) == 0,
+        "round trip is identical");
+}
+
+#if defined(LIBFUZZER)
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  checkInput(data, size);
+  return 0;
+}
+
+#else
+
+/**
+ * @brief 构造覆盖全部记录类型的合法帧作为变异的起点
+ */
+static size_t seeds(Encoder *out) {
+  size_t count = 0;
+  Encoder config(1);
+  config.u8(TYPE_BRIGHTNESS, 56);
+  config.color(TYPE_SPAWN_COLOR, 0xFF1414);
+  config.color(TYPE_SOUTH_COLOR, 0x1414FF);
+  config.location(TYPE_SPAWN, 312000000, 1214000000);
+  config.u8(TYPE_SERVER_MODE, 1);
+  config.u8(TYPE_MODEL, 1);
+  config.string(TYPE_WIFI_SSID, "home");
+  config.string(TYPE_WIFI_PASSWORD, "password");
+  out[count++] = config;
+  Encoder waypoint(2);
+  waypoint.location(TYPE_WAYPOINT_ADD, -338688000, 1512093000, "Sydney");
+  waypoint.string(TYPE_WAYPOINT_DELETE, "Home");
+  waypoint.u8(TYPE_WAYPOINT_SELECT, (uint8_t)-2);
+  out[count++] = waypoint;
+  Encoder action(3);
+  action.record(TYPE_CALIBRATE, nullptr, 0);
+  action.record(TYPE_FACTORY_RESET, nullptr, 0);
+  out[count++] = action;
+  out[count++] = Encoder(4);
+  return count;
+}
+
+static uint32_t nextRandom(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+  uint32_t state = argc > 2 ? (uint32_t)atol(argv[2]) : 0x12345678;
+  if (state == 0) {
+    state = 1;
+  }
+  Encoder seed[4] = {Encoder(0), Encoder(0), Encoder(0), Encoder(0)};
+  size_t seedCount = seeds(seed);
+  long accepted = 0;
+  for (size_t i = 0; i < seedCount; i++) {
+    Message message;
+    uint8_t record;
+    check(decode(seed[i].data(), seed[i].length(), message, record) ==
+              STATUS_OK,
+          "seed decodes");
+  }
+  // 配置文件拒绝的 (0,0) 出生点, 蓝牙同样拒绝
+  Encoder origin(5);
+  origin.location(TYPE_SPAWN, 0, 0);
+  Message message;
+  uint8_t record;
+  check(decode(origin.data(), origin.length(), message, record) ==
+            STATUS_BAD_VALUE,
+        "(0,0) spawn rejected");
+  uint8_t frame[512];
+  for (long i = 0; i < iterations; i++) {
+    const Encoder &base = seed[nextRandom(state) % seedCount];
+    size_t length = base.length();
+    memcpy(frame, base.data(), length);
+    int mutations = 1 + nextRandom(state) % 4;
+    for (int m = 0; m < mutations; m++) {
+      uint32_t r = nextRandom(state);
+      switch (r % 5) {
+      case 0: // 翻转一位
+        if (length) {
+          frame[(r >> 8) % length] ^= 1 << ((r >> 3) % 8);
+        }
+        break;
+      case 1: // 改写一个字节
+        if (length) {
+          frame[(r >> 8) % length] = (uint8_t)(r >> 16);
+        }
+        break;
+      case 2: // 截断
+        length = length ? (r >> 8) % length : 0;
+        break;
+      case 3: // 追加随机字节
+        for (uint32_t n = (r >> 8) % 8; n > 0 && length < sizeof(frame); n--) {
+          frame[length++] = (uint8_t)nextRandom(state);
+        }
+        break;
+      default: // 改写一个长度字节为边界值
+        if (length > 3) {
+          static const uint8_t edges[] = {0, 1, 2, 3, 8, 9, 15, 16, 32, 33,
+                                          64, 65, 255};
+          frame[3 + (r >> 8) % (length - 3)] =
+              edges[(r >> 16) % sizeof(edges)];
+        }
+        break;
+      }
+    }
+    Message message;
+    uint8_t record;
+    if (decode(frame, length, message, record) == STATUS_OK) {
+      accepted++;
+    }
+    checkInput(frame, length);
+  }
+  printf("%ld inputs, %ld accepted, no failures\n", iterations, accepted);
+  return 0;
+}
+
+#endif
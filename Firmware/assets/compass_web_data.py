@@ -33,7 +33,7 @@ def compress_folder(folder_path):
 
 if __name__ == "__main__":
     # 指定要压缩的文件夹路径
-    folder_path = "./data/_next"  # 替换为你的文件夹路径
+    folder_path = "./webui/_next"  # 替换为你的文件夹路径
 
     # 检查文件夹是否存在
     if not os.path.exists(folder_path):
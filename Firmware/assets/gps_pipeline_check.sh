@@ -0,0 +1,59 @@
+#!/bin/sh
+# GPS数据通路的回归检查 (主机上运行, 可用于CI)
+#
+# 用法: sh gps_pipeline_check.sh [输出目录]
+#
+# 编译 gps_pipeline_sim.cpp, 用 nmea_track.py 生成各个场景的轨迹, 逐个运行
+# 并检查限制(见 gps_pipeline_sim.cpp). 每个场景的CSV记录留在输出目录
+# (默认 build/gps_pipeline)中, 失败时可以对照. 任一场景失败时返回1.
+# 限制是按当前固件的结果留出余量定的, 修改滤波或电源策略后结果有意变化时
+# 同步修改这里.
+set -e
+cd "$(dirname "$0")"
+OUT=${1:-build/gps_pipeline}
+mkdir -p "$OUT"
+
+CC=${CC:-gcc}
+CXX=${CXX:-g++}
+DEFINES="-DCONFIG_IDF_TARGET_ESP32C3 -DBUILD_VERSION=\"host\" -DGIT_BRANCH=\"host\" -DGIT_COMMIT=\"host\""
+$CC -c -O2 -I host -I ../include ../src/impl/nmea_tokenizer.c -o "$OUT/nmea_tokenizer.o"
+$CC -c -O2 -I host -I ../include ../src/impl/nmea_parser.c -o "$OUT/nmea_parser.o"
+$CXX -std=gnu++17 -O2 -pthread $DEFINES -I host -I ../include \
+    gps_pipeline_sim.cpp host/host.cpp host/track.cpp \
+    ../src/impl/gps_impl.cpp ../src/impl/gps_power_impl.cpp \
+    ../src/impl/position_filter_impl.cpp ../src/impl/waypoint_impl.cpp \
+    ../src/impl/context_impl.cpp ../src/impl/event_impl.cpp \
+    ../src/impl/utils_impl.cpp "$OUT/nmea_tokenizer.o" "$OUT/nmea_parser.o" \
+    -o "$OUT/gps_pipeline_sim"
+
+for scenario in walk drive cold nofix crc noise; do
+    python3 nmea_track.py $scenario > "$OUT/$scenario.nmea"
+done
+: > "$OUT/empty.nmea"
+
+failed=0
+# run 名称 轨迹 参数...
+run() {
+    name=$1
+    shift
+    echo "== $name"
+    if ! "$OUT/gps_pipeline_sim" "$@" -o "$OUT/$name.csv"; then
+        echo "!! $name failed"
+        failed=1
+    fi
+}
+
+# 目标在1公里内时一直跟踪, 检查解析和滤波; 目标在远处时检查休眠
+run walk-near "$OUT/walk.nmea" -d 1 --detect yes --min-fixes 590 --max-err 10 --max-format 0
+run walk-far "$OUT/walk.nmea" -d 20 --detect yes --min-fixes 2 --max-on 20
+run drive-near "$OUT/drive.nmea" -d 2 --min-fixes 1500 --max-err 400 --max-format 0
+run drive-far "$OUT/drive.nmea" -d 20 --min-fixes 100 --max-on 50
+run cold "$OUT/cold.nmea" -d 1 --detect yes --min-fixes 290 --max-err 10
+run nofix "$OUT/nofix.nmea" --detect yes --max-fixes 0
+run crc "$OUT/crc.nmea" -d 1 --min-crc 100 --min-fixes 500 --max-err 10 --max-format 0
+run noise "$OUT/noise.nmea" -d 1 --min-fixes 590 --max-err 10
+# 没有接GPS: 检测超时后关闭GPS
+run no-gps --detect no
+run silent "$OUT/empty.nmea" --detect no
+
+exit $failed
@@ -0,0 +1,338 @@
+/*
+ * GPS数据通路的主机仿真: 串口 -> NMEA解析 -> 滤波 -> 电源管理
+ *
+ * 用法:
+ *   python nmea_track.py walk crc > walk.nmea
+ *   gcc -c -O2 -I host -I ../include ../src/impl/nmea_tokenizer.c \
+ *       ../src/impl/nmea_parser.c
+ *   g++ -std=gnu++17 -O2 -pthread -DCONFIG_IDF_TARGET_ESP32C3 \
+ *       '-DBUILD_VERSION="host"' '-DGIT_BRANCH="host"' '-DGIT_COMMIT="host"' \
+ *       -I host -I ../include gps_pipeline_sim.cpp host/host.cpp \
+ *       host/track.cpp ../src/impl/gps_impl.cpp ../src/impl/gps_power_impl.cpp \
+ *       ../src/impl/position_filter_impl.cpp ../src/impl/waypoint_impl.cpp \
+ *       ../src/impl/context_impl.cpp ../src/impl/event_impl.cpp \
+ *       ../src/impl/utils_impl.cpp nmea_tokenizer.o nmea_parser.o \
+ *       -o gps_pipeline_sim
+ *   ./gps_pipeline_sim [walk.nmea] [-d km] [-t 秒] [-o log.csv] [-v] [限制...]
+ * 一次跑完所有场景并检查结果见 gps_pipeline_check.sh.
+ *
+ * 与 gps-replay 环境在设备上的回放走同样的路径, 但在主机上用虚拟时钟瞬间
+ * 跑完, 可以放进CI. gps::init 及其后的模块原样编译(见 host/host.h):
+ * 轨迹字节按UTC时间写入串口驱动, NMEA解析任务读取并投递定位事件, 主线程
+ * 像主循环一样处理事件, 依次经过滤波, 航点, 到达判断和 gps_power; 唤醒定时器
+ * 和检测超时定时器(gpsDisableTimer)在虚拟时钟上到期.
+ * GPS模块的模型与 gps_power_sim.cpp 相同: GPS_EN_PIN 为低电平时上电, 唤醒后
+ * 经过热/温启动定位时间才输出语句, 首次上电的冷启动由轨迹本身描述.
+ * 不给轨迹文件(或文件不存在)时模拟没有接GPS, 用来检查检测超时后关闭GPS.
+ *
+ * 目标放在第一个有效定位正东 d 公里处(默认20). 轨迹结束后再运行 t 秒
+ * (默认60), 覆盖检测超时和之后的唤醒.
+ * -o 把每次定位, 电源开关和定时器启动/停止/触发逐行写成CSV:
+ *   时间(秒),fix,定位质量,纬度,经度,滤波纬度,滤波经度,sigma(米)
+ *   时间(秒),power,on|off
+ *   时间(秒),timer,名称,start|stop|fire,时长(秒)
+ * 结束时打印解析统计, 定位数, 上电时间占比, GPS检测结果, 以及罗盘所知位置
+ * (Context 中的当前位置)与轨迹真实位置之间的误差.
+ * 限制参数, 不满足时返回1:
+ *   --min-fixes N   有效定位至少 N 次
+ *   --max-fixes N   有效定位至多 N 次
+ *   --max-on P      上电时间占比不超过 P%
+ *   --max-err M     位置误差的95分位不超过 M 米
+ *   --min-crc N     校验和错误至少 N 条(确认错误被计数而不是被忽略)
+ *   --max-format N  格式错误至多 N 条
+ *   --detect yes|no GPS 应该被检测到 / 应该在检测超时后被关闭
+ */
+#include <Arduino.h>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "context.h"
+#include "gps_def.h"
+#include "gps_power_def.h"
+#include "host/host.h"
+#include "host/track.h"
+#include "macro_def.h"
+#include "position_filter_def.h"
+#include "preference_def.h"
+#include "utils.h"
+
+using namespace mcompass;
+
+#define SIM_HOT_TTFF_S 3
+#define SIM_WARM_TTFF_S 28
+
+// ---- 固件其他模块的内存实现 ----
+
+void preference::saveWaypoints(const void *data, size_t length) {}
+
+size_t preference::getWaypoints(void *data, size_t length) { return 0; }
+
+void preference::getSpawnLocation(Location &location) {
+  location = Context::getInstance().getSpawnLocation();
+}
+
+// ---- GPS模块和记录 ----
+
+static FILE *logFile = nullptr;
+static bool powered = false;
+static int64_t readyUs = 0; // 模块开始输出语句的时间
+static int64_t powerOffUs = -1;
+static uint32_t toggles = 0;
+static int64_t disabledUs = -1; // 检测超时关闭GPS的时间
+
+static void onPinChange(uint8_t number, uint8_t value) {
+  if (number != GPS_EN_PIN) {
+    return;
+  }
+  int64_t now = host::now();
+  powered = value == LOW;
+  toggles++;
+  if (powered) {
+    bool hot = powerOffUs >= 0 &&
+               now - powerOffUs < (int64_t)GPS_HOT_START_WINDOW * 1000000;
+    int ttff = powerOffUs < 0 ? 0 : (hot ? SIM_HOT_TTFF_S : SIM_WARM_TTFF_S);
+    readyUs = now + (int64_t)ttff * 1000000;
+  } else {
+    powerOffUs = now;
+  }
+  if (logFile) {
+    fprintf(logFile, "%.3f,power,%s\n", now / 1e6, powered ? "on" : "off");
+  }
+}
+
+static void onTimer(const char *name, const char *event, int64_t us) {
+  bool fire = strcmp(event, "fire") == 0;
+  if (fire && strcmp(name, "gpsDisableTimer") == 0 &&
+      !Context::getInstance().getDetectGPS()) {
+    disabledUs = us;
+  }
+  if (logFile) {
+    fprintf(logFile, "%.3f,timer,%s,%s,%.3f\n", host::now() / 1e6, name,
+            event, fire ? 0 : us / 1e6);
+  }
+}
+
+static double percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[(size_t)(p * (values.size() - 1))];
+}
+
+struct Limits {
+  long minFixes = -1, maxFixes = -1, minCrc = -1, maxFormat = -1;
+  double maxOn = -1, maxErr = -1;
+  int detect = -1; // 1 应该检测到, 0 应该被关闭
+};
+
+static bool parseArguments(int argc, char **argv, const char *&track,
+                           double &distanceKm, double &tailS, Limits &limits) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "-v") == 0) {
+      host::logLevel = 3;
+      continue;
+    }
+    if (arg[0] != '-') {
+      track = arg;
+      continue;
+    }
+    if (!value) {
+      return false;
+    }
+    i++;
+    if (strcmp(arg, "-d") == 0) {
+      distanceKm = atof(value);
+    } else if (strcmp(arg, "-t") == 0) {
+      tailS = atof(value);
+    } else if (strcmp(arg, "-o") == 0) {
+      logFile = fopen(value, "w");
+      if (!logFile) {
+        fprintf(stderr, "%s: cannot write\n", value);
+        return false;
+      }
+    } else if (strcmp(arg, "--min-fixes") == 0) {
+      limits.minFixes = atol(value);
+    } else if (strcmp(arg, "--max-fixes") == 0) {
+      limits.maxFixes = atol(value);
+    } else if (strcmp(arg, "--max-on") == 0) {
+      limits.maxOn = atof(value);
+    } else if (strcmp(arg, "--max-err") == 0) {
+      limits.maxErr = atof(value);
+    } else if (strcmp(arg, "--min-crc") == 0) {
+      limits.minCrc = atol(value);
+    } else if (strcmp(arg, "--max-format") == 0) {
+      limits.maxFormat = atol(value);
+    } else if (strcmp(arg, "--detect") == 0) {
+      limits.detect = strcmp(value, "yes") == 0;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const char *track = nullptr;
+  double distanceKm = 20, tailS = 60;
+  Limits limits;
+  if (!parseArguments(argc, argv, track, distanceKm, tailS, limits)) {
+    fprintf(stderr,
+            "usage: %s [track.nmea] [-d km] [-t seconds] [-o log.csv] [-v]\n"
+            "  [--min-fixes N] [--max-fixes N] [--max-on percent]\n"
+            "  [--max-err meters] [--min-crc N] [--max-format N]\n"
+            "  [--detect yes|no]\n",
+            argv[0]);
+    return 1;
+  }
+  std::vector<host::Epoch> epochs;
+  if (track && !host::loadTrack(track, epochs)) {
+    fprintf(stderr, "%s: not found, simulating a compass without GPS\n",
+            track);
+  }
+
+  // 目标在第一个有效定位正东
+  Context &context = Context::getInstance();
+  for (const host::Epoch &epoch : epochs) {
+    if (epoch.fixed) {
+      context.setSpawnLocation(
+          {(float)epoch.latitude,
+           (float)(epoch.longitude +
+                   distanceKm /
+                       (EARTH_RADIUS * cos(epoch.latitude * PI / 180)) * 180 /
+                       PI)});
+      break;
+    }
+  }
+  if (logFile) {
+    fprintf(logFile, "time,event\n");
+  }
+
+  // 与 board::init 相同的顺序; 开机时GPS未上电, 首次上电是冷启动
+  context.setEventLoop((esp_event_loop_handle_t)&context);
+  digitalWrite(GPS_EN_PIN, HIGH);
+  host::onPinChange(onPinChange);
+  host::onTimer(onTimer);
+  gps::init(&context);
+
+  gps_fix_record_t last = {};
+  bool hadFix = false;
+  uint32_t fixes = 0, validFixes = 0;
+  nmea_parser_stats_t stats = {};
+  std::vector<double> errors;
+  int64_t endUs = (epochs.empty() ? 0 : epochs.back().timeUs) +
+                  (int64_t)(tailS * 1000000);
+  for (size_t i = 0; i <= epochs.size(); i++) {
+    const host::Epoch *epoch = i < epochs.size() ? &epochs[i] : nullptr;
+    host::advanceTo(epoch ? epoch->timeUs : endUs);
+    if (epoch && powered && host::now() >= readyUs) {
+      std::string bytes;
+      for (const std::string &line : epoch->lines) {
+        bytes += line;
+      }
+      host::uartWrite(UART_NUM_1, bytes.data(), bytes.size());
+    }
+    // 主循环处理定位事件
+    host::dispatchEvents();
+    gps::getParserStats(&stats); // 检测超时关闭GPS后保留最后一次的统计
+
+    gps_fix_record_t fix;
+    if (gps::getLatestFix(&fix) &&
+        (!hadFix || fix.timestamp_us != last.timestamp_us)) {
+      hadFix = true;
+      last = fix;
+      fixes++;
+      validFixes += fix.fix != GPS_FIX_INVALID;
+      if (logFile) {
+        position_filter::Estimate estimate = position_filter::getEstimate();
+        fprintf(logFile, "%.3f,fix,%u,%.7f,%.7f,%.7f,%.7f,%.1f\n",
+                host::now() / 1e6, fix.fix, fix.latitude_e7 / 1e7,
+                fix.longitude_e7 / 1e7, estimate.location.latitude,
+                estimate.location.longitude, estimate.sigma);
+      }
+    }
+    if (epoch && epoch->fixed && context.getIsGPSFixed()) {
+      Location known = context.getCurrentLocation();
+      errors.push_back(utils::complexDistance(epoch->latitude,
+                                              epoch->longitude, known.latitude,
+                                              known.longitude) *
+                       1000);
+    }
+  }
+  if (logFile) {
+    fclose(logFile);
+  }
+
+  gps_power::Stats power = gps_power::getStats();
+  double onPercent =
+      100.0 * power.onTimeMs / std::max<uint64_t>(power.uptimeMs, 1);
+  double mean = 0;
+  for (double error : errors) {
+    mean += error;
+  }
+  mean /= errors.empty() ? 1 : errors.size();
+  double p95 = percentile(errors, 0.95);
+  bool detected = context.getDetectGPS();
+
+  printf("track:  %s, %zu epochs, %.1f s + %.0f s, target %.0f km east\n",
+         track ? track : "(none)", epochs.size(),
+         epochs.empty() ? 0 : epochs.back().timeUs / 1e6, tailS, distanceKm);
+  printf("nmea:   %u bytes, %u lines, crc %u, format %u, overflow %u, "
+         "resync %u\n",
+         stats.bytes, stats.lines, stats.crc_errors, stats.format_errors,
+         stats.overflows, stats.resyncs);
+  printf("fixes:  %u records, %u valid\n", fixes, validFixes);
+  printf("power:  on %.1f%%, %u wakes, %u pin toggles, state %s\n", onPercent,
+         power.wakeCount, toggles, gps_power::stateToString(power.state));
+  if (detected) {
+    printf("gps:    detected\n");
+  } else if (disabledUs >= 0) {
+    printf("gps:    not detected, disabled at %.1f s\n", disabledUs / 1e6);
+  } else {
+    printf("gps:    not detected\n");
+  }
+  printf("error:  mean %.1f m, p95 %.1f m, max %.1f m over %zu epochs\n", mean,
+         p95, errors.empty() ? 0 : *std::max_element(errors.begin(),
+                                                      errors.end()),
+         errors.size());
+
+  int failures = 0;
+  auto check = [&](bool ok, const char *what) {
+    if (!ok) {
+      fprintf(stderr, "FAIL: %s\n", what);
+      failures++;
+    }
+  };
+  if (limits.minFixes >= 0) {
+    check(validFixes >= limits.minFixes, "too few valid fixes");
+  }
+  if (limits.maxFixes >= 0) {
+    check(validFixes <= limits.maxFixes, "too many valid fixes");
+  }
+  if (limits.maxOn >= 0) {
+    check(onPercent <= limits.maxOn, "GPS powered for too long");
+  }
+  if (limits.maxErr >= 0) {
+    check(!errors.empty() && p95 <= limits.maxErr, "position error too large");
+  }
+  if (limits.minCrc >= 0) {
+    check(stats.crc_errors >= limits.minCrc, "checksum errors not counted");
+  }
+  if (limits.maxFormat >= 0) {
+    check(stats.format_errors <= limits.maxFormat, "too many format errors");
+  }
+  if (limits.detect == 1) {
+    check(detected, "GPS not detected");
+  } else if (limits.detect == 0) {
+    check(!detected && disabledUs >= 0 && !powered,
+          "GPS not disabled after the detection timeout");
+  }
+  return failures ? 1 : 0;
+}
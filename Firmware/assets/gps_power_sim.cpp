@@ -0,0 +1,231 @@
+/*
+ * GPS电源管理的主机仿真: 上电时间和指引精度的取舍
+ *
+ * 用法:
+ *   python nmea_track.py walk > walk.nmea
+ *   python nmea_track.py drive > drive.nmea
+ *   gcc -c -O2 -I ../include ../src/impl/nmea_tokenizer.c -o nmea_tokenizer.o
+ *   g++ -std=gnu++17 -O2 -pthread -DCONFIG_IDF_TARGET_ESP32C3 -I host \
+ *       -I ../include gps_power_sim.cpp host/host.cpp host/track.cpp \
+ *       ../src/impl/gps_power_impl.cpp ../src/impl/utils_impl.cpp \
+ *       nmea_tokenizer.o -o gps_power_sim
+ *   ./gps_power_sim walk.nmea drive.nmea [-d 5,20,60,150] [-v]
+ *
+ * 固件中的 gps_power 原样编译(见 host/host.h), 仿真时钟按轨迹的UTC时间推进,
+ * 唤醒定时器在仿真时钟上到期, 整条轨迹瞬间跑完.
+ * GPS模块的模型:
+ *   - GPS_EN_PIN 为低电平时上电, 断电期间的语句丢弃
+ *   - 唤醒后经过定位时间才输出语句, 断电不超过 GPS_HOT_START_WINDOW 时按
+ *     SIM_HOT_TTFF_S 热启动, 否则按 SIM_WARM_TTFF_S 温启动; 首次上电的冷启动
+ *     由轨迹本身描述(见 nmea_track.py 的 cold 场景)
+ *   - 语句按解析任务的规则组成定位记录: GGA 结束一个历元, 之前收到过
+ *     RMC/VTG 时带地速和航向, 只有有效定位交给 gps_power::onFix
+ * 目标放在轨迹起点正东 d 公里处, 每个距离单独跑一遍(子进程, 状态互不影响).
+ * 轨迹中每个历元的定位作为真实位置, 与罗盘此刻所知的位置(最近一次交给
+ * gps_power 的定位)比较, 输出:
+ *   on      上电时间占比(耗电的近似)
+ *   wakes   唤醒次数
+ *   err     位置误差(米)的平均值/95分位/最大值
+ *   bearing 指向目标的方位误差(度)的平均值/最大值
+ */
+#include <Arduino.h>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "gps_power_def.h"
+#include "host/host.h"
+#include "host/track.h"
+#include "macro_def.h"
+#include "nmea_tokenizer.h"
+#include "utils.h"
+
+using namespace mcompass;
+
+#define SIM_HOT_TTFF_S 3
+#define SIM_WARM_TTFF_S 28
+
+static bool powered = false;
+static int64_t readyUs = 0;   // 模块开始输出语句的时间
+static int64_t powerOffUs = -1;
+
+static void onPinChange(uint8_t number, uint8_t value) {
+  if (number != GPS_EN_PIN) {
+    return;
+  }
+  int64_t now = host::now();
+  powered = value == LOW;
+  if (powered) {
+    bool hot = powerOffUs >= 0 &&
+               now - powerOffUs < (int64_t)GPS_HOT_START_WINDOW * 1000000;
+    int ttff = powerOffUs < 0 ? 0 : (hot ? SIM_HOT_TTFF_S : SIM_WARM_TTFF_S);
+    readyUs = now + (int64_t)ttff * 1000000;
+  } else {
+    powerOffUs = now;
+  }
+  if (host::logLevel >= 3) {
+    printf("  %8.1f s  power %s\n", now / 1e6, powered ? "on" : "off");
+  }
+}
+
+static double percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[(size_t)(p * (values.size() - 1))];
+}
+
+static double angleDifference(double a, double b) {
+  double delta = fabs(a - b);
+  return delta > 180 ? 360 - delta : delta;
+}
+
+/**
+ * @brief 以目标距离 distanceKm 跑一遍轨迹, 打印一行结果
+ */
+static void simulate(const char *name, const std::vector<host::Epoch> &epochs,
+                     double distanceKm) {
+  // 目标在起点正东
+  const host::Epoch *start = &epochs[0];
+  for (const host::Epoch &epoch : epochs) {
+    if (epoch.fixed) {
+      start = &epoch;
+      break;
+    }
+  }
+  Location target = {
+      (float)start->latitude,
+      (float)(start->longitude +
+              distanceKm / (EARTH_RADIUS * cos(start->latitude * PI / 180)) *
+                  180 / PI)};
+
+  // 开机时GPS未上电, 首次上电是冷启动
+  digitalWrite(GPS_EN_PIN, HIGH);
+  host::onPinChange(onPinChange);
+  gps_power::init();
+
+  nmea_tokenizer_t tokenizer;
+  nmea_tokenizer_init(&tokenizer);
+  bool known = false;
+  double knownLatitude = 0, knownLongitude = 0;
+  std::vector<double> errors, bearingErrors;
+  for (const host::Epoch &epoch : epochs) {
+    host::advanceTo(epoch.timeUs);
+    if (powered && host::now() >= readyUs) {
+      for (const std::string &line : epoch.lines) {
+        if (nmea_tokenizer_parse(&tokenizer, line.c_str(), line.size(),
+                                 NULL) != NMEA_OK ||
+            !(tokenizer.updated & (1 << NMEA_SENTENCE_GGA))) {
+          continue;
+        }
+        // 与解析任务相同: GGA 结束一个历元
+        uint32_t updated = tokenizer.updated;
+        tokenizer.updated = 0;
+        const nmea_data_t &data = tokenizer.data;
+        gps_fix_record_t fix = {};
+        fix.latitude_e7 = data.latitude_e7;
+        fix.longitude_e7 = data.longitude_e7;
+        fix.speed_mmps = data.speed_mmps;
+        fix.course_x100 = data.course_x100;
+        fix.hdop_x100 = data.hdop_x100;
+        fix.fix = data.fix;
+        fix.sats_in_use = data.sats_in_use;
+        fix.has_velocity = (updated & ((1 << NMEA_SENTENCE_RMC) |
+                                       (1 << NMEA_SENTENCE_VTG))) != 0;
+        fix.utc_ms = data.time_ms;
+        fix.timestamp_us = host::now();
+        if (fix.fix == GPS_FIX_INVALID) {
+          continue;
+        }
+        known = true;
+        knownLatitude = fix.latitude_e7 / 1e7;
+        knownLongitude = fix.longitude_e7 / 1e7;
+        gps_power::onFix(fix, target);
+      }
+    }
+    if (!epoch.fixed || !known) {
+      continue;
+    }
+    errors.push_back(utils::complexDistance(epoch.latitude, epoch.longitude,
+                                            knownLatitude, knownLongitude) *
+                     1000);
+    bearingErrors.push_back(angleDifference(
+        utils::calculateBearing(epoch.latitude, epoch.longitude,
+                                target.latitude, target.longitude),
+        utils::calculateBearing(knownLatitude, knownLongitude,
+                                target.latitude, target.longitude)));
+  }
+
+  gps_power::Stats stats = gps_power::getStats();
+  double mean = 0, bearingMean = 0;
+  for (double error : errors) {
+    mean += error;
+  }
+  for (double error : bearingErrors) {
+    bearingMean += error;
+  }
+  size_t samples = errors.empty() ? 1 : errors.size();
+  printf("%-12s %7.0f %6.1f%% %6u %8.1f %8.1f %8.1f %8.2f %8.2f\n", name,
+         distanceKm, 100.0 * stats.onTimeMs / std::max<uint64_t>(stats.uptimeMs, 1),
+         stats.wakeCount, mean / samples, percentile(errors, 0.95),
+         errors.empty() ? 0 : *std::max_element(errors.begin(), errors.end()),
+         bearingMean / samples,
+         bearingErrors.empty()
+             ? 0
+             : *std::max_element(bearingErrors.begin(), bearingErrors.end()));
+}
+
+int main(int argc, char **argv) {
+  std::vector<double> distances = {5, 20, 60, 150};
+  std::vector<const char *> tracks;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      distances.clear();
+      for (char *p = strtok(argv[++i], ","); p; p = strtok(NULL, ",")) {
+        distances.push_back(atof(p));
+      }
+    } else if (strcmp(argv[i], "-v") == 0) {
+      host::logLevel = 3;
+    } else {
+      tracks.push_back(argv[i]);
+    }
+  }
+  if (tracks.empty()) {
+    fprintf(stderr, "usage: %s track.nmea... [-d km,km...] [-v]\n", argv[0]);
+    return 1;
+  }
+  printf("%-12s %7s %7s %6s %8s %8s %8s %8s %8s\n", "track", "km", "on",
+         "wakes", "err", "err95", "errmax", "bearing", "bmax");
+  for (const char *path : tracks) {
+    std::vector<host::Epoch> epochs;
+    if (!host::loadTrack(path, epochs) || epochs.empty()) {
+      fprintf(stderr, "%s: cannot read track\n", path);
+      return 1;
+    }
+    const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    for (double distance : distances) {
+      // gps_power 的状态是静态的, 每个距离在子进程中从头开始
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid == 0) {
+        simulate(name, epochs, distance);
+        fflush(stdout);
+        _exit(0);
+      }
+      int status = 0;
+      waitpid(pid, &status, 0);
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s at %.0f km failed\n", name, distance);
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
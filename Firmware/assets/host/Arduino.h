@@ -0,0 +1,34 @@
+#pragma once
+// 主机仿真用的 Arduino.h, 只有固件中与硬件无关的模块用到的部分, 见 host.h
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define HIGH 0x1
+#define LOW 0x0
+
+/// @brief 只用于编译接口中的 String 参数, 没有 WString 的其余方法
+class String : public std::string {
+public:
+  using std::string::string;
+};
+
+void digitalWrite(uint8_t pin, uint8_t value);
+unsigned long millis();
+void delay(uint32_t ms);
+long random(long low, long high);
+
+using std::max;
+using std::min;
@@ -0,0 +1,75 @@
+#pragma once
+// 主机仿真用的 FastLED.h, 只有 pixels_impl 用到的部分, show() 只计数
+#include <stdint.h>
+
+#include "Arduino.h"
+
+struct CRGB {
+  enum HTMLColorCode : uint32_t {
+    Red = 0xFF0000,
+    Green = 0x008000,
+    Blue = 0x0000FF,
+  };
+
+  uint8_t r, g, b;
+
+  CRGB() : r(0), g(0), b(0) {}
+  CRGB(uint32_t color) : r(color >> 16), g(color >> 8), b(color) {}
+
+  CRGB &fadeToBlackBy(uint8_t amount) {
+    r = r * (255 - amount) / 255;
+    g = g * (255 - amount) / 255;
+    b = b * (255 - amount) / 255;
+    return *this;
+  }
+
+  uint32_t value() const { return (uint32_t)r << 16 | g << 8 | b; }
+};
+
+template <uint8_t PIN> class NEOPIXEL {};
+
+class CFastLED {
+public:
+  template <template <uint8_t> class CHIPSET, uint8_t PIN>
+  void addLeds(CRGB *leds, int count) {
+    m_leds = leds;
+    m_count = count;
+  }
+  void setBrightness(uint8_t brightness) { m_brightness = brightness; }
+  void show() { m_shows++; }
+  void clear() {
+    for (int i = 0; i < m_count; i++) {
+      m_leds[i] = CRGB();
+    }
+  }
+
+  /// addLeds 注册的 LED 数组, 之前为 nullptr
+  const CRGB *leds() const { return m_leds; }
+  int count() const { return m_count; }
+  uint32_t shows() const { return m_shows; }
+
+private:
+  CRGB *m_leds = nullptr;
+  int m_count = 0;
+  uint8_t m_brightness = 255;
+  uint32_t m_shows = 0;
+};
+
+extern CFastLED FastLED;
+
+inline void fill_solid(CRGB *leds, int count, const CRGB &color) {
+  for (int i = 0; i < count; i++) {
+    leds[i] = color;
+  }
+}
+
+inline void fadeToBlackBy(CRGB *leds, int count, uint8_t amount) {
+  for (int i = 0; i < count; i++) {
+    leds[i].fadeToBlackBy(amount);
+  }
+}
+
+inline uint8_t beatsin8(uint8_t bpm, uint8_t low, uint8_t high) {
+  double phase = millis() * bpm / 60000.0;
+  return low + (high - low) * (sin(phase * 2 * PI) + 1) / 2;
+}
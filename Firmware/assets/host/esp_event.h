@@ -0,0 +1,36 @@
+#pragma once
+// 主机仿真用的 esp_event.h, 投递的事件在 host::dispatchEvents 中处理, 见 host.h
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef const char *esp_event_base_t;
+typedef void *esp_event_loop_handle_t;
+typedef void (*esp_event_handler_t)(void *handler_arg, esp_event_base_t base,
+                                    int32_t id, void *event_data);
+
+#define ESP_EVENT_DECLARE_BASE(id) extern esp_event_base_t const id
+#define ESP_EVENT_DEFINE_BASE(id) esp_event_base_t const id = #id
+#define ESP_EVENT_ANY_ID -1
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t loop,
+                            esp_event_base_t base, int32_t id,
+                            const void *data, size_t size,
+                            TickType_t ticks);
+esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t loop,
+                                          esp_event_base_t base, int32_t id,
+                                          esp_event_handler_t handler,
+                                          void *handler_arg);
+esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t loop,
+                                            esp_event_base_t base, int32_t id,
+                                            esp_event_handler_t handler);
+
+#ifdef __cplusplus
+}
+#endif
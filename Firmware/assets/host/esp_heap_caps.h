@@ -0,0 +1,19 @@
+#pragma once
+// 主机仿真用的 esp_heap_caps.h, 直接转给 malloc, 只用于编译 alloc_tracker
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+// 主机仿真用的 esp_log.h, 按 host::logLevel 过滤后输出到 stderr
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void host_log(int level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#define ESP_LOGE(tag, format, ...) host_log(1, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) host_log(2, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) host_log(3, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) host_log(4, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) host_log(5, tag, format, ##__VA_ARGS__)
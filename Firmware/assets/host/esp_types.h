@@ -0,0 +1,5 @@
+#pragma once
+// 主机仿真用的 esp_types.h
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
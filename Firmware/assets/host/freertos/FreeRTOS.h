@@ -0,0 +1,21 @@
+#pragma once
+// 主机仿真用的 FreeRTOS.h, 临界区为空操作, 见 host.h
+#include <stdint.h>
+
+typedef int portMUX_TYPE;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configMAX_TASK_NAME_LEN 16
+
+// 主机上没有中断
+static inline BaseType_t xPortInIsrContext(void) { return pdFALSE; }
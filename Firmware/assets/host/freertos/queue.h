@@ -0,0 +1,15 @@
+#pragma once
+// 主机仿真用的 queue.h, 只有串口驱动的事件队列用到的部分
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_queue *QueueHandle_t;
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
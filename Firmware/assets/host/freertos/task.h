@@ -0,0 +1,22 @@
+#pragma once
+// 主机仿真用的 task.h, 每个任务是一个线程, 见 host.h
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name,
+                       uint32_t stack, void *arg, UBaseType_t priority,
+                       TaskHandle_t *out_handle);
+void vTaskDelete(TaskHandle_t task);
+// 主线程也有一个任务句柄, 名称为 "main"
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char *pcTaskGetName(TaskHandle_t task);
+
+#ifdef __cplusplus
+}
+#endif
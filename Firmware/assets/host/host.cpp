@@ -0,0 +1,464 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "Arduino.h"
+#include "FastLED.h"
+#include "driver/uart.h"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "freertos/task.h"
+#include "host.h"
+#include "soc/usb_serial_jtag_reg.h"
+
+int host::logLevel = 2;
+uint32_t host_usb_frame_number = 0;
+
+static int64_t clockUs = 0;
+static uint8_t pins[64];
+static void (*pinCallback)(uint8_t, uint8_t) = nullptr;
+static void (*timerCallback)(const char *, const char *, int64_t) = nullptr;
+
+struct esp_timer {
+  esp_timer_create_args_t args;
+  int64_t deadline;
+  uint64_t period; // 0 表示单次定时器
+  bool active;
+};
+
+static std::vector<esp_timer *> timers;
+
+void host::advanceTo(int64_t us) {
+  while (true) {
+    // 找出最早到期的定时器, 回调中可能重新启动或删除定时器
+    esp_timer *next = nullptr;
+    for (esp_timer *timer : timers) {
+      if (timer->active && timer->deadline <= us &&
+          (!next || timer->deadline < next->deadline)) {
+        next = timer;
+      }
+    }
+    if (!next) {
+      break;
+    }
+    if (next->deadline > clockUs) {
+      clockUs = next->deadline;
+    }
+    if (next->period) {
+      next->deadline += next->period;
+    } else {
+      next->active = false;
+    }
+    if (timerCallback) {
+      timerCallback(next->args.name, "fire", clockUs);
+    }
+    next->args.callback(next->args.arg);
+  }
+  if (us > clockUs) {
+    clockUs = us;
+  }
+}
+
+int64_t host::now() { return clockUs; }
+
+uint8_t host::pin(uint8_t number) { return pins[number % 64]; }
+
+void host::onPinChange(void (*callback)(uint8_t, uint8_t)) {
+  pinCallback = callback;
+}
+
+void host::onTimer(void (*callback)(const char *, const char *, int64_t)) {
+  timerCallback = callback;
+}
+
+void host_log(int level, const char *tag, const char *format, ...) {
+  static const char LEVELS[] = "?EWIDV";
+  if (level > host::logLevel) {
+    return;
+  }
+  fprintf(stderr, "%c (%lld) %s: ", LEVELS[level], (long long)(clockUs / 1000),
+          tag);
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pins[pin % 64] != value && pinCallback) {
+    pinCallback(pin, value);
+  }
+  pins[pin % 64] = value;
+}
+
+unsigned long millis() { return (unsigned long)(clockUs / 1000); }
+
+void delay(uint32_t ms) { host::advanceTo(clockUs + (int64_t)ms * 1000); }
+
+long random(long low, long high) {
+  return high > low ? low + rand() % (high - low) : low;
+}
+
+CFastLED FastLED;
+
+int64_t esp_timer_get_time() { return clockUs; }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args,
+                           esp_timer_handle_t *out_handle) {
+  esp_timer *timer = new esp_timer{*args, 0, 0, false};
+  timers.push_back(timer);
+  *out_handle = timer;
+  return ESP_OK;
+}
+
+static esp_err_t start(esp_timer_handle_t timer, uint64_t us, uint64_t period) {
+  if (timer->active) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->deadline = clockUs + (int64_t)us;
+  timer->period = period;
+  timer->active = true;
+  if (timerCallback) {
+    timerCallback(timer->args.name, "start", (int64_t)us);
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  return start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+  return start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer->active) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->active = false;
+  if (timerCallback) {
+    timerCallback(timer->args.name, "stop", 0);
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  for (size_t i = 0; i < timers.size(); i++) {
+    if (timers[i] == timer) {
+      timers.erase(timers.begin() + i);
+      break;
+    }
+  }
+  delete timer;
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) { return timer->active; }
+
+// ---- 堆 ----
+// 固件本身不直接调用 heap_caps_*, 这里只是让 alloc_tracker 的包装函数能链接
+
+void *heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+  return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps) {
+  return realloc(ptr, size);
+}
+
+// ---- FreeRTOS 任务和队列 ----
+// 任务是独立的线程, 但只在主线程等待它处理完队列时运行, 见 host::uartWrite
+
+// 不析构: 进程退出时被删除的任务还睡眠在上面
+static std::mutex &rtosMutex = *new std::mutex;
+static std::condition_variable &rtosChanged = *new std::condition_variable;
+
+struct host_task {
+  TaskFunction_t function;
+  void *arg;
+  bool deleted;
+  char name[configMAX_TASK_NAME_LEN];
+};
+
+struct host_queue {
+  std::deque<uart_event_t> items;
+  size_t capacity;
+  int waiting; // 阻塞在 xQueueReceive 中的任务数
+};
+
+static thread_local host_task *currentTask = nullptr;
+static host_task mainTask = {nullptr, nullptr, false, "main"};
+
+static void *taskEntry(void *arg) {
+  currentTask = static_cast<host_task *>(arg);
+  currentTask->function(currentTask->arg);
+  return nullptr;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name,
+                       uint32_t stack, void *arg, UBaseType_t priority,
+                       TaskHandle_t *out_handle) {
+  host_task *task = new host_task{function, arg, false, {}};
+  strncpy(task->name, name, sizeof(task->name) - 1);
+  pthread_t thread;
+  if (pthread_create(&thread, nullptr, taskEntry, task) != 0) {
+    delete task;
+    return pdFALSE;
+  }
+  pthread_detach(thread);
+  if (out_handle) {
+    *out_handle = task;
+  }
+  return pdTRUE;
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+  host_task *task = handle ? static_cast<host_task *>(handle) : currentTask;
+  std::unique_lock<std::mutex> lock(rtosMutex);
+  task->deleted = true;
+  rtosChanged.notify_all();
+  if (task == currentTask) {
+    // 被删除的任务不再运行, 线程一直睡眠到进程退出
+    rtosChanged.wait(lock, [] { return false; });
+  }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return currentTask ? currentTask : &mainTask;
+}
+
+char *pcTaskGetName(TaskHandle_t handle) {
+  host_task *task = static_cast<host_task *>(
+      handle ? handle : xTaskGetCurrentTaskHandle());
+  return task->name;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(rtosMutex);
+  queue->waiting++;
+  rtosChanged.notify_all();
+  // 主机上只支持一直等待
+  rtosChanged.wait(lock, [&] {
+    return !queue->items.empty() || (currentTask && currentTask->deleted);
+  });
+  queue->waiting--;
+  if (currentTask && currentTask->deleted) {
+    rtosChanged.wait(lock, [] { return false; });
+  }
+  memcpy(item, &queue->items.front(), sizeof(uart_event_t));
+  queue->items.pop_front();
+  return pdTRUE;
+}
+
+// ---- 串口驱动 ----
+
+struct HostUart {
+  QueueHandle_t queue;
+  std::deque<uint8_t> ring;
+  size_t capacity;
+};
+
+static HostUart *uarts[UART_NUM_MAX];
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_buffer_size,
+                              int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags) {
+  std::lock_guard<std::mutex> lock(rtosMutex);
+  if (port < 0 || port >= UART_NUM_MAX || uarts[port]) {
+    return ESP_FAIL;
+  }
+  HostUart *uart = new HostUart{new host_queue{{}, (size_t)queue_size, 0}, {},
+                                (size_t)rx_buffer_size};
+  uarts[port] = uart;
+  *uart_queue = uart->queue;
+  return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t port) {
+  std::lock_guard<std::mutex> lock(rtosMutex);
+  if (port < 0 || port >= UART_NUM_MAX || !uarts[port]) {
+    return ESP_FAIL;
+  }
+  // 队列和被删除的任务一起泄漏, 睡眠中的线程可能还持有它
+  delete uarts[port];
+  uarts[port] = nullptr;
+  rtosChanged.notify_all();
+  return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config) {
+  return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts) {
+  return ESP_OK;
+}
+
+esp_err_t uart_flush(uart_port_t port) {
+  std::lock_guard<std::mutex> lock(rtosMutex);
+  if (uarts[port]) {
+    uarts[port]->ring.clear();
+  }
+  return ESP_OK;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t port, size_t *size) {
+  std::lock_guard<std::mutex> lock(rtosMutex);
+  *size = uarts[port] ? uarts[port]->ring.size() : 0;
+  return ESP_OK;
+}
+
+int uart_read_bytes(uart_port_t port, void *buf, uint32_t length,
+                    TickType_t ticks) {
+  std::lock_guard<std::mutex> lock(rtosMutex);
+  HostUart *uart = uarts[port];
+  if (!uart) {
+    return -1;
+  }
+  size_t count = length < uart->ring.size() ? length : uart->ring.size();
+  std::copy(uart->ring.begin(), uart->ring.begin() + count, (uint8_t *)buf);
+  uart->ring.erase(uart->ring.begin(), uart->ring.begin() + count);
+  return (int)count;
+}
+
+/**
+ * @brief 等待读取队列的任务处理完所有事件, 或者驱动被删除
+ */
+static void waitIdle(std::unique_lock<std::mutex> &lock, int port,
+                     HostUart *uart) {
+  QueueHandle_t queue = uart->queue;
+  rtosChanged.wait(lock, [&] {
+    return uarts[port] != uart ||
+           (queue->items.empty() && queue->waiting > 0);
+  });
+}
+
+bool host::uartWrite(int port, const char *data, size_t length) {
+  std::unique_lock<std::mutex> lock(rtosMutex);
+  HostUart *uart = port >= 0 && port < UART_NUM_MAX ? uarts[port] : nullptr;
+  if (!uart) {
+    return false;
+  }
+  for (size_t offset = 0; offset < length; offset += HOST_UART_CHUNK) {
+    size_t chunk = length - offset < HOST_UART_CHUNK ? length - offset
+                                                      : HOST_UART_CHUNK;
+    uart_event_t event = {UART_DATA, chunk, false};
+    if (uart->ring.size() + chunk > uart->capacity) {
+      // 与驱动相同: 缓冲区满时丢弃这次收到的数据
+      event.type = UART_BUFFER_FULL;
+    } else {
+      uart->ring.insert(uart->ring.end(), data + offset, data + offset + chunk);
+    }
+    if (uart->queue->items.size() < uart->queue->capacity) {
+      uart->queue->items.push_back(event);
+      rtosChanged.notify_all();
+    }
+    waitIdle(lock, port, uart);
+    if (uarts[port] != uart) {
+      return false; // 处理过程中驱动被删除
+    }
+  }
+  return true;
+}
+
+// ---- 事件循环 ----
+
+struct Handler {
+  esp_event_loop_handle_t loop;
+  esp_event_base_t base;
+  int32_t id;
+  esp_event_handler_t function;
+  void *arg;
+};
+
+// 与 esp_event 相同: 事件按值放进固定长度的队列, 只有携带的数据才在堆上
+// 拷贝一份, 所以不带数据的投递不产生堆分配(alloc_cycle_test 依赖这一点)
+struct PostedEvent {
+  esp_event_loop_handle_t loop;
+  esp_event_base_t base;
+  int32_t id;
+  void *data;
+};
+
+static std::vector<Handler> handlers;
+static PostedEvent postedEvents[HOST_EVENT_QUEUE];
+static size_t postedHead = 0, postedCount = 0;
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t loop,
+                            esp_event_base_t base, int32_t id,
+                            const void *data, size_t size, TickType_t ticks) {
+  std::lock_guard<std::mutex> lock(rtosMutex);
+  if (postedCount == HOST_EVENT_QUEUE) {
+    return ESP_ERR_TIMEOUT;
+  }
+  PostedEvent &event =
+      postedEvents[(postedHead + postedCount) % HOST_EVENT_QUEUE];
+  event = {loop, base, id, nullptr};
+  if (data && size) {
+    event.data = malloc(size);
+    memcpy(event.data, data, size);
+  }
+  postedCount++;
+  return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t loop,
+                                          esp_event_base_t base, int32_t id,
+                                          esp_event_handler_t handler,
+                                          void *handler_arg) {
+  handlers.push_back({loop, base, id, handler, handler_arg});
+  return ESP_OK;
+}
+
+esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t loop,
+                                            esp_event_base_t base, int32_t id,
+                                            esp_event_handler_t handler) {
+  for (size_t i = 0; i < handlers.size(); i++) {
+    if (handlers[i].loop == loop && handlers[i].base == base &&
+        handlers[i].id == id && handlers[i].function == handler) {
+      handlers.erase(handlers.begin() + i);
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+int host::dispatchEvents() {
+  int count = 0;
+  while (true) {
+    PostedEvent event;
+    {
+      std::lock_guard<std::mutex> lock(rtosMutex);
+      if (postedCount == 0) {
+        return count;
+      }
+      event = postedEvents[postedHead];
+      postedHead = (postedHead + 1) % HOST_EVENT_QUEUE;
+      postedCount--;
+    }
+    count++;
+    // 处理函数中可能注销自己, 先拷贝一份
+    Handler matched[HOST_EVENT_HANDLERS];
+    size_t matchedCount = 0;
+    for (const Handler &handler : handlers) {
+      if (handler.loop == event.loop && handler.base == event.base &&
+          (handler.id == ESP_EVENT_ANY_ID || handler.id == event.id) &&
+          matchedCount < HOST_EVENT_HANDLERS) {
+        matched[matchedCount++] = handler;
+      }
+    }
+    for (size_t i = 0; i < matchedCount; i++) {
+      matched[i].function(matched[i].arg, event.base, event.id, event.data);
+    }
+    free(event.data);
+  }
+}
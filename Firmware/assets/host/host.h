@@ -0,0 +1,88 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 主机仿真环境
+ *
+ * 本目录中的头文件代替 Arduino 和 ESP-IDF 中固件用到的那一小部分接口,
+ * 让 src/impl 中与硬件无关的模块在主机上原样编译. 编译时把本目录放在
+ * include 路径的最前面, 并定义 CONFIG_IDF_TARGET_ESP32C3:
+ *   g++ -std=gnu++17 -pthread -DCONFIG_IDF_TARGET_ESP32C3 -I host \
+ *       -I ../include ...
+ *
+ * 时间是虚拟的: esp_timer_get_time() 和 millis() 返回仿真时钟, 只有调用
+ * advanceTo() 时才前进, 到期的 esp_timer 按时间顺序在其中同步触发.
+ * 临界区和互斥锁是空操作: FreeRTOS 任务虽然是独立的线程, 但只在主线程调用
+ * uartWrite() 等它处理数据时运行, 两边不会同时访问固件的数据.
+ * 投递到事件循环的事件在主线程调用 dispatchEvents() 时处理, 相当于固件中
+ * 主循环处理事件队列.
+ */
+namespace host {
+
+/**
+ * @brief 把仿真时钟推进到 us, 依次触发其间到期的定时器
+ */
+void advanceTo(int64_t us);
+
+/**
+ * @brief 仿真时钟(微秒)
+ */
+int64_t now();
+
+/**
+ * @brief 最近一次 digitalWrite 写入的电平
+ */
+uint8_t pin(uint8_t number);
+
+/**
+ * @brief 记录引脚电平变化, 可以为 nullptr
+ */
+void onPinChange(void (*callback)(uint8_t number, uint8_t value));
+
+/**
+ * @brief 记录定时器启动和触发, 可以为 nullptr
+ *
+ * @param name 定时器名称
+ * @param event "start", "stop" 或 "fire"
+ * @param us 启动时为定时时长, 触发时为当前时间
+ */
+void onTimer(void (*callback)(const char *name, const char *event, int64_t us));
+
+/**
+ * @brief uartWrite 每次交给驱动的字节数, 相当于接收 FIFO 的超时中断
+ */
+#define HOST_UART_CHUNK 120
+
+/**
+ * @brief 模拟串口收到数据
+ *
+ * 数据按 HOST_UART_CHUNK 分段写入驱动的接收缓冲区, 每段向事件队列投递
+ * UART_DATA, 并等待读取队列的任务处理完. 缓冲区放不下时丢弃这一段并投递
+ * UART_BUFFER_FULL, 与驱动的行为相同.
+ *
+ * @return 驱动未安装(或处理过程中被删除)时返回 false
+ */
+bool uartWrite(int port, const char *data, size_t length);
+
+/**
+ * @brief 事件队列长度(与固件的 queue_size 相同)和同一事件的处理函数上限
+ */
+#define HOST_EVENT_QUEUE 128
+#define HOST_EVENT_HANDLERS 16
+
+/**
+ * @brief 依次处理 esp_event_post_to 投递的事件, 返回处理的事件数
+ *
+ * 队列满时 esp_event_post_to 返回 ESP_ERR_TIMEOUT, 与 ticks 为0时的固件相同
+ */
+int dispatchEvents();
+
+/**
+ * @brief ESP_LOGx 的输出级别, 默认只输出警告和错误
+ *
+ * 0 不输出, 1 错误, 2 警告, 3 信息, 4 调试, 5 详细
+ */
+extern int logLevel;
+
+} // namespace host
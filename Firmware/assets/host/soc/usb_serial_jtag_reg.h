@@ -0,0 +1,6 @@
+#pragma once
+// 主机仿真用的寄存器定义, USB帧计数寄存器指向一个不变的变量
+#include <stdint.h>
+
+extern uint32_t host_usb_frame_number;
+#define USB_SERIAL_JTAG_FRAM_NUM_REG (&host_usb_frame_number)
@@ -0,0 +1,78 @@
+#include "track.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nmea_tokenizer.h"
+
+/**
+ * @brief 读取GGA/RMC语句中的UTC时间
+ *
+ * @return 当天的毫秒数, 其他语句返回-1
+ */
+static int32_t sentenceTime(const char *line) {
+  const char *dollar = strchr(line, '$');
+  if (!dollar || strlen(dollar) < 14 ||
+      (strncmp(dollar + 3, "GGA,", 4) != 0 &&
+       strncmp(dollar + 3, "RMC,", 4) != 0)) {
+    return -1;
+  }
+  const char *p = dollar + 7;
+  for (int i = 0; i < 6; i++) {
+    if (p[i] < '0' || p[i] > '9') {
+      return -1;
+    }
+  }
+  int32_t ms = ((p[0] - '0') * 10 + (p[1] - '0')) * 3600000 +
+               ((p[2] - '0') * 10 + (p[3] - '0')) * 60000 +
+               ((p[4] - '0') * 10 + (p[5] - '0')) * 1000;
+  if (p[6] == '.') {
+    int32_t scale = 100;
+    for (const char *q = p + 7; *q >= '0' && *q <= '9' && scale > 0; q++) {
+      ms += (*q - '0') * scale;
+      scale /= 10;
+    }
+  }
+  return ms;
+}
+
+bool host::loadTrack(const char *path, std::vector<Epoch> &epochs) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    return false;
+  }
+  nmea_tokenizer_t truth;
+  nmea_tokenizer_init(&truth);
+  char line[256];
+  int32_t firstMs = -1, lastMs = -1;
+  int64_t dayOffsetUs = 0;
+  while (fgets(line, sizeof(line), file)) {
+    int32_t ms = sentenceTime(line);
+    if (ms >= 0 && ms != lastMs) {
+      if (firstMs < 0) {
+        firstMs = ms;
+      } else if (ms < lastMs) {
+        dayOffsetUs += 24LL * 3600 * 1000000; // 跨过UTC零点
+      }
+      lastMs = ms;
+      Epoch epoch = {dayOffsetUs + (int64_t)(ms - firstMs) * 1000, {}, false,
+                     0, 0};
+      epochs.push_back(epoch);
+    }
+    if (epochs.empty()) {
+      continue;
+    }
+    Epoch &epoch = epochs.back();
+    epoch.lines.push_back(line);
+    nmea_sentence_t sentence;
+    if (nmea_tokenizer_parse(&truth, line, strlen(line), &sentence) ==
+            NMEA_OK &&
+        sentence == NMEA_SENTENCE_GGA) {
+      epoch.fixed = truth.data.fix != 0;
+      epoch.latitude = truth.data.latitude_e7 / 1e7;
+      epoch.longitude = truth.data.longitude_e7 / 1e7;
+    }
+  }
+  fclose(file);
+  return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * NMEA 轨迹文件, 供主机上的GPS仿真使用
+ *
+ * 轨迹按GGA/RMC语句中的UTC时间切成历元, 跨过UTC零点时时间继续递增.
+ * 第一条带时间的语句之前的内容丢弃.
+ */
+namespace host {
+
+/// @brief 轨迹中的一个历元: 同一UTC时间的语句
+struct Epoch {
+  int64_t timeUs;                 // 相对轨迹开始的时间
+  std::vector<std::string> lines; // 原始语句, 含行尾
+  bool fixed;                     // 是否有有效定位
+  double latitude, longitude;     // 有效定位时的坐标, 作为真实位置
+};
+
+/**
+ * @brief 读取轨迹文件
+ *
+ * @return 文件不存在时返回 false, 空文件返回 true 且 epochs 为空
+ */
+bool loadTrack(const char *path, std::vector<Epoch> &epochs);
+
+} // namespace host
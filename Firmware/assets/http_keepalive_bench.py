@@ -0,0 +1,112 @@
+"""HTTP 长连接和流水线请求吞吐量
+
+用法: python http_keepalive_bench.py [--host esp32.local] [--path /brightness] [--requests 200] [--depth 4]
+
+依次测量三种方式连续请求同一个接口的每秒请求数:
+  close      每个请求新建连接并带 Connection: close
+  reuse      所有请求复用一个 HTTP/1.1 连接
+  pipelined  复用一个连接, 每次连续发出 depth 个请求后再依次读取响应
+每种方式前后读取 /httpStats, 打印设备统计的连接数和复用次数的变化.
+流水线一次发出的请求超过 WEBSERVER_PIPELINE_BUFFER(默认2048字节)时, 设备
+回 503 并关闭连接, 计入 overflows, 测量时 depth 要小于这个限制.
+只依赖标准库.
+"""
+import argparse
+import http.client
+import json
+import socket
+import time
+
+
+def stats(host):
+    conn = http.client.HTTPConnection(host, 80, timeout=5)
+    conn.request("GET", "/httpStats", headers={"Connection": "close"})
+    data = json.loads(conn.getresponse().read())
+    conn.close()
+    return data
+
+
+def run_close(host, path, count):
+    for _ in range(count):
+        conn = http.client.HTTPConnection(host, 80, timeout=5)
+        conn.request("GET", path, headers={"Connection": "close"})
+        conn.getresponse().read()
+        conn.close()
+
+
+def run_reuse(host, path, count):
+    conn = http.client.HTTPConnection(host, 80, timeout=5)
+    for _ in range(count):
+        conn.request("GET", path)
+        conn.getresponse().read()
+    conn.close()
+
+
+def read_response(stream):
+    """读取一个带 Content-Length 的响应, 返回状态码"""
+    status = stream.readline()
+    if not status:
+        raise ConnectionError("connection closed")
+    length = 0
+    while True:
+        line = stream.readline().strip()
+        if not line:
+            break
+        name, _, value = line.partition(b":")
+        if name.strip().lower() == b"content-length":
+            length = int(value)
+    stream.read(length)
+    return int(status.split()[1])
+
+
+def run_pipelined(host, path, count, depth):
+    request = ("GET %s HTTP/1.1\r\nHost: %s\r\n\r\n" % (path, host)).encode()
+    sock = socket.create_connection((host, 80), timeout=5)
+    stream = sock.makefile("rb")
+    sent = 0
+    while sent < count:
+        batch = min(depth, count - sent)
+        sock.sendall(request * batch)
+        for _ in range(batch):
+            read_response(stream)
+        sent += batch
+    stream.close()
+    sock.close()
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--host", default="esp32.local")
+    parser.add_argument("--path", default="/brightness")
+    parser.add_argument("--requests", type=int, default=200)
+    parser.add_argument("--depth", type=int, default=4)
+    args = parser.parse_args()
+
+    modes = [
+        ("close", lambda: run_close(args.host, args.path, args.requests)),
+        ("reuse", lambda: run_reuse(args.host, args.path, args.requests)),
+        ("pipelined", lambda: run_pipelined(args.host, args.path,
+                                            args.requests, args.depth)),
+    ]
+    for name, run in modes:
+        before = stats(args.host)
+        start = time.perf_counter()
+        run()
+        elapsed = time.perf_counter() - start
+        after = stats(args.host)
+        # 两次读取 /httpStats 本身各占一个连接和请求
+        delta = {key: after[key] - before[key] for key in after
+                 if isinstance(after[key], int)}
+        print("%-9s %6.1f req/s  connections %d, reused %d, pipelined %d, "
+              "overflows %d" % (
+                  name, args.requests / elapsed, delta["connections"] - 1,
+                  delta["reused"], delta["pipelined"],
+                  delta.get("pipelineOverflows", 0)))
+    pool = stats(args.host).get("eventPool")
+    if pool:
+        print("event pool %d, high water %d, overflows %d" % (
+            pool["size"], pool["highWater"], pool["overflows"]))
+
+
+if __name__ == "__main__":
+    main()
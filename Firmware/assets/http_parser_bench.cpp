@@ -0,0 +1,395 @@
+/*
+ * HTTP 请求解析的堆分配次数和耗时 (主机上运行)
+ *
+ * 用法:
+ *   g++ -O2 -I ../lib/ESPAsyncWebServer-esphome/src http_parser_bench.cpp \
+ *       ../lib/ESPAsyncWebServer-esphome/src/WebRequestParser.cpp -o http_parser_bench
+ *   ./http_parser_bench [次数]
+ *
+ * 请求取自网页和 Minecraft 模组实际发出的请求. 对每个请求比较:
+ *   legacy  原来逐行拼接 String, 每个参数和请求头各建一个对象的解析方式
+ *   inplace 现在复制进请求内的固定缓冲区后原地切分, 只保留视图
+ * 主机上没有 Arduino String, 这里按 arduino-esp32 WString 的分配方式建模:
+ * 14字节以内存放在对象内部, 超出后每次增长都按实际长度 realloc.
+ * 两种方式都只统计解析阶段, url/host/contentType 在两边都会生成 String.
+ * 耗时是主机上的结果, 只用来比较两种方式的相对差别.
+ */
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "WebRequestParser.h"
+
+static unsigned allocations = 0;
+
+/**
+ * @brief 按 arduino-esp32 WString 的分配方式建模的字符串
+ */
+class ModelString {
+  enum { SSO = 14 };
+  char sso[SSO + 1];
+  char *heap;
+  size_t cap;
+  size_t len;
+
+  char *buffer() { return heap ? heap : sso; }
+
+public:
+  void reserve(size_t size) {
+    if (size <= (heap ? cap : (size_t)SSO)) {
+      return;
+    }
+    char *grown = (char *)realloc(heap, size + 1);
+    if (!heap) {
+      memcpy(grown, sso, len + 1);
+    }
+    heap = grown;
+    cap = size;
+    allocations++;
+  }
+
+  ModelString() : heap(nullptr), cap(0), len(0) { sso[0] = 0; }
+  ModelString(const char *s, size_t n) : ModelString() { concat(s, n); }
+  ModelString(const char *s) : ModelString(s, strlen(s)) {}
+  ModelString(const ModelString &o) : ModelString(o.c_str(), o.len) {}
+  ~ModelString() { free(heap); }
+  ModelString &operator=(const ModelString &o) {
+    if (this != &o) {
+      len = 0;
+      concat(o.c_str(), o.len);
+    }
+    return *this;
+  }
+  // 临时 String 的赋值直接接管缓冲区, 原来的缓冲区释放
+  ModelString(ModelString &&o) : ModelString() { *this = static_cast<ModelString &&>(o); }
+  ModelString &operator=(ModelString &&o) {
+    free(heap);
+    heap = o.heap;
+    cap = o.cap;
+    len = o.len;
+    memcpy(sso, o.sso, sizeof(sso));
+    o.heap = nullptr;
+    o.len = 0;
+    return *this;
+  }
+  ModelString &operator=(const char *s) {
+    len = 0;
+    return concat(s, strlen(s));
+  }
+
+  const char *c_str() const { return heap ? heap : sso; }
+  size_t length() const { return len; }
+  ModelString &concat(const char *s, size_t n) {
+    reserve(len + n);
+    memcpy(buffer() + len, s, n);
+    len += n;
+    buffer()[len] = 0;
+    return *this;
+  }
+  ModelString &operator+=(char c) { return concat(&c, 1); }
+  int indexOf(char c, size_t from = 0) const {
+    const char *p = strchr(c_str() + from, c);
+    return p ? p - c_str() : -1;
+  }
+  ModelString substring(size_t from, size_t to) const {
+    if (to > len) to = len;
+    return from < to ? ModelString(c_str() + from, to - from) : ModelString();
+  }
+  ModelString substring(size_t from) const { return substring(from, len); }
+  void trim() {
+    const char *s = c_str();
+    size_t start = 0, end = len;
+    while (start < end && isspace((unsigned char)s[start])) start++;
+    while (end > start && isspace((unsigned char)s[end - 1])) end--;
+    memmove(buffer(), s + start, end - start);
+    len = end - start;
+    buffer()[len] = 0;
+  }
+  bool equalsIgnoreCase(const char *s) const { return strcasecmp(c_str(), s) == 0; }
+};
+
+struct Item {
+  ModelString name;
+  ModelString value;
+};
+
+/**
+ * @brief 原来的链表节点和参数/请求头对象各算一次分配
+ */
+struct ModelList {
+  Item *items[32];
+  size_t count = 0;
+  void add(const ModelString &name, const ModelString &value) {
+    allocations += 2;
+    items[count++] = new Item{name, value};
+  }
+  ~ModelList() {
+    for (size_t i = 0; i < count; i++) delete items[i];
+  }
+};
+
+static ModelString urlDecode(const ModelString &text) {
+  ModelString decoded;
+  decoded.reserve(text.length());
+  const char *s = text.c_str();
+  for (size_t i = 0; i < text.length(); i++) {
+    char c = s[i];
+    if (c == '%' && i + 2 < text.length()) {
+      char hex[3] = {s[i + 1], s[i + 2], 0};
+      c = strtol(hex, nullptr, 16);
+      i += 2;
+    } else if (c == '+') {
+      c = ' ';
+    }
+    decoded += c;
+  }
+  return decoded;
+}
+
+static void legacyParams(const ModelString &query, ModelList &params) {
+  size_t start = 0;
+  while (start < query.length()) {
+    int end = query.indexOf('&', start);
+    if (end < 0) end = query.length();
+    int equal = query.indexOf('=', start);
+    if (equal < 0 || equal > end) equal = end;
+    params.add(urlDecode(query.substring(start, equal)),
+               urlDecode(query.substring(equal + 1, end)));
+    start = end + 1;
+  }
+}
+
+/**
+ * @brief 原来的解析流程: 每行拼进 _temp, 再用 substring 拆分
+ */
+static void legacyParse(const char *request, size_t length) {
+  ModelString temp, url, host, contentType;
+  ModelList headers, params;
+  size_t contentLength = 0;
+  const char *p = request, *end = request + length;
+  bool first = true;
+  while (p < end) {
+    const char *eol = (const char *)memchr(p, '\n', end - p);
+    temp.concat(p, eol - p);
+    temp.trim();
+    p = eol + 1;
+    if (!temp.length()) break;
+    if (first) {
+      int index = temp.indexOf(' ');
+      ModelString method = temp.substring(0, index);
+      int next = temp.indexOf(' ', index + 1);
+      ModelString target = temp.substring(method.length() + 1, next);
+      temp = temp.substring(next + 1);
+      ModelString query;
+      int q = target.indexOf('?');
+      if (q > 0) {
+        query = target.substring(q + 1);
+        target = target.substring(0, q);
+      }
+      url = urlDecode(target);
+      legacyParams(query, params);
+      first = false;
+    } else {
+      int index = temp.indexOf(':');
+      ModelString name = temp.substring(0, index);
+      ModelString value = temp.substring(index + 2);
+      if (name.equalsIgnoreCase("Host")) {
+        host = value;
+      } else if (name.equalsIgnoreCase("Content-Type")) {
+        contentType = value.substring(0, value.indexOf(';'));
+      } else if (name.equalsIgnoreCase("Content-Length")) {
+        contentLength = atoi(value.c_str());
+      }
+      headers.add(name, value);
+    }
+    temp = ModelString();
+  }
+  // urlencoded 请求体逐字符拼接
+  for (size_t i = 0; contentLength && i < contentLength; i++) {
+    char c = p[i];
+    if (c != '&') temp += c;
+    if (c == '&' || i + 1 == contentLength) {
+      int equal = temp.indexOf('=');
+      params.add(urlDecode(temp.substring(0, equal)),
+                 urlDecode(temp.substring(equal + 1)));
+      temp = ModelString();
+    }
+  }
+}
+
+struct Views {
+  AsyncWebView name[32];
+  AsyncWebView value[32];
+  size_t count = 0;
+};
+
+static void addPair(void *arg, const AsyncWebView &name,
+                    const AsyncWebView &value) {
+  Views *views = (Views *)arg;
+  views->name[views->count] = name;
+  views->value[views->count++] = value;
+}
+
+/**
+ * @brief 现在的解析流程: 复制进固定缓冲区, 原地切分
+ */
+static void inplaceParse(const char *request, size_t length) {
+  char head[1536];
+  ModelString url, host, contentType;
+  Views headers, params;
+  size_t headLength = 0, lineStart = 0, contentLength = 0;
+  const char *p = request, *end = request + length;
+  bool first = true;
+  while (p < end) {
+    const char *eol = (const char *)memchr(p, '\n', end - p);
+    size_t take = eol - p + 1;
+    memcpy(head + headLength, p, take);
+    headLength += take;
+    p += take;
+    size_t len;
+    char *line = AsyncWebParser::trim(head + lineStart,
+                                      headLength - 1 - lineStart, &len);
+    lineStart = headLength;
+    if (!len) break;
+    if (first) {
+      AsyncWebRequestLine requestLine;
+      AsyncWebParser::requestLine(line, len, &requestLine);
+      url = requestLine.path.c_str();
+      if (requestLine.query.valid()) {
+        AsyncWebParser::pairs((char *)requestLine.query.c_str(),
+                              requestLine.query.length(), false, addPair,
+                              &params);
+      }
+      first = false;
+    } else {
+      AsyncWebView name, value;
+      AsyncWebParser::headerLine(line, len, &name, &value);
+      if (name.equalsIgnoreCase("Host")) {
+        host = value.c_str();
+      } else if (name.equalsIgnoreCase("Content-Type")) {
+        contentType = value.c_str();
+      } else if (name.equalsIgnoreCase("Content-Length")) {
+        contentLength = value.toInt();
+      }
+      addPair(&headers, name, value);
+    }
+  }
+  if (contentLength) {
+    memcpy(head + headLength, p, contentLength);
+    head[headLength + contentLength] = 0;
+    AsyncWebParser::pairs(head + headLength, contentLength, true, addPair,
+                          &params);
+  }
+}
+
+struct Sample {
+  const char *name;
+  const char *request;
+};
+
+static const Sample SAMPLES[] = {
+    {"ui GET /state",
+     "GET /state HTTP/1.1\r\n"
+     "Host: esp32.local\r\n"
+     "Connection: keep-alive\r\n"
+     "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 "
+     "(KHTML, like Gecko) Chrome/126.0.0.0 Safari/537.36\r\n"
+     "Accept: */*\r\n"
+     "Referer: http://esp32.local/\r\n"
+     "Accept-Encoding: gzip, deflate\r\n"
+     "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+     "If-None-Match: \"5a1f09c2\"\r\n"
+     "\r\n"},
+    {"ui GET asset",
+     "GET /_next/static/chunks/app/page-3f1c2b7d9e0a4c55.js HTTP/1.1\r\n"
+     "Host: esp32.local\r\n"
+     "Connection: keep-alive\r\n"
+     "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 "
+     "(KHTML, like Gecko) Chrome/126.0.0.0 Safari/537.36\r\n"
+     "Accept: */*\r\n"
+     "Referer: http://esp32.local/\r\n"
+     "Accept-Encoding: gzip, deflate\r\n"
+     "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+     "If-None-Match: \"0d4c8e1f2a3b5c6d\"\r\n"
+     "\r\n"},
+    {"ui POST /pointColors",
+     "POST /pointColors?southColor=%23FF0000&spawnColor=%2300FF00 HTTP/1.1\r\n"
+     "Host: esp32.local\r\n"
+     "Connection: keep-alive\r\n"
+     "Content-Length: 0\r\n"
+     "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 "
+     "(KHTML, like Gecko) Chrome/126.0.0.0 Safari/537.36\r\n"
+     "Accept: */*\r\n"
+     "Origin: http://esp32.local\r\n"
+     "Referer: http://esp32.local/\r\n"
+     "Accept-Encoding: gzip, deflate\r\n"
+     "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+     "\r\n"},
+    {"ui POST /spawn",
+     "POST /spawn?latitude=31.230416&longitude=121.473701 HTTP/1.1\r\n"
+     "Host: esp32.local\r\n"
+     "Connection: keep-alive\r\n"
+     "Content-Length: 0\r\n"
+     "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 "
+     "(KHTML, like Gecko) Chrome/126.0.0.0 Safari/537.36\r\n"
+     "Accept: */*\r\n"
+     "Origin: http://esp32.local\r\n"
+     "Referer: http://esp32.local/\r\n"
+     "Accept-Encoding: gzip, deflate\r\n"
+     "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+     "\r\n"},
+    {"mod POST /setAzimuth",
+     "POST /setAzimuth?azimuth=237.45 HTTP/1.1\r\n"
+     "Content-Length: 0\r\n"
+     "Host: esp32.local\r\n"
+     "Connection: Keep-Alive\r\n"
+     "Accept-Encoding: gzip\r\n"
+     "User-Agent: okhttp/4.12.0\r\n"
+     "\r\n"},
+    {"mod GET /ip",
+     "GET /ip HTTP/1.1\r\n"
+     "Host: esp32.local\r\n"
+     "Connection: Keep-Alive\r\n"
+     "Accept-Encoding: gzip\r\n"
+     "User-Agent: okhttp/4.12.0\r\n"
+     "\r\n"},
+    {"form POST /waypoints",
+     "POST /waypoints HTTP/1.1\r\n"
+     "Host: esp32.local\r\n"
+     "Content-Type: application/x-www-form-urlencoded\r\n"
+     "Content-Length: 52\r\n"
+     "\r\n"
+     "name=Home+Base&latitude=31.230416&longitude=121.4737"},
+};
+
+template <typename F> static double measure(F parse, const char *request,
+                                            size_t length, int rounds) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    parse(request, length);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / rounds;
+}
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 100000;
+  printf("%-22s %5s  %17s  %17s\n", "request", "bytes", "legacy allocs/ns",
+         "inplace allocs/ns");
+  for (const Sample &sample : SAMPLES) {
+    size_t length = strlen(sample.request);
+    allocations = 0;
+    legacyParse(sample.request, length);
+    unsigned legacyAllocations = allocations;
+    allocations = 0;
+    inplaceParse(sample.request, length);
+    unsigned inplaceAllocations = allocations;
+    double legacyNs = measure(legacyParse, sample.request, length, rounds);
+    double inplaceNs = measure(inplaceParse, sample.request, length, rounds);
+    printf("%-22s %5zu  %8u %8.0f  %8u %8.0f\n", sample.name, length,
+           legacyAllocations, legacyNs, inplaceAllocations, inplaceNs);
+  }
+  return 0;
+}
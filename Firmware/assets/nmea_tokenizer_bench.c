@@ -0,0 +1,124 @@
+/*
+ * NMEA 分词器的吞吐量 (主机上运行)
+ *
+ * 用法:
+ *   gcc -O2 -I ../include nmea_tokenizer_bench.c ../src/impl/nmea_tokenizer.c \
+ *       -o nmea_tokenizer_bench
+ *   ./nmea_tokenizer_bench 日志文件... [-n 遍数]
+ * 日志是从GPS串口抓取的原始NMEA数据; 没有实测日志时可以用
+ *   python nmea_track.py walk drive crc noise > track.nmea
+ * 生成一份带校验和错误和串口噪声的轨迹.
+ *
+ * 日志整个读进内存, 按解析任务的方式切行: 遇到'$'开始新语句, 遇到'\n'交给
+ * 分词器, 语句外的字节跳过. 每个文件单独统计各结果的行数和吞吐量.
+ * 数字是主机上的结果, 用于比较修改前后的相对差别; ESP32-C3 上大约慢一个数量级.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nmea_tokenizer.h"
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *read_file(const char *path, size_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = malloc(size > 0 ? (size_t)size : 1);
+    *length = fread(data, 1, size > 0 ? (size_t)size : 0, file);
+    fclose(file);
+    return data;
+}
+
+/**
+ * @brief 按解析任务的方式把缓冲区切成语句交给分词器
+ *
+ * @return 解析成功的语句数
+ */
+static uint32_t run(nmea_tokenizer_t *tok, const char *data, size_t length)
+{
+    uint32_t parsed = 0;
+    size_t start = 0;
+    int in_sentence = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == '$') {
+            start = i;
+            in_sentence = 1;
+        } else if (data[i] == '\n' && in_sentence) {
+            if (nmea_tokenizer_parse(tok, data + start, i + 1 - start, NULL) == NMEA_OK) {
+                parsed++;
+            }
+            in_sentence = 0;
+        }
+    }
+    return parsed;
+}
+
+static void bench(const char *path, int passes)
+{
+    size_t length = 0;
+    char *data = read_file(path, &length);
+    if (!data) {
+        fprintf(stderr, "%s: cannot read\n", path);
+        return;
+    }
+    nmea_tokenizer_t tok;
+    nmea_tokenizer_init(&tok);
+    uint32_t parsed = run(&tok, data, length);
+    nmea_tokenizer_t first = tok;
+
+    /* 先跑一遍预热缓存, 之后取多遍的总时间 */
+    double start = seconds();
+    uint32_t checksum = 0;
+    for (int i = 0; i < passes; i++) {
+        checksum += run(&tok, data, length);
+        checksum += (uint32_t)tok.data.latitude_e7;
+    }
+    double elapsed = seconds() - start;
+
+    printf("%s: %zu bytes, %u lines, ok %u, crc %u, format %u, unsupported %u\n", path, length,
+           first.lines, parsed, first.crc_errors, first.format_errors, first.unsupported);
+    printf("  %d passes in %.3f s: %.1f MB/s, %.2f M lines/s, %.0f ns/line (checksum %u)\n",
+           passes, elapsed, length * (double)passes / elapsed / 1e6,
+           first.lines * (double)passes / elapsed / 1e6,
+           elapsed * 1e9 / ((double)first.lines * passes), checksum);
+    free(data);
+}
+
+int main(int argc, char **argv)
+{
+    int passes = 200;
+    int files = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            passes = atoi(argv[++i]);
+        }
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0) {
+            i++;
+            continue;
+        }
+        bench(argv[i], passes > 0 ? passes : 1);
+        files++;
+    }
+    if (files == 0) {
+        fprintf(stderr, "usage: %s log.nmea... [-n passes]\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * NMEA 分词器的模糊测试 (主机上运行)
+ *
+ * 用法:
+ *   独立运行, 用随机变异的合法语句测试:
+ *     gcc -O1 -g -fsanitize=address,undefined -I ../include \
+ *         nmea_tokenizer_fuzz.c ../src/impl/nmea_tokenizer.c -o nmea_tokenizer_fuzz
+ *     ./nmea_tokenizer_fuzz [次数] [随机种子]
+ *   libFuzzer:
+ *     clang -O1 -g -fsanitize=fuzzer,address,undefined -DLIBFUZZER -I ../include \
+ *         nmea_tokenizer_fuzz.c ../src/impl/nmea_tokenizer.c -o nmea_tokenizer_fuzz
+ *     ./nmea_tokenizer_fuzz
+ *
+ * 每个输入检查:
+ *   - 解析不越界读取(由 AddressSanitizer 检查), 不要求输入以'\0'结尾
+ *   - 每行恰好计入一个结果, 统计计数与返回值一致
+ *   - 解析成功时坐标, 航向, 时间和日期在协议范围内
+ * 独立运行时还会随机生成合法语句, 检查坐标按整数精确解码, 与编码值一致
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmea_tokenizer.h"
+
+static void check(int condition, const char *what)
+{
+    if (!condition) {
+        fprintf(stderr, "check failed: %s\n", what);
+        abort();
+    }
+}
+
+static void check_data(const nmea_data_t *data)
+{
+    check(data->latitude_e7 >= -900000000 && data->latitude_e7 <= 900000000, "latitude in range");
+    check(data->longitude_e7 >= -1800000000 && data->longitude_e7 <= 1800000000, "longitude in range");
+    check(data->course_x100 < 36000, "course in range");
+    check(data->time_ms < 24 * 3600 * 1000 + 1000, "time in range");
+    check(data->year <= 99 && data->month <= 99 && data->day <= 99, "date in range");
+}
+
+static void check_input(const uint8_t *data, size_t length)
+{
+    /* 复制到刚好大小的堆缓冲区, 越界读取会被 AddressSanitizer 发现 */
+    char *line = malloc(length ? length : 1);
+    if (length) {
+        memcpy(line, data, length);
+    }
+    nmea_tokenizer_t tok;
+    nmea_tokenizer_init(&tok);
+    nmea_sentence_t sentence;
+    nmea_result_t result = nmea_tokenizer_parse(&tok, line, length, &sentence);
+    free(line);
+
+    check(tok.lines == 1, "line counted");
+    check(tok.crc_errors + tok.format_errors + tok.unsupported == (result != NMEA_OK),
+          "exactly one outcome counted");
+    switch (result) {
+    case NMEA_OK:
+        check(sentence != NMEA_SENTENCE_UNKNOWN, "known sentence");
+        check(tok.updated == 1u << sentence, "updated mask");
+        break;
+    case NMEA_ERR_FORMAT:
+        check(tok.format_errors == 1, "format error counted");
+        break;
+    case NMEA_ERR_CRC:
+        check(tok.crc_errors == 1, "crc error counted");
+        break;
+    case NMEA_ERR_UNSUPPORTED:
+        check(tok.unsupported == 1 && sentence == NMEA_SENTENCE_UNKNOWN, "unsupported counted");
+        break;
+    default:
+        check(0, "result in range");
+    }
+    check(result == NMEA_OK || tok.updated == 0, "nothing applied on error");
+    check_data(&tok.data);
+}
+
+#if defined(LIBFUZZER)
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    check_input(data, size);
+    return 0;
+}
+
+#else
+
+static uint32_t next_random(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/**
+ * @brief 给语句主体加上'$'和校验和
+ *
+ * @return 语句长度
+ */
+static size_t finish(char *out, size_t capacity, const char *body)
+{
+    uint8_t crc = 0;
+    for (const char *p = body; *p; p++) {
+        crc ^= (uint8_t)*p;
+    }
+    return (size_t)snprintf(out, capacity, "$%s*%02X\r\n", body, crc);
+}
+
+/**
+ * @brief 把 1e-7 度写成 NMEA 的 (d)ddmm.mmmmmmm
+ *
+ * 分的小数取7位, 解码时按整数换算回 1e-7 度, 与 e7 的误差不超过1
+ */
+static void format_coordinate(char *out, size_t capacity, int32_t e7, int width, char positive,
+                              char negative)
+{
+    int64_t value = e7 < 0 ? -(int64_t)e7 : e7;
+    int64_t degree = value / 10000000;
+    int64_t minute_e7 = value % 10000000 * 60;
+    snprintf(out, capacity, "%0*lld%02lld.%07lld,%c", width, (long long)degree,
+             (long long)(minute_e7 / 10000000), (long long)(minute_e7 % 10000000),
+             e7 < 0 ? negative : positive);
+}
+
+/**
+ * @brief 生成一条随机坐标的合法 GGA 语句, 检查坐标精确解码
+ */
+static void check_round_trip(uint32_t *state)
+{
+    int32_t latitude = (int32_t)(next_random(state) % 1800000001u) - 900000000;
+    int32_t longitude = (int32_t)(next_random(state) % 3600000001u - 1800000000u);
+    char lat[32], lon[32], body[128], line[160];
+    format_coordinate(lat, sizeof(lat), latitude, 2, 'N', 'S');
+    format_coordinate(lon, sizeof(lon), longitude, 3, 'E', 'W');
+    snprintf(body, sizeof(body), "GNGGA,123456.789,%s,%s,1,09,0.91,10.5,M,-3.2,M,,", lat, lon);
+    size_t length = finish(line, sizeof(line), body);
+
+    nmea_tokenizer_t tok;
+    nmea_tokenizer_init(&tok);
+    check(nmea_tokenizer_parse(&tok, line, length, NULL) == NMEA_OK, "generated sentence parses");
+    check(llabs((long long)tok.data.latitude_e7 - latitude) <= 1, "latitude exact");
+    check(llabs((long long)tok.data.longitude_e7 - longitude) <= 1, "longitude exact");
+    check(tok.data.time_ms == 45296789, "time exact");
+    check(tok.data.hdop_x100 == 91 && tok.data.altitude_mm == 7300, "scaled values exact");
+    check_input((const uint8_t *)line, length);
+}
+
+static const char *const seeds[] = {
+    "GPGGA,083000.000,3113.824000,N,12128.422000,E,1,09,0.90,10.0,M,0.0,M,,",
+    "GPRMC,083000.000,A,3113.824000,N,12128.422000,E,2.72,45.00,010126,,,A",
+    "GNGSA,A,3,01,02,03,04,05,06,07,08,09,10,11,12,1.50,0.90,1.20",
+    "GNVTG,45.00,T,,M,2.72,N,5.04,K,A",
+    "GPGGA,083000.000,,,,,0,00,99.99,,,,,,",
+    "GPRMC,083000.000,V,,,,,,,010126,,,N",
+    "GPGSV,3,1,12,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45",
+};
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    uint32_t state = argc > 2 ? (uint32_t)atol(argv[2]) : 0x12345678;
+    if (state == 0) {
+        state = 1;
+    }
+    size_t seed_count = sizeof(seeds) / sizeof(seeds[0]);
+    char seed_lines[sizeof(seeds) / sizeof(seeds[0])][128];
+    size_t seed_lengths[sizeof(seeds) / sizeof(seeds[0])];
+    for (size_t i = 0; i < seed_count; i++) {
+        seed_lengths[i] = finish(seed_lines[i], sizeof(seed_lines[i]), seeds[i]);
+        nmea_tokenizer_t tok;
+        nmea_tokenizer_init(&tok);
+        nmea_result_t result = nmea_tokenizer_parse(&tok, seed_lines[i], seed_lengths[i], NULL);
+        check(result == (i + 1 < seed_count ? NMEA_OK : NMEA_ERR_UNSUPPORTED), "seed parses");
+    }
+
+    long accepted = 0;
+    char frame[256];
+    for (long i = 0; i < iterations; i++) {
+        if (i % 16 == 0) {
+            check_round_trip(&state);
+        }
+        size_t seed = next_random(&state) % seed_count;
+        size_t length = seed_lengths[seed];
+        memcpy(frame, seed_lines[seed], length);
+        int mutations = 1 + next_random(&state) % 4;
+        for (int m = 0; m < mutations; m++) {
+            uint32_t r = next_random(&state);
+            switch (r % 6) {
+            case 0: /* 翻转一位 */
+                if (length) {
+                    frame[(r >> 8) % length] ^= (char)(1 << ((r >> 3) % 8));
+                }
+                break;
+            case 1: /* 改写一个字节 */
+                if (length) {
+                    frame[(r >> 8) % length] = (char)(r >> 16);
+                }
+                break;
+            case 2: /* 截断 */
+                length = length ? (r >> 8) % length : 0;
+                break;
+            case 3: /* 追加随机字节 */
+                for (uint32_t n = (r >> 8) % 8; n > 0 && length < sizeof(frame); n--) {
+                    frame[length++] = (char)next_random(&state);
+                }
+                break;
+            case 4: /* 插入一个分隔符, 制造多余或过长的字段 */
+                if (length && length < sizeof(frame)) {
+                    size_t at = (r >> 8) % length;
+                    memmove(frame + at + 1, frame + at, length - at);
+                    frame[at] = ",.*$-"[(r >> 20) % 5];
+                    length++;
+                }
+                break;
+            default: /* 改写字段中的一个数字, 再修正校验和 */
+                if (length > 6) {
+                    size_t at = 1 + (r >> 8) % (length - 6);
+                    frame[at] = (char)('0' + (r >> 20) % 10);
+                    const char *star = memchr(frame, '*', length);
+                    if (star && star + 2 < frame + length) {
+                        uint8_t crc = 0;
+                        for (const char *p = frame + 1; p < star; p++) {
+                            crc ^= (uint8_t)*p;
+                        }
+                        char digits[3];
+                        snprintf(digits, sizeof(digits), "%02X", crc);
+                        memcpy((char *)star + 1, digits, 2);
+                    }
+                }
+                break;
+            }
+        }
+        nmea_tokenizer_t tok;
+        nmea_tokenizer_init(&tok);
+        if (nmea_tokenizer_parse(&tok, frame, length, NULL) == NMEA_OK) {
+            accepted++;
+        }
+        check_input((const uint8_t *)frame, length);
+    }
+    printf("%ld inputs, %ld accepted, no failures\n", iterations, accepted);
+    return 0;
+}
+
+#endif
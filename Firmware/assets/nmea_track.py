@@ -0,0 +1,119 @@
+"""生成GPS回放用的NMEA轨迹
+
+用法: python nmea_track.py walk drive crc noise > ../data/replay.nmea
+然后上传文件系统, 用 esp32-c3-devkitm-1-gps-replay 环境编译烧录.
+回放结束后记得从 data 中删除 replay.nmea, 避免打包进正式固件.
+主机上的回归检查(gps_pipeline_check.sh)也用这里的场景生成轨迹.
+
+场景:
+  walk   步行 1.4 m/s, 10 分钟
+  drive  驾车 15 m/s 远离再返回, 30 分钟
+  cold   冷启动, 前 40 秒没有定位
+  nofix  只有无效定位, 5 分钟
+  crc    步行, 每 7 条语句有一条校验和错误
+  noise  步行, 语句之间夹杂串口噪声
+"""
+import math
+import random
+import sys
+
+START_LAT = 31.2304
+START_LON = 121.4737
+EARTH_RADIUS = 6371000.0
+
+
+def checksum(body):
+    value = 0
+    for c in body:
+        value ^= ord(c)
+    return "%02X" % value
+
+
+def sentence(body):
+    return "$%s*%s" % (body, checksum(body))
+
+
+def nmea_time(t):
+    t %= 86400
+    return "%02d%02d%06.3f" % (t // 3600, t // 60 % 60, t % 60)
+
+
+def nmea_coordinate(value, width):
+    hemisphere = value < 0
+    value = abs(value)
+    degrees = int(value)
+    minutes = (value - degrees) * 60
+    return "%0*d%09.6f" % (width, degrees, minutes), hemisphere
+
+
+def epoch(t, lat, lon, speed, course, fixed, sats=9, hdop=0.9):
+    la, south = nmea_coordinate(lat, 2)
+    lo, west = nmea_coordinate(lon, 3)
+    ns = "S" if south else "N"
+    ew = "W" if west else "E"
+    if not fixed:
+        return [
+            sentence("GPGGA,%s,,,,,0,00,99.99,,,,,," % nmea_time(t)),
+            sentence("GPRMC,%s,V,,,,,,,010126,,,N" % nmea_time(t)),
+        ]
+    return [
+        sentence("GPGGA,%s,%s,%s,%s,%s,1,%02d,%.2f,10.0,M,0.0,M,,"
+                 % (nmea_time(t), la, ns, lo, ew, sats, hdop)),
+        sentence("GPRMC,%s,A,%s,%s,%s,%s,%.2f,%.2f,010126,,,A"
+                 % (nmea_time(t), la, ns, lo, ew, speed / 0.514444, course)),
+    ]
+
+
+def move(lat, lon, distance, course):
+    """沿航向移动 distance 米(局部平面近似)"""
+    d_north = distance * math.cos(math.radians(course))
+    d_east = distance * math.sin(math.radians(course))
+    lat += math.degrees(d_north / EARTH_RADIUS)
+    lon += math.degrees(d_east / (EARTH_RADIUS * math.cos(math.radians(lat))))
+    return lat, lon
+
+
+def track(t0, seconds, speed, course, fixed=True, turn_at=None):
+    lat, lon = START_LAT, START_LON
+    lines = []
+    for i in range(seconds):
+        if turn_at is not None and i == turn_at:
+            course = (course + 180) % 360
+        lines += epoch(t0 + i, lat + random.gauss(0, 2e-5),
+                       lon + random.gauss(0, 2e-5), speed, course, fixed)
+        lat, lon = move(lat, lon, speed, course)
+    return lines
+
+
+def scenario(name, t0):
+    if name == "walk":
+        return track(t0, 600, 1.4, 45)
+    if name == "drive":
+        return track(t0, 1800, 15.0, 90, turn_at=900)
+    if name == "cold":
+        return track(t0, 40, 0, 0, fixed=False) + track(t0 + 40, 300, 1.4, 0)
+    if name == "nofix":
+        return track(t0, 300, 0, 0, fixed=False)
+    if name == "crc":
+        lines = track(t0, 600, 1.4, 180)
+        for i in range(0, len(lines), 7):
+            lines[i] = lines[i][:-2] + "00"
+        return lines
+    if name == "noise":
+        lines = []
+        for line in track(t0, 600, 1.4, 270):
+            if random.random() < 0.2:
+                lines.append("".join(chr(random.randint(0x20, 0x7e))
+                                     for _ in range(random.randint(1, 80))))
+            lines.append(line)
+        return lines
+    raise SystemExit("unknown scenario: " + name)
+
+
+if __name__ == "__main__":
+    random.seed(1)
+    t = 8 * 3600
+    for name in sys.argv[1:] or ["walk"]:
+        lines = scenario(name, t)
+        sys.stdout.write("\r\n".join(lines) + "\r\n")
+        t += len([l for l in lines if "GGA" in l]) + 60
@@ -0,0 +1,80 @@
+"""/state 与逐个接口请求的对比
+
+用法: python state_bench.py [--host esp32.local] [--rounds 20]
+
+分别测量三种方式取回网页需要的全部状态的耗时:
+  separate  依次请求 /info /spawn /pointColors /brightness /advancedConfig /wifi /waypoints
+  state     一次 GET /state
+  304       带上次的 ETag 请求 /state, 状态没有变化时返回304
+用 alloc-tracker 环境编译的固件会在 /state 响应头 X-Allocations 中回报
+生成响应时的堆分配次数, 这里一并打印.
+只依赖标准库.
+"""
+import argparse
+import http.client
+import time
+
+SEPARATE = ["/info", "/spawn", "/pointColors", "/brightness",
+            "/advancedConfig", "/wifi", "/waypoints"]
+
+
+def get(host, path, headers=None):
+    conn = http.client.HTTPConnection(host, 80, timeout=5)
+    start = time.perf_counter()
+    conn.request("GET", path, headers=headers or {})
+    response = conn.getresponse()
+    body = response.read()
+    elapsed = (time.perf_counter() - start) * 1000
+    conn.close()
+    return response, body, elapsed
+
+
+def percentile(samples, p):
+    samples = sorted(samples)
+    return samples[min(len(samples) - 1, len(samples) * p // 100)]
+
+
+def run(host, rounds):
+    results = {"separate": [], "state": [], "304": []}
+    sizes = {"separate": 0, "state": 0, "304": 0}
+    allocations = []
+    etag = None
+    for _ in range(rounds):
+        total = 0
+        size = 0
+        for path in SEPARATE:
+            _, body, elapsed = get(host, path)
+            total += elapsed
+            size += len(body)
+        results["separate"].append(total)
+        sizes["separate"] = size
+
+        response, body, elapsed = get(host, "/state")
+        results["state"].append(elapsed)
+        sizes["state"] = len(body)
+        etag = response.getheader("ETag")
+        if response.getheader("X-Allocations"):
+            allocations.append(int(response.getheader("X-Allocations")))
+
+        response, body, elapsed = get(host, "/state", {"If-None-Match": etag})
+        if response.status == 304:
+            results["304"].append(elapsed)
+
+    for name, samples in results.items():
+        if not samples:
+            print("%-8s no samples" % name)
+            continue
+        print("%-8s %2d requests, %5d bytes, p50 %.1f ms, p95 %.1f ms (%d rounds)" % (
+            name, len(SEPARATE) if name == "separate" else 1, sizes[name],
+            percentile(samples, 50), percentile(samples, 95), len(samples)))
+    if allocations:
+        print("device allocations per /state: min %d, max %d" % (
+            min(allocations), max(allocations)))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--host", default="esp32.local")
+    parser.add_argument("--rounds", type=int, default=20)
+    args = parser.parse_args()
+    run(args.host, args.rounds)
@@ -0,0 +1,110 @@
+"""UDP方位角发送和延迟对比
+
+用法:
+  python udp_azimuth.py send [--host esp32.local] [--rate 100] [--seconds 30] [--color FF1414]
+  python udp_azimuth.py bench [--host esp32.local] [--count 200]
+
+send  按指定频率连续发送方位角包, 可选覆盖指针颜色.
+bench 交替测量两条路径的延迟, 设备需处于罗盘状态:
+      UDP  带回送标志发包, 设备刷新LED后原样回送, 测得 发包->LED刷新->回送 的时间;
+      HTTP POST /setAzimuth, 测得 请求->响应 的时间. 响应在投递方位角之后、
+           LED刷新之前发出, 所以HTTP数值是它到LED延迟的下限, 对比结果偏向HTTP.
+只依赖标准库.
+"""
+import argparse
+import http.client
+import socket
+import struct
+import time
+
+PORT = 4210
+PACKET_FORMAT = "<HHI"
+FLAG_COLOR = 0x01
+FLAG_ECHO = 0x02
+
+
+def packet(sequence, angle, color=None, echo=False):
+    flags = (FLAG_COLOR if color is not None else 0) | (FLAG_ECHO if echo else 0)
+    return struct.pack(PACKET_FORMAT, sequence & 0xFFFF,
+                       int(angle * 100) % 36000,
+                       (flags << 24) | ((color or 0) & 0xFFFFFF))
+
+
+def summary(name, samples, lost=0):
+    if not samples:
+        print("%-4s no samples, %d lost" % (name, lost))
+        return
+    samples.sort()
+    print("%-4s ms: min %.1f, p50 %.1f, p95 %.1f, max %.1f (%d samples, %d lost)" % (
+        name, samples[0], samples[len(samples) // 2],
+        samples[len(samples) * 95 // 100], samples[-1], len(samples), lost))
+
+
+def send(host, rate, seconds, color):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    address = (socket.gethostbyname(host), PORT)
+    interval = 1.0 / rate if rate > 0 else 0
+    start = time.monotonic()
+    sent = 0
+    while time.monotonic() - start < seconds:
+        sock.sendto(packet(sent, sent * 0.37, color), address)
+        sent += 1
+        if interval:
+            time.sleep(max(0, start + sent * interval - time.monotonic()))
+    elapsed = time.monotonic() - start
+    print("sent %d packets in %.1f s, %.1f packets/s" % (sent, elapsed, sent / elapsed))
+
+
+def bench(host, count):
+    ip = socket.gethostbyname(host)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(0.5)
+    http_conn = http.client.HTTPConnection(ip, 80, timeout=2)
+    udp_rtts, http_rtts = [], []
+    udp_lost = http_lost = 0
+    # 每次换一个角度, 保证LED确实需要刷新
+    for i in range(count):
+        angle = (i * 37) % 360
+        expected = packet(i, angle, echo=True)
+        start = time.perf_counter()
+        sock.sendto(expected, (ip, PORT))
+        try:
+            while True:
+                data, _ = sock.recvfrom(16)
+                if data == expected:
+                    udp_rtts.append((time.perf_counter() - start) * 1000)
+                    break
+        except socket.timeout:
+            udp_lost += 1
+
+        start = time.perf_counter()
+        try:
+            http_conn.request("POST", "/setAzimuth?azimuth=%d" % ((angle + 180) % 360))
+            response = http_conn.getresponse()
+            response.read()
+            if response.status == 200:
+                http_rtts.append((time.perf_counter() - start) * 1000)
+            else:
+                http_lost += 1
+        except (OSError, http.client.HTTPException):
+            http_lost += 1
+            http_conn.close()
+            http_conn = http.client.HTTPConnection(ip, 80, timeout=2)
+        time.sleep(0.02)
+    summary("UDP", udp_rtts, udp_lost)
+    summary("HTTP", http_rtts, http_lost)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("mode", choices=["send", "bench"])
+    parser.add_argument("--host", default="esp32.local")
+    parser.add_argument("--rate", type=float, default=100)
+    parser.add_argument("--seconds", type=float, default=30)
+    parser.add_argument("--color", type=lambda v: int(v.lstrip("#"), 16))
+    parser.add_argument("--count", type=int, default=200)
+    args = parser.parse_args()
+    if args.mode == "send":
+        send(args.host, args.rate, args.seconds, args.color)
+    else:
+        bench(args.host, args.count)
@@ -0,0 +1,240 @@
+/*
+ * 航点查询的耗时和最近航点的正确性 (主机上运行)
+ *
+ * 用法:
+ *   g++ -std=gnu++17 -O2 -pthread -DCONFIG_IDF_TARGET_ESP32C3 -I host \
+ *       -I ../include waypoint_bench.cpp host/host.cpp \
+ *       ../src/impl/waypoint_impl.cpp ../src/impl/utils_impl.cpp \
+ *       -o waypoint_bench
+ *   ./waypoint_bench [次数]
+ *
+ * 固件中的 waypoint 模块原样编译, NVS, Context 和 GPS 的几个接口在这里用
+ * 内存实现代替. 航点表填满 WAYPOINT_MAX 个航点, 比较:
+ *   nearest   waypoint::nearest, 单位向量弦长比较
+ *   navigate  waypoint::navigate 遍历全部航点, 列表显示的开销
+ *   legacy    每个航点各算一次 haversine 和 calculateBearing
+ * 正确性: 航点聚集在当前位置附近几米到几公里内, 用双精度 haversine 找出
+ * 真正最近的航点, nearest 选出的航点要么相同, 要么距离只差1米以内;
+ * 另外检查 (39.9, 116.4) 处北方120米和1公里的两个航点.
+ * 有错误时返回1, 可以作为回归检查.
+ */
+#include <Arduino.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "context.h"
+#include "gps_def.h"
+#include "preference_def.h"
+#include "utils.h"
+#include "waypoint_def.h"
+
+using namespace mcompass;
+
+// ---- 固件其他模块的内存实现 ----
+
+static uint8_t blob[4096];
+static size_t blobLength = 0;
+static Location spawn = {0, 0};
+static Location current = {0, 0};
+
+void preference::saveWaypoints(const void *data, size_t length) {
+  blobLength = length < sizeof(blob) ? length : 0;
+  memcpy(blob, data, blobLength);
+}
+
+size_t preference::getWaypoints(void *data, size_t length) {
+  size_t copied = blobLength < length ? blobLength : length;
+  memcpy(data, blob, copied);
+  return copied;
+}
+
+void preference::getSpawnLocation(Location &location) { location = spawn; }
+
+void Context::setSpawnLocation(const Location &loc) { spawn = loc; }
+
+Location Context::getCurrentLocation() const { return current; }
+
+bool gps::isValidGPSLocation(Location location) {
+  if (location.latitude == 0 && location.longitude == 0) {
+    return false;
+  }
+  return location.latitude >= -90 && location.latitude <= 90 &&
+         location.longitude >= -180 && location.longitude <= 180;
+}
+
+// ---- 测试 ----
+
+static uint32_t state = 0x12345678;
+
+static double uniform(double low, double high) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return low + (high - low) * (state / 4294967296.0);
+}
+
+/**
+ * @brief 从 origin 出发沿航向移动 meters 米(局部平面近似)
+ */
+static Location offset(const Location &origin, double meters, double course) {
+  double north = meters * cos(course), east = meters * sin(course);
+  double radius = EARTH_RADIUS * 1000;
+  return {(float)(origin.latitude + north / radius * 180 / PI),
+          (float)(origin.longitude +
+                  east / (radius * cos(origin.latitude * PI / 180)) * 180 /
+                      PI)};
+}
+
+static double distanceMeters(const Location &a, const Location &b) {
+  return utils::complexDistance(a.latitude, a.longitude, b.latitude,
+                                b.longitude) *
+         1000;
+}
+
+static void clear() {
+  while (waypoint::count() > 0) {
+    waypoint::remove(0);
+  }
+}
+
+/**
+ * @brief 用聚集在 from 附近 spread 米内的航点填满航点表
+ */
+static void fill(const Location &from, double spread) {
+  clear();
+  for (int i = 0; i < WAYPOINT_MAX; i++) {
+    char name[WAYPOINT_NAME_LENGTH];
+    snprintf(name, sizeof(name), "wp%d", i);
+    Location location = offset(from, uniform(0, spread), uniform(0, 2 * PI));
+    if (waypoint::add(name, location) < 0) {
+      fprintf(stderr, "failed to add %s\n", name);
+      exit(1);
+    }
+  }
+}
+
+/**
+ * @brief 双精度 haversine 找出的最近航点
+ */
+static int nearestReference(const Location &from) {
+  int index = -1;
+  double best = 1e30;
+  for (size_t i = 0; i < waypoint::count(); i++) {
+    waypoint::Waypoint wp;
+    waypoint::get(i, wp);
+    double d = distanceMeters(from, wp.location);
+    if (d < best) {
+      best = d;
+      index = i;
+    }
+  }
+  return index;
+}
+
+static int checkNearest() {
+  int errors = 0;
+  // 评审中的例子: 北方120米的航点必须胜过北方1公里的航点
+  Location beijing = {39.9f, 116.4f};
+  clear();
+  waypoint::add("far", offset(beijing, 1000, 0));
+  waypoint::add("near", offset(beijing, 120, 0));
+  if (waypoint::nearest(beijing) != 1) {
+    fprintf(stderr, "120 m waypoint lost to the 1 km one\n");
+    errors++;
+  }
+
+  const double spreads[] = {20, 200, 2000, 20000};
+  int trials = 0;
+  for (double spread : spreads) {
+    for (int round = 0; round < 50; round++) {
+      Location from = {(float)uniform(-70, 70), (float)uniform(-180, 180)};
+      fill(from, spread);
+      for (int q = 0; q < 20; q++, trials++) {
+        Location at = offset(from, uniform(0, spread), uniform(0, 2 * PI));
+        int expected = nearestReference(at);
+        int actual = waypoint::nearest(at);
+        if (actual == expected) {
+          continue;
+        }
+        waypoint::Waypoint a, e;
+        waypoint::get(actual, a);
+        waypoint::get(expected, e);
+        double loss = distanceMeters(at, a.location) -
+                      distanceMeters(at, e.location);
+        if (loss > 1.0) {
+          fprintf(stderr, "spread %.0f m: picked %.1f m, nearest %.1f m\n",
+                  spread, distanceMeters(at, a.location),
+                  distanceMeters(at, e.location));
+          errors++;
+        }
+      }
+    }
+  }
+  printf("nearest: %d queries with waypoints within 20 m..20 km, %d wrong\n",
+         trials, errors);
+  return errors;
+}
+
+template <typename F> static double timeNs(int rounds, F function) {
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    sink = sink + function(round);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / rounds;
+}
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 100000;
+  int errors = checkNearest();
+
+  // 航点分布在几百公里内, 查询位置每次略有变化
+  Location origin = {31.23f, 121.47f};
+  fill(origin, 300000);
+  std::vector<Location> queries;
+  for (int i = 0; i < 256; i++) {
+    queries.push_back(offset(origin, uniform(0, 300000), uniform(0, 2 * PI)));
+  }
+  size_t count = waypoint::count();
+  std::vector<Location> locations;
+  for (size_t i = 0; i < count; i++) {
+    waypoint::Waypoint wp;
+    waypoint::get(i, wp);
+    locations.push_back(wp.location);
+  }
+
+  double nearestNs = timeNs(rounds, [&](int round) {
+    return (float)waypoint::nearest(queries[round & 255]);
+  });
+  double navigateNs = timeNs(rounds / 10, [&](int round) {
+    float sum = 0, bearing, distance;
+    for (size_t i = 0; i < count; i++) {
+      waypoint::navigate(queries[round & 255], i, bearing, distance);
+      sum += bearing + distance;
+    }
+    return sum;
+  });
+  double legacyNs = timeNs(rounds / 10, [&](int round) {
+    const Location &from = queries[round & 255];
+    float sum = 0;
+    for (const Location &to : locations) {
+      sum += utils::complexDistance(from.latitude, from.longitude, to.latitude,
+                                    to.longitude) +
+             utils::calculateBearing(from.latitude, from.longitude,
+                                     to.latitude, to.longitude);
+    }
+    return sum;
+  });
+
+  printf("%zu waypoints\n", count);
+  printf("nearest   %8.1f ns/query\n", nearestNs);
+  printf("navigate  %8.1f ns for all waypoints (%.1f ns each)\n", navigateNs,
+         navigateNs / count);
+  printf("legacy    %8.1f ns for all waypoints (%.1f ns each)\n", legacyNs,
+         legacyNs / count);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+"""把网页资源打包成一个资源包镜像, 写入 webui 分区
+
+用法: python webui_bundle.py [webui目录] [输出文件]
+编译固件时 extra_script.py 会自动生成 .pio/build/<env>/webui.bin,
+pio run -t uploadwebui 单独烧录资源包.
+
+镜像格式(小端), 与 include/asset_def.h 中的 BundleHeader / BundleEntry 一致:
+  头部    32字节  magic "MCWB", 版本, 资源数量, 镜像大小, CRC32, 索引偏移, 索引项大小
+  索引    count * 160字节, 按请求路径排序, 固件直接在映射的flash上二分查找
+  数据    每个文件按 BUNDLE_ALIGN 对齐
+CRC32 覆盖头部之后的全部内容, 固件校验失败时不使用资源包,
+所以烧录到一半的镜像不会被加载. 资源包只有一份, 原地覆盖写入, 替换不是
+原子的: 烧录中断后到重新烧录之前, 网页服务改用 LittleFS 中的基础页面
+data/index.html (只有设备信息, 出生点和WiFi设置, 以及重新烧录的提示).
+"""
+import os
+import struct
+import sys
+import zlib
+
+import asset_manifest
+
+MAGIC = b"MCWB"
+VERSION = 1
+HEADER_FORMAT = "<4sHHIIII8x"
+ENTRY_FORMAT = "<96s20s32sIIB3x"
+BUNDLE_ALIGN = 16
+PATH_SIZE = 96
+ETAG_SIZE = 20
+CONTENT_TYPE_SIZE = 32
+
+
+def align(value):
+    return (value + BUNDLE_ALIGN - 1) // BUNDLE_ALIGN * BUNDLE_ALIGN
+
+
+def field(value, size, name):
+    data = value.encode()
+    # 至少留一个字节作为结束符
+    if len(data) >= size:
+        raise SystemExit("%s too long: %s" % (name, value))
+    return data
+
+
+def build(root):
+    entries = sorted(asset_manifest.entries(root))
+    header_size = struct.calcsize(HEADER_FORMAT)
+    entry_size = struct.calcsize(ENTRY_FORMAT)
+    offset = align(header_size + entry_size * len(entries))
+    table = b""
+    blobs = []
+    for url, file_path, size, gzip, immutable, etag, content_type in entries:
+        table += struct.pack(ENTRY_FORMAT,
+                             field(url, PATH_SIZE, "path"),
+                             field(etag, ETAG_SIZE, "etag"),
+                             field(content_type, CONTENT_TYPE_SIZE, "content type"),
+                             offset, size, gzip | (immutable << 1))
+        with open(os.path.join(root, file_path.lstrip("/")), "rb") as f:
+            data = f.read()
+        blobs.append(data + b"\0" * (align(size) - size))
+        offset += align(size)
+    body = table
+    body += b"\0" * (align(header_size + len(table)) - header_size - len(table))
+    body += b"".join(blobs)
+    header = struct.pack(HEADER_FORMAT, MAGIC, VERSION, len(entries),
+                         header_size + len(body), zlib.crc32(body),
+                         header_size, entry_size)
+    return header + body, len(entries)
+
+
+def generate(root, output):
+    image, count = build(root)
+    os.makedirs(os.path.dirname(os.path.abspath(output)), exist_ok=True)
+    with open(output, "wb") as f:
+        f.write(image)
+    return count, len(image)
+
+
+if __name__ == "__main__":
+    here = os.path.dirname(os.path.abspath(__file__))
+    root = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "..", "webui")
+    output = sys.argv[2] if len(sys.argv) > 2 else "webui.bin"
+    count, size = generate(root, output)
+    print("%d assets, %d bytes -> %s" % (count, size, output))
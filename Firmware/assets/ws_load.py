@@ -0,0 +1,111 @@
+"""/ws 方位角通道压测
+
+用法: python ws_load.py [--host esp32.local] [--rate 200] [--seconds 30]
+
+按指定频率发送方位角帧(rate 为 0 时尽可能快), 统计实际发送速率,
+根据遥测帧回带的时间戳计算往返延迟, 并打印设备统计的丢帧数量.
+只依赖标准库.
+"""
+import argparse
+import asyncio
+import base64
+import os
+import struct
+import time
+
+FRAME_AZIMUTH = 0x01
+FRAME_TELEMETRY = 0x81
+AZIMUTH_FORMAT = "<BBHHI"
+TELEMETRY_FORMAT = "<BBHIIIHI"
+
+
+def now_ms():
+    return int(time.monotonic() * 1000) & 0xFFFFFFFF
+
+
+def ws_frame(payload):
+    """客户端到服务端的帧必须加掩码"""
+    mask = os.urandom(4)
+    masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+    return bytes([0x82, 0x80 | len(payload)]) + mask + masked
+
+
+async def handshake(reader, writer, host):
+    key = base64.b64encode(os.urandom(16)).decode()
+    writer.write((
+        "GET /ws HTTP/1.1\r\n"
+        "Host: %s\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: %s\r\n"
+        "Sec-WebSocket-Version: 13\r\n\r\n" % (host, key)).encode())
+    status = await reader.readline()
+    if b" 101 " not in status:
+        raise SystemExit("handshake failed: %r" % status)
+    while (await reader.readline()) not in (b"\r\n", b""):
+        pass
+
+
+async def receive(reader, rtts, telemetry):
+    while True:
+        header = await reader.readexactly(2)
+        length = header[1] & 0x7F
+        if length == 126:
+            length = struct.unpack(">H", await reader.readexactly(2))[0]
+        elif length == 127:
+            length = struct.unpack(">Q", await reader.readexactly(8))[0]
+        payload = await reader.readexactly(length)
+        opcode = header[0] & 0x0F
+        if opcode == 0x8:
+            return
+        if opcode != 0x2 or len(payload) != struct.calcsize(TELEMETRY_FORMAT):
+            continue
+        fields = struct.unpack(TELEMETRY_FORMAT, payload)
+        if fields[0] != FRAME_TELEMETRY:
+            continue
+        rtts.append((now_ms() - fields[3]) & 0xFFFFFFFF)
+        telemetry[:] = fields
+
+
+async def run(host, port, rate, seconds):
+    reader, writer = await asyncio.open_connection(host, port)
+    await handshake(reader, writer, host)
+    rtts, telemetry = [], []
+    receiver = asyncio.ensure_future(receive(reader, rtts, telemetry))
+    interval = 1.0 / rate if rate > 0 else 0
+    start = time.monotonic()
+    sent = 0
+    while time.monotonic() - start < seconds:
+        angle = (sent * 37) % 36000
+        payload = struct.pack(AZIMUTH_FORMAT, FRAME_AZIMUTH, 0, sent & 0xFFFF,
+                              angle, now_ms())
+        writer.write(ws_frame(payload))
+        await writer.drain()
+        sent += 1
+        if interval:
+            await asyncio.sleep(start + sent * interval - time.monotonic())
+    elapsed = time.monotonic() - start
+    # 等待最后的遥测帧
+    await asyncio.sleep(0.5)
+    receiver.cancel()
+    writer.close()
+
+    print("sent %d frames in %.1f s, %.1f frames/s" % (sent, elapsed, sent / elapsed))
+    if rtts:
+        rtts.sort()
+        print("rtt ms: min %d, p50 %d, p95 %d, max %d (%d samples)" % (
+            rtts[0], rtts[len(rtts) // 2], rtts[len(rtts) * 95 // 100],
+            rtts[-1], len(rtts)))
+    if telemetry:
+        print("device: received %d, lost %d, free heap %d" % (
+            telemetry[4], telemetry[5], telemetry[7]))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--host", default="esp32.local")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--rate", type=float, default=200)
+    parser.add_argument("--seconds", type=float, default=30)
+    args = parser.parse_args()
+    asyncio.run(run(args.host, args.port, args.rate, args.seconds))
@@ -43,4 +43,39 @@ env.Append(CPPDEFINES=[
     ("DEFAULT_MODEL", model_enum),  # 覆盖宏定义中的默认型号
     ("DEFAULT_SERVER_MODE", server_mode_enum),  # 新增服务器模式定义
  ])
-print(f"Model: {model}, Server Mode: {server_mode}")
\ No newline at end of file
+print(f"Model: {model}, Server Mode: {server_mode}")
+
+# 打包文件系统前重新生成静态资源清单, 保证清单和镜像中的文件一致
+def generate_asset_manifest(source, target, env):
+    import sys
+    sys.path.insert(0, os.path.join(env.subst("$PROJECT_DIR"), "assets"))
+    import asset_manifest
+    count = asset_manifest.generate(env.subst("$PROJECT_DATA_DIR"))
+    print(f"Asset manifest: {count} assets")
+
+
+env.AddPreAction("$BUILD_DIR/${ESP32_FS_IMAGE_NAME}.bin", generate_asset_manifest)
+
+
+# 编译固件时同时生成网页资源包, 单独烧录: pio run -t uploadwebui
+def generate_webui_bundle(source, target, env):
+    import sys
+    sys.path.insert(0, os.path.join(env.subst("$PROJECT_DIR"), "assets"))
+    import webui_bundle
+    count, size = webui_bundle.generate(
+        os.path.join(env.subst("$PROJECT_DIR"), "webui"),
+        env.subst("$BUILD_DIR/webui.bin"))
+    print(f"Web UI bundle: {count} assets, {size} bytes")
+
+
+env.AddPreAction("$BUILD_DIR/${PROGNAME}.elf", generate_webui_bundle)
+env.AddCustomTarget(
+    name="uploadwebui",
+    dependencies=None,
+    actions=[
+        generate_webui_bundle,
+        '"$PYTHONEXE" "$UPLOADER" --chip esp32c3 --port "$UPLOAD_PORT" '
+        'write_flash 0x190000 "$BUILD_DIR/webui.bin"',
+    ],
+    title="Upload Web UI Bundle",
+    description="Build and flash the web UI bundle to the webui partition")
@@ -0,0 +1,72 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdint.h>
+
+/**
+ * 调试用的堆分配追踪器
+ *
+ * 定义 MCOMPASS_ALLOC_TRACKER 并通过 -Wl,--wrap 包装 malloc/calloc/realloc 与
+ * heap_caps_* 后生效(见 platformio.ini 中的 alloc-tracker 环境).
+ * arm() 之后按任务统计分配次数和字节数, ALLOC_GUARD 标记的作用域内出现堆分配会
+ * 被记录为违规并打印日志, 用来保证稳态路径(传感器->渲染)零分配.
+ * assets/alloc_cycle_test.cpp 在主机上用同样的包装运行这条路径, 断言每个周期
+ * 没有分配(CI 中运行).
+ * 未开启时所有接口都是空实现.
+ */
+namespace mcompass {
+namespace alloc_tracker {
+
+#if defined(MCOMPASS_ALLOC_TRACKER)
+/**
+ * @brief 初始化, 创建周期性报告定时器
+ */
+void init();
+
+/**
+ * @brief 开始统计, 一般在启动流程结束后调用
+ */
+void arm();
+
+/**
+ * @brief 获取任务在 arm() 之后的分配次数
+ * @param task 任务句柄, nullptr 表示当前任务
+ */
+uint32_t count(TaskHandle_t task = nullptr);
+
+/**
+ * @brief 获取 ALLOC_GUARD 作用域内发生分配的次数
+ */
+uint32_t violations();
+
+/**
+ * @brief 打印各任务的分配统计
+ */
+void report();
+
+/**
+ * @brief 作用域守卫, 析构时检查当前任务在作用域内是否发生了分配
+ */
+class Guard {
+public:
+  explicit Guard(const char *name);
+  ~Guard();
+
+private:
+  const char *m_name;
+  uint32_t m_start;
+};
+
+#define ALLOC_GUARD(name) mcompass::alloc_tracker::Guard _allocGuard(name)
+#else
+inline void init() {}
+inline void arm() {}
+inline uint32_t count(TaskHandle_t task = nullptr) { return 0; }
+inline uint32_t violations() { return 0; }
+inline void report() {}
+
+#define ALLOC_GUARD(name)
+#endif
+
+} // namespace alloc_tracker
+} // namespace mcompass
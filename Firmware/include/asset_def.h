@@ -0,0 +1,80 @@
+#pragma once
+#include <FS.h>
+
+#include "common.h"
+#include "macro_def.h"
+
+namespace mcompass {
+namespace asset {
+
+/// @brief 资源包头部, 小端, 由 assets/webui_bundle.py 生成
+struct __attribute__((packed)) BundleHeader {
+  char magic[4];        // "MCWB"
+  uint16_t version;     // ASSET_BUNDLE_VERSION
+  uint16_t count;       // 资源数量
+  uint32_t imageSize;   // 镜像总大小(字节), 含头部
+  uint32_t crc32;       // 头部之后全部内容的CRC32
+  uint32_t entryOffset; // 索引相对镜像起始的偏移
+  uint32_t entrySize;   // 索引项大小, 等于 sizeof(BundleEntry)
+  uint8_t reserved[8];
+};
+
+/// @brief 资源包索引项, 按 path 排序, 字符串以'\0'结尾
+struct __attribute__((packed)) BundleEntry {
+  char path[96];
+  char etag[20];
+  char contentType[32];
+  uint32_t offset; // 数据相对镜像起始的偏移, 按16字节对齐
+  uint32_t size;   // 数据大小(字节)
+  uint8_t flags;   // bit0: gzip, bit1: 不可变
+  uint8_t reserved[3];
+};
+
+/// @brief 静态资源清单中的一项, 字符串指向常驻内存的清单内容
+struct Entry {
+  const char *path;        // 请求路径, 不带 .gz
+  const char *file;        // 文件系统中的路径, 来自资源包时为 nullptr
+  const uint8_t *data;     // 来自资源包时指向映射的flash, 否则为 nullptr
+  uint32_t size;           // 文件大小(字节)
+  bool gzip;               // 文件是否gzip压缩
+  bool immutable;          // 文件名带内容哈希, 可以永久缓存
+  const char *etag;        // 强ETag, 带引号, 可以直接作为响应头
+  const char *contentType; // Content-Type
+};
+
+/**
+ * @brief 映射 webui 分区中的资源包
+ *
+ * 整个镜像映射到地址空间, 资源内容直接从映射的flash读取, 不需要挂载文件系统;
+ * 头部或CRC校验失败时(例如烧录中断)不使用资源包, 网页服务退回 LittleFS,
+ * 由其中的基础页面 data/index.html 提示重新烧录
+ *
+ * @return 资源包是否可用
+ */
+bool initBundle();
+
+/**
+ * @brief 从文件系统读取资源清单(ASSET_MANIFEST_FILE), 没有资源包时使用
+ *
+ * 清单由 assets/asset_manifest.py 在打包文件系统时生成, 读取后常驻内存,
+ * 之后查找资源不再访问文件系统
+ *
+ * @return 是否读取成功, 失败时 find 总是返回 nullptr
+ */
+bool init(fs::FS &fs);
+
+/**
+ * @brief 按请求路径查找资源, 二分查找
+ *
+ * @param path 请求路径
+ * @return 资源, 不存在时返回 nullptr
+ */
+const Entry *find(const char *path);
+
+/**
+ * @brief 清单中的资源数量
+ */
+size_t count();
+
+} // namespace asset
+} // namespace mcompass
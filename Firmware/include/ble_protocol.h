@@ -0,0 +1,109 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 蓝牙二进制配置协议
+ *
+ * 客户端向协议特征值(PROTOCOL_CHARACTERISTIC_UUID)无响应写入一帧:
+ *   version(1) sequence(1) 记录...
+ * 每条记录为 type(1) length(1) value(length), 多字节整数小端.
+ * 一帧中的记录全部校验通过后才执行, 配置类记录合并为一次NVS保存;
+ * 执行结果写回特征值并通知, 见 Response.
+ *
+ * 解码只依赖C标准库, 可以在主机上编译(见 assets/ble_protocol_fuzz.cpp)
+ */
+
+namespace mcompass {
+namespace ble_protocol {
+
+/// @brief 协议版本, 不兼容的修改才增加
+enum { VERSION = 1 };
+
+/// @brief 航点名称缓冲区大小, 与 WAYPOINT_NAME_LENGTH 一致
+enum { NAME_CAPACITY = 16 };
+
+/// @brief 记录类型, 每种类型在一帧中最多出现一次
+enum Type : uint8_t {
+  TYPE_BRIGHTNESS = 0x01,      // uint8 亮度
+  TYPE_SPAWN_COLOR = 0x02,     // uint8[3] 出生点指针颜色 R,G,B
+  TYPE_SOUTH_COLOR = 0x03,     // uint8[3] 指南针指针颜色 R,G,B
+  TYPE_SPAWN = 0x04,           // int32 纬度, int32 经度, 单位1e-7度
+  TYPE_SERVER_MODE = 0x05,     // uint8 0: WiFi, 1: 蓝牙, 重启后生效
+  TYPE_MODEL = 0x06,           // uint8 0: 标准版, 1: GPS版, 重启后生效
+  TYPE_WIFI_SSID = 0x07,       // 1~32字节, 必须和密码同时出现
+  TYPE_WIFI_PASSWORD = 0x08,   // 0~64字节
+  TYPE_WAYPOINT_ADD = 0x10,    // int32 纬度, int32 经度, 名称
+  TYPE_WAYPOINT_DELETE = 0x11, // 名称
+  TYPE_WAYPOINT_SELECT = 0x12, // int8 航点序号, -1 出生点, -2 最近的航点
+  TYPE_CALIBRATE = 0x18,       // 空, 请求校准传感器
+  TYPE_FACTORY_RESET = 0x19,   // 空, 恢复出厂设置
+};
+
+/// @brief 执行结果
+enum Status : uint8_t {
+  STATUS_OK = 0,
+  STATUS_BAD_VERSION = 1,  // 版本不支持
+  STATUS_TRUNCATED = 2,    // 帧头或记录不完整
+  STATUS_BAD_LENGTH = 3,   // 记录长度与类型不符
+  STATUS_BAD_VALUE = 4,    // 记录取值非法
+  STATUS_DUPLICATE = 5,    // 同一类型出现多次
+  STATUS_UNKNOWN_TYPE = 6, // 未知类型
+  STATUS_FAILED = 7,       // 执行失败, 例如保存失败或航点不存在
+};
+
+/// @brief 帧级别的错误没有对应的记录
+enum { NO_RECORD = 0xFF };
+
+/// @brief 执行结果, 写入协议特征值并通知
+struct __attribute__((packed)) Response {
+  uint8_t version;  // VERSION
+  uint8_t sequence; // 对应请求帧的序号
+  uint8_t status;   // Status
+  uint8_t record;   // 出错的记录序号(从0开始), 没有时为 NO_RECORD
+};
+
+/// @brief 解码后的一帧, 只有 has() 为true的字段有效
+struct Message {
+  uint8_t sequence;
+  uint32_t types; // 出现过的记录类型, 第 type 位
+  uint8_t brightness;
+  uint32_t spawnColor; // 0xRRGGBB
+  uint32_t southColor; // 0xRRGGBB
+  int32_t latitudeE7;
+  int32_t longitudeE7;
+  uint8_t serverMode;
+  uint8_t model;
+  char ssid[33];
+  char password[65];
+  int32_t waypointLatitudeE7;
+  int32_t waypointLongitudeE7;
+  char addName[NAME_CAPACITY];
+  char deleteName[NAME_CAPACITY];
+  int8_t selection;
+
+  bool has(Type type) const { return types & (1u << type); }
+};
+
+/**
+ * @brief 解码一帧
+ *
+ * 结构和取值全部在这里校验, 任何一条记录不合法时整帧失败;
+ * 字符串复制到 Message 中并以'\0'结尾, 不允许包含'\0'
+ *
+ * @param data 帧数据
+ * @param length 帧长度
+ * @param message 输出的消息
+ * @param record 失败时输出出错的记录序号, 帧级别错误为 NO_RECORD
+ * @return 解码结果
+ */
+Status decode(const uint8_t *data, size_t length, Message &message,
+              uint8_t &record);
+
+/**
+ * @brief 结果名称, 用于日志
+ */
+const char *statusName(Status status);
+
+} // namespace ble_protocol
+} // namespace mcompass
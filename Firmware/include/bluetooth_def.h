@@ -5,6 +5,21 @@
 
 namespace mcompass {
 namespace ble_server {
+
+/// @brief 方位角流通知的头部, 小端, 后面紧跟 count 个 AzimuthSample
+struct __attribute__((packed)) AzimuthStreamHeader {
+  uint16_t sequence;    // 通知序号, 每次加1, 用于统计丢包
+  uint8_t count;        // 样本数量
+  uint8_t reserved;     // 保留, 填0
+  uint32_t timestampMs; // 第一个样本的时间(毫秒, 设备启动后)
+};
+
+/// @brief 方位角样本, 小端
+struct __attribute__((packed)) AzimuthSample {
+  uint16_t angleX100; // 方位角, 0.01度, [0, 36000)
+  uint16_t offsetMs;  // 相对第一个样本的时间(毫秒)
+};
+
 /**
  * @brief 蓝牙初始化
  */
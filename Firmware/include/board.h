@@ -2,15 +2,24 @@
 
 #include <Arduino.h>
 
+#include "asset_def.h"
 #include "bluetooth_def.h"
 #include "button_def.h"
 #include "common.h"
+#include "config_def.h"
 #include "gps_def.h"
+#include "gps_power_def.h"
+#include "gps_replay.h"
+#include "ingest_def.h"
 #include "macro_def.h"
+#include "monitor_def.h"
+#include "net_power_def.h"
 #include "pixel_def.h"
+#include "position_filter_def.h"
 #include "preference_def.h"
 #include "sensor_def.h"
 #include "utils.h"
+#include "waypoint_def.h"
 #include "web_server_def.h"
 
 namespace mcompass {
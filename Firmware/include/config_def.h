@@ -0,0 +1,77 @@
+#pragma once
+#include "common.h"
+#include "macro_def.h"
+#include "utils.h"
+
+namespace mcompass {
+namespace config {
+
+/// @brief 批量配置中包含的字段
+enum Field : uint32_t {
+  FIELD_SPAWN_COLOR = 1 << 0, // 出生点指针颜色
+  FIELD_SOUTH_COLOR = 1 << 1, // 指南针指针颜色
+  FIELD_BRIGHTNESS = 1 << 2,  // 亮度
+  FIELD_SPAWN = 1 << 3,       // 目标出生点
+  FIELD_SERVER_MODE = 1 << 4, // 服务器模式, 重启后生效
+  FIELD_MODEL = 1 << 5,       // 型号, 重启后生效
+  FIELD_WIFI = 1 << 6,        // WiFi账号密码, 重启后生效
+};
+
+/// @brief 需要重启才能生效的字段
+constexpr uint32_t RESTART_FIELDS = FIELD_SERVER_MODE | FIELD_MODEL | FIELD_WIFI;
+
+/// @brief 一次批量配置, 只有 fields 中标记的字段有效
+struct Change {
+  uint32_t fields;
+  PointerColor color;
+  uint8_t brightness;
+  Location spawn;
+  ServerMode serverMode;
+  Model model;
+  char ssid[33];
+  char password[65];
+};
+
+/**
+ * @brief 初始化
+ */
+void init(Context *context);
+
+/**
+ * @brief 解析并校验JSON格式的批量配置
+ *
+ * 接受以下字段的任意子集, 出现未知字段或任何一个字段不合法时整体失败:
+ * {"brightness":56,"spawnColor":"#FF1414","southColor":"#FF1414",
+ *  "spawn":{"latitude":31.2,"longitude":121.4},"serverMode":0,"model":1,
+ *  "ssid":"...","password":"..."}
+ * ssid 和 password 必须同时出现
+ *
+ * @param json JSON文本, 不要求以'\0'结尾
+ * @param length 长度
+ * @param change 输出的配置
+ * @param error 失败时指向错误说明
+ * @return 是否解析成功
+ */
+bool parse(const char *json, size_t length, Change &change,
+           const char *&error);
+
+/**
+ * @brief 应用批量配置
+ *
+ * 先在一次NVS事务中保存全部字段, 保存成功后才更新 Context,
+ * 所以不会出现只有一部分配置生效的情况
+ *
+ * @return 是否保存成功
+ */
+bool apply(const Change &change);
+
+/**
+ * @brief 当前配置JSON, 字段与 parse 接受的一致(不包含密码)
+ *
+ * @param restart 为true时附加 "restart":true, 提示需要重启才能完全生效
+ */
+void toJson(utils::FixedString<CONFIG_JSON_CAPACITY> &json,
+            bool restart = false);
+
+} // namespace config
+} // namespace mcompass
@@ -2,6 +2,7 @@
 
 #include "IState.h"
 #include "common.h"
+#include "utils.h"
 #include <Arduino.h>
 
 namespace mcompass {
@@ -60,10 +61,10 @@ public:
   uint8_t getBrightness() const;
   void setBrightness(uint8_t bright);
 
-  String getSsid() const;
+  const String &getSsid() const;
   void setSsid(const String &id);
 
-  String getPassword() const;
+  const String &getPassword() const;
   void setPassword(const String &pass);
 
   Event::Source getSubscribeSource() const;
@@ -81,6 +82,11 @@ public:
 
   void logSelf(char *buffer);
 
+  /**
+   * @brief 生成设备信息JSON, 供网页和蓝牙共用
+   */
+  void infoJson(utils::FixedString<INFO_JSON_CAPACITY> &json);
+
   void setIsGPSFixed(bool isFixed);
   bool getIsGPSFixed() const;
 
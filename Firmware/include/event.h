@@ -3,6 +3,10 @@
 #include <stdint.h>
 
 ESP_EVENT_DECLARE_BASE(MCOMPASS_EVENT);
+// 方位角事件, 事件ID为消息源, 不携带数据, 数据存放在方位角邮箱中
+ESP_EVENT_DECLARE_BASE(MCOMPASS_AZIMUTH_EVENT);
+// GPS定位事件, 不携带数据, 最新定位存放在GPS模块的定位邮箱中
+ESP_EVENT_DECLARE_BASE(MCOMPASS_GPS_EVENT);
 
 namespace Event {
 
@@ -26,6 +30,7 @@ enum Source {
   GPS,         // GPS
   OTHER,       // 其他
   NETHER,      // 地狱
+  SOURCE_MAX,  // 消息源数量
 };
 
 // 事件结构
@@ -50,4 +55,37 @@ const char* TypeToString(Type type);
  *  @brief Source 转换为 const char *
  */
 const char* SourceToString(Source source);
+
+/**
+ * @brief 投递方位角
+ *
+ * 方位角写入对应消息源的邮箱, 只有邮箱中的旧值已被取走时才向事件循环投递
+ * 一个不携带数据的唤醒事件. esp_event_post_to 携带数据时会在堆上拷贝一份,
+ * 这样 传感器->渲染 的每个周期都不会产生堆分配, 积压的旧值也会被最新值覆盖.
+ *
+ * @param loop 事件循环
+ * @param source 消息源
+ * @param angle 方位角
+ * @return 是否投递了新的唤醒事件(false 表示与未处理的值合并或者队列已满)
+ */
+bool postAzimuth(esp_event_loop_handle_t loop, Source source, int angle);
+
+/**
+ * @brief 取出消息源邮箱中的方位角, 并构造成事件
+ *
+ * @param source 消息源
+ * @param evt 输出的事件
+ */
+void takeAzimuth(Source source, Body* evt);
+
+/**
+ * @brief 读取消息源邮箱中最新的方位角, 不取走
+ *
+ * 同一个唤醒事件的其他处理器(例如蓝牙通知)用它读取数据,
+ * 不会清除待处理标记, 也不会访问传感器
+ *
+ * @param source 消息源
+ * @return 方位角
+ */
+int peekAzimuth(Source source);
 }  // namespace Event
@@ -1,6 +1,7 @@
 #pragma once
 #include "common.h"
 #include "macro_def.h"
+#include "nmea_parser.h"
 
 namespace mcompass {
 namespace gps {
@@ -25,5 +26,21 @@ bool isValidGPSLocation(Location location);
  * @brief GPS 关闭
  */
 void disable();
+/**
+ * @brief 读取最新的定位记录
+ *
+ * 定位记录由NMEA解析任务写入, 只保留最新的一条, 任何任务都可以随时读取
+ *
+ * @param fix 输出的定位记录
+ * @return 是否收到过定位记录
+ */
+bool getLatestFix(gps_fix_record_t *fix);
+/**
+ * @brief 读取NMEA串口接收统计(字节数, 语句数, 校验错误, 溢出, 重新同步)
+ *
+ * @param stats 输出的统计
+ * @return GPS解析器是否在运行
+ */
+bool getParserStats(nmea_parser_stats_t *stats);
 } // namespace gps
 } // namespace mcompass
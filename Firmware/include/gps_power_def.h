@@ -0,0 +1,61 @@
+#pragma once
+#include "common.h"
+#include "macro_def.h"
+#include "nmea_parser.h"
+
+namespace mcompass {
+namespace gps_power {
+
+/// @brief GPS电源状态
+enum class State {
+  OFF,       // 关闭(未检测到GPS或已禁用)
+  ACQUIRING, // 已上电, 等待定位
+  TRACKING,  // 已定位, 持续跟踪
+  SLEEPING,  // 休眠中, 等待唤醒定时器
+};
+
+/// @brief GPS电源统计
+struct Stats {
+  State state;           // 当前状态
+  uint32_t wakeCount;    // 唤醒次数
+  uint64_t onTimeMs;     // 累计上电时间
+  uint64_t uptimeMs;     // 统计开始至今的时间
+  uint32_t lastTtffMs;   // 最近一次唤醒到定位的时间
+  uint32_t hotTtffMs;    // 热启动定位时间估计
+  uint32_t warmTtffMs;   // 温启动定位时间估计
+  uint32_t lastSleepSec; // 最近一次的休眠时长
+};
+
+/**
+ * @brief 初始化, 创建唤醒定时器并给GPS上电
+ */
+void init();
+
+/**
+ * @brief 处理一次有效定位, 决定继续跟踪还是休眠
+ *
+ * 根据到目标的距离找到所在距离区间, 用地速和航向估计最早进入更近区间的时间,
+ * 扣除下一次启动的定位时间后作为休眠时长
+ *
+ * @param fix 定位记录
+ * @param target 目标坐标
+ */
+void onFix(const gps_fix_record_t &fix, const Location &target);
+
+/**
+ * @brief 关闭GPS电源并停止唤醒定时器
+ */
+void shutdown();
+
+/**
+ * @brief 获取统计信息
+ */
+Stats getStats();
+
+/**
+ * @brief State 转换为 const char *
+ */
+const char *stateToString(State state);
+
+} // namespace gps_power
+} // namespace mcompass
@@ -0,0 +1,87 @@
+#pragma once
+#include <esp_timer.h>
+#include <stdint.h>
+
+#include "nmea_parser.h"
+#include "position_filter_def.h"
+
+/**
+ * 调试用的GPS轨迹回放
+ *
+ * 定义 MCOMPASS_GPS_REPLAY 后生效(见 platformio.ini 中的 gps-replay 环境).
+ * 从 LittleFS 读取 GPS_REPLAY_FILE 中的NMEA轨迹, 通过GPS串口的内部回环发送给
+ * NMEA解析任务, 串口接收, 解析, 滤波, GPS电源管理和检测超时都走真实路径.
+ * 回放按轨迹中的UTC时间以 GPS_REPLAY_SPEED 倍速进行, now() 返回同样倍速的虚拟
+ * 时间, 定时器时长用 scale() 缩短. GPS断电期间轨迹照常前进但不发送.
+ * 定位, 电源开关和休眠定时器以 "replay" 标签逐行打印, 便于在主机上比对.
+ * 未开启时 now() 就是 esp_timer_get_time(), 其余接口都是空实现.
+ * 同样的场景平时在主机上检查(assets/gps_pipeline_check.sh, 可以放进CI),
+ * 设备上的回放只用来确认真实串口和任务调度下的结果一致.
+ */
+namespace mcompass {
+namespace gps_replay {
+
+#if defined(MCOMPASS_GPS_REPLAY)
+/**
+ * @brief 打开轨迹文件, 打开成功时把串口波特率改为 GPS_REPLAY_BAUD_RATE
+ *
+ * @param config NMEA解析器配置, 在 nmea_parser_init 之前调用
+ * @return 是否进入回放模式
+ */
+bool init(nmea_parser_config_t &config);
+
+/**
+ * @brief 开启串口回环并启动回放任务, 在 nmea_parser_init 之后调用
+ */
+void start(uart_port_t port);
+
+/**
+ * @brief 停止回放, 在删除串口驱动之前调用
+ */
+void stop();
+
+/**
+ * @brief 把 esp_timer_get_time() 的时间换算为虚拟时间(微秒)
+ */
+int64_t toVirtual(int64_t us);
+
+/**
+ * @brief 虚拟时间(微秒)
+ */
+int64_t now();
+
+/**
+ * @brief 把虚拟时长(微秒)换算为实际定时器时长
+ */
+uint64_t scale(uint64_t us);
+
+/**
+ * @brief 记录GPS电源开关
+ */
+void onPower(bool on);
+
+/**
+ * @brief 记录休眠定时器
+ */
+void onSleep(uint32_t seconds);
+
+/**
+ * @brief 记录一次定位和滤波结果
+ */
+void onFix(const gps_fix_record_t &fix,
+           const position_filter::Estimate &estimate);
+#else
+inline bool init(nmea_parser_config_t &config) { return false; }
+inline void start(uart_port_t port) {}
+inline void stop() {}
+inline int64_t toVirtual(int64_t us) { return us; }
+inline int64_t now() { return esp_timer_get_time(); }
+inline uint64_t scale(uint64_t us) { return us; }
+inline void onPower(bool on) {}
+inline void onSleep(uint32_t seconds) {}
+inline void onFix(const gps_fix_record_t &fix,
+                  const position_filter::Estimate &estimate) {}
+#endif
+
+} // namespace gps_replay
+} // namespace mcompass
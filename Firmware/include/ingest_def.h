@@ -0,0 +1,58 @@
+#pragma once
+#include "common.h"
+#include "macro_def.h"
+
+namespace mcompass {
+namespace ingest {
+
+/// @brief 外部方位角的接入通道, 每个通道单独限速和计数
+enum Channel {
+  HTTP,        // POST /setAzimuth
+  WEB_SOCKET,  // /ws
+  UDP,         // UDP方位角包
+  CHANNEL_MAX, // 通道数量
+};
+
+/// @brief 提交结果
+enum Result {
+  ACCEPTED,  // 已投递到方位角邮箱
+  COALESCED, // 邮箱中的旧值还没被取走, 被新值覆盖
+  REJECTED,  // 超过限速, 丢弃
+};
+
+/// @brief 通道计数
+struct Stats {
+  uint32_t accepted;
+  uint32_t coalesced;
+  uint32_t rejected;
+};
+
+/**
+ * @brief 初始化
+ */
+void init(Context *context);
+
+/**
+ * @brief 提交一个外部方位角
+ *
+ * 每个通道一个令牌桶, 令牌用完时直接丢弃而不是阻塞或断言;
+ * 通过限速的值切换到MOD模式并写入 WEB_SERVER 方位角邮箱, 只保留最新值.
+ *
+ * @param channel 接入通道
+ * @param angle 方位角(度)
+ * @return 提交结果
+ */
+Result submit(Channel channel, int angle);
+
+/**
+ * @brief 获取通道计数
+ */
+Stats getStats(Channel channel);
+
+/**
+ * @brief 通道名称
+ */
+const char *channelName(Channel channel);
+
+} // namespace ingest
+} // namespace mcompass
@@ -28,8 +28,95 @@
 #define DEFAULT_WIFI_CONNECT_TIME 15
 // 默认无client连接关闭web server时间
 #define DEFAULT_SERVER_TIMEOUT 120
+// HTTP长连接空闲超时(秒)和每个连接最多处理的请求数
+#define HTTP_KEEP_ALIVE_TIMEOUT 5
+#define HTTP_KEEP_ALIVE_MAX 100
+// 路由表最多接口数量
+#define ROUTE_MAX 40
+// WebSocket最多客户端数量
+#define WEB_SOCKET_MAX_CLIENTS 2
+// WebSocket遥测帧最短间隔(毫秒)
+#define WEB_SOCKET_TELEMETRY_INTERVAL 100
+// 实时遥测(/events)默认推送间隔和允许范围(毫秒)
+#define DEFAULT_EVENTS_INTERVAL 500
+#define MIN_EVENTS_INTERVAL 100
+#define MAX_EVENTS_INTERVAL 10000
+// 网页资源包分区名称和格式版本
+#define ASSET_BUNDLE_PARTITION "webui"
+#define ASSET_BUNDLE_VERSION 1
+// 网页静态资源清单, 由 assets/asset_manifest.py 生成
+#define ASSET_MANIFEST_FILE "/assets.manifest"
+// 静态资源请求路径最大长度
+#define ASSET_PATH_MAX 128
+// 外部方位角每个接入通道的限速(次/秒)和突发容量
+#define INGEST_RATE_LIMIT 200
+#define INGEST_BURST 20
+// UDP方位角端口, 通过mDNS _mcompass._udp 广播
+#define UDP_AZIMUTH_PORT 4210
+// 超过这个时间(毫秒)没有收到UDP方位角, 下一个包无论序号都接受, 用于发送端重启
+#define UDP_AZIMUTH_RESYNC_INTERVAL 1000
+// WiFi省电模式评估间隔(毫秒)
+#define NET_POWER_TICK_INTERVAL 1000
+// 最后一次HTTP请求后保持DTIM唤醒(MIN_MODEM)的时间(秒), 之后进入深度省电
+#define NET_POWER_INTERACTIVE_TIMEOUT 20
+// 最后一个UDP方位角之后保持射频常开的时间(秒)
+#define NET_POWER_STREAM_HOLD 3
+// STA模式下没有客户端时, 以深度省电继续提供网页服务的时间(秒)
+#define NET_POWER_IDLE_SHUTDOWN 600
 // 默认检测不到GPS,关闭GPS供电时间
 #define DEFAULT_GPS_DETECT_TIMEOUT 30
+// GPS最短休眠时间 30秒, 更短时不值得断电
+#define GPS_MIN_SLEEP_INTERVAL 30
+// GPS热启动窗口 2小时, 断电时间更长时星历可能失效
+#define GPS_HOT_START_WINDOW (2 * 60 * 60)
+// GPS热启动/温启动定位时间初始估计(毫秒)
+#define GPS_DEFAULT_HOT_TTFF_MS 5000
+#define GPS_DEFAULT_WARM_TTFF_MS 35000
+// 估计最早到达时假设的最低速度(米/秒), 约等于步行速度
+#define GPS_MIN_ASSUMED_SPEED 1.5f
+// 正在接近目标时的速度余量
+#define GPS_APPROACH_SPEED_FACTOR 1.5f
+// 唤醒后没有地速时, 至少跟踪的定位次数
+#define GPS_MIN_TRACK_FIXES 5
+// 位置滤波: 用户等效测距误差(米), 观测标准差 = UERE * HDOP
+#define GPS_FILTER_UERE 4.0f
+// 位置滤波: 没有HDOP时使用的默认值
+#define GPS_FILTER_DEFAULT_HDOP 2.0f
+// 位置滤波: 卫星数少于该值时降低观测权重
+#define GPS_FILTER_MIN_SATS 6
+// 位置滤波: 加速度噪声(米/秒^2)
+#define GPS_FILTER_ACCEL_NOISE 0.5f
+// 位置滤波: 初始速度标准差(米/秒)
+#define GPS_FILTER_INIT_SPEED_SIGMA 5.0f
+// 位置滤波: 两次定位间隔超过该值(秒)时重新初始化
+#define GPS_FILTER_RESET_GAP 10.0f
+// 位置滤波: 跳点剔除门限(马氏距离平方, 2自由度)
+#define GPS_FILTER_GATE 16.0f
+// 位置滤波: 连续剔除次数超过该值时重新初始化
+#define GPS_FILTER_MAX_REJECTS 3
+// 位置滤波: 局部坐标原点的最大偏移(米)
+#define GPS_FILTER_ORIGIN_RANGE 5000.0f
+// 到达半径(米), 实际半径还要加上两倍位置标准差
+#define GPS_ARRIVED_RADIUS 8.0f
+// 离开时到达半径的放大倍数
+#define GPS_ARRIVED_HYSTERESIS 1.5f
+// GPS轨迹回放(调试): 轨迹文件, 回放倍速和回环串口波特率
+#define GPS_REPLAY_FILE "/replay.nmea"
+#define GPS_REPLAY_SPEED 100
+#define GPS_REPLAY_BAUD_RATE 921600
+// 最多保存的航点数量
+#define WAYPOINT_MAX 64
+// 航点名称长度(含结尾的'\0')
+#define WAYPOINT_NAME_LENGTH 16
+
+// 事件循环任务栈大小
+#define EVENT_LOOP_TASK_STACK_SIZE (1024 * 8)
+// 校准任务栈大小
+#define CALIBRATE_TASK_STACK_SIZE 8192
+// 栈/堆水位采样间隔 5秒
+#define MONITOR_SAMPLE_INTERVAL 5
+// 栈/堆水位报告间隔 5分钟
+#define MONITOR_REPORT_INTERVAL (5 * 60)
 
 // 默认初始的坐标值
 #define DEFAULT_INVALID_LOCATION_VALUE 255.0f
@@ -61,6 +148,10 @@
   "{\"buildDate\":\"" __DATE__ "\",\"buildTime\":\"" __TIME__                  \
   "\",\"buildVersion\":\"" BUILD_VERSION "\",\"gitBranch\":\"" GIT_BRANCH      \
   "\",\"gitCommit\":\"" GIT_COMMIT "\"}"
+// 设备信息JSON缓冲区容量
+#define INFO_JSON_CAPACITY 256
+// 批量配置JSON最大长度, 同时用于请求体和 config::toJson
+#define CONFIG_JSON_CAPACITY 512
 
 ///////////////////// 蓝牙相关 ///////////////////////
 /* 基础配置 */
@@ -79,6 +170,27 @@
   (uint16_t)(BASE_SERVICE_UUID + 8) // 服务器模式
 #define CUSTOM_MODEL_CHARACTERISTIC_UUID                                       \
   (uint16_t)(BASE_SERVICE_UUID + 9) // 自定义型号
+#define WAYPOINT_CHARACTERISTIC_UUID                                           \
+  (uint16_t)(BASE_SERVICE_UUID + 10) // 航点
+#define CONFIG_CHARACTERISTIC_UUID                                             \
+  (uint16_t)(BASE_SERVICE_UUID + 11) // 批量配置
+#define PROTOCOL_CHARACTERISTIC_UUID                                           \
+  (uint16_t)(BASE_SERVICE_UUID + 12) // 二进制配置协议, 见 ble_protocol.h
+#define AZIMUTH_STREAM_CHARACTERISTIC_UUID                                     \
+  (uint16_t)(BASE_SERVICE_UUID + 13) // 方位角流, 批量样本通知
+// 按属性句柄分发读写的表大小, 需要大于全部服务的属性数量
+#define BLE_HANDLE_TABLE_SIZE 64
+// 请求的连接间隔范围(1.25毫秒), 从设备延迟和监督超时(10毫秒)
+#define BLE_CONN_INTERVAL_MIN 12
+#define BLE_CONN_INTERVAL_MAX 24
+#define BLE_CONN_LATENCY 4
+#define BLE_CONN_TIMEOUT 200
+// 方位角流: 变化超过阈值(度)才采样, 采样最短间隔(毫秒, 即最高50Hz), 每个通知最多样本数
+#define BLE_AZIMUTH_THRESHOLD 1
+#define BLE_AZIMUTH_SAMPLE_INTERVAL 20
+#define BLE_AZIMUTH_BATCH_MAX 16
+// 旧方位角特征值的通知间隔(毫秒)
+#define BLE_AZIMUTH_LEGACY_INTERVAL 1000
 
 /** 高级配置  */
 #define ADVANCED_SERVICE_UUID (uint16_t)0xfa00
@@ -100,6 +212,7 @@
 #define BRIGHTNESS_KEY "brightness"       // 亮度
 #define MODEL_KEY "model_key"             // 型号
 #define CALIBRATION_KEY "calibration_key" // 校准数据
+#define WAYPOINTS_KEY "waypoints"         // 航点表
 
 ///////////////////// 错误信息 ///////////////////////
 #define SENSOR_ERROR "Sensor Error 100"           // 传感器错误
@@ -0,0 +1,49 @@
+#pragma once
+#include "common.h"
+#include "macro_def.h"
+
+namespace mcompass {
+namespace monitor {
+
+/// @brief 堆内存统计
+struct HeapStats {
+  uint32_t freeBytes;       // 当前空闲
+  uint32_t minFreeBytes;    // 历史最小空闲(跨重启)
+  uint32_t largestBlock;    // 当前最大连续空闲块
+  uint32_t minLargestBlock; // 历史最小的最大连续空闲块(跨重启)
+  uint8_t fragmentation;    // 当前碎片率(%)
+  uint8_t maxFragmentation; // 历史最大碎片率(%)(跨重启)
+};
+
+/**
+ * @brief 初始化, 恢复RTC内存中保存的历史水位并启动周期采样
+ */
+void init();
+
+/**
+ * @brief 立即采样一次所有任务的栈水位和堆状态
+ */
+void sample();
+
+/**
+ * @brief 打印历史最差水位以及推荐的任务栈大小
+ */
+void report();
+
+/**
+ * @brief 获取堆内存统计
+ */
+HeapStats getHeapStats();
+
+/**
+ * @brief 获取任务历史最小剩余栈(字节), 未记录的任务返回0
+ */
+uint32_t getMinFreeStack(const char *taskName);
+
+/**
+ * @brief 清空历史水位
+ */
+void reset();
+
+} // namespace monitor
+} // namespace mcompass
@@ -0,0 +1,58 @@
+#pragma once
+#include "common.h"
+#include "macro_def.h"
+
+namespace mcompass {
+namespace net_power {
+
+/// @brief 按网络活动选择的功耗档位
+enum Mode {
+  UNMANAGED,   // 未连接路由器或处于热点模式, 不调整省电模式
+  STREAMING,   // 有实时流客户端, 射频常开(WIFI_PS_NONE)
+  INTERACTIVE, // 最近有网页请求, 每个DTIM唤醒(WIFI_PS_MIN_MODEM)
+  IDLE,        // 没有客户端, 按监听间隔唤醒(WIFI_PS_MAX_MODEM)
+  MODE_MAX,    // 档位数量
+};
+
+/// @brief 各档位累计时间
+struct Stats {
+  Mode mode;                 // 当前档位
+  uint32_t switches;         // 切换次数
+  uint32_t idleSeconds;      // 距离最后一次网络活动的时间
+  uint32_t timeMs[MODE_MAX]; // 每个档位的累计时间
+};
+
+/**
+ * @brief 初始化并开始按活动调整省电模式, 在STA模式连接路由器前调用
+ *
+ * @param streamClients 返回当前实时流(WebSocket, /events)客户端数量
+ */
+void init(uint32_t (*streamClients)());
+
+/**
+ * @brief 停止调整, 恢复射频常开
+ */
+void deinit();
+
+/**
+ * @brief 收到网页请求, 立即至少切换到 INTERACTIVE
+ */
+void notifyRequest();
+
+/**
+ * @brief 收到实时流数据(UDP方位角), 立即切换到 STREAMING
+ */
+void notifyStream();
+
+/**
+ * @brief 获取统计
+ */
+Stats getStats();
+
+/**
+ * @brief 档位名称
+ */
+const char *modeName(Mode mode);
+
+} // namespace net_power
+} // namespace mcompass
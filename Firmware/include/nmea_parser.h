@@ -11,18 +11,10 @@ extern "C" {
 #endif
 
 #include "esp_types.h"
-#include "esp_event.h"
 #include "esp_err.h"
 #include "driver/uart.h"
 
-#define GPS_MAX_SATELLITES_IN_USE (12)
-#define GPS_MAX_SATELLITES_IN_VIEW (16)
-
-/**
- * @brief Declare of NMEA Parser Event base
- *
- */
-ESP_EVENT_DECLARE_BASE(ESP_NMEA_EVENT);
+#define NMEA_PARSER_TASK_STACK_SIZE (3072)
 
 /**
  * @brief GPS fix type
@@ -35,85 +27,42 @@ typedef enum {
 } gps_fix_t;
 
 /**
- * @brief GPS fix mode
- *
- */
-typedef enum {
-    GPS_MODE_INVALID = 1, /*!< Not fixed */
-    GPS_MODE_2D,          /*!< 2D GPS */
-    GPS_MODE_3D           /*!< 3D GPS */
-} gps_fix_mode_t;
-
-/**
- * @brief GPS satellite information
+ * @brief Compact fix record handed to the user once per navigation epoch
  *
  */
 typedef struct {
-    uint8_t num;       /*!< Satellite number */
-    uint8_t elevation; /*!< Satellite elevation */
-    uint16_t azimuth;  /*!< Satellite azimuth */
-    uint8_t snr;       /*!< Satellite signal noise ratio */
-} gps_satellite_t;
+    int32_t latitude_e7;  /*!< Latitude, 1e-7 degree, north positive */
+    int32_t longitude_e7; /*!< Longitude, 1e-7 degree, east positive */
+    uint32_t speed_mmps;  /*!< Ground speed, millimetre per second */
+    uint16_t course_x100; /*!< Course over ground, 0.01 degree */
+    uint16_t hdop_x100;   /*!< Horizontal dilution of precision * 100 */
+    uint8_t fix;          /*!< Fix quality, see gps_fix_t */
+    uint8_t sats_in_use;  /*!< Number of satellites in use */
+    bool has_velocity;    /*!< Speed and course were refreshed by RMC/VTG since the last record */
+    uint32_t utc_ms;      /*!< UTC time of day, millisecond */
+    int64_t timestamp_us; /*!< esp_timer_get_time() when the epoch was completed */
+} gps_fix_record_t;
 
 /**
- * @brief GPS time
+ * @brief Callback invoked from the parser task with each new fix record
  *
+ * The record is only valid during the call, copy what is needed and return
+ * quickly.
  */
-typedef struct {
-    uint8_t hour;      /*!< Hour */
-    uint8_t minute;    /*!< Minute */
-    uint8_t second;    /*!< Second */
-    uint16_t thousand; /*!< Thousand */
-} gps_time_t;
+typedef void (*nmea_fix_cb_t)(const gps_fix_record_t *fix, void *arg);
 
 /**
- * @brief GPS date
+ * @brief Ingestion statistics of NMEA Parser
  *
  */
 typedef struct {
-    uint8_t day;   /*!< Day (start from 1) */
-    uint8_t month; /*!< Month (start from 1) */
-    uint16_t year; /*!< Year (start from 2000) */
-} gps_date_t;
-
-/**
- * @brief NMEA Statement
- *
- */
-typedef enum {
-    STATEMENT_UNKNOWN = 0, /*!< Unknown statement */
-    STATEMENT_GGA,         /*!< GGA */
-    STATEMENT_GSA,         /*!< GSA */
-    STATEMENT_RMC,         /*!< RMC */
-    STATEMENT_GSV,         /*!< GSV */
-    STATEMENT_GLL,         /*!< GLL */
-    STATEMENT_VTG          /*!< VTG */
-} nmea_statement_t;
-
-/**
- * @brief GPS object
- *
- */
-typedef struct {
-    float latitude;                                                /*!< Latitude (degrees) */
-    float longitude;                                               /*!< Longitude (degrees) */
-    float altitude;                                                /*!< Altitude (meters) */
-    gps_fix_t fix;                                                 /*!< Fix status */
-    uint8_t sats_in_use;                                           /*!< Number of satellites in use */
-    gps_time_t tim;                                                /*!< time in UTC */
-    gps_fix_mode_t fix_mode;                                       /*!< Fix mode */
-    uint8_t sats_id_in_use[GPS_MAX_SATELLITES_IN_USE];             /*!< ID list of satellite in use */
-    float dop_h;                                                   /*!< Horizontal dilution of precision */
-    float dop_p;                                                   /*!< Position dilution of precision  */
-    float dop_v;                                                   /*!< Vertical dilution of precision  */
-    uint8_t sats_in_view;                                          /*!< Number of satellites in view */
-    gps_satellite_t sats_desc_in_view[GPS_MAX_SATELLITES_IN_VIEW]; /*!< Information of satellites in view */
-    gps_date_t date;                                               /*!< Fix date */
-    bool valid;                                                    /*!< GPS validity */
-    float speed;                                                   /*!< Ground speed, unit: m/s */
-    float cog;                                                     /*!< Course over ground */
-    float variation;                                               /*!< Magnetic variation */
-} gps_t;
+    uint32_t bytes;         /*!< Bytes read from the UART */
+    uint32_t lines;         /*!< Sentences handed to the tokenizer */
+    uint32_t crc_errors;    /*!< Sentences with a checksum mismatch */
+    uint32_t format_errors; /*!< Malformed sentences */
+    uint32_t overflows;     /*!< UART hardware FIFO or ring buffer overflows */
+    uint32_t resyncs;       /*!< Partial sentences dropped on a new '$' or when too long */
+} nmea_parser_stats_t;
 
 /**
  * @brief Configuration of NMEA Parser
@@ -154,15 +103,6 @@ typedef void *nmea_parser_handle_t;
         }                                         \
     }
 
-/**
- * @brief NMEA Parser Event ID
- *
- */
-typedef enum {
-    GPS_UPDATE, /*!< GPS information has been updated */
-    GPS_UNKNOWN /*!< Unknown statements detected */
-} nmea_event_id_t;
-
 /**
  * @brief Init NMEA Parser
  *
@@ -180,30 +120,23 @@ nmea_parser_handle_t nmea_parser_init(const nmea_parser_config_t *config);
 esp_err_t nmea_parser_deinit(nmea_parser_handle_t nmea_hdl);
 
 /**
- * @brief Add user defined handler for NMEA parser
+ * @brief Set the callback receiving fix records
  *
  * @param nmea_hdl handle of NMEA parser
- * @param event_handler user defined event handler
- * @param handler_args handler specific arguments
- * @return esp_err_t
- *  - ESP_OK: Success
- *  - ESP_ERR_NO_MEM: Cannot allocate memory for the handler
- *  - ESP_ERR_INVALIG_ARG: Invalid combination of event base and event id
- *  - Others: Fail
+ * @param fix_cb callback, NULL to stop delivering fixes
+ * @param cb_arg argument passed to the callback
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG on NULL handle
  */
-esp_err_t nmea_parser_add_handler(nmea_parser_handle_t nmea_hdl, esp_event_handler_t event_handler, void *handler_args);
+esp_err_t nmea_parser_set_fix_callback(nmea_parser_handle_t nmea_hdl, nmea_fix_cb_t fix_cb, void *cb_arg);
 
 /**
- * @brief Remove user defined handler for NMEA parser
+ * @brief Get ingestion statistics
  *
  * @param nmea_hdl handle of NMEA parser
- * @param event_handler user defined event handler
- * @return esp_err_t
- *  - ESP_OK: Success
- *  - ESP_ERR_INVALIG_ARG: Invalid combination of event base and event id
- *  - Others: Fail
+ * @param stats receives the statistics
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG on NULL handle
  */
-esp_err_t nmea_parser_remove_handler(nmea_parser_handle_t nmea_hdl, esp_event_handler_t event_handler);
+esp_err_t nmea_parser_get_stats(nmea_parser_handle_t nmea_hdl, nmea_parser_stats_t *stats);
 
 #ifdef __cplusplus
 }
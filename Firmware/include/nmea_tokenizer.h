@@ -0,0 +1,110 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * NMEA tokenizer core
+ *
+ * Parses one NMEA 0183 sentence in a single pass over the caller's line
+ * buffer: the checksum is accumulated while the fields are split into
+ * (pointer, length) views, nothing is copied and nothing is allocated.
+ * Coordinates are decoded into integer 1e-7 degrees and every other value
+ * into scaled integers, so no float math is involved.
+ *
+ * The core only depends on the C standard library so it can be built on the
+ * host as well as on the target.
+ */
+
+#define NMEA_TOKENIZER_MAX_FIELDS (24)
+#define NMEA_TOKENIZER_MAX_SATS_IN_USE (12)
+
+/**
+ * @brief Sentences understood by the tokenizer
+ *
+ */
+typedef enum {
+    NMEA_SENTENCE_UNKNOWN = 0, /*!< Unknown or unsupported sentence */
+    NMEA_SENTENCE_GGA,         /*!< Fix data */
+    NMEA_SENTENCE_GSA,         /*!< DOP and active satellites */
+    NMEA_SENTENCE_RMC,         /*!< Recommended minimum data */
+    NMEA_SENTENCE_VTG,         /*!< Course and speed over ground */
+} nmea_sentence_t;
+
+/**
+ * @brief Result of parsing a line
+ *
+ */
+typedef enum {
+    NMEA_OK = 0,          /*!< Sentence parsed and applied */
+    NMEA_ERR_FORMAT,      /*!< No '$', no '*', bad checksum digits or too many fields */
+    NMEA_ERR_CRC,         /*!< Checksum mismatch */
+    NMEA_ERR_UNSUPPORTED, /*!< Valid sentence of a type we do not decode */
+} nmea_result_t;
+
+/**
+ * @brief Navigation data accumulated from the decoded sentences
+ *
+ */
+typedef struct {
+    int32_t latitude_e7;                                    /*!< Latitude, 1e-7 degree, north positive */
+    int32_t longitude_e7;                                   /*!< Longitude, 1e-7 degree, east positive */
+    int32_t altitude_mm;                                    /*!< Altitude above ellipsoid, millimetre */
+    uint32_t time_ms;                                       /*!< UTC time of day, millisecond */
+    uint8_t day;                                            /*!< Day (start from 1) */
+    uint8_t month;                                          /*!< Month (start from 1) */
+    uint8_t year;                                           /*!< Year (start from 2000) */
+    uint8_t fix;                                            /*!< GGA fix quality, 0 means no fix */
+    uint8_t fix_mode;                                       /*!< GSA fix mode, 1 none, 2 2D, 3 3D */
+    uint8_t sats_in_use;                                    /*!< Number of satellites in use */
+    uint8_t sats_id_in_use[NMEA_TOKENIZER_MAX_SATS_IN_USE]; /*!< ID list of satellites in use */
+    uint16_t hdop_x100;                                     /*!< Horizontal dilution of precision * 100 */
+    uint16_t pdop_x100;                                     /*!< Position dilution of precision * 100 */
+    uint16_t vdop_x100;                                     /*!< Vertical dilution of precision * 100 */
+    uint32_t speed_mmps;                                    /*!< Ground speed, millimetre per second */
+    uint16_t course_x100;                                   /*!< Course over ground, 0.01 degree */
+    bool valid;                                             /*!< RMC status is 'A' */
+} nmea_data_t;
+
+/**
+ * @brief Tokenizer state and statistics
+ *
+ */
+typedef struct {
+    nmea_data_t data;        /*!< Accumulated navigation data */
+    uint32_t updated;        /*!< OR'd (1 << nmea_sentence_t) of sentences applied since last clear */
+    uint32_t lines;          /*!< Lines handed to the tokenizer */
+    uint32_t crc_errors;     /*!< Lines with a checksum mismatch */
+    uint32_t format_errors;  /*!< Malformed lines */
+    uint32_t unsupported;    /*!< Valid lines of unsupported types */
+} nmea_tokenizer_t;
+
+/**
+ * @brief Reset tokenizer state and statistics
+ *
+ * @param tok tokenizer
+ */
+void nmea_tokenizer_init(nmea_tokenizer_t *tok);
+
+/**
+ * @brief Parse one sentence
+ *
+ * Leading garbage before '$' and anything after the two checksum digits
+ * (usually "\r\n") is ignored. The line does not need to be NUL terminated.
+ *
+ * @param tok tokenizer
+ * @param line start of the line
+ * @param len number of bytes in the line
+ * @param sentence optional, receives the sentence type
+ * @return nmea_result_t NMEA_OK when the sentence was applied to tok->data
+ */
+nmea_result_t nmea_tokenizer_parse(nmea_tokenizer_t *tok, const char *line, size_t len, nmea_sentence_t *sentence);
+
+#ifdef __cplusplus
+}
+#endif
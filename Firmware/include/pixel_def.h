@@ -50,6 +50,10 @@ void showFrameByBearing(float bearing, int azimuth);
  */
 void showFrameByLocation(float latA, float lonA, float latB, float lonB,
                          int azimuth);
+/**
+ * @brief 已到达目标, 指针颜色呼吸闪烁
+ */
+void showArrived();
 /**
  * @brief 热点
  */
@@ -0,0 +1,57 @@
+#pragma once
+#include "common.h"
+#include "macro_def.h"
+#include "nmea_parser.h"
+
+namespace mcompass {
+namespace position_filter {
+
+/// @brief 滤波后的位置估计
+struct Estimate {
+  Location location; // 滤波后的坐标
+  float speed;       // 滤波后的地速(米/秒)
+  float sigma;       // 水平位置标准差(米)
+  bool valid;        // 是否有有效估计
+};
+
+/**
+ * @brief 清空滤波器, 下一次定位重新初始化
+ */
+void reset();
+
+/**
+ * @brief 输入一次有效定位
+ *
+ * 东/北两个方向各自是一个匀速模型的卡尔曼滤波器, 在以首次定位为原点的
+ * 局部平面(米)内用单精度浮点计算. 观测噪声由HDOP和卫星数决定, 偏离过大的
+ * 定位会被剔除, 两次定位间隔过长(例如GPS休眠后)时重新初始化.
+ * 只能在事件循环中调用
+ *
+ * @param fix 定位记录
+ * @return 更新后的位置估计
+ */
+Estimate update(const gps_fix_record_t &fix);
+
+/**
+ * @brief 获取当前位置估计
+ */
+Estimate getEstimate();
+
+/**
+ * @brief 根据目标位置更新到达状态
+ *
+ * 到达半径为 GPS_ARRIVED_RADIUS 加上两倍位置标准差, 离开时使用更大的半径
+ * 防止在边界上反复切换. 只能在事件循环中调用
+ *
+ * @param target 目标坐标
+ * @return 是否已到达
+ */
+bool updateArrival(const Location &target);
+
+/**
+ * @brief 是否已到达目标
+ */
+bool isArrived();
+
+} // namespace position_filter
+} // namespace mcompass
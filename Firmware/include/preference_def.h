@@ -1,5 +1,6 @@
 #pragma once
 #include "common.h"
+#include "config_def.h"
 #include "macro_def.h"
 
 namespace mcompass {
@@ -80,6 +81,27 @@ void setCalibration(CalibrationData data);
  */
 CalibrationData getCalibration();
 
+/**
+ * @brief 保存航点表
+ */
+void saveWaypoints(const void *data, size_t length);
+
+/**
+ * @brief 获取航点表
+ *
+ * @return 读取的字节数, 没有保存过时返回0
+ */
+size_t getWaypoints(void *data, size_t length);
+
+/**
+ * @brief 批量保存配置, 只写入 change.fields 中的字段
+ *
+ * 所有字段使用同一个NVS句柄写入, 最后只提交一次
+ *
+ * @return 全部写入并提交成功时返回true
+ */
+bool saveConfig(const config::Change &change);
+
 /**
  * @brief 设置出厂设置
  */
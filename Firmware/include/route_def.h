@@ -0,0 +1,88 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+
+#include "common.h"
+#include "macro_def.h"
+
+namespace mcompass {
+namespace route {
+
+/// @brief 接口处理函数, apis() 中的 lambda 都不捕获变量, 可以直接转换
+typedef void (*RequestHandler)(AsyncWebServerRequest *request);
+typedef void (*BodyHandler)(AsyncWebServerRequest *request, uint8_t *data,
+                            size_t length, size_t index, size_t total);
+
+/// @brief 延迟直方图桶数, 最后一个桶不设上限
+enum { LATENCY_BUCKETS = 8 };
+
+/// @brief 单个路由的计数, 只在 async_tcp 任务中更新和读取
+struct Stats {
+  uint32_t count;                      // 请求次数
+  uint32_t maxUs;                      // 最长处理时间(微秒)
+  uint64_t totalUs;                    // 累计处理时间(微秒)
+  uint32_t histogram[LATENCY_BUCKETS]; // 处理时间分布
+};
+
+/// @brief 路由表中的一项
+struct Route {
+  const char *path;                  // 请求路径, 完全匹配
+  WebRequestMethodComposite method;  // 接受的请求方法
+  RequestHandler onRequest;          // 请求处理
+  BodyHandler onBody;                // 请求体处理, 可以为 nullptr
+  const char *header;                // 处理时需要保留的请求头, 可以为 nullptr
+  Stats stats;
+};
+
+/**
+ * @brief 注册接口, 必须在 build 之前调用
+ *
+ * @param path 请求路径
+ * @param method 请求方法
+ * @param onRequest 请求处理
+ * @param onBody 请求体处理, 原样交给处理函数
+ * @param header 处理时需要读取的请求头, 其余请求头在解析时丢弃
+ * @return 是否注册成功, 超过 ROUTE_MAX 时失败
+ */
+bool add(const char *path, WebRequestMethodComposite method,
+         RequestHandler onRequest, BodyHandler onBody = nullptr,
+         const char *header = nullptr);
+
+/**
+ * @brief 按 (path, method) 排序路由表, 返回分发处理器
+ *
+ * 分发处理器对每个请求只做一次二分查找, 代替逐个询问 server.on 注册的处理器;
+ * 不匹配时返回 false, 由之后注册的静态资源处理器和 notFound 兜底.
+ *
+ * @return 注册到 AsyncWebServer 的处理器
+ */
+AsyncWebHandler *build();
+
+/**
+ * @brief 按请求路径和方法查找路由, 二分查找
+ *
+ * @return 路由, 不存在时返回 nullptr
+ */
+const Route *find(const char *path, WebRequestMethodComposite method);
+
+/**
+ * @brief 路由数量
+ */
+size_t count();
+
+/**
+ * @brief 按排序后的下标获取路由
+ */
+const Route &at(size_t index);
+
+/**
+ * @brief 延迟直方图第 bucket 个桶的上限(微秒), 最后一个桶返回 UINT32_MAX
+ */
+uint32_t latencyBound(int bucket);
+
+/**
+ * @brief 请求方法名称, 组合方法返回 "ANY"
+ */
+const char *methodName(WebRequestMethodComposite method);
+
+} // namespace route
+} // namespace mcompass
@@ -1,15 +1,266 @@
 #pragma once
 
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
 #include <string>
-#include <vector>
 
 namespace mcompass {
     enum class WorkType;
     enum class SensorModel;
+    struct Location;
 };
 
 namespace utils {
 
+/**
+ * @brief 固定容量字符串, 数据存放在对象内部, 不产生堆分配
+ *
+ * 超出容量的内容会被截断, 可以通过 truncated() 检查
+ * @tparam N 容量(包含结尾的'\0')
+ */
+template <size_t N> class FixedString {
+public:
+  FixedString() { clear(); }
+
+  void clear() {
+    m_length = 0;
+    m_truncated = false;
+    m_buffer[0] = '\0';
+  }
+
+  FixedString &append(const char *str) {
+    size_t len = strlen(str);
+    if (len > N - 1 - m_length) {
+      len = N - 1 - m_length;
+      m_truncated = true;
+    }
+    memcpy(m_buffer + m_length, str, len);
+    m_length += len;
+    m_buffer[m_length] = '\0';
+    return *this;
+  }
+
+  FixedString &appendf(const char *format, ...)
+      __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, format);
+    int written =
+        vsnprintf(m_buffer + m_length, N - m_length, format, args);
+    va_end(args);
+    if (written < 0) {
+      m_buffer[m_length] = '\0';
+      return *this;
+    }
+    if ((size_t)written >= N - m_length) {
+      m_length = N - 1;
+      m_truncated = true;
+    } else {
+      m_length += written;
+    }
+    return *this;
+  }
+
+  /**
+   * @brief 与 Print::write 相同的接口, 用作 JsonWriter 的输出
+   */
+  size_t write(const uint8_t *data, size_t len) {
+    if (len > N - 1 - m_length) {
+      len = N - 1 - m_length;
+      m_truncated = true;
+    }
+    memcpy(m_buffer + m_length, data, len);
+    m_length += len;
+    m_buffer[m_length] = '\0';
+    return len;
+  }
+
+  const char *c_str() const { return m_buffer; }
+  size_t length() const { return m_length; }
+  bool truncated() const { return m_truncated; }
+  static constexpr size_t capacity() { return N - 1; }
+
+private:
+  char m_buffer[N];
+  size_t m_length;
+  bool m_truncated;
+};
+
+/**
+ * @brief 只计算写入内容的FNV-1a哈希和长度, 用于在发送前生成ETag
+ */
+class HashSink {
+public:
+  size_t write(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+      m_hash = (m_hash ^ data[i]) * 16777619u;
+    }
+    m_length += len;
+    return len;
+  }
+
+  uint32_t hash() const { return m_hash; }
+  size_t length() const { return m_length; }
+
+private:
+  uint32_t m_hash = 2166136261u;
+  size_t m_length = 0;
+};
+
+/**
+ * @brief 流式JSON写入, 不产生堆分配
+ *
+ * 输出可以是任何带 write(const uint8_t *, size_t) 的对象, 例如 FixedString,
+ * HashSink 或者 AsyncResponseStream. 自动处理逗号和字符串转义,
+ * 嵌套深度最多32层.
+ * @tparam Output 输出类型
+ */
+template <typename Output> class JsonWriter {
+public:
+  explicit JsonWriter(Output &out) : m_out(out) {}
+
+  JsonWriter &beginObject(const char *name = nullptr) {
+    open(name, '{');
+    return *this;
+  }
+  JsonWriter &endObject() {
+    close('}');
+    return *this;
+  }
+  JsonWriter &beginArray(const char *name = nullptr) {
+    open(name, '[');
+    return *this;
+  }
+  JsonWriter &endArray() {
+    close(']');
+    return *this;
+  }
+
+  JsonWriter &field(const char *name, const char *value) {
+    key(name);
+    string(value);
+    return *this;
+  }
+  JsonWriter &field(const char *name, bool value) {
+    key(name);
+    raw(value ? "true" : "false");
+    return *this;
+  }
+  JsonWriter &field(const char *name, int value) {
+    return fieldf(name, "%d", value);
+  }
+  JsonWriter &field(const char *name, unsigned int value) {
+    return fieldf(name, "%u", value);
+  }
+  JsonWriter &field(const char *name, long value) {
+    return fieldf(name, "%ld", value);
+  }
+  JsonWriter &field(const char *name, unsigned long value) {
+    return fieldf(name, "%lu", value);
+  }
+  /**
+   * @brief 浮点数, NaN和无穷输出为null
+   */
+  JsonWriter &field(const char *name, double value, int decimals) {
+    if (value != value || value > 1e300 || value < -1e300) {
+      key(name);
+      raw("null");
+      return *this;
+    }
+    return fieldf(name, "%.*f", decimals, value);
+  }
+  /**
+   * @brief 按格式输出的值, 调用方保证结果是合法的JSON值
+   */
+  JsonWriter &fieldf(const char *name, const char *format, ...)
+      __attribute__((format(printf, 3, 4))) {
+    key(name);
+    char buffer[32];
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (written < 0 || (size_t)written >= sizeof(buffer)) {
+      raw("null");
+    } else {
+      write(buffer, written);
+    }
+    return *this;
+  }
+
+private:
+  void open(const char *name, char bracket) {
+    key(name);
+    write(&bracket, 1);
+    if (m_depth < 32) {
+      m_hasItem &= ~(1u << m_depth);
+    }
+    m_depth++;
+  }
+
+  void close(char bracket) {
+    if (m_depth > 0) {
+      m_depth--;
+    }
+    write(&bracket, 1);
+  }
+
+  /**
+   * @brief 写入逗号和键, 数组元素的 name 为 nullptr
+   */
+  void key(const char *name) {
+    if (m_depth > 0 && m_depth <= 32) {
+      uint32_t bit = 1u << (m_depth - 1);
+      if (m_hasItem & bit) {
+        write(",", 1);
+      }
+      m_hasItem |= bit;
+    }
+    if (name) {
+      string(name);
+      write(":", 1);
+    }
+  }
+
+  void string(const char *value) {
+    write("\"", 1);
+    const char *start = value;
+    for (const char *p = value; *p; p++) {
+      unsigned char c = *p;
+      if (c != '"' && c != '\\' && c >= 0x20) {
+        continue;
+      }
+      write(start, p - start);
+      char escaped[7];
+      if (c == '"' || c == '\\') {
+        escaped[0] = '\\';
+        escaped[1] = c;
+        write(escaped, 2);
+      } else {
+        snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        write(escaped, 6);
+      }
+      start = p + 1;
+    }
+    write(start, strlen(start));
+    write("\"", 1);
+  }
+
+  void raw(const char *value) { write(value, strlen(value)); }
+
+  void write(const char *data, size_t len) {
+    if (len > 0) {
+      m_out.write(reinterpret_cast<const uint8_t *>(data), len);
+    }
+  }
+
+  Output &m_out;
+  uint32_t m_hasItem = 0; // 每层是否已经写过元素
+  uint8_t m_depth = 0;
+};
+
 /**
  * @brief 将RGB颜色转换为16进制字符串
  * @param spawnColor 颜色值
@@ -31,9 +282,14 @@ int fromHexString(const std::string &hexColor);
 bool isPluggedUSB(void);
 
 /**
- * @brief 分割字符串到vector
+ * @brief 原地分割字符串, 分隔符会被替换为'\0', 不产生堆分配
+ * @param s 待分割的字符串
+ * @param delimiter 分隔符
+ * @param tokens 输出每一段的起始地址
+ * @param maxTokens tokens容量, 超出部分保留在最后一段中
+ * @return 段数
  */
-std::vector<std::string> split(std::string &s, const std::string &delimiter);
+size_t split(char *s, char delimiter, char **tokens, size_t maxTokens);
 
 /**
  * @brief 计算方位角
@@ -46,8 +302,43 @@ std::vector<std::string> split(std::string &s, const std::string &delimiter);
 double calculateBearing(double lat1, double lon1, double lat2, double lon2);
 double complexDistance(double lat1, double lon1, double lat2, double lon2);
 
+/**
+ * @brief 计算方位角, 单精度版本
+ *
+ * 与 calculateBearing 相同的定义(正北为0度, 顺时针, 范围0~360), 分母使用
+ * sin(Δφ) + 2·sinφ1·cosφ2·sin²(Δλ/2) 的形式, 避免近距离时单精度浮点相减
+ * 造成的精度损失
+ */
+float calculateBearingF(float lat1, float lon1, float lat2, float lon2);
+
+/**
+ * @brief 导航解缓存
+ *
+ * 保存上一次计算使用的起点/终点坐标, 坐标不变时直接返回缓存的方位角和距离.
+ * 定位大约每秒更新一次, 而渲染是60Hz, 绝大多数调用只需要比较坐标
+ */
+class NavigationCache {
+public:
+  /**
+   * @brief 获取从 from 到 to 的方位角(正北为0度, 顺时针)
+   */
+  float bearing(const mcompass::Location &from, const mcompass::Location &to);
+  /**
+   * @brief 获取从 from 到 to 的距离(公里)
+   */
+  float distance(const mcompass::Location &from, const mcompass::Location &to);
+
+private:
+  void update(const mcompass::Location &from, const mcompass::Location &to);
+
+  float m_fromLat = 0, m_fromLon = 0, m_toLat = 0, m_toLon = 0;
+  float m_bearing = 0;
+  float m_distance = 0;
+  bool m_valid = false;
+};
+
 double simplifiedDistance(double lat1, double lon1, double lat2, double lon2);
 
-std::string workType2Str(mcompass::WorkType type);
-std::string sensorModel2Str(mcompass::SensorModel model);
+const char *workType2Str(mcompass::WorkType type);
+const char *sensorModel2Str(mcompass::SensorModel model);
 }  // namespace utils
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+#include "common.h"
+#include "macro_def.h"
+
+namespace mcompass {
+class Context;
+namespace waypoint {
+
+/// @brief 目标选择方式, 大于等于0时表示选中的航点序号
+enum Selection : int8_t {
+  SELECT_SPAWN = -1,   // 使用出生点(原有的单一目标)
+  SELECT_NEAREST = -2, // 自动使用最近的航点
+};
+
+/// @brief 航点
+struct Waypoint {
+  char name[WAYPOINT_NAME_LENGTH]; // 名称
+  Location location;               // 坐标
+};
+
+/**
+ * @brief 初始化, 从NVS加载航点表并预计算单位向量
+ */
+void init(Context *context);
+
+/**
+ * @brief 航点数量
+ */
+size_t count();
+
+/**
+ * @brief 获取航点
+ *
+ * @param index 序号
+ * @param waypoint 输出的航点
+ * @return 序号是否有效
+ */
+bool get(size_t index, Waypoint &waypoint);
+
+/**
+ * @brief 添加航点, 同名航点会被更新
+ *
+ * 名称中的引号, 反斜杠, 逗号和不可见字符会被替换为'_'
+ *
+ * @return 航点序号, 表已满或坐标无效时返回-1
+ */
+int add(const char *name, const Location &location);
+
+/**
+ * @brief 删除航点
+ *
+ * @return 是否删除成功
+ */
+bool remove(size_t index);
+
+/**
+ * @brief 按名称查找航点
+ *
+ * @return 航点序号, 找不到返回-1
+ */
+int find(const char *name);
+
+/**
+ * @brief 设置目标选择方式
+ *
+ * @param selection SELECT_SPAWN, SELECT_NEAREST 或航点序号
+ * @return 是否设置成功
+ */
+bool select(int selection);
+
+/**
+ * @brief 当前的目标选择方式
+ */
+int getSelection();
+
+/**
+ * @brief 当前作为目标的航点序号, 使用出生点时返回-1
+ */
+int getActive();
+
+/**
+ * @brief 查找离指定位置最近的航点
+ *
+ * 比较单位向量之间弦长的平方, 不需要三角函数, 近距离仍有米级分辨率
+ *
+ * @return 航点序号, 没有航点时返回-1
+ */
+int nearest(const Location &from);
+
+/**
+ * @brief 从指定位置到航点的方位角(正北为0度, 顺时针)和距离(公里)
+ *
+ * 使用预计算的单精度单位向量, 适合列表显示; 百米以内方位误差约0.1度,
+ * 指针指向仍使用 utils::calculateBearingF
+ *
+ * @return 序号是否有效
+ */
+bool navigate(const Location &from, size_t index, float &bearing,
+              float &distance);
+
+/**
+ * @brief 根据当前位置更新目标, 在每次定位后调用
+ *
+ * 选中最近航点时会切换到新的最近航点, 目标变化时写入 Context 的出生点
+ */
+void update(const Location &current);
+
+} // namespace waypoint
+} // namespace mcompass
@@ -6,6 +6,46 @@
 namespace mcompass {
 namespace web_server {
 
+/// @brief /ws 上的二进制帧类型
+enum FrameType : uint8_t {
+  FRAME_AZIMUTH = 0x01,   // 客户端->设备, 方位角
+  FRAME_TELEMETRY = 0x81, // 设备->客户端, 遥测
+};
+
+/// @brief 方位角帧, 小端
+struct __attribute__((packed)) AzimuthFrame {
+  uint8_t type;         // FRAME_AZIMUTH
+  uint8_t reserved;     // 保留, 填0
+  uint16_t sequence;    // 序号, 每帧加1, 用于统计丢帧
+  uint16_t angleX100;   // 方位角, 0.01度, [0, 36000)
+  uint32_t timestampMs; // 客户端时间戳(毫秒), 由遥测帧原样带回
+};
+
+/// @brief 遥测帧, 小端
+struct __attribute__((packed)) TelemetryFrame {
+  uint8_t type;         // FRAME_TELEMETRY
+  uint8_t flags;        // bit0: GPS已定位
+  uint16_t sequence;    // 最近收到的方位角帧序号
+  uint32_t timestampMs; // 最近收到的方位角帧时间戳
+  uint32_t received;    // 收到的方位角帧数量
+  uint32_t lost;        // 按序号推算的丢帧数量
+  uint16_t azimuth;     // 当前方位角(度)
+  uint32_t freeHeap;    // 剩余堆内存(字节)
+};
+
+/// @brief UDP方位角包 color 字段高8位的标志
+enum UdpFlag : uint8_t {
+  UDP_FLAG_COLOR = 0x01, // 低24位RGB覆盖指针颜色
+  UDP_FLAG_ECHO = 0x02,  // LED刷新后把这个包原样回送, 用于测量延迟
+};
+
+/// @brief UDP方位角包, 小端, 固定8字节
+struct __attribute__((packed)) UdpAzimuthPacket {
+  uint16_t sequence;  // 序号, 乱序和重复的包按序号丢弃
+  uint16_t angleX100; // 方位角, 0.01度, [0, 36000)
+  uint32_t color;     // 高8位 UdpFlag, 低24位RGB
+};
+
 /**
  * @brief Web初始化
  */
@@ -25,5 +65,17 @@ void createAccessPoint(const char *ssid = "The Lost Compass");
  * @brief 关闭热点
  */
 void endAccessPoint();
+
+/**
+ * @brief MOD模式下按网络方位角刷新LED之前调用, 应用UDP包带来的指针颜色
+ *
+ * UDP包在 async_udp 任务中处理, 颜色和方位角一样交给 event_loop 生效
+ */
+void applyPendingColor();
+
+/**
+ * @brief MOD模式下LED已按网络方位角刷新, 回送待确认的UDP包
+ */
+void onAzimuthShown();
 }  // namespace web_server
 }  // namespace mcompass
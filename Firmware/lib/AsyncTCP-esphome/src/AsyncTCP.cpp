@@ -38,12 +38,18 @@ extern "C"{
  * */
 
 typedef enum {
-    LWIP_TCP_SENT, LWIP_TCP_RECV, LWIP_TCP_FIN, LWIP_TCP_ERROR, LWIP_TCP_POLL, LWIP_TCP_CLEAR, LWIP_TCP_ACCEPT, LWIP_TCP_CONNECTED, LWIP_TCP_DNS
+    LWIP_TCP_SENT, LWIP_TCP_RECV, LWIP_TCP_FIN, LWIP_TCP_ERROR, LWIP_TCP_POLL, LWIP_TCP_CLEAR, LWIP_TCP_ACCEPT, LWIP_TCP_CONNECTED, LWIP_TCP_DNS, LWIP_TCP_CALL
 } lwip_event_t;
 
-typedef struct {
+typedef struct lwip_event_packet_t {
         lwip_event_t event;
         void *arg;
+        // global FIFO, in the order the async task handles the packets
+        struct lwip_event_packet_t *prev;
+        struct lwip_event_packet_t *next;
+        // packets of the same bucket of args, so one client's events can be purged without walking the FIFO
+        struct lwip_event_packet_t *arg_prev;
+        struct lwip_event_packet_t *arg_next;
         union {
                 struct {
                         void * pcb;
@@ -75,10 +81,31 @@ typedef struct {
                         const char * name;
                         ip_addr_t addr;
                 } dns;
+                struct {
+                        void (*fn)(void *);
+                } call;
         };
 } lwip_event_packet_t;
 
-static xQueueHandle _async_queue;
+#define ASYNC_TCP_EVENT_BUCKETS 16
+
+#ifdef LIBRETINY
+#define ASYNC_EVENT_LOCK() portENTER_CRITICAL()
+#define ASYNC_EVENT_UNLOCK() portEXIT_CRITICAL()
+#else
+static portMUX_TYPE _async_event_mux = portMUX_INITIALIZER_UNLOCKED;
+#define ASYNC_EVENT_LOCK() portENTER_CRITICAL(&_async_event_mux)
+#define ASYNC_EVENT_UNLOCK() portEXIT_CRITICAL(&_async_event_mux)
+#endif
+
+// Packets are taken from a fixed pool; the heap is only used when the pool runs dry
+static lwip_event_packet_t _async_event_pool[CONFIG_ASYNC_TCP_EVENT_POOL_SIZE];
+static lwip_event_packet_t * _async_event_free = NULL;
+static lwip_event_packet_t * _async_queue_head = NULL;
+static lwip_event_packet_t * _async_queue_tail = NULL;
+static lwip_event_packet_t * _async_arg_buckets[ASYNC_TCP_EVENT_BUCKETS];
+static async_tcp_event_stats_t _async_event_stats;
+static bool _async_queue_ready = false;
 static TaskHandle_t _async_service_task_handle = NULL;
 
 
@@ -96,65 +123,172 @@ static uint32_t _closed_index = []() {
 
 
 static inline bool _init_async_event_queue(){
-    if(!_async_queue){
-        _async_queue = xQueueCreate(256, sizeof(lwip_event_packet_t *));
-        if(!_async_queue){
-            return false;
+    ASYNC_EVENT_LOCK();
+    if(!_async_queue_ready){
+        for(int i = CONFIG_ASYNC_TCP_EVENT_POOL_SIZE - 1; i >= 0; i--){
+            _async_event_pool[i].next = _async_event_free;
+            _async_event_free = &_async_event_pool[i];
         }
+        _async_event_stats.size = CONFIG_ASYNC_TCP_EVENT_POOL_SIZE;
+        _async_queue_ready = true;
     }
+    ASYNC_EVENT_UNLOCK();
     return true;
 }
 
-static inline bool _send_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueSend(_async_queue, e, portMAX_DELAY) == pdPASS;
+static inline bool _is_pooled_event(lwip_event_packet_t * e){
+    return e >= _async_event_pool && e < _async_event_pool + CONFIG_ASYNC_TCP_EVENT_POOL_SIZE;
 }
 
-static inline bool _prepend_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueSendToFront(_async_queue, e, portMAX_DELAY) == pdPASS;
+static lwip_event_packet_t * _alloc_async_event(){
+    lwip_event_packet_t * e = NULL;
+    ASYNC_EVENT_LOCK();
+    if(_async_event_free){
+        e = _async_event_free;
+        _async_event_free = e->next;
+        if(++_async_event_stats.used > _async_event_stats.highWater){
+            _async_event_stats.highWater = _async_event_stats.used;
+        }
+    } else {
+        _async_event_stats.overflows++;
+    }
+    ASYNC_EVENT_UNLOCK();
+    if(!e){
+        e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    }
+    return e;
 }
 
-static inline bool _get_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueReceive(_async_queue, e, portMAX_DELAY) == pdPASS;
+static void _free_async_event(lwip_event_packet_t * e){
+    if(!_is_pooled_event(e)){
+        free((void*)(e));
+        return;
+    }
+    ASYNC_EVENT_LOCK();
+    e->next = _async_event_free;
+    _async_event_free = e;
+    _async_event_stats.used--;
+    ASYNC_EVENT_UNLOCK();
 }
 
-static bool _remove_events_with_arg(void * arg){
-    lwip_event_packet_t * first_packet = NULL;
-    lwip_event_packet_t * packet = NULL;
+static inline lwip_event_packet_t ** _arg_bucket(void * arg){
+    return &_async_arg_buckets[((uintptr_t)arg >> 3) % ASYNC_TCP_EVENT_BUCKETS];
+}
 
-    if(!_async_queue){
+//call with the lock held
+static void _unlink_async_event(lwip_event_packet_t * e){
+    if(e->prev){
+        e->prev->next = e->next;
+    } else {
+        _async_queue_head = e->next;
+    }
+    if(e->next){
+        e->next->prev = e->prev;
+    } else {
+        _async_queue_tail = e->prev;
+    }
+    if(e->arg_prev){
+        e->arg_prev->arg_next = e->arg_next;
+    } else {
+        *_arg_bucket(e->arg) = e->arg_next;
+    }
+    if(e->arg_next){
+        e->arg_next->arg_prev = e->arg_prev;
+    }
+    _async_event_stats.queued--;
+}
+
+static bool _queue_async_event(lwip_event_packet_t * e, bool front){
+    if(!_async_queue_ready || !_async_service_task_handle){
         return false;
     }
-    //figure out which is the first packet so we can keep the order
-    while(!first_packet){
-        if(xQueueReceive(_async_queue, &first_packet, 0) != pdPASS){
-            return false;
+    lwip_event_packet_t ** bucket = _arg_bucket(e->arg);
+    ASYNC_EVENT_LOCK();
+    if(front){
+        e->prev = NULL;
+        e->next = _async_queue_head;
+        if(_async_queue_head){
+            _async_queue_head->prev = e;
+        } else {
+            _async_queue_tail = e;
         }
-        //discard packet if matching
-        if((int)first_packet->arg == (int)arg){
-            free(first_packet);
-            first_packet = NULL;
-        //return first packet to the back of the queue
-        } else if(xQueueSend(_async_queue, &first_packet, portMAX_DELAY) != pdPASS){
-            return false;
+        _async_queue_head = e;
+    } else {
+        e->next = NULL;
+        e->prev = _async_queue_tail;
+        if(_async_queue_tail){
+            _async_queue_tail->next = e;
+        } else {
+            _async_queue_head = e;
         }
+        _async_queue_tail = e;
     }
+    e->arg_prev = NULL;
+    e->arg_next = *bucket;
+    if(*bucket){
+        (*bucket)->arg_prev = e;
+    }
+    *bucket = e;
+    _async_event_stats.queued++;
+    ASYNC_EVENT_UNLOCK();
+    xTaskNotifyGive(_async_service_task_handle);
+    return true;
+}
 
-    while(xQueuePeek(_async_queue, &packet, 0) == pdPASS && packet != first_packet){
-        if(xQueueReceive(_async_queue, &packet, 0) != pdPASS){
-            return false;
+static inline bool _send_async_event(lwip_event_packet_t ** e){
+    return _queue_async_event(*e, false);
+}
+
+static inline bool _prepend_async_event(lwip_event_packet_t ** e){
+    return _queue_async_event(*e, true);
+}
+
+static inline bool _get_async_event(lwip_event_packet_t ** e){
+    for(;;){
+        ASYNC_EVENT_LOCK();
+        *e = _async_queue_head;
+        if(*e){
+            _unlink_async_event(*e);
         }
-        if((int)packet->arg == (int)arg){
-            free(packet);
-            packet = NULL;
-        } else if(xQueueSend(_async_queue, &packet, portMAX_DELAY) != pdPASS){
-            return false;
+        ASYNC_EVENT_UNLOCK();
+        if(*e){
+            return true;
         }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+static bool _remove_events_with_arg(void * arg){
+    lwip_event_packet_t * removed = NULL;
+    //only the packets sharing the bucket of arg are visited
+    ASYNC_EVENT_LOCK();
+    lwip_event_packet_t * e = *_arg_bucket(arg);
+    while(e){
+        lwip_event_packet_t * next = e->arg_next;
+        if(e->arg == arg){
+            _unlink_async_event(e);
+            e->next = removed;
+            removed = e;
+        }
+        e = next;
+    }
+    ASYNC_EVENT_UNLOCK();
+    while(removed){
+        lwip_event_packet_t * next = removed->next;
+        //nobody else will release the data of a dropped receive
+        if(removed->event == LWIP_TCP_RECV && removed->recv.pb){
+            pbuf_free(removed->recv.pb);
+        }
+        _free_async_event(removed);
+        removed = next;
     }
     return true;
 }
 
 static void _handle_async_event(lwip_event_packet_t * e){
-    if(e->arg == NULL){
+    if(e->event == LWIP_TCP_CALL){
+        e->call.fn(e->arg);
+    } else if(e->arg == NULL){
         // do nothing when arg is NULL
         //ets_printf("event arg == NULL: 0x%08x\n", e->recv.pcb);
     } else if(e->event == LWIP_TCP_CLEAR){
@@ -184,7 +318,32 @@ static void _handle_async_event(lwip_event_packet_t * e){
         //ets_printf("D: 0x%08x %s = %s\n", e->arg, e->dns.name, ipaddr_ntoa(&e->dns.addr));
         AsyncClient::_s_dns_found(e->dns.name, &e->dns.addr, e->arg);
     }
-    free((void*)(e));
+    _free_async_event(e);
+}
+
+bool asyncTcpCall(void (*fn)(void *), void * arg){
+    if(!fn || !_async_queue_ready || !_async_service_task_handle){
+        return false;
+    }
+    lwip_event_packet_t * e = _alloc_async_event();
+    if(!e){
+        return false;
+    }
+    e->event = LWIP_TCP_CALL;
+    e->arg = arg;
+    e->call.fn = fn;
+    if(!_send_async_event(&e)){
+        _free_async_event(e);
+        return false;
+    }
+    return true;
+}
+
+async_tcp_event_stats_t asyncTcpEventStats(){
+    ASYNC_EVENT_LOCK();
+    async_tcp_event_stats_t stats = _async_event_stats;
+    ASYNC_EVENT_UNLOCK();
+    return stats;
 }
 
 static void _async_service_task(void *pvParameters){
@@ -253,42 +412,64 @@ static bool _start_async_task(){
  * */
 
 static int8_t _tcp_clear_events(void * arg) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
+    if(!e){
+        //no packet to defer the purge with, drop the events right away
+        _remove_events_with_arg(arg);
+        return ERR_OK;
+    }
     e->event = LWIP_TCP_CLEAR;
     e->arg = arg;
     if (!_prepend_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_connected(void * arg, tcp_pcb * pcb, int8_t err) {
     //ets_printf("+C: 0x%08x\n", pcb);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
+    if(!e){
+        log_e("event dropped");
+        return ERR_OK;
+    }
     e->event = LWIP_TCP_CONNECTED;
     e->arg = arg;
     e->connected.pcb = pcb;
     e->connected.err = err;
     if (!_prepend_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_poll(void * arg, struct tcp_pcb * pcb) {
     //ets_printf("+P: 0x%08x\n", pcb);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
+    if(!e){
+        //the next poll will come anyway
+        return ERR_OK;
+    }
     e->event = LWIP_TCP_POLL;
     e->arg = arg;
     e->poll.pcb = pcb;
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_recv(void * arg, struct tcp_pcb * pcb, struct pbuf *pb, int8_t err) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
+    if(!e){
+        if(pb){
+            //LwIP keeps the data and delivers it again later
+            return ERR_MEM;
+        }
+        AsyncClient::_s_lwip_fin(arg, pcb, err);
+        log_e("event dropped");
+        return ERR_OK;
+    }
     e->arg = arg;
     if(pb){
         //ets_printf("+R: 0x%08x\n", pcb);
@@ -305,37 +486,49 @@ static int8_t _tcp_recv(void * arg, struct tcp_pcb * pcb, struct pbuf *pb, int8_
         AsyncClient::_s_lwip_fin(e->arg, e->fin.pcb, e->fin.err);
     }
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_sent(void * arg, struct tcp_pcb * pcb, uint16_t len) {
     //ets_printf("+S: 0x%08x\n", pcb);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
+    if(!e){
+        log_e("event dropped");
+        return ERR_OK;
+    }
     e->event = LWIP_TCP_SENT;
     e->arg = arg;
     e->sent.pcb = pcb;
     e->sent.len = len;
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
     return ERR_OK;
 }
 
 static void _tcp_error(void * arg, int8_t err) {
     //ets_printf("+E: 0x%08x\n", arg);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
+    if(!e){
+        log_e("event dropped");
+        return;
+    }
     e->event = LWIP_TCP_ERROR;
     e->arg = arg;
     e->error.err = err;
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
 }
 
 static void _tcp_dns_found(const char * name, struct ip_addr * ipaddr, void * arg) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
+    if(!e){
+        log_e("event dropped");
+        return;
+    }
     //ets_printf("+DNS: name=%s ipaddr=0x%08x arg=%x\n", name, ipaddr, arg);
     e->event = LWIP_TCP_DNS;
     e->arg = arg;
@@ -346,18 +539,22 @@ static void _tcp_dns_found(const char * name, struct ip_addr * ipaddr, void * ar
         memset(&e->dns.addr, 0, sizeof(e->dns.addr));
     }
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
 }
 
 //Used to switch out from LwIP thread
 static int8_t _tcp_accept(void * arg, AsyncClient * client) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_async_event();
+    if(!e){
+        log_e("event dropped");
+        return ERR_OK;
+    }
     e->event = LWIP_TCP_ACCEPT;
     e->arg = arg;
     e->accept.client = client;
     if (!_prepend_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
     return ERR_OK;
 }
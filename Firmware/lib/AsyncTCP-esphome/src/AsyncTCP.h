@@ -53,6 +53,26 @@ extern "C" {
 #define CONFIG_ASYNC_TCP_STACK_SIZE 8192 * 2
 #endif
 
+//event packets preallocated for the async task, the heap is used only when they are all in flight
+#ifndef CONFIG_ASYNC_TCP_EVENT_POOL_SIZE
+#define CONFIG_ASYNC_TCP_EVENT_POOL_SIZE 64
+#endif
+
+typedef struct {
+    uint16_t size;      //packets in the pool
+    uint16_t used;      //pool packets currently in flight
+    uint16_t highWater; //most pool packets ever in flight at once
+    uint16_t queued;    //events waiting for the async task
+    uint32_t overflows; //packets taken from the heap because the pool was empty
+} async_tcp_event_stats_t;
+
+async_tcp_event_stats_t asyncTcpEventStats();
+
+//run fn(arg) on the async task, after the events already queued
+//client callbacks run there too, so fn may touch client lists and queues
+//that other tasks must not; false if the task is not running
+bool asyncTcpCall(void (*fn)(void *), void * arg);
+
 class AsyncClient;
 
 #define ASYNC_MAX_ACK_TIME 5000
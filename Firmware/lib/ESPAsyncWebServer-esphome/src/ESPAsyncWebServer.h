@@ -24,9 +24,11 @@
 #include "Arduino.h"
 
 #include <functional>
+#include <vector>
 #include "FS.h"
 
 #include "StringArray.h"
+#include "WebRequestParser.h"
 
 #if defined(ESP32) || defined(LIBRETINY)
 #include <WiFi.h>
@@ -46,6 +48,29 @@
 
 #define DEBUGF(...) //Serial.printf(__VA_ARGS__)
 
+// Bytes of pipelined requests buffered while the current response is still being sent.
+// When a client pipelines more than this, the buffered requests are dropped and,
+// once the current response is done, the next one is answered with 503 and
+// Connection: close (counted in AsyncWebServerStats::pipelineOverflows).
+// The client retries the unanswered requests on a new connection.
+#ifndef WEBSERVER_PIPELINE_BUFFER
+#define WEBSERVER_PIPELINE_BUFFER 2048
+#endif
+
+// Request line, headers and small urlencoded bodies are copied here once and tokenized in place
+#ifndef WEBSERVER_HEAD_BUFFER
+#define WEBSERVER_HEAD_BUFFER 1536
+#endif
+
+// Headers and parameters kept as views; parameters past the limit fall back to AsyncWebParameter, headers are dropped
+#ifndef WEBSERVER_MAX_HEADERS
+#define WEBSERVER_MAX_HEADERS 24
+#endif
+
+#ifndef WEBSERVER_MAX_PARAMS
+#define WEBSERVER_MAX_PARAMS 16
+#endif
+
 class AsyncWebServer;
 class AsyncWebServerRequest;
 class AsyncWebServerResponse;
@@ -122,6 +147,24 @@ class AsyncWebHeader {
     String toString() const { return String(_name+": "+_value+"\r\n"); }
 };
 
+/*
+ * VIEWS :: Headers and parameters as slices of the request buffer.
+ * The String based objects are only built when a handler asks for them.
+ * */
+
+typedef struct {
+  AsyncWebView name;
+  AsyncWebView value;
+  AsyncWebHeader *header;
+} AsyncWebHeaderView;
+
+typedef struct {
+  AsyncWebView name;
+  AsyncWebView value;
+  bool post;
+  AsyncWebParameter *param;
+} AsyncWebParamView;
+
 /*
  * REQUEST :: Each incoming Client is wrapped inside a Request and both live together until disconnect
  * */
@@ -136,6 +179,7 @@ class AsyncWebServerRequest {
   using FS = fs::FS;
   friend class AsyncWebServer;
   friend class AsyncCallbackWebHandler;
+  friend class AsyncWebServerResponse;
   private:
     AsyncClient* _client;
     AsyncWebServer* _server;
@@ -160,11 +204,26 @@ class AsyncWebServerRequest {
     bool _isMultipart;
     bool _isPlainPost;
     bool _expectingContinue;
+    bool _connectionClose;
+    bool _connectionKeepAlive;
+    bool _keepAlive;
+    uint16_t _served; // requests already answered on this connection
+    bool *_deleted; // set by the destructor while a response callback may close the connection
+    std::vector<uint8_t> _pending; // pipelined bytes received before the response finished
+    bool _pipelineOverflow; // _pending overflowed, the next request is rejected
     size_t _contentLength;
     size_t _parsedLength;
 
-    LinkedList<AsyncWebHeader *> _headers;
-    LinkedList<AsyncWebParameter *> _params;
+    char _head[WEBSERVER_HEAD_BUFFER];
+    size_t _headLength;
+    size_t _lineStart; // start of the line being received, or of the buffered body
+    bool _bodyInHead;
+    mutable AsyncWebHeaderView _headerViews[WEBSERVER_MAX_HEADERS];
+    uint8_t _headerCount;
+    mutable AsyncWebParamView _paramViews[WEBSERVER_MAX_PARAMS];
+    uint8_t _paramCount;
+
+    LinkedList<AsyncWebParameter *> _params; // multipart parameters and those past WEBSERVER_MAX_PARAMS
     LinkedList<String *> _pathParams;
 
     uint8_t _multiParseState;
@@ -185,13 +244,23 @@ class AsyncWebServerRequest {
     void _onTimeout(uint32_t time);
     void _onDisconnect();
     void _onData(void *buf, size_t len);
+    void _onResponseDone();
 
     void _addParam(AsyncWebParameter*);
+    void _addParamView(const AsyncWebView& name, const AsyncWebView& value, bool post);
+    static void _onParamPair(void *r, const AsyncWebView& name, const AsyncWebView& value);
+    static void _onPostPair(void *r, const AsyncWebView& name, const AsyncWebView& value);
     void _addPathParam(const char *param);
+    int _findHeader(const char *name) const;
+    int _findParam(const char *name, bool post, bool anyPost) const;
+    AsyncWebHeader* _headerAt(size_t i) const;
+    AsyncWebParameter* _paramAt(size_t i) const;
 
-    bool _parseReqHead();
-    bool _parseReqHeader();
+    bool _parseReqHead(char *line, size_t len);
+    bool _parseReqHeader(char *line, size_t len);
     void _parseLine();
+    void _headTooLarge();
+    void _pipelineRejected();
     void _parsePlainPostChar(uint8_t data);
     void _parseMultipartPostByte(uint8_t data, bool last);
     void _addGetParams(const String& params);
@@ -203,6 +272,7 @@ class AsyncWebServerRequest {
   public:
     File _tempFile;
     void *_tempObject;
+    void *_handlerData; // set by the attached handler in canHandle(), never freed by the request
 
     AsyncWebServerRequest(AsyncWebServer*, AsyncClient*);
     ~AsyncWebServerRequest();
@@ -218,6 +288,7 @@ class AsyncWebServerRequest {
     const char * methodToString() const;
     const char * requestedConnTypeToString() const;
     RequestedConnectionType requestedConnType() const { return _reqconntype; }
+    bool keepAlive() const { return _keepAlive; }
     bool isExpectedRequestedConnType(RequestedConnectionType erct1, RequestedConnectionType erct2 = RCT_NOT_USED, RequestedConnectionType erct3 = RCT_NOT_USED);
     void onDisconnect (ArDisconnectHandler fn);
 
@@ -284,6 +355,10 @@ class AsyncWebServerRequest {
     const String& header(size_t i) const;        // get request header value by number
     const String& headerName(size_t i) const;    // get request header name by number
     String urlDecode(const String& text) const;
+
+    // Borrowed views into the request buffer, no copy is made; invalid when missing
+    AsyncWebView headerView(const char* name) const;
+    AsyncWebView paramView(const char* name, bool post=false) const;
 };
 
 /*
@@ -369,6 +444,7 @@ class AsyncWebServerResponse {
     size_t _writtenLength;
     WebResponseState _state;
     const char* _responseCodeToString(int code);
+    void _addConnectionHeaders(AsyncWebServerRequest *request);
 
   public:
     AsyncWebServerResponse();
@@ -390,16 +466,29 @@ class AsyncWebServerResponse {
  * SERVER :: One instance
  * */
 
+typedef struct {
+  uint32_t connections; // accepted TCP connections
+  uint32_t requests;    // parsed request heads
+  uint32_t reused;      // requests served on an already used connection
+  uint32_t pipelined;   // requests that arrived before the previous response finished
+  uint32_t idleClosed;  // kept-alive connections closed while waiting for the next request
+  uint32_t pipelineOverflows; // connections whose pipelined requests exceeded WEBSERVER_PIPELINE_BUFFER
+} AsyncWebServerStats;
+
 typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
 typedef std::function<void(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
 typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)> ArBodyHandlerFunction;
 
 class AsyncWebServer {
+  friend class AsyncWebServerRequest;
   protected:
     AsyncServer _server;
     LinkedList<AsyncWebRewrite*> _rewrites;
     LinkedList<AsyncWebHandler*> _handlers;
     AsyncCallbackWebHandler* _catchAllHandler;
+    uint8_t _keepAliveTimeout;
+    uint16_t _keepAliveMax;
+    AsyncWebServerStats _stats;
 
   public:
     AsyncWebServer(uint16_t port);
@@ -432,6 +521,12 @@ class AsyncWebServer {
     void onRequestBody(ArBodyHandlerFunction fn); //handle posts with plain body content (JSON often transmitted this way as a request)
 
     void reset(); //remove all writers and handlers, with onNotFound/onFileUpload/onRequestBody 
+
+    // HTTP/1.1 persistent connections: idle timeout in seconds (0 disables) and requests per connection
+    void setKeepAlive(uint8_t timeout, uint16_t maxRequests);
+    uint8_t keepAliveTimeout() const { return _keepAliveTimeout; }
+    uint16_t keepAliveMax() const { return _keepAliveMax; }
+    const AsyncWebServerStats& stats() const { return _stats; }
   
     void _handleDisconnect(AsyncWebServerRequest *request);
     void _attachHandler(AsyncWebServerRequest *request);
@@ -51,9 +51,20 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   , _isMultipart(false)
   , _isPlainPost(false)
   , _expectingContinue(false)
+  , _connectionClose(false)
+  , _connectionKeepAlive(false)
+  , _keepAlive(false)
+  , _served(0)
+  , _deleted(NULL)
+  , _pending()
+  , _pipelineOverflow(false)
   , _contentLength(0)
   , _parsedLength(0)
-  , _headers(LinkedList<AsyncWebHeader *>([](AsyncWebHeader *h){ delete h; }))
+  , _headLength(0)
+  , _lineStart(0)
+  , _bodyInHead(false)
+  , _headerCount(0)
+  , _paramCount(0)
   , _params(LinkedList<AsyncWebParameter *>([](AsyncWebParameter *p){ delete p; }))
   , _pathParams(LinkedList<String *>([](String *p){ delete p; }))
   , _multiParseState(0)
@@ -68,6 +79,7 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   , _itemBufferIndex(0)
   , _itemIsFile(false)
   , _tempObject(NULL)
+  , _handlerData(NULL)
 {
   c->onError([](void *r, AsyncClient* c, int8_t error){ (void)c; AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onError(error); }, this);
   c->onAck([](void *r, AsyncClient* c, size_t len, uint32_t time){ (void)c; AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onAck(len, time); }, this);
@@ -78,7 +90,15 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
 }
 
 AsyncWebServerRequest::~AsyncWebServerRequest(){
-  _headers.free();
+  if(_deleted){
+    *_deleted = true;
+  }
+  for(uint8_t i = 0; i < _headerCount; i++){
+    delete _headerViews[i].header;
+  }
+  for(uint8_t i = 0; i < _paramCount; i++){
+    delete _paramViews[i].param;
+  }
 
   _params.free();
   _pathParams.free();
@@ -99,32 +119,46 @@ AsyncWebServerRequest::~AsyncWebServerRequest(){
 }
 
 void AsyncWebServerRequest::_onData(void *buf, size_t len){
-  size_t i = 0;
+  size_t i;
+  // A failed parse or a handler may close the connection, which deletes this request
+  bool deleted = false;
+  _deleted = &deleted;
   while (true) {
+  if(deleted) return;
+
+  if(_parseState >= PARSE_REQ_END){
+    // Pipelined request: keep it until the current response has been sent
+    if(!_keepAlive || _pipelineOverflow){
+      // Nothing more is served on this connection
+    } else if(_pending.size() + len <= WEBSERVER_PIPELINE_BUFFER){
+      _pending.insert(_pending.end(), (uint8_t*)buf, (uint8_t*)buf + len);
+    } else {
+      // Too much queued: finish the current response, then reject the next
+      // request with 503 and close instead of dropping the connection silently
+      _pipelineOverflow = true;
+      _pending.clear();
+      _pending.shrink_to_fit();
+      _server->_stats.pipelineOverflows++;
+    }
+    break;
+  }
 
   if(_parseState < PARSE_REQ_BODY){
-    // Find new line in buf
-    char *str = (char*)buf;
-    for (i = 0; i < len; i++) {
-      if (str[i] == '\n') {
-        break;
-      }
+    // Copy up to the end of the line into the head buffer, it is tokenized there
+    const uint8_t *eol = (const uint8_t*)memchr(buf, '\n', len);
+    i = eol ? eol - (const uint8_t*)buf + 1 : len;
+    if(_headLength + i >= WEBSERVER_HEAD_BUFFER){
+      _headTooLarge();
+      break;
     }
-    if (i == len) { // No new line, just add the buffer in _temp
-      char ch = str[len-1];
-      str[len-1] = 0;
-      _temp.reserve(_temp.length()+len);
-      _temp.concat(str);
-      _temp.concat(ch);
-    } else { // Found new line - extract it and parse
-      str[i] = 0; // Terminate the string at the end of the line.
-      _temp.concat(str);
-      _temp.trim();
+    memcpy(_head + _headLength, buf, i);
+    _headLength += i;
+    if(eol){
       _parseLine();
-      if (++i < len) {
+      if(i < len){
         // Still have more buffer to process
-        buf = str+i;
-        len-= i;
+        buf = (uint8_t*)buf + i;
+        len -= i;
         continue;
       }
     }
@@ -132,6 +166,12 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
     // A handler should be already attached at this point in _parseLine function.
     // If handler does nothing (_onRequest is NULL), we don't need to really parse the body.
     const bool needParse = _handler && !_handler->isRequestHandlerTrivial();
+    // Bytes past Content-Length belong to the next pipelined request
+    size_t extra = 0;
+    if(_parsedLength + len > _contentLength){
+      extra = _parsedLength + len - _contentLength;
+      len -= extra;
+    }
     if(_isMultipart){
       if(needParse){
         size_t i;
@@ -152,11 +192,22 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
             _isPlainPost = true;
           }
         }
+        // A body that fits behind the headers is tokenized in place like the query
+        _bodyInHead = _isPlainPost && needParse && _headLength + _contentLength < WEBSERVER_HEAD_BUFFER;
+        _lineStart = _headLength;
       }
       if(!_isPlainPost) {
         //check if authenticated before calling the body
         if(_handler) _handler->handleBody(this, (uint8_t*)buf, len, _parsedLength, _contentLength);
         _parsedLength += len;
+      } else if(_bodyInHead) {
+        memcpy(_head + _headLength, buf, len);
+        _headLength += len;
+        _parsedLength += len;
+        if(_parsedLength >= _contentLength){
+          _head[_headLength] = 0;
+          AsyncWebParser::pairs(_head + _lineStart, _headLength - _lineStart, true, _onPostPair, this);
+        }
       } else if(needParse) {
         size_t i;
         for(i=0; i<len; i++){
@@ -167,30 +218,60 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
         _parsedLength += len;
       }
     }
-    if(_parsedLength == _contentLength){
+    if(_parsedLength >= _contentLength){
       _parseState = PARSE_REQ_END;
       //check if authenticated before calling handleRequest and request auth instead
       if(_handler) _handler->handleRequest(this);
       else send(501);
+      if(extra){
+        buf = (uint8_t*)buf + len;
+        len = extra;
+        continue;
+      }
     }
   }
   break;
   }
+  if(!deleted) _deleted = NULL;
 }
 
 void AsyncWebServerRequest::_removeNotInterestingHeaders(){
-  if (_interestingHeaders.containsIgnoreCase("ANY")) return; // nothing to do
-  for(const auto& header: _headers){
-      if(!_interestingHeaders.containsIgnoreCase(header->name().c_str())){
-        _headers.remove(header);
+  for(const auto& name: _interestingHeaders){
+    if(name.equalsIgnoreCase("ANY")) return; // nothing to do
+  }
+  uint8_t kept = 0;
+  for(uint8_t i = 0; i < _headerCount; i++){
+    bool interesting = false;
+    for(const auto& name: _interestingHeaders){
+      if(_headerViews[i].name.equalsIgnoreCase(name.c_str())){
+        interesting = true;
+        break;
       }
+    }
+    if(interesting){
+      _headerViews[kept++] = _headerViews[i];
+    } else {
+      delete _headerViews[i].header;
+    }
   }
+  _headerCount = kept;
 }
 
 void AsyncWebServerRequest::_onPoll(){
   //os_printf("p\n");
   if(_response != NULL && _client != NULL && _client->canSend() && !_response->_finished()){
+    // A failing response closes the connection, which deletes this request
+    bool deleted = false;
+    _deleted = &deleted;
     _response->_ack(this, 0, 0);
+    if(deleted) return;
+    _deleted = NULL;
+  }
+  if(_keepAlive && _response != NULL && _response->_finished()){
+    _onResponseDone();
+  } else if(_parseState == PARSE_REQ_FAIL && _response != NULL && _response->_finished()){
+    // The 431/503 error response is out, close instead of waiting for the client
+    _client->close();
   }
 }
 
@@ -198,13 +279,57 @@ void AsyncWebServerRequest::_onAck(size_t len, uint32_t time){
   //os_printf("a:%u:%u\n", len, time);
   if(_response != NULL){
     if(!_response->_finished()){
+      bool deleted = false;
+      _deleted = &deleted;
       _response->_ack(this, len, time);
+      if(deleted) return;
+      _deleted = NULL;
     } else {
       AsyncWebServerResponse* r = _response;
       _response = NULL;
       delete r;
     }
   }
+  if(_keepAlive && _response != NULL && _response->_finished()){
+    _onResponseDone();
+  } else if(_parseState == PARSE_REQ_FAIL && _response != NULL && _response->_finished()){
+    // The 431/503 error response is out, close instead of waiting for the client
+    _client->close();
+  }
+}
+
+void AsyncWebServerRequest::_onResponseDone(){
+  // The response is fully acked: hand the connection to a fresh request.
+  // The new request takes over the client callbacks in its constructor,
+  // so this one can be deleted right away.
+  if(_response->_failed()){
+    _keepAlive = false;
+    _client->close();
+    return;
+  }
+  AsyncClient *client = _client;
+  AsyncWebServer *server = _server;
+  AsyncWebServerRequest *next = new AsyncWebServerRequest(server, client);
+  if(next == NULL){
+    _keepAlive = false;
+    _client->close();
+    return;
+  }
+  next->_served = _served + 1;
+  std::vector<uint8_t> pending;
+  pending.swap(_pending);
+  const bool overflow = _pipelineOverflow;
+  if(_onDisconnectfn){
+    _onDisconnectfn();
+  }
+  delete this;
+  client->setRxTimeout(server->_keepAliveTimeout);
+  if(overflow){
+    next->_pipelineRejected();
+  } else if(!pending.empty()){
+    server->_stats.pipelined++;
+    next->_onData(pending.data(), pending.size());
+  }
 }
 
 void AsyncWebServerRequest::_onError(int8_t error){
@@ -223,6 +348,9 @@ void AsyncWebServerRequest::onDisconnect (ArDisconnectHandler fn){
 
 void AsyncWebServerRequest::_onDisconnect(){
   //os_printf("d\n");
+  if(_served && _parseState == PARSE_REQ_START && !_headLength){
+    _server->_stats.idleClosed++;
+  }
   if(_onDisconnectfn) {
       _onDisconnectfn();
     }
@@ -233,11 +361,39 @@ void AsyncWebServerRequest::_addParam(AsyncWebParameter *p){
   _params.add(p);
 }
 
+void AsyncWebServerRequest::_addParamView(const AsyncWebView& name, const AsyncWebView& value, bool post){
+  if(_paramCount < WEBSERVER_MAX_PARAMS){
+    AsyncWebParamView &v = _paramViews[_paramCount++];
+    v.name = name;
+    v.value = value;
+    v.post = post;
+    v.param = NULL;
+  } else {
+    _addParam(new AsyncWebParameter(String(name.c_str()), String(value.c_str()), post));
+  }
+}
+
+void AsyncWebServerRequest::_onParamPair(void *r, const AsyncWebView& name, const AsyncWebView& value){
+  ((AsyncWebServerRequest*)r)->_addParamView(name, value, false);
+}
+
+void AsyncWebServerRequest::_onPostPair(void *r, const AsyncWebView& name, const AsyncWebView& value){
+  ((AsyncWebServerRequest*)r)->_addParamView(name, value, true);
+}
+
 void AsyncWebServerRequest::_addPathParam(const char *p){
   _pathParams.add(new String(p));
 }
 
 void AsyncWebServerRequest::_addGetParams(const String& params){
+  // Parameters added by a rewrite are copied behind the headers when they fit
+  if(_headLength + params.length() < WEBSERVER_HEAD_BUFFER){
+    char *text = _head + _headLength;
+    memcpy(text, params.c_str(), params.length() + 1);
+    _headLength += params.length() + 1;
+    AsyncWebParser::pairs(text, params.length(), false, _onParamPair, this);
+    return;
+  }
   size_t start = 0;
   while (start < params.length()){
     int end = params.indexOf('&', start);
@@ -251,103 +407,90 @@ void AsyncWebServerRequest::_addGetParams(const String& params){
   }
 }
 
-bool AsyncWebServerRequest::_parseReqHead(){
+bool AsyncWebServerRequest::_parseReqHead(char *line, size_t len){
   // Split the head into method, url and version
-  int index = _temp.indexOf(' ');
-  String m = _temp.substring(0, index);
-  index = _temp.indexOf(' ', index+1);
-  String u = _temp.substring(m.length()+1, index);
-  _temp = _temp.substring(index+1);
+  AsyncWebRequestLine head;
+  if(!AsyncWebParser::requestLine(line, len, &head)){
+    return false;
+  }
 
-  if(m == "GET"){
+  if(head.method.equals("GET")){
     _method = HTTP_GET;
-  } else if(m == "POST"){
+  } else if(head.method.equals("POST")){
     _method = HTTP_POST;
-  } else if(m == "DELETE"){
+  } else if(head.method.equals("DELETE")){
     _method = HTTP_DELETE;
-  } else if(m == "PUT"){
+  } else if(head.method.equals("PUT")){
     _method = HTTP_PUT;
-  } else if(m == "PATCH"){
+  } else if(head.method.equals("PATCH")){
     _method = HTTP_PATCH;
-  } else if(m == "HEAD"){
+  } else if(head.method.equals("HEAD")){
     _method = HTTP_HEAD;
-  } else if(m == "OPTIONS"){
+  } else if(head.method.equals("OPTIONS")){
     _method = HTTP_OPTIONS;
   }
 
-  String g = String();
-  index = u.indexOf('?');
-  if(index > 0){
-    g = u.substring(index +1);
-    u = u.substring(0, index);
+  _url = head.path.c_str();
+  if(head.query.valid()){
+    AsyncWebParser::pairs((char*)head.query.c_str(), head.query.length(), false, _onParamPair, this);
   }
-  _url = urlDecode(u);
-  _addGetParams(g);
 
-  if(!_temp.startsWith("HTTP/1.0"))
+  if(!head.version.startsWith("HTTP/1.0"))
     _version = 1;
 
-  _temp = String();
   return true;
 }
 
-bool strContains(String src, String find, bool mindcase = true) {
-  int pos=0, i=0;
-  const int slen = src.length();
-  const int flen = find.length();
-
-  if (slen < flen) return false;
-  while (pos <= (slen - flen)) {
-    for (i=0; i < flen; i++) {
-      if (mindcase) {
-        if (src[pos+i] != find[i]) i = flen + 1; // no match
-      } else if (tolower(src[pos+i]) != tolower(find[i])) i = flen + 1; // no match
-    }
-    if (i == flen) return true;
-    pos++;
+bool AsyncWebServerRequest::_parseReqHeader(char *line, size_t len){
+  AsyncWebView name, value;
+  if(!AsyncWebParser::headerLine(line, len, &name, &value)){
+    return false;
   }
-  return false;
-}
-
-bool AsyncWebServerRequest::_parseReqHeader(){
-  int index = _temp.indexOf(':');
-  if(index){
-    String name = _temp.substring(0, index);
-    String value = _temp.substring(index + 2);
-    if(name.equalsIgnoreCase("Host")){
-      _host = value;
-    } else if(name.equalsIgnoreCase("Content-Type")){
-	  _contentType = value.substring(0, value.indexOf(';'));
-      if (value.startsWith("multipart/")){
-        _boundary = value.substring(value.indexOf('=')+1);
-        _boundary.replace("\"","");
-        _isMultipart = true;
-      }
-    } else if(name.equalsIgnoreCase("Content-Length")){
-      _contentLength = atoi(value.c_str());
-    } else if(name.equalsIgnoreCase("Expect") && value == "100-continue"){
-      _expectingContinue = true;
-    } else if(name.equalsIgnoreCase("Authorization")){
-      if(value.length() > 5 && value.substring(0,5).equalsIgnoreCase("Basic")){
-        _authorization = value.substring(6);
-      } else if(value.length() > 6 && value.substring(0,6).equalsIgnoreCase("Digest")){
-        _isDigest = true;
-        _authorization = value.substring(7);
-      }
+  if(name.equalsIgnoreCase("Host")){
+    _host = value.c_str();
+  } else if(name.equalsIgnoreCase("Content-Type")){
+    const char *params = strchr(value.c_str(), ';');
+    _contentType = value.c_str();
+    if(params){
+      _contentType.remove(params - value.c_str());
+    }
+    if (value.startsWith("multipart/")){
+      const char *boundary = strchr(value.c_str(), '=');
+      _boundary = boundary ? boundary + 1 : "";
+      _boundary.replace("\"","");
+      _isMultipart = true;
+    }
+  } else if(name.equalsIgnoreCase("Content-Length")){
+    _contentLength = value.toInt();
+  } else if(name.equalsIgnoreCase("Connection")){
+    _connectionClose = value.containsIgnoreCase("close");
+    _connectionKeepAlive = value.containsIgnoreCase("keep-alive");
+  } else if(name.equalsIgnoreCase("Expect") && value.equals("100-continue")){
+    _expectingContinue = true;
+  } else if(name.equalsIgnoreCase("Authorization")){
+    if(value.length() > 5 && strncasecmp(value.c_str(), "Basic", 5) == 0){
+      _authorization = value.c_str() + 6;
+    } else if(value.length() > 6 && strncasecmp(value.c_str(), "Digest", 6) == 0){
+      _isDigest = true;
+      _authorization = value.c_str() + 7;
+    }
+  } else {
+    if(name.equalsIgnoreCase("Upgrade") && value.equalsIgnoreCase("websocket")){
+      // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
+      _reqconntype = RCT_WS;
     } else {
-      if(name.equalsIgnoreCase("Upgrade") && value.equalsIgnoreCase("websocket")){
-        // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
-        _reqconntype = RCT_WS;
-      } else {
-        if(name.equalsIgnoreCase("Accept") && strContains(value, "text/event-stream", false)){
-          // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
-          _reqconntype = RCT_EVENT;
-        }
+      if(name.equalsIgnoreCase("Accept") && value.containsIgnoreCase("text/event-stream")){
+        // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
+        _reqconntype = RCT_EVENT;
       }
     }
-    _headers.add(new AsyncWebHeader(name, value));
   }
-  _temp = String();
+  if(_headerCount < WEBSERVER_MAX_HEADERS){
+    AsyncWebHeaderView &v = _headerViews[_headerCount++];
+    v.name = name;
+    v.value = value;
+    v.header = NULL;
+  }
   return true;
 }
 
@@ -552,20 +695,37 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last){
 }
 
 void AsyncWebServerRequest::_parseLine(){
+  // The line ends with the '\n' just copied; tokens are terminated in place
+  size_t len;
+  char *line = AsyncWebParser::trim(_head + _lineStart, _headLength - 1 - _lineStart, &len);
+  _lineStart = _headLength;
+
   if(_parseState == PARSE_REQ_START){
-    if(!_temp.length()){
+    if(!len && _served){
+      // Tolerate the extra CRLF some clients send between pipelined requests
+      _headLength = _lineStart = 0;
+      return;
+    }
+    if(!len || !_parseReqHead(line, len)){
       _parseState = PARSE_REQ_FAIL;
       _client->close();
     } else {
-      _parseReqHead();
       _parseState = PARSE_REQ_HEADERS;
     }
     return;
   }
 
   if(_parseState == PARSE_REQ_HEADERS){
-    if(!_temp.length()){
+    if(!len){
       //end of headers
+      _server->_stats.requests++;
+      if(_served){
+        _server->_stats.reused++;
+      }
+      // HTTP/1.1 keeps the connection unless asked to close, HTTP/1.0 only when asked to keep it
+      _keepAlive = _server->_keepAliveTimeout && _reqconntype == RCT_HTTP
+        && (_version ? !_connectionClose : _connectionKeepAlive)
+        && _served + 1 < _server->_keepAliveMax;
       _server->_rewriteRequest(this);
       _server->_attachHandler(this);
       _removeNotInterestingHeaders();
@@ -581,21 +741,57 @@ void AsyncWebServerRequest::_parseLine(){
         if(_handler) _handler->handleRequest(this);
         else send(501);
       }
-    } else _parseReqHeader();
+    } else _parseReqHeader(line, len);
   }
 }
 
-size_t AsyncWebServerRequest::headers() const{
-  return _headers.length();
+void AsyncWebServerRequest::_headTooLarge(){
+  // Answer once and drop the connection, the rest of the head is ignored.
+  // The connection is closed once the response is acked, see _onAck()
+  _parseState = PARSE_REQ_FAIL;
+  _keepAlive = false;
+  send(431);
 }
 
-bool AsyncWebServerRequest::hasHeader(const String& name) const {
-  for(const auto& h: _headers){
-    if(h->name().equalsIgnoreCase(name)){
-      return true;
+void AsyncWebServerRequest::_pipelineRejected(){
+  // The pipelined requests did not fit in WEBSERVER_PIPELINE_BUFFER and were
+  // dropped. Answer the next one and close, the client retries the rest.
+  _parseState = PARSE_REQ_FAIL;
+  _keepAlive = false;
+  send(503);
+}
+
+int AsyncWebServerRequest::_findHeader(const char *name) const {
+  for(uint8_t i = 0; i < _headerCount; i++){
+    if(_headerViews[i].name.equalsIgnoreCase(name)){
+      return i;
     }
   }
-  return false;
+  return -1;
+}
+
+AsyncWebHeader* AsyncWebServerRequest::_headerAt(size_t i) const {
+  if(i >= _headerCount){
+    return nullptr;
+  }
+  AsyncWebHeaderView &v = _headerViews[i];
+  if(!v.header){
+    v.header = new AsyncWebHeader(String(v.name.c_str()), String(v.value.c_str()));
+  }
+  return v.header;
+}
+
+AsyncWebView AsyncWebServerRequest::headerView(const char* name) const {
+  int i = _findHeader(name);
+  return i < 0 ? AsyncWebView() : _headerViews[i].value;
+}
+
+size_t AsyncWebServerRequest::headers() const{
+  return _headerCount;
+}
+
+bool AsyncWebServerRequest::hasHeader(const String& name) const {
+  return _findHeader(name.c_str()) >= 0;
 }
 
 bool AsyncWebServerRequest::hasHeader(const __FlashStringHelper * data) const {
@@ -619,12 +815,8 @@ bool AsyncWebServerRequest::hasHeader(const __FlashStringHelper * data) const {
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const {
-  for(const auto& h: _headers){
-    if(h->name().equalsIgnoreCase(name)){
-      return h;
-    }
-  }
-  return nullptr;
+  int i = _findHeader(name.c_str());
+  return i < 0 ? nullptr : _headerAt(i);
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(const __FlashStringHelper * data) const {
@@ -642,15 +834,43 @@ AsyncWebHeader* AsyncWebServerRequest::getHeader(const __FlashStringHelper * dat
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(size_t num) const {
-  auto header = _headers.nth(num);
-  return header ? *header : nullptr;
+  return _headerAt(num);
+}
+
+int AsyncWebServerRequest::_findParam(const char *name, bool post, bool anyPost) const {
+  for(uint8_t i = 0; i < _paramCount; i++){
+    if((anyPost || _paramViews[i].post == post) && _paramViews[i].name.equals(name)){
+      return i;
+    }
+  }
+  return -1;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::_paramAt(size_t i) const {
+  if(i >= _paramCount){
+    auto param = _params.nth(i - _paramCount);
+    return param ? *param : nullptr;
+  }
+  AsyncWebParamView &v = _paramViews[i];
+  if(!v.param){
+    v.param = new AsyncWebParameter(String(v.name.c_str()), String(v.value.c_str()), v.post);
+  }
+  return v.param;
+}
+
+AsyncWebView AsyncWebServerRequest::paramView(const char* name, bool post) const {
+  int i = _findParam(name, post, false);
+  return i < 0 ? AsyncWebView() : _paramViews[i].value;
 }
 
 size_t AsyncWebServerRequest::params() const {
-  return _params.length();
+  return _paramCount + _params.length();
 }
 
 bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) const {
+  if(!file && _findParam(name.c_str(), post, false) >= 0){
+    return true;
+  }
   for(const auto& p: _params){
     if(p->name() == name && p->isPost() == post && p->isFile() == file){
       return true;
@@ -676,6 +896,10 @@ bool AsyncWebServerRequest::hasParam(const __FlashStringHelper * data, bool post
 }
 
 AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post, bool file) const {
+  int i = file ? -1 : _findParam(name.c_str(), post, false);
+  if(i >= 0){
+    return _paramAt(i);
+  }
   for(const auto& p: _params){
     if(p->name() == name && p->isPost() == post && p->isFile() == file){
       return p;
@@ -699,8 +923,7 @@ AsyncWebParameter* AsyncWebServerRequest::getParam(const __FlashStringHelper * d
 }
 
 AsyncWebParameter* AsyncWebServerRequest::getParam(size_t num) const {
-  auto param = _params.nth(num);
-  return param ? *param : nullptr;
+  return _paramAt(num);
 }
 
 void AsyncWebServerRequest::addInterestingHeader(const String& name){
@@ -862,6 +1085,9 @@ void AsyncWebServerRequest::requestAuthentication(const char * realm, bool isDig
 }
 
 bool AsyncWebServerRequest::hasArg(const char* name) const {
+  if(_findParam(name, false, true) >= 0){
+    return true;
+  }
   for(const auto& arg: _params){
     if(arg->name() == name){
       return true;
@@ -886,6 +1112,10 @@ bool AsyncWebServerRequest::hasArg(const __FlashStringHelper * data) const {
 
 
 const String& AsyncWebServerRequest::arg(const String& name) const {
+  int i = _findParam(name.c_str(), false, true);
+  if(i >= 0){
+    return _paramAt(i)->value();
+  }
   for(const auto& arg: _params){
     if(arg->name() == name){
       return arg->value();
@@ -0,0 +1,137 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  In place tokenizer, see WebRequestParser.h
+*/
+#include "WebRequestParser.h"
+
+static inline bool _isSpace(char c){
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline int _hexValue(char c){
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool AsyncWebView::containsIgnoreCase(const char *str) const {
+  size_t n = strlen(str);
+  if(!_data || n > _len) return false;
+  for(size_t i = 0; i + n <= _len; i++){
+    if(strncasecmp(_data + i, str, n) == 0) return true;
+  }
+  return false;
+}
+
+bool AsyncWebView::copyTo(char *out, size_t capacity) const {
+  if(!capacity) return false;
+  size_t n = _len < capacity - 1 ? _len : capacity - 1;
+  memcpy(out, c_str(), n);
+  out[n] = 0;
+  return n == _len;
+}
+
+char *AsyncWebParser::trim(char *line, size_t len, size_t *outLen){
+  while(len && _isSpace(line[len - 1])) len--;
+  while(len && _isSpace(*line)){
+    line++;
+    len--;
+  }
+  line[len] = 0;
+  *outLen = len;
+  return line;
+}
+
+bool AsyncWebParser::requestLine(char *line, size_t len, AsyncWebRequestLine *out){
+  char *end = line + len;
+  char *method = line;
+  char *p = (char*)memchr(line, ' ', len);
+  if(!p || p == method) return false;
+  *p++ = 0;
+  out->method = AsyncWebView(method, p - 1 - method);
+
+  char *target = p;
+  p = (char*)memchr(target, ' ', end - target);
+  char *targetEnd = p ? p : end;
+  *targetEnd = 0;
+  if(p){
+    p++;
+    out->version = AsyncWebView(p, end - p);
+  } else {
+    out->version = AsyncWebView(end, 0);
+  }
+
+  char *query = (char*)memchr(target, '?', targetEnd - target);
+  if(query && query > target){
+    *query++ = 0;
+    out->query = AsyncWebView(query, targetEnd - query);
+  } else {
+    out->query = AsyncWebView();
+    query = NULL;
+  }
+  size_t pathLen = (query ? query - 1 : targetEnd) - target;
+  out->path = AsyncWebView(target, urlDecode(target, pathLen));
+  return true;
+}
+
+bool AsyncWebParser::headerLine(char *line, size_t len, AsyncWebView *name, AsyncWebView *value){
+  char *colon = (char*)memchr(line, ':', len);
+  if(!colon || colon == line) return false;
+  *colon = 0;
+  size_t valueLen;
+  char *v = trim(colon + 1, line + len - colon - 1, &valueLen);
+  *name = AsyncWebView(line, colon - line);
+  *value = AsyncWebView(v, valueLen);
+  return true;
+}
+
+size_t AsyncWebParser::urlDecode(char *text, size_t len){
+  size_t in = 0, out = 0;
+  while(in < len){
+    char c = text[in++];
+    if(c == '%' && in + 1 < len){
+      int hi = _hexValue(text[in]);
+      int lo = _hexValue(text[in + 1]);
+      if(hi >= 0 && lo >= 0){
+        c = (char)((hi << 4) | lo);
+        in += 2;
+      }
+    } else if(c == '+'){
+      c = ' ';
+    }
+    text[out++] = c;
+  }
+  text[out] = 0;
+  return out;
+}
+
+size_t AsyncWebParser::pairs(char *text, size_t len, bool body, PairHandler handler, void *arg){
+  size_t count = 0;
+  char *end = text + len;
+  char *p = text;
+  while(p < end){
+    char *sep = p;
+    while(sep < end && *sep != '&' && *sep) sep++;
+    *sep = 0;
+    size_t pairLen = sep - p;
+    if(pairLen){
+      char *equal = (char*)memchr(p, '=', pairLen);
+      if(body && (!equal || equal == p || *p == '{' || *p == '[')){
+        AsyncWebView value(p, urlDecode(p, pairLen));
+        handler(arg, AsyncWebView("body", 4), value);
+      } else {
+        char *v = equal ? equal + 1 : sep;
+        if(equal) *equal = 0;
+        size_t nameLen = (equal ? equal : sep) - p;
+        AsyncWebView name(p, urlDecode(p, nameLen));
+        AsyncWebView value(v, urlDecode(v, sep - v));
+        handler(arg, name, value);
+      }
+      count++;
+    }
+    p = sep + 1;
+  }
+  return count;
+}
@@ -0,0 +1,70 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  In place tokenizer for the request line, the headers and urlencoded
+  parameters. Tokens are terminated inside the buffer they were received
+  into, so the views handed out are plain C strings that stay valid as long
+  as that buffer. Nothing here allocates or depends on Arduino, which keeps
+  the parser usable from host side benchmarks.
+*/
+#ifndef ASYNCWEBREQUESTPARSER_H_
+#define ASYNCWEBREQUESTPARSER_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*
+ * VIEW :: Borrowed, nul terminated slice of the request buffer
+ * */
+
+class AsyncWebView {
+  private:
+    const char *_data;
+    size_t _len;
+
+  public:
+    AsyncWebView(): _data(NULL), _len(0){}
+    AsyncWebView(const char *data, size_t len): _data(data), _len(len){}
+
+    bool valid() const { return _data != NULL; }
+    const char *c_str() const { return _data ? _data : ""; }
+    size_t length() const { return _len; }
+    bool equals(const char *str) const { return _data && strcmp(_data, str) == 0; }
+    bool equalsIgnoreCase(const char *str) const { return _data && strcasecmp(_data, str) == 0; }
+    bool startsWith(const char *prefix) const { return _data && strncmp(_data, prefix, strlen(prefix)) == 0; }
+    bool containsIgnoreCase(const char *str) const;
+    long toInt() const { return _data ? atol(_data) : 0; }
+    float toFloat() const { return _data ? (float)atof(_data) : 0; }
+    // Copies at most capacity - 1 bytes and terminates out, returns false when the value did not fit
+    bool copyTo(char *out, size_t capacity) const;
+};
+
+typedef struct {
+  AsyncWebView method;
+  AsyncWebView path;
+  AsyncWebView query;
+  AsyncWebView version;
+} AsyncWebRequestLine;
+
+// All functions write terminators into the buffer, the byte at [len] must be writable
+class AsyncWebParser {
+  public:
+    // Called for every name=value pair, both already decoded in place
+    typedef void (*PairHandler)(void *arg, const AsyncWebView& name, const AsyncWebView& value);
+
+    // Strips surrounding whitespace and the trailing CR, terminates the line and returns its new start
+    static char *trim(char *line, size_t len, size_t *outLen);
+    // "METHOD SP target SP version"; the target is split at '?' and its path is url decoded
+    static bool requestLine(char *line, size_t len, AsyncWebRequestLine *out);
+    // "Name: value"; false when the line has no name
+    static bool headerLine(char *line, size_t len, AsyncWebView *name, AsyncWebView *value);
+    // Decodes %XX and '+' in place, returns the new length; invalid escapes are kept as they are
+    static size_t urlDecode(char *text, size_t len);
+    // Splits "a=1&b=2" and reports each pair; empty pairs are skipped.
+    // With body set, a pair without '=' or starting with '{' or '[' is reported whole under the name "body"
+    static size_t pairs(char *text, size_t len, bool body, PairHandler handler, void *arg);
+};
+
+#endif /* ASYNCWEBREQUESTPARSER_H_ */
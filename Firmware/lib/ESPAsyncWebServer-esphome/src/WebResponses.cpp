@@ -123,6 +123,22 @@ void AsyncWebServerResponse::addHeader(const String& name, const String& value){
   _headers.add(new AsyncWebHeader(name, value));
 }
 
+void AsyncWebServerResponse::_addConnectionHeaders(AsyncWebServerRequest *request){
+  // Without a length or chunked framing the client can only see the end of the body when the connection closes
+  if(request->_keepAlive && !(_sendContentLength || (_chunked && request->version()))){
+    request->_keepAlive = false;
+  }
+  if(!request->_keepAlive){
+    addHeader("Connection","close");
+    return;
+  }
+  AsyncWebServer *server = request->_server;
+  char value[32];
+  snprintf(value, sizeof(value), "timeout=%u, max=%u", server->keepAliveTimeout(), server->keepAliveMax() - request->_served - 1);
+  addHeader("Connection","keep-alive");
+  addHeader("Keep-Alive", value);
+}
+
 String AsyncWebServerResponse::_assembleHead(uint8_t version){
   if(version){
     addHeader("Accept-Ranges","none");
@@ -175,10 +191,10 @@ AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, cons
     if(!_contentType.length())
       _contentType = "text/plain";
   }
-  addHeader("Connection","close");
 }
 
 void AsyncBasicResponse::_respond(AsyncWebServerRequest *request){
+  _addConnectionHeaders(request);
   _state = RESPONSE_HEADERS;
   String out = _assembleHead(request->version());
   size_t outLen = out.length();
@@ -255,7 +271,7 @@ AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _ca
 }
 
 void AsyncAbstractResponse::_respond(AsyncWebServerRequest *request){
-  addHeader("Connection","close");
+  _addConnectionHeaders(request);
   _head = _assembleHead(request->version());
   _state = RESPONSE_HEADERS;
   _ack(request, 0, 0);
@@ -34,6 +34,9 @@ AsyncWebServer::AsyncWebServer(uint16_t port)
   : _server(port)
   , _rewrites(LinkedList<AsyncWebRewrite*>(nullptr))
   , _handlers(LinkedList<AsyncWebHandler*>(nullptr))
+  , _keepAliveTimeout(0)
+  , _keepAliveMax(0)
+  , _stats()
 {
   _catchAllHandler = new AsyncCallbackWebHandler();
   if(_catchAllHandler == NULL)
@@ -42,6 +45,7 @@ AsyncWebServer::AsyncWebServer(uint16_t port)
     if(c == NULL)
       return;
     c->setRxTimeout(3);
+    ((AsyncWebServer*)s)->_stats.connections++;
     AsyncWebServerRequest *r = new AsyncWebServerRequest((AsyncWebServer*)s, c);
     if(r == NULL){
       c->close(true);
@@ -79,6 +83,11 @@ bool AsyncWebServer::removeHandler(AsyncWebHandler *handler){
   return _handlers.remove(handler);
 }
 
+void AsyncWebServer::setKeepAlive(uint8_t timeout, uint16_t maxRequests){
+  _keepAliveTimeout = timeout;
+  _keepAliveMax = maxRequests;
+}
+
 void AsyncWebServer::begin(){
   _server.setNoDelay(true);
   _server.begin();
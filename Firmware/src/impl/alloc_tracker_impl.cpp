@@ -0,0 +1,182 @@
+#include "alloc_tracker.h"
+
+#if defined(MCOMPASS_ALLOC_TRACKER)
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <string.h>
+
+using namespace mcompass;
+
+static const char *TAG = "AllocTracker";
+
+// 最多追踪的任务数量, 超出的计入 untracked
+#define ALLOC_TRACKER_MAX_TASKS 16
+// 报告间隔 10秒
+#define ALLOC_TRACKER_REPORT_INTERVAL (10 * 1000000)
+
+struct TaskSlot {
+  TaskHandle_t task;
+  char name[configMAX_TASK_NAME_LEN];
+  uint32_t count;
+  uint32_t bytes;
+};
+
+static TaskSlot slots[ALLOC_TRACKER_MAX_TASKS];
+static uint32_t untracked = 0;
+static uint32_t guardViolations = 0;
+static volatile bool armed = false;
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief 记录一次分配, 本函数自身不能产生任何堆分配
+ */
+static void record(size_t size) {
+  if (!armed || xPortInIsrContext()) {
+    return;
+  }
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&mux);
+  TaskSlot *slot = nullptr;
+  for (int i = 0; i < ALLOC_TRACKER_MAX_TASKS; i++) {
+    if (slots[i].task == task) {
+      slot = &slots[i];
+      break;
+    }
+    if (slots[i].task == nullptr) {
+      slot = &slots[i];
+      slot->task = task;
+      strncpy(slot->name, pcTaskGetName(task), sizeof(slot->name) - 1);
+      break;
+    }
+  }
+  if (slot) {
+    slot->count++;
+    slot->bytes += size;
+  } else {
+    untracked++;
+  }
+  portEXIT_CRITICAL(&mux);
+}
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_heap_caps_malloc(size_t size, uint32_t caps);
+void *__real_heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void *__real_heap_caps_realloc(void *ptr, size_t size, uint32_t caps);
+
+void *__wrap_malloc(size_t size) {
+  record(size);
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  record(n * size);
+  return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  record(size);
+  return __real_realloc(ptr, size);
+}
+
+void *__wrap_heap_caps_malloc(size_t size, uint32_t caps) {
+  record(size);
+  return __real_heap_caps_malloc(size, caps);
+}
+
+void *__wrap_heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+  record(n * size);
+  return __real_heap_caps_calloc(n, size, caps);
+}
+
+void *__wrap_heap_caps_realloc(void *ptr, size_t size, uint32_t caps) {
+  record(size);
+  return __real_heap_caps_realloc(ptr, size, caps);
+}
+}
+
+void alloc_tracker::init() {
+  esp_timer_handle_t timer;
+  esp_timer_create_args_t timer_args = {
+      .callback = [](void *) { alloc_tracker::report(); },
+      .arg = nullptr,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "alloc_tracker_timer",
+      .skip_unhandled_events = true};
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer));
+  ESP_ERROR_CHECK(
+      esp_timer_start_periodic(timer, ALLOC_TRACKER_REPORT_INTERVAL));
+}
+
+void alloc_tracker::arm() {
+  portENTER_CRITICAL(&mux);
+  memset(slots, 0, sizeof(slots));
+  untracked = 0;
+  guardViolations = 0;
+  armed = true;
+  portEXIT_CRITICAL(&mux);
+  ESP_LOGI(TAG, "Armed");
+}
+
+uint32_t alloc_tracker::count(TaskHandle_t task) {
+  if (task == nullptr) {
+    task = xTaskGetCurrentTaskHandle();
+  }
+  uint32_t result = 0;
+  portENTER_CRITICAL(&mux);
+  for (int i = 0; i < ALLOC_TRACKER_MAX_TASKS; i++) {
+    if (slots[i].task == task) {
+      result = slots[i].count;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&mux);
+  return result;
+}
+
+uint32_t alloc_tracker::violations() { return guardViolations; }
+
+void alloc_tracker::report() {
+  // 先拷贝一份快照, 打印日志时不持有锁
+  TaskSlot snapshot[ALLOC_TRACKER_MAX_TASKS];
+  portENTER_CRITICAL(&mux);
+  memcpy(snapshot, slots, sizeof(slots));
+  uint32_t lost = untracked;
+  uint32_t violated = guardViolations;
+  portEXIT_CRITICAL(&mux);
+
+  ESP_LOGI(TAG, "%-16s %10s %10s", "task", "allocs", "bytes");
+  for (int i = 0; i < ALLOC_TRACKER_MAX_TASKS && snapshot[i].task; i++) {
+    ESP_LOGI(TAG, "%-16s %10u %10u", snapshot[i].name, snapshot[i].count,
+             snapshot[i].bytes);
+  }
+  ESP_LOGI(TAG, "untracked=%u guard violations=%u", lost, violated);
+}
+
+alloc_tracker::Guard::Guard(const char *name)
+    : m_name(name), m_start(alloc_tracker::count()) {}
+
+alloc_tracker::Guard::~Guard() {
+  if (!armed) {
+    return;
+  }
+  uint32_t allocated = alloc_tracker::count() - m_start;
+  if (allocated == 0) {
+    return;
+  }
+  portENTER_CRITICAL(&mux);
+  guardViolations++;
+  portEXIT_CRITICAL(&mux);
+  // 限制日志频率, 避免60Hz的热路径刷屏
+  static int64_t lastLog = 0;
+  int64_t now = esp_timer_get_time();
+  if (now - lastLog > 1000000) {
+    lastLog = now;
+    ESP_LOGE(TAG, "%s: %u allocation(s) in zero-allocation scope", m_name,
+             allocated);
+  }
+}
+#endif
@@ -0,0 +1,202 @@
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asset_def.h"
+
+using namespace mcompass;
+
+static const char *TAG = "Asset";
+
+// 清单原文, 解析时把分隔符替换为'\0', Entry 中的字符串直接指向这里
+static char *manifest = nullptr;
+static asset::Entry *entries = nullptr;
+static size_t entryCount = 0;
+static spi_flash_mmap_handle_t bundleHandle = 0;
+
+static void reset() {
+  free(entries);
+  free(manifest);
+  entries = nullptr;
+  manifest = nullptr;
+  entryCount = 0;
+  if (bundleHandle) {
+    spi_flash_munmap(bundleHandle);
+    bundleHandle = 0;
+  }
+}
+
+static int compareEntry(const void *a, const void *b) {
+  return strcmp(static_cast<const asset::Entry *>(a)->path,
+                static_cast<const asset::Entry *>(b)->path);
+}
+
+/**
+ * @brief 取出下一个字段并截断, 没有更多字段时返回 nullptr
+ */
+static char *nextField(char *&cursor, char separator) {
+  if (!cursor) {
+    return nullptr;
+  }
+  char *field = cursor;
+  char *end = strchr(cursor, separator);
+  if (end) {
+    *end = '\0';
+    cursor = end + 1;
+  } else {
+    cursor = nullptr;
+  }
+  return field;
+}
+
+/**
+ * @brief 解析一行清单
+ */
+static bool parseLine(char *line, asset::Entry &entry) {
+  char *cursor = line;
+  char *path = nextField(cursor, '\t');
+  char *file = nextField(cursor, '\t');
+  char *size = nextField(cursor, '\t');
+  char *gzip = nextField(cursor, '\t');
+  char *immutable = nextField(cursor, '\t');
+  char *etag = nextField(cursor, '\t');
+  char *contentType = nextField(cursor, '\t');
+  if (!contentType || path[0] != '/' || etag[0] != '"') {
+    return false;
+  }
+  entry.path = path;
+  entry.file = file;
+  entry.size = strtoul(size, nullptr, 10);
+  entry.gzip = gzip[0] == '1';
+  entry.immutable = immutable[0] == '1';
+  entry.etag = etag;
+  entry.contentType = contentType;
+  return true;
+}
+
+bool asset::initBundle() {
+  reset();
+  const esp_partition_t *partition = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+      ASSET_BUNDLE_PARTITION);
+  if (!partition) {
+    ESP_LOGW(TAG, "Partition %s not found", ASSET_BUNDLE_PARTITION);
+    return false;
+  }
+  BundleHeader header;
+  if (esp_partition_read(partition, 0, &header, sizeof(header)) != ESP_OK ||
+      memcmp(header.magic, "MCWB", 4) != 0 ||
+      header.version != ASSET_BUNDLE_VERSION ||
+      header.entrySize != sizeof(BundleEntry) ||
+      header.imageSize > partition->size ||
+      header.entryOffset + (uint32_t)header.count * sizeof(BundleEntry) >
+          header.imageSize) {
+    ESP_LOGW(TAG, "No valid bundle in %s", ASSET_BUNDLE_PARTITION);
+    return false;
+  }
+  const void *mapped = nullptr;
+  if (esp_partition_mmap(partition, 0, header.imageSize,
+                         ESP_PARTITION_MMAP_DATA, &mapped,
+                         &bundleHandle) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to mmap %u bytes", header.imageSize);
+    bundleHandle = 0;
+    return false;
+  }
+  const uint8_t *image = static_cast<const uint8_t *>(mapped);
+  // 烧录中断的镜像CRC不匹配, 整个资源包不使用
+  uint32_t crc = esp_rom_crc32_le(0, image + sizeof(BundleHeader),
+                                  header.imageSize - sizeof(BundleHeader));
+  if (crc != header.crc32) {
+    ESP_LOGE(TAG, "Bundle crc mismatch %08X != %08X", crc, header.crc32);
+    reset();
+    return false;
+  }
+  const BundleEntry *items =
+      reinterpret_cast<const BundleEntry *>(image + header.entryOffset);
+  entries = static_cast<Entry *>(calloc(header.count, sizeof(Entry)));
+  if (!entries) {
+    reset();
+    return false;
+  }
+  for (size_t i = 0; i < header.count; i++) {
+    const BundleEntry &item = items[i];
+    if (memchr(item.path, '\0', sizeof(item.path)) == nullptr ||
+        memchr(item.etag, '\0', sizeof(item.etag)) == nullptr ||
+        memchr(item.contentType, '\0', sizeof(item.contentType)) == nullptr ||
+        item.offset + item.size > header.imageSize) {
+      ESP_LOGW(TAG, "Invalid bundle entry %u", i);
+      continue;
+    }
+    Entry &entry = entries[entryCount++];
+    entry.path = item.path;
+    entry.data = image + item.offset;
+    entry.size = item.size;
+    entry.gzip = item.flags & 0x01;
+    entry.immutable = item.flags & 0x02;
+    entry.etag = item.etag;
+    entry.contentType = item.contentType;
+  }
+  // 生成时已经排序, 这里保证二分查找的前提
+  qsort(entries, entryCount, sizeof(Entry), compareEntry);
+  ESP_LOGI(TAG, "Mapped bundle, %u assets, %u bytes", entryCount,
+           header.imageSize);
+  return entryCount > 0;
+}
+
+bool asset::init(fs::FS &fs) {
+  reset();
+
+  File file = fs.open(ASSET_MANIFEST_FILE, "r");
+  if (!file) {
+    ESP_LOGW(TAG, "%s not found, fallback to file system", ASSET_MANIFEST_FILE);
+    return false;
+  }
+  size_t size = file.size();
+  manifest = static_cast<char *>(malloc(size + 1));
+  if (!manifest || file.read((uint8_t *)manifest, size) != size) {
+    ESP_LOGE(TAG, "Failed to read %s", ASSET_MANIFEST_FILE);
+    file.close();
+    reset();
+    return false;
+  }
+  file.close();
+  manifest[size] = '\0';
+
+  size_t lines = 0;
+  for (size_t i = 0; i < size; i++) {
+    lines += manifest[i] == '\n';
+  }
+  entries = static_cast<Entry *>(calloc(lines + 1, sizeof(Entry)));
+  if (!entries) {
+    reset();
+    return false;
+  }
+  char *cursor = manifest;
+  while (char *line = nextField(cursor, '\n')) {
+    if (line[0] == '\0') {
+      continue;
+    }
+    if (!parseLine(line, entries[entryCount])) {
+      ESP_LOGW(TAG, "Invalid manifest line: %s", line);
+      continue;
+    }
+    entryCount++;
+  }
+  qsort(entries, entryCount, sizeof(Entry), compareEntry);
+  ESP_LOGI(TAG, "Loaded %u assets, manifest %u bytes", entryCount, size);
+  return entryCount > 0;
+}
+
+const asset::Entry *asset::find(const char *path) {
+  if (!entries) {
+    return nullptr;
+  }
+  Entry key = {};
+  key.path = path;
+  return static_cast<const Entry *>(
+      bsearch(&key, entries, entryCount, sizeof(Entry), compareEntry));
+}
+
+size_t asset::count() { return entryCount; }
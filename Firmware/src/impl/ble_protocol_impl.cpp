@@ -0,0 +1,190 @@
+#include <string.h>
+
+#include "ble_protocol.h"
+#include "gps_def.h"
+
+using namespace mcompass;
+using namespace mcompass::ble_protocol;
+
+static int32_t readInt32(const uint8_t *data) {
+  return (int32_t)((uint32_t)data[0] | (uint32_t)data[1] << 8 |
+                   (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+}
+
+static uint32_t readColor(const uint8_t *data) {
+  return (uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2];
+}
+
+/**
+ * @brief 复制字符串记录, 长度不在 [minLength, capacity) 或包含'\0'时失败
+ */
+static bool readString(const uint8_t *data, uint8_t length, size_t minLength,
+                       char *out, size_t capacity) {
+  if (length < minLength || length >= capacity ||
+      memchr(data, 0, length) != nullptr) {
+    return false;
+  }
+  memcpy(out, data, length);
+  out[length] = '\0';
+  return true;
+}
+
+/**
+ * @brief 坐标先按协议范围检查, 再与配置文件一样交给 gps::isValidGPSLocation
+ */
+static bool validCoordinate(int32_t latitudeE7, int32_t longitudeE7) {
+  if (latitudeE7 < -900000000 || latitudeE7 > 900000000 ||
+      longitudeE7 < -1800000000 || longitudeE7 > 1800000000) {
+    return false;
+  }
+  Location location;
+  location.latitude = latitudeE7 * 1e-7;
+  location.longitude = longitudeE7 * 1e-7;
+  return gps::isValidGPSLocation(location);
+}
+
+/**
+ * @brief 解码一条记录的值
+ */
+static Status decodeRecord(uint8_t type, const uint8_t *value, uint8_t length,
+                           Message &message) {
+  switch (type) {
+  case TYPE_BRIGHTNESS:
+    if (length != 1) {
+      return STATUS_BAD_LENGTH;
+    }
+    message.brightness = value[0];
+    return STATUS_OK;
+  case TYPE_SPAWN_COLOR:
+  case TYPE_SOUTH_COLOR:
+    if (length != 3) {
+      return STATUS_BAD_LENGTH;
+    }
+    (type == TYPE_SPAWN_COLOR ? message.spawnColor : message.southColor) =
+        readColor(value);
+    return STATUS_OK;
+  case TYPE_SPAWN:
+    if (length != 8) {
+      return STATUS_BAD_LENGTH;
+    }
+    message.latitudeE7 = readInt32(value);
+    message.longitudeE7 = readInt32(value + 4);
+    return validCoordinate(message.latitudeE7, message.longitudeE7)
+               ? STATUS_OK
+               : STATUS_BAD_VALUE;
+  case TYPE_SERVER_MODE:
+  case TYPE_MODEL:
+    if (length != 1) {
+      return STATUS_BAD_LENGTH;
+    }
+    if (value[0] > 1) {
+      return STATUS_BAD_VALUE;
+    }
+    (type == TYPE_SERVER_MODE ? message.serverMode : message.model) =
+        value[0];
+    return STATUS_OK;
+  case TYPE_WIFI_SSID:
+    return readString(value, length, 1, message.ssid, sizeof(message.ssid))
+               ? STATUS_OK
+               : STATUS_BAD_VALUE;
+  case TYPE_WIFI_PASSWORD:
+    return readString(value, length, 0, message.password,
+                      sizeof(message.password))
+               ? STATUS_OK
+               : STATUS_BAD_VALUE;
+  case TYPE_WAYPOINT_ADD:
+    if (length < 9) {
+      return STATUS_BAD_LENGTH;
+    }
+    message.waypointLatitudeE7 = readInt32(value);
+    message.waypointLongitudeE7 = readInt32(value + 4);
+    if (!validCoordinate(message.waypointLatitudeE7,
+                         message.waypointLongitudeE7)) {
+      return STATUS_BAD_VALUE;
+    }
+    return readString(value + 8, length - 8, 1, message.addName,
+                      sizeof(message.addName))
+               ? STATUS_OK
+               : STATUS_BAD_VALUE;
+  case TYPE_WAYPOINT_DELETE:
+    return readString(value, length, 1, message.deleteName,
+                      sizeof(message.deleteName))
+               ? STATUS_OK
+               : STATUS_BAD_VALUE;
+  case TYPE_WAYPOINT_SELECT:
+    if (length != 1) {
+      return STATUS_BAD_LENGTH;
+    }
+    message.selection = (int8_t)value[0];
+    return message.selection >= -2 ? STATUS_OK : STATUS_BAD_VALUE;
+  case TYPE_CALIBRATE:
+  case TYPE_FACTORY_RESET:
+    return length == 0 ? STATUS_OK : STATUS_BAD_LENGTH;
+  default:
+    return STATUS_UNKNOWN_TYPE;
+  }
+}
+
+Status ble_protocol::decode(const uint8_t *data, size_t length,
+                            Message &message, uint8_t &record) {
+  memset(&message, 0, sizeof(message));
+  record = NO_RECORD;
+  if (length < 2) {
+    return STATUS_TRUNCATED;
+  }
+  message.sequence = data[1];
+  if (data[0] != VERSION) {
+    return STATUS_BAD_VERSION;
+  }
+  size_t offset = 2;
+  for (uint8_t index = 0; offset < length; index++) {
+    // 每种类型最多出现一次, 记录序号不会溢出
+    record = index;
+    if (length - offset < 2 || length - offset - 2 < data[offset + 1]) {
+      return STATUS_TRUNCATED;
+    }
+    uint8_t type = data[offset];
+    uint8_t size = data[offset + 1];
+    if (type >= 32) {
+      return STATUS_UNKNOWN_TYPE;
+    }
+    if (message.types & (1u << type)) {
+      return STATUS_DUPLICATE;
+    }
+    Status status = decodeRecord(type, data + offset + 2, size, message);
+    if (status != STATUS_OK) {
+      return status;
+    }
+    message.types |= 1u << type;
+    offset += 2 + size;
+  }
+  record = NO_RECORD;
+  // 账号和密码必须成对修改
+  if (message.has(TYPE_WIFI_SSID) != message.has(TYPE_WIFI_PASSWORD)) {
+    return STATUS_BAD_VALUE;
+  }
+  return STATUS_OK;
+}
+
+const char *ble_protocol::statusName(Status status) {
+  switch (status) {
+  case STATUS_OK:
+    return "ok";
+  case STATUS_BAD_VERSION:
+    return "bad version";
+  case STATUS_TRUNCATED:
+    return "truncated";
+  case STATUS_BAD_LENGTH:
+    return "bad length";
+  case STATUS_BAD_VALUE:
+    return "bad value";
+  case STATUS_DUPLICATE:
+    return "duplicate";
+  case STATUS_UNKNOWN_TYPE:
+    return "unknown type";
+  case STATUS_FAILED:
+    return "failed";
+  default:
+    return "unknown";
+  }
+}
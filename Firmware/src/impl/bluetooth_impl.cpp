@@ -1,5 +1,7 @@
 #include <NimBLEDevice.h>
+#include <atomic>
 
+#include "ble_protocol.h"
 #include "board.h"
 #include "event.h"
 #include "macro_def.h"
@@ -11,6 +13,16 @@ static const char *TAG = "Bluetooth";
 static bool clientConnected = false;
 // 服务工作状态
 static bool serverEnable = false;
+// 在 init 中创建后缓存, 通知时不再按UUID查找
+static NimBLECharacteristic *azimuthChar = nullptr;
+static NimBLECharacteristic *azimuthStreamChar = nullptr;
+static NimBLECharacteristic *infoChar = nullptr;
+// 协商的连接间隔(毫秒)和MTU, 由 NimBLE 任务写入, 事件循环读取;
+// 多个客户端时使用最近一次协商的结果
+static std::atomic<uint16_t> connIntervalMs{BLE_CONN_INTERVAL_MAX * 5 / 4};
+static std::atomic<uint16_t> peerMtu{BLE_ATT_MTU_DFLT};
+// 订阅方位角流的客户端, 按连接句柄置位
+static std::atomic<uint32_t> streamSubscribers{0};
 
 using namespace mcompass;
 
@@ -20,7 +32,12 @@ using namespace mcompass;
 class ServerCallbacks : public NimBLEServerCallbacks {
   void onConnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo) override {
     ESP_LOGI(TAG, "Client address: %s\n", connInfo.getAddress().toString());
-    pServer->updateConnParams(connInfo.getConnHandle(), 80, 100, 4, 200);
+    // 方位角流需要较短的连接间隔, 没有数据时由从设备延迟跳过连接事件
+    pServer->updateConnParams(connInfo.getConnHandle(), BLE_CONN_INTERVAL_MIN,
+                              BLE_CONN_INTERVAL_MAX, BLE_CONN_LATENCY,
+                              BLE_CONN_TIMEOUT);
+    connIntervalMs = connInfo.getConnInterval() * 5 / 4;
+    peerMtu = connInfo.getMTU();
     clientConnected = true;
   }
 
@@ -33,181 +50,456 @@ class ServerCallbacks : public NimBLEServerCallbacks {
   void onMTUChange(uint16_t MTU, NimBLEConnInfo &connInfo) override {
     ESP_LOGI(TAG, "MTU updated: %u for connection ID: %u\n", MTU,
              connInfo.getConnHandle());
+    peerMtu = MTU;
+  }
+
+  void onConnParamsUpdate(NimBLEConnInfo &connInfo) override {
+    connIntervalMs = connInfo.getConnInterval() * 5 / 4;
+    ESP_LOGI(TAG, "Connection interval %u ms, latency %u",
+             connIntervalMs.load(), connInfo.getConnLatency());
   }
 
 } serverCallbacks;
 
+/**
+ * @brief 更新航点特征值为 "选择方式,目标航点,航点数量"
+ */
+static void setWaypointSummary(NimBLECharacteristic *pCharacteristic) {
+  utils::FixedString<32> summary;
+  summary.appendf("%d,%d,%u", waypoint::getSelection(), waypoint::getActive(),
+                  waypoint::count());
+  pCharacteristic->setValue(summary.c_str());
+}
+
+/**
+ * @brief 处理航点命令
+ *
+ * add,名称,纬度,经度  添加或更新航点
+ * del,名称            删除航点
+ * sel,序号            选择目标, -1 出生点, -2 最近的航点
+ * get,序号            读取航点, 特征值变为 "序号,名称,纬度,经度"
+ */
+static void onWaypointCommand(NimBLECharacteristic *pCharacteristic,
+                              const std::string &value) {
+  char buffer[64] = {0};
+  strncpy(buffer, value.c_str(), sizeof(buffer) - 1);
+  char *tokens[4];
+  size_t count = utils::split(buffer, ',', tokens, 4);
+  bool success = false;
+  if (count == 4 && strcmp(tokens[0], "add") == 0) {
+    Location location;
+    location.latitude = strtof(tokens[2], nullptr);
+    location.longitude = strtof(tokens[3], nullptr);
+    success = waypoint::add(tokens[1], location) >= 0;
+  } else if (count == 2 && strcmp(tokens[0], "del") == 0) {
+    int index = waypoint::find(tokens[1]);
+    success = index >= 0 && waypoint::remove(index);
+  } else if (count == 2 && strcmp(tokens[0], "sel") == 0) {
+    success = waypoint::select(atoi(tokens[1]));
+  } else if (count == 2 && strcmp(tokens[0], "get") == 0) {
+    int index = atoi(tokens[1]);
+    waypoint::Waypoint item;
+    if (index >= 0 && waypoint::get(index, item)) {
+      utils::FixedString<64> record;
+      record.appendf("%d,%s,%.6f,%.6f", index, item.name,
+                     item.location.latitude, item.location.longitude);
+      pCharacteristic->setValue(record.c_str());
+      return;
+    }
+  }
+  if (!success) {
+    ESP_LOGE(TAG, "Error: Invalid waypoint command");
+  }
+  setWaypointSummary(pCharacteristic);
+}
+
+/**
+ * @brief 处理批量配置, 写入JSON后特征值变为当前配置或 {"error":"..."}
+ */
+static void onConfigCommand(NimBLECharacteristic *pCharacteristic,
+                            const std::string &value) {
+  config::Change change;
+  const char *error;
+  if (!config::parse(value.data(), value.length(), change, error)) {
+    ESP_LOGE(TAG, "Error: Invalid config, %s", error);
+    utils::FixedString<64> json;
+    json.appendf("{\"error\":\"%s\"}", error);
+    pCharacteristic->setValue(json.c_str());
+    return;
+  }
+  if (!config::apply(change)) {
+    pCharacteristic->setValue("{\"error\":\"save failed\"}");
+    return;
+  }
+  utils::FixedString<CONFIG_JSON_CAPACITY> json;
+  config::toJson(json, change.fields & config::RESTART_FIELDS);
+  pCharacteristic->setValue(json.c_str());
+}
+
+/**
+ * @brief 向主事件循环发送事件, 用于校准和恢复出厂设置
+ */
+static void postEvent(Event::Type type) {
+  Context &context = Context::getInstance();
+  Event::Body event;
+  event.type = type;
+  event.source = Event::Source::BLE;
+  auto eventLoop = context.getEventLoop();
+  ESP_ERROR_CHECK(esp_event_post_to(eventLoop, MCOMPASS_EVENT, 0, &event,
+                                    sizeof(event), portMAX_DELAY));
+}
+
+/**
+ * @brief 执行一帧已校验的二进制协议消息
+ *
+ * 配置类记录合并为一个 config::Change, 一次NVS事务保存; 之后依次执行
+ * 航点添加, 删除, 选择和校准, 恢复出厂设置
+ */
+static ble_protocol::Status applyMessage(const ble_protocol::Message &message) {
+  using namespace ble_protocol;
+  static_assert(NAME_CAPACITY == WAYPOINT_NAME_LENGTH, "waypoint name");
+  static_assert(sizeof(Message::ssid) == sizeof(config::Change::ssid) &&
+                    sizeof(Message::password) ==
+                        sizeof(config::Change::password),
+                "wifi credentials");
+  config::Change change;
+  memset(&change, 0, sizeof(change));
+  Context &context = Context::getInstance();
+  change.color = context.getColor();
+  if (message.has(TYPE_BRIGHTNESS)) {
+    change.fields |= config::FIELD_BRIGHTNESS;
+    change.brightness = message.brightness;
+  }
+  if (message.has(TYPE_SPAWN_COLOR)) {
+    change.fields |= config::FIELD_SPAWN_COLOR;
+    change.color.spawnColor = message.spawnColor;
+  }
+  if (message.has(TYPE_SOUTH_COLOR)) {
+    change.fields |= config::FIELD_SOUTH_COLOR;
+    change.color.southColor = message.southColor;
+  }
+  if (message.has(TYPE_SPAWN)) {
+    change.fields |= config::FIELD_SPAWN;
+    change.spawn.latitude = message.latitudeE7 * 1e-7;
+    change.spawn.longitude = message.longitudeE7 * 1e-7;
+  }
+  if (message.has(TYPE_SERVER_MODE)) {
+    change.fields |= config::FIELD_SERVER_MODE;
+    change.serverMode =
+        message.serverMode ? ServerMode::BLE : ServerMode::WIFI;
+  }
+  if (message.has(TYPE_MODEL)) {
+    change.fields |= config::FIELD_MODEL;
+    change.model = message.model ? Model::GPS : Model::LITE;
+  }
+  if (message.has(TYPE_WIFI_SSID)) {
+    change.fields |= config::FIELD_WIFI;
+    strcpy(change.ssid, message.ssid);
+    strcpy(change.password, message.password);
+  }
+  if (change.fields && !config::apply(change)) {
+    return STATUS_FAILED;
+  }
+  if (message.has(TYPE_WAYPOINT_ADD)) {
+    Location location;
+    location.latitude = message.waypointLatitudeE7 * 1e-7;
+    location.longitude = message.waypointLongitudeE7 * 1e-7;
+    if (waypoint::add(message.addName, location) < 0) {
+      return STATUS_FAILED;
+    }
+  }
+  if (message.has(TYPE_WAYPOINT_DELETE)) {
+    int index = waypoint::find(message.deleteName);
+    if (index < 0 || !waypoint::remove(index)) {
+      return STATUS_FAILED;
+    }
+  }
+  if (message.has(TYPE_WAYPOINT_SELECT) &&
+      !waypoint::select(message.selection)) {
+    return STATUS_FAILED;
+  }
+  if (message.has(TYPE_CALIBRATE)) {
+    postEvent(Event::Type::SENSOR_CALIBRATE);
+  }
+  if (message.has(TYPE_FACTORY_RESET)) {
+    postEvent(Event::Type::FACTORY_RESET);
+  }
+  return STATUS_OK;
+}
+
+/**
+ * @brief 处理二进制协议帧, 结果写回特征值并通知订阅的客户端
+ */
+static void onProtocolWrite(NimBLECharacteristic *pCharacteristic) {
+  NimBLEAttValue value = pCharacteristic->getValue();
+  ble_protocol::Message message;
+  uint8_t record;
+  ble_protocol::Status status =
+      ble_protocol::decode(value.data(), value.length(), message, record);
+  if (status == ble_protocol::STATUS_OK) {
+    status = applyMessage(message);
+  }
+  if (status != ble_protocol::STATUS_OK) {
+    ESP_LOGE(TAG, "Protocol frame %u: %s, record %u", message.sequence,
+             ble_protocol::statusName(status), record);
+  }
+  ble_protocol::Response response = {
+      .version = ble_protocol::VERSION,
+      .sequence = message.sequence,
+      .status = status,
+      .record = record,
+  };
+  pCharacteristic->setValue(reinterpret_cast<const uint8_t *>(&response),
+                            sizeof(response));
+  pCharacteristic->notify();
+}
+
+//////////////////////////// 旧特征值 ////////////////////////////
+// 各自使用不同的文本格式, 兼容旧版客户端保留
+
+static void onSpawnWrite(NimBLECharacteristic *pCharacteristic) {
+  // 获取写入的数据
+  std::string value = pCharacteristic->getValue();
+  ESP_LOGI(TAG, "Spawn onWrite, Received data:%s ", value.c_str());
+  // 解析经度和纬度
+  float longitude = 0.0f;
+  float latitude = 0.0f;
+  bool parseSuccess = false;
+  size_t commaIndex = value.find(',');
+  if (commaIndex != std::string::npos) {
+    std::string latitudeStr = value.substr(0, commaIndex);
+    std::string longitudeStr = value.substr(commaIndex + 1);
+    try {
+      longitude = std::stof(longitudeStr);
+      latitude = std::stof(latitudeStr);
+      parseSuccess = true;
+    } catch (const std::invalid_argument &e) {
+      ESP_LOGE(TAG, "Error: Invalid number format");
+    } catch (const std::out_of_range &e) {
+      ESP_LOGE(TAG, "Error: Number out of range");
+    }
+  } else {
+    ESP_LOGE(TAG, "Error: Invalid format, expected 'xxx,yyy'");
+  }
+
+  // 打印经度和纬度
+  if (parseSuccess) {
+    ESP_LOGI(TAG, "Save Longitude: %.6f, Latitude:%.6f", longitude,
+             latitude);
+    Location location = {
+        .latitude = latitude,
+        .longitude = longitude,
+    };
+    Context &context = Context::getInstance();
+    preference::saveSpawnLocation(location);
+    context.setSpawnLocation(location);
+    // 设置出生点后不再指向航点
+    waypoint::select(waypoint::SELECT_SPAWN);
+  }
+}
+
+static void onColorWrite(NimBLECharacteristic *pCharacteristic) {
+  std::string value = pCharacteristic->getValue();
+  ESP_LOGI(TAG, "Color onWrite, Received data: %s", value.c_str());
+  char buffer[32] = {0};
+  strncpy(buffer, value.c_str(), sizeof(buffer) - 1);
+  char *colors[2];
+  size_t colorCount = utils::split(buffer, ',', colors, 2);
+  Context &context = Context::getInstance();
+  PointerColor color;
+  color = context.getColor();
+  if (colorCount == 1) {
+    char *endptr;
+    int southColor = strtol(colors[0], &endptr, 16);
+    if (endptr != colors[0]) {
+      color.southColor = southColor;
+    }
+    preference::savePointerColor(color);
+    context.setColor(color);
+  } else if (colorCount >= 2) {
+    char *endptr;
+    int southColor = strtol(colors[0], &endptr, 16);
+    if (endptr == colors[0]) {
+      ESP_LOGE(TAG, "Failed to parse southColor value");
+    } else {
+      color.southColor = southColor;
+    }
+    int spawnColor = strtol(colors[1], &endptr, 16);
+    if (endptr == colors[1]) {
+      ESP_LOGE(TAG, "Failed to parse spawnColor value");
+    } else {
+      color.spawnColor = spawnColor;
+    }
+    preference::savePointerColor(color);
+    context.setColor(color);
+  } else {
+    ESP_LOGE(TAG, "Failed to parse PointerColor value");
+  }
+}
+
+static void onVirtualLocationWrite(NimBLECharacteristic *pCharacteristic) {
+  std::string value = pCharacteristic->getValue();
+  ESP_LOGI(TAG, "Virtual Location onWrite, Received data: %s",
+           value.c_str());
+}
+
+static void onVirtualAzimuthWrite(NimBLECharacteristic *pCharacteristic) {
+  std::string value = pCharacteristic->getValue();
+  ESP_LOGI(TAG, "Virtual Azimuth onWrite, Received data: %s",
+           value.c_str());
+}
+
+static void onRebootWrite(NimBLECharacteristic *pCharacteristic) {
+  std::string value = pCharacteristic->getValue();
+  ESP_LOGI(TAG, "Reboot onWrite, Received data: %s", value.c_str());
+  postEvent(Event::Type::FACTORY_RESET);
+}
+
+static void onServerModeWrite(NimBLECharacteristic *pCharacteristic) {
+  std::string value = pCharacteristic->getValue();
+  ESP_LOGI(TAG, "ServerMode onWrite, Received data: %s", value.c_str());
+  Context &context = Context::getInstance();
+  if (value[0] == 0) {
+    preference::setServerMode(ServerMode::WIFI);
+    context.setServerMode(ServerMode::WIFI);
+  } else if (value[0] == 1) {
+    preference::setServerMode(ServerMode::BLE);
+    context.setServerMode(ServerMode::BLE);
+  }
+}
+
+static void onBrightnessWrite(NimBLECharacteristic *pCharacteristic) {
+  std::string value = pCharacteristic->getValue();
+  // 打印亮度值
+  ESP_LOGI(TAG, "Brightness onWrite, Received data: %d", value[0]);
+  if (value.length() == 1) {
+    Context &context = Context::getInstance();
+    uint8_t brightness = static_cast<uint8_t>(value[0]);
+    preference::setBrightness(brightness);
+    context.setBrightness(brightness);
+    pixel::setBrightness(brightness);
+  } else {
+    ESP_LOGE(TAG, "Error: Invalid brightness value length");
+  }
+}
+
+static void onCalibrateWrite(NimBLECharacteristic *pCharacteristic) {
+  std::string value = pCharacteristic->getValue();
+  ESP_LOGI(TAG, "Calibrate onWrite, Received data: %d", value[0]);
+  // 发送校准事件
+  postEvent(Event::Type::SENSOR_CALIBRATE);
+}
+
+static void onCustomModelWrite(NimBLECharacteristic *pCharacteristic) {
+  std::string value = pCharacteristic->getValue();
+  ESP_LOGI(TAG, "Custom Model onWrite, Received data: %s", value.c_str());
+  Context &context = Context::getInstance();
+  if (value.length() == 1) {
+    Model model = static_cast<Model>(value[0]);
+    preference::setCustomDeviceModel(model);
+    context.setModel(model);
+  }
+}
+
+static void onWaypointWrite(NimBLECharacteristic *pCharacteristic) {
+  std::string value = pCharacteristic->getValue();
+  ESP_LOGI(TAG, "Waypoint onWrite, Received data: %s", value.c_str());
+  onWaypointCommand(pCharacteristic, value);
+}
+
+static void onConfigWrite(NimBLECharacteristic *pCharacteristic) {
+  std::string value = pCharacteristic->getValue();
+  ESP_LOGI(TAG, "Config onWrite, Received data: %s", value.c_str());
+  onConfigCommand(pCharacteristic, value);
+}
+
+/// @brief 特征值的写入处理, 写入的数据由处理函数自己读取
+typedef void (*WriteHandler)(NimBLECharacteristic *pCharacteristic);
+
+/// @brief 特征值与处理函数的对应关系
+struct Binding {
+  uint16_t service;     // 所在服务
+  uint16_t uuid;        // 特征值UUID
+  const char *name;     // 日志中的名称
+  WriteHandler onWrite; // 写入处理, 只读特征值为 nullptr
+};
+
+static const Binding bindings[] = {
+    {BASE_SERVICE_UUID, PROTOCOL_CHARACTERISTIC_UUID, "Protocol",
+     onProtocolWrite},
+    {BASE_SERVICE_UUID, COLOR_CHARACTERISITC_UUID, "Color", onColorWrite},
+    {BASE_SERVICE_UUID, AZIMUTH_CHARACHERSITC_UUID, "Azimuth", nullptr},
+    {BASE_SERVICE_UUID, SPAWN_CHARACTERISTIC_UUID, "Spawn", onSpawnWrite},
+    {BASE_SERVICE_UUID, INFO_CHARACTERISTIC_UUID, "Info", nullptr},
+    {BASE_SERVICE_UUID, AZIMUTH_STREAM_CHARACTERISTIC_UUID, "Azimuth Stream",
+     nullptr},
+    {BASE_SERVICE_UUID, BRIGHTNESS_CHARACTERISTIC_UUID, "Brightness",
+     onBrightnessWrite},
+    {BASE_SERVICE_UUID, CALIBRATE_CHARACTERISTIC_UUID, "Calibrate",
+     onCalibrateWrite},
+    {BASE_SERVICE_UUID, REBOOT_CHARACTERISTIC_UUID, "Reboot", onRebootWrite},
+    {BASE_SERVICE_UUID, SERVER_MODE_CHARACTERISTIC_UUID, "Web Server",
+     onServerModeWrite},
+    {BASE_SERVICE_UUID, CUSTOM_MODEL_CHARACTERISTIC_UUID, "Custom Model",
+     onCustomModelWrite},
+    {BASE_SERVICE_UUID, WAYPOINT_CHARACTERISTIC_UUID, "Waypoint",
+     onWaypointWrite},
+    {BASE_SERVICE_UUID, CONFIG_CHARACTERISTIC_UUID, "Config", onConfigWrite},
+    {ADVANCED_SERVICE_UUID, VIRTUAL_LOCATION_CHARACTERISTIC_UUID,
+     "Virtual Location", onVirtualLocationWrite},
+    {ADVANCED_SERVICE_UUID, VIRTUAL_AZIMUTH_CHARACTERISTIC_UUID,
+     "Virtual Azimuth", onVirtualAzimuthWrite},
+};
+
+/// @brief 按属性句柄索引的 bindings, 服务启动分配句柄后由 buildHandleTable 填充
+static const Binding *handleTable[BLE_HANDLE_TABLE_SIZE];
+
+/**
+ * @brief 查找每个特征值的句柄并填入 handleTable
+ *
+ * 只在初始化时比较一次UUID, 之后读写回调按句柄直接取表
+ */
+static void buildHandleTable() {
+  memset(handleTable, 0, sizeof(handleTable));
+  for (const Binding &binding : bindings) {
+    NimBLEService *pSvc =
+        pServer->getServiceByUUID(NimBLEUUID(binding.service));
+    NimBLECharacteristic *pChr =
+        pSvc ? pSvc->getCharacteristic(NimBLEUUID(binding.uuid)) : nullptr;
+    uint16_t handle = pChr ? pChr->getHandle() : 0;
+    if (handle == 0 || handle >= BLE_HANDLE_TABLE_SIZE) {
+      ESP_LOGE(TAG, "No handle for %s: %u", binding.name, handle);
+      continue;
+    }
+    handleTable[handle] = &binding;
+  }
+}
+
+static const Binding *findBinding(NimBLECharacteristic *pCharacteristic) {
+  uint16_t handle = pCharacteristic->getHandle();
+  return handle < BLE_HANDLE_TABLE_SIZE ? handleTable[handle] : nullptr;
+}
+
 /** Handler class for characteristic actions */
 class CharacteristicCallbacks : public NimBLECharacteristicCallbacks {
   void onRead(NimBLECharacteristic *pCharacteristic,
               NimBLEConnInfo &connInfo) override {
-    std::string characteristic = "Unknown";
-    if (pCharacteristic->getUUID().equals(
-            NimBLEUUID(SPAWN_CHARACTERISTIC_UUID))) {
-      characteristic = "Spawn";
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(COLOR_CHARACTERISITC_UUID))) {
-      characteristic = "Color";
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(AZIMUTH_CHARACHERSITC_UUID))) {
-      characteristic = "Azimuth";
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(INFO_CHARACTERISTIC_UUID))) {
-      characteristic = "Info";
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(SERVER_MODE_CHARACTERISTIC_UUID))) {
-      characteristic = "Web Server";
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(BRIGHTNESS_CHARACTERISTIC_UUID))) {
-      characteristic = "Brightness";
+    // 设备信息只在读取时生成
+    if (pCharacteristic == infoChar) {
+      utils::FixedString<INFO_JSON_CAPACITY> infoJson;
+      Context::getInstance().infoJson(infoJson);
+      infoChar->setValue(infoJson.c_str());
     }
-    ESP_LOGI(TAG, "%s onRead, value: %s", characteristic,
+    const Binding *binding = findBinding(pCharacteristic);
+    ESP_LOGI(TAG, "%s onRead, value: %s", binding ? binding->name : "Unknown",
              pCharacteristic->getValue().c_str());
   }
 
   void onWrite(NimBLECharacteristic *pCharacteristic,
                NimBLEConnInfo &connInfo) override {
-    if (pCharacteristic->getUUID().equals(
-            NimBLEUUID(SPAWN_CHARACTERISTIC_UUID))) {
-      // 获取写入的数据
-      std::string value = pCharacteristic->getValue();
-      ESP_LOGI(TAG, "Spawn onWrite, Received data:%s ", value.c_str());
-      // 解析经度和纬度
-      float longitude = 0.0f;
-      float latitude = 0.0f;
-      bool parseSuccess = false;
-      size_t commaIndex = value.find(',');
-      if (commaIndex != std::string::npos) {
-        std::string latitudeStr = value.substr(0, commaIndex);
-        std::string longitudeStr = value.substr(commaIndex + 1);
-        try {
-          longitude = std::stof(longitudeStr);
-          latitude = std::stof(latitudeStr);
-          parseSuccess = true;
-        } catch (const std::invalid_argument &e) {
-          ESP_LOGE(TAG, "Error: Invalid number format");
-        } catch (const std::out_of_range &e) {
-          ESP_LOGE(TAG, "Error: Number out of range");
-        }
-      } else {
-        ESP_LOGE(TAG, "Error: Invalid format, expected 'xxx,yyy'");
-      }
-
-      // 打印经度和纬度
-      if (parseSuccess) {
-        ESP_LOGI(TAG, "Save Longitude: %.6f, Latitude:%.6f", longitude,
-                 latitude);
-        Location location = {
-            .latitude = latitude,
-            .longitude = longitude,
-        };
-        Context &context = Context::getInstance();
-        preference::saveSpawnLocation(location);
-        context.setSpawnLocation(location);
-      }
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(COLOR_CHARACTERISITC_UUID))) {
-      std::string value = pCharacteristic->getValue();
-      ESP_LOGI(TAG, "Color onWrite, Received data: %s", value.c_str());
-      std::vector<std::string> colors = utils::split(value, ",");
-      Context &context = Context::getInstance();
-      PointerColor color;
-      color = context.getColor();
-      if (colors.size() == 1) {
-        char *endptr;
-        int southColor = strtol(colors[0].c_str(), &endptr, 16);
-        if (endptr == colors[0].c_str() + 1) {
-          color.southColor = southColor;
-        }
-        preference::savePointerColor(color);
-      } else if (colors.size() >= 2) {
-        char *endptr;
-        int southColor = strtol(colors[0].c_str(), &endptr, 16);
-        if (endptr == colors[0].c_str()) {
-          ESP_LOGE(TAG, "Failed to parse southColor value");
-        } else {
-          color.southColor = southColor;
-        }
-        int spawnColor = strtol(colors[1].c_str(), &endptr, 16);
-        if (endptr == colors[1].c_str()) {
-          ESP_LOGE(TAG, "Failed to parse spawnColor value");
-        } else {
-          color.spawnColor = spawnColor;
-        }
-        preference::savePointerColor(color);
-        context.setColor(color);
-      } else {
-        ESP_LOGE(TAG, "Failed to parse PointerColor value");
-      }
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(VIRTUAL_LOCATION_CHARACTERISTIC_UUID))) {
-      std::string value = pCharacteristic->getValue();
-      ESP_LOGI(TAG, "Virtual Location onWrite, Received data: %s",
-               value.c_str());
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(VIRTUAL_AZIMUTH_CHARACTERISTIC_UUID))) {
-      std::string value = pCharacteristic->getValue();
-      ESP_LOGI(TAG, "Virtual Azimuth onWrite, Received data: %s",
-               value.c_str());
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(REBOOT_CHARACTERISTIC_UUID))) {
-      std::string value = pCharacteristic->getValue();
-      ESP_LOGI(TAG, "Reboot onWrite, Received data: %s", value.c_str());
-      Context &context = Context::getInstance();
-      Event::Body event;
-      event.type = Event::Type::FACTORY_RESET;
-      event.source = Event::Source::BLE;
-      auto eventLoop = context.getEventLoop();
-      ESP_ERROR_CHECK(esp_event_post_to(eventLoop, MCOMPASS_EVENT, 0, &event,
-                                        sizeof(event), portMAX_DELAY));
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(SERVER_MODE_CHARACTERISTIC_UUID))) {
-      std::string value = pCharacteristic->getValue();
-      ESP_LOGI(TAG, "ServerMode onWrite, Received data: %s", value.c_str());
-      Context &context = Context::getInstance();
-      if (value[0] == 0) {
-        preference::setServerMode(ServerMode::WIFI);
-        context.setServerMode(ServerMode::WIFI);
-      } else if (value[0] == 1) {
-        preference::setServerMode(ServerMode::BLE);
-        context.setServerMode(ServerMode::BLE);
-      }
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(BRIGHTNESS_CHARACTERISTIC_UUID))) {
-      std::string value = pCharacteristic->getValue();
-      // 打印亮度值
-      ESP_LOGI(TAG, "Brightness onWrite, Received data: %d", value[0]);
-      if (value.length() == 1) {
-        Context &context = Context::getInstance();
-        uint8_t brightness = static_cast<uint8_t>(value[0]);
-        preference::setBrightness(brightness);
-        context.setBrightness(brightness);
-        pixel::setBrightness(brightness);
-      } else {
-        ESP_LOGE(TAG, "Error: Invalid brightness value length");
-      }
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(CALIBRATE_CHARACTERISTIC_UUID))) {
-      std::string value = pCharacteristic->getValue();
-      ESP_LOGI(TAG, "Calibrate onWrite, Received data: %d", value[0]);
-      // 发送校准事件
-      Context &context = Context::getInstance();
-      Event::Body event;
-      event.type = Event::Type::SENSOR_CALIBRATE;
-      event.source = Event::Source::BLE;
-      auto eventLoop = context.getEventLoop();
-      ESP_ERROR_CHECK(esp_event_post_to(eventLoop, MCOMPASS_EVENT, 0, &event,
-                                        sizeof(event), portMAX_DELAY));
-    } else if (pCharacteristic->getUUID().equals(
-                   NimBLEUUID(CUSTOM_MODEL_CHARACTERISTIC_UUID))) {
-      std::string value = pCharacteristic->getValue();
-      ESP_LOGI(TAG, "Custom Model onWrite, Received data: %s", value.c_str());
-      Context &context = Context::getInstance();
-      if (value.length() == 1) {
-        Model model = static_cast<Model>(value[0]);
-        preference::setCustomDeviceModel(model);
-        context.setModel(model);
-      }
+    const Binding *binding = findBinding(pCharacteristic);
+    if (binding && binding->onWrite) {
+      binding->onWrite(pCharacteristic);
     }
   }
   /**
@@ -221,6 +513,15 @@ class CharacteristicCallbacks : public NimBLECharacteristicCallbacks {
   /** Peer subscribed to notifications/indications */
   void onSubscribe(NimBLECharacteristic *pCharacteristic,
                    NimBLEConnInfo &connInfo, uint16_t subValue) override {
+    // 断开连接时协议栈也会以 subValue=0 回调
+    if (pCharacteristic == azimuthStreamChar) {
+      uint32_t bit = 1u << (connInfo.getConnHandle() & 31);
+      if (subValue & 1) {
+        streamSubscribers |= bit;
+      } else {
+        streamSubscribers &= ~bit;
+      }
+    }
     std::string str = "Client ID: ";
     str += connInfo.getConnHandle();
     str += " Address: ";
@@ -240,45 +541,107 @@ class CharacteristicCallbacks : public NimBLECharacteristicCallbacks {
   }
 } chrCallbacks;
 
+/// @brief 待发送的方位角流通知
+struct __attribute__((packed)) AzimuthBatch {
+  ble_server::AzimuthStreamHeader header;
+  ble_server::AzimuthSample samples[BLE_AZIMUTH_BATCH_MAX];
+};
+
+static AzimuthBatch azimuthBatch;
+static int lastSampleAngle = -1;
+static uint32_t lastSampleMs = 0;
+static uint32_t lastNotifyMs = 0;
+static uint32_t lastLegacyMs = 0;
+
+/**
+ * @brief 当前MTU下一个通知能容纳的样本数
+ */
+static uint8_t batchCapacity() {
+  // 通知的ATT头部占3字节
+  int payload = (int)peerMtu.load() - 3 -
+                (int)sizeof(ble_server::AzimuthStreamHeader);
+  int capacity = payload / (int)sizeof(ble_server::AzimuthSample);
+  if (capacity < 1) {
+    return 1;
+  }
+  return capacity < BLE_AZIMUTH_BATCH_MAX ? capacity : BLE_AZIMUTH_BATCH_MAX;
+}
+
+static void sendBatch(uint32_t now) {
+  AzimuthBatch &batch = azimuthBatch;
+  size_t length = sizeof(batch.header) +
+                  batch.header.count * sizeof(ble_server::AzimuthSample);
+  azimuthStreamChar->notify(reinterpret_cast<const uint8_t *>(&batch),
+                            length);
+  batch.header.sequence++;
+  batch.header.count = 0;
+  lastNotifyMs = now;
+}
+
+/**
+ * @brief 方位角变化超过阈值时加入一个样本, 按连接间隔发送
+ *
+ * 样本最高 1000/BLE_AZIMUTH_SAMPLE_INTERVAL Hz; 连接间隔内积累的样本
+ * 合并为一个通知, 放不下时提前发送
+ */
+static void streamAzimuth(int angle, uint32_t now) {
+  AzimuthBatch &batch = azimuthBatch;
+  int difference = abs(angle - lastSampleAngle) % 360;
+  if (difference > 180) {
+    difference = 360 - difference;
+  }
+  bool changed = difference >= BLE_AZIMUTH_THRESHOLD &&
+                 now - lastSampleMs >= BLE_AZIMUTH_SAMPLE_INTERVAL;
+  if (lastSampleAngle < 0 || changed) {
+    if (batch.header.count >= batchCapacity()) {
+      sendBatch(now);
+    }
+    if (batch.header.count == 0) {
+      batch.header.timestampMs = now;
+    }
+    ble_server::AzimuthSample &sample = batch.samples[batch.header.count++];
+    sample.angleX100 = (uint16_t)(((angle % 360) + 360) % 360 * 100);
+    sample.offsetMs = (uint16_t)(now - batch.header.timestampMs);
+    lastSampleAngle = angle;
+    lastSampleMs = now;
+  }
+  if (batch.header.count > 0 && now - lastNotifyMs >= connIntervalMs.load()) {
+    sendBatch(now);
+  }
+}
+
+/**
+ * @brief 蓝牙方位角通知
+ *
+ * 和主处理器共用 SENSOR 方位角的唤醒事件, 从邮箱读取滤波后的方位角,
+ * 不再单独读传感器; 特征值在 init 中缓存, 事件循环中不做查找和堆分配
+ */
 static void ble_azimuth_dispatcher(void *handler_arg, esp_event_base_t base,
                                    int32_t id, void *event_data) {
-  static uint32_t last_update = 0;
-  if (millis() - last_update < 1000)
+  // 方位角事件不携带数据, 事件ID即为消息源
+  if (static_cast<Event::Source>(id) != Event::Source::SENSOR ||
+      pServer->getConnectedCount() == 0) {
     return;
-  last_update = millis();
-  Event::Body *evt = (Event::Body *)event_data;
-  switch (evt->type) {
-  case Event::Type::AZIMUTH: {
-    if (pServer->getConnectedCount() > 0) {
-      // 校验刷新频率, 限制帧率1Hz
-      ESP_LOGI(TAG, "Notify Azimuth: %d", evt->azimuth.angle);
-      NimBLEService *pSvc =
-          pServer->getServiceByUUID(NimBLEUUID(BASE_SERVICE_UUID));
-      if (pSvc) {
-        NimBLECharacteristic *pChr =
-            pSvc->getCharacteristic(NimBLEUUID(AZIMUTH_CHARACHERSITC_UUID), 0);
-        pChr->setValue(sensor::getAzimuth());
-        if (pChr) {
-          pChr->notify();
-        }
-        Context &context = Context::getInstance();
-        pChr = pSvc->getCharacteristic(NimBLEUUID(INFO_CHARACTERISTIC_UUID), 0);
-        String infoJson =
-            "{\"buildDate\":\"" + String(__DATE__) + "\",\"buildTime\":\"" +
-            String(__TIME__) + "\",\"buildVersion\":\"" +
-            String(BUILD_VERSION) + "\",\"gitBranch\":\"" + String(GIT_BRANCH) +
-            "\",\"gpsStatus\":\"" + (context.getDetectGPS() ? "1" : "0") +
-            "\",\"model\":\"" + (context.isGPSModel() ? "1" : "0") +
-            "\",\"sensorStatus\":\"" + (context.getHasSensor() ? "1" : "0") +
-            "\",\"gitCommit\":\"" + String(GIT_COMMIT) + "\"}";
-        pChr->setValue(infoJson);
-      }
-    }
-  } break;
   }
+  int angle = Event::peekAzimuth(Event::Source::SENSOR);
+  uint32_t now = millis();
+  // 旧特征值保持1Hz通知
+  if (now - lastLegacyMs >= BLE_AZIMUTH_LEGACY_INTERVAL) {
+    lastLegacyMs = now;
+    azimuthChar->setValue(angle);
+    azimuthChar->notify();
+  }
+  if (streamSubscribers.load() == 0) {
+    // 没有订阅时丢弃积累的样本, 重新订阅后从当前角度开始
+    azimuthBatch.header.count = 0;
+    lastSampleAngle = -1;
+    return;
+  }
+  streamAzimuth(angle, now);
 }
 
 void ble_server::init(Context *context) {
+  config::init(context);
   NimBLEDevice::init("NimBLE");
   NimBLEDevice::setSecurityAuth(BLE_SM_PAIR_AUTHREQ_SC);
   NimBLEDevice::setMTU(255);
@@ -298,7 +661,7 @@ void ble_server::init(Context *context) {
   colorChar->setValue(colorBuffer);
   colorChar->setCallbacks(&chrCallbacks);
   // 方位角, 可读, Notify
-  NimBLECharacteristic *azimuthChar = baseService->createCharacteristic(
+  azimuthChar = baseService->createCharacteristic(
       NimBLEUUID(AZIMUTH_CHARACHERSITC_UUID),
       NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
   azimuthChar->setValue(0);
@@ -314,18 +677,12 @@ void ble_server::init(Context *context) {
   spawnChar->setValue(locationBuffer);
   spawnChar->setCallbacks(&chrCallbacks);
   // 设备信息
-  NimBLECharacteristic *infoChar = baseService->createCharacteristic(
+  infoChar = baseService->createCharacteristic(
       NimBLEUUID(INFO_CHARACTERISTIC_UUID),
       NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE);
-  String infoJson =
-      "{\"buildDate\":\"" + String(__DATE__) + "\",\"buildTime\":\"" +
-      String(__TIME__) + "\",\"buildVersion\":\"" + String(BUILD_VERSION) +
-      "\",\"gitBranch\":\"" + String(GIT_BRANCH) + "\",\"gpsStatus\":\"" +
-      (context->getDetectGPS() ? "1" : "0") + "\",\"model\":\"" +
-      (context->isGPSModel() ? "1" : "0") + "\",\"sensorStatus\":\"" +
-      (context->getHasSensor() ? "1" : "0") + "\",\"gitCommit\":\"" +
-      String(GIT_COMMIT) + "\"}";
-  infoChar->setValue(infoJson);
+  utils::FixedString<INFO_JSON_CAPACITY> infoJson;
+  context->infoJson(infoJson);
+  infoChar->setValue(infoJson.c_str());
   infoChar->setCallbacks(&chrCallbacks);
   // 请求校准
   NimBLECharacteristic *calibrateChar = baseService->createCharacteristic(
@@ -373,9 +730,37 @@ void ble_server::init(Context *context) {
       NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ);
   customModelChar->setValue(static_cast<uint8_t>(context->getModel()));
   customModelChar->setCallbacks(&chrCallbacks);
+  // 航点, 写入命令后读取结果
+  NimBLECharacteristic *waypointChar = baseService->createCharacteristic(
+      NimBLEUUID(WAYPOINT_CHARACTERISTIC_UUID),
+      NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ);
+  setWaypointSummary(waypointChar);
+  waypointChar->setCallbacks(&chrCallbacks);
+  // 批量配置, 写入JSON后读取结果
+  NimBLECharacteristic *configChar = baseService->createCharacteristic(
+      NimBLEUUID(CONFIG_CHARACTERISTIC_UUID),
+      NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ);
+  utils::FixedString<CONFIG_JSON_CAPACITY> configJson;
+  config::toJson(configJson);
+  configChar->setValue(configJson.c_str());
+  configChar->setCallbacks(&chrCallbacks);
+  // 方位角流, 只通知, 格式见 AzimuthStreamHeader
+  azimuthStreamChar = baseService->createCharacteristic(
+      NimBLEUUID(AZIMUTH_STREAM_CHARACTERISTIC_UUID), NIMBLE_PROPERTY::NOTIFY);
+  azimuthStreamChar->setCallbacks(&chrCallbacks);
+  // 二进制配置协议, 无响应写入, 结果通过通知返回
+  NimBLECharacteristic *protocolChar = baseService->createCharacteristic(
+      NimBLEUUID(PROTOCOL_CHARACTERISTIC_UUID),
+      NIMBLE_PROPERTY::WRITE_NR | NIMBLE_PROPERTY::WRITE |
+          NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+  protocolChar->setValue(static_cast<uint8_t>(ble_protocol::VERSION));
+  protocolChar->setCallbacks(&chrCallbacks);
 
   baseService->start();
   advancedService->start();
+  // 启动GATT服务器分配属性句柄, 之后按句柄分发读写
+  pServer->start();
+  buildHandleTable();
 
   NimBLEAdvertising *pAdvertising = NimBLEDevice::getAdvertising();
   pAdvertising->setName("MCOMPASS");
@@ -386,7 +771,8 @@ void ble_server::init(Context *context) {
 
   serverEnable = true;
   Serial.printf("Advertising Started\n");
-  esp_event_handler_register_with(context->getEventLoop(), MCOMPASS_EVENT, 0,
+  esp_event_handler_register_with(context->getEventLoop(),
+                                  MCOMPASS_AZIMUTH_EVENT, ESP_EVENT_ANY_ID,
                                   ble_azimuth_dispatcher, NULL);
   // 定时器, 用于关闭蓝牙
   esp_timer_handle_t deinitTimer;
@@ -421,7 +807,8 @@ void ble_server::deinit(Context *context) {
     return;
   }
   ESP_LOGW(TAG, "deinit");
-  esp_event_handler_unregister_with(context->getEventLoop(), MCOMPASS_EVENT, 0,
+  esp_event_handler_unregister_with(context->getEventLoop(),
+                                    MCOMPASS_AZIMUTH_EVENT, ESP_EVENT_ANY_ID,
                                     ble_azimuth_dispatcher);
   NimBLEDevice::deinit(false);
   esp_bt_controller_disable();
@@ -2,6 +2,7 @@
 #include <esp_log.h>
 #include <esp_wifi.h>
 
+#include "alloc_tracker.h"
 #include "board.h"
 #include "context.h"
 #include "event.h"
@@ -29,6 +30,8 @@ const float dt = 1.0f / 60.0f;
 
 static void setupContext() {
   preference::init(&context);
+  // 加载航点表, 选中航点时覆盖出生点
+  waypoint::init(&context);
   // 根据设备型号设置默认订阅源
   if (context.isGPSModel()) {
     context.setSubscribeSource(Event::Source::NETHER);
@@ -50,6 +53,8 @@ void board::init() {
   ESP_LOGI(TAG, "Board init %p", &context);
   // 初始化上下文
   setupContext();
+  // 启动栈/堆水位监控
+  monitor::init();
   // 设置引脚模式
   pinMode(CALIBRATE_PIN, INPUT_PULLUP);
   pinMode(GPS_EN_PIN, OUTPUT);
@@ -93,6 +98,7 @@ void board::init() {
   esp_timer_create_args_t sensor_timer_args = {
       .callback =
           [](void *) {
+            ALLOC_GUARD("sensor_timer");
             auto target_azimuth = sensor::getAzimuth();
 
             // 2. 计算 "目标" 与 "当前" 之间的最短角度差 (位移 x)
@@ -130,13 +136,9 @@ void board::init() {
             }
 
             // 9. 使用这个新的、插值后的 "弹性" 角度
-            Event::Body event;
-            event.type = Event::Type::AZIMUTH;
-            event.source = Event::Source::SENSOR;
             // 使用插值后的值, 而不是传感器的原始值
-            event.azimuth.angle = g_interpolated_azimuth;
-            esp_event_post_to(context.getEventLoop(), MCOMPASS_EVENT, 0, &event,
-                              sizeof(event), 0);
+            Event::postAzimuth(context.getEventLoop(), Event::Source::SENSOR,
+                               g_interpolated_azimuth);
           },
       .arg = nullptr,
       .dispatch_method = ESP_TIMER_TASK,
@@ -176,12 +178,8 @@ void board::init() {
             //          currentIndex, targetIndex, azimuth);
 
             // 发送方位角事件
-            Event::Body event;
-            event.type = Event::Type::AZIMUTH;
-            event.source = Event::Source::NETHER;
-            event.azimuth.angle = azimuth;
-            esp_event_post_to(context.getEventLoop(), MCOMPASS_EVENT, 0, &event,
-                              sizeof(event), 0);
+            Event::postAzimuth(context.getEventLoop(), Event::Source::NETHER,
+                               azimuth);
           },
       .arg = nullptr,
       .dispatch_method = ESP_TIMER_TASK,
@@ -191,4 +189,8 @@ void board::init() {
   esp_timer_start_periodic(nether_timer, 50000); // 50ms
 
   context.setState(new CompassState());
+
+  // 启动流程结束, 开始统计稳态下的堆分配
+  alloc_tracker::init();
+  alloc_tracker::arm();
 }
\ No newline at end of file
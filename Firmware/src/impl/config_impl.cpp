@@ -0,0 +1,360 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "config_def.h"
+#include "context.h"
+
+using namespace mcompass;
+
+static const char *TAG = "Config";
+static Context *ctx = nullptr;
+
+/**
+ * @brief 只支持批量配置需要的JSON子集的读取器:
+ * 对象, 字符串, 数字, 布尔和null, 不支持数组
+ */
+struct Reader {
+  const char *p;
+  const char *end;
+  const char *error;
+
+  bool fail(const char *message) {
+    if (!error) {
+      error = message;
+    }
+    return false;
+  }
+
+  void skipSpace() {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+      p++;
+    }
+  }
+
+  bool consume(char c) {
+    skipSpace();
+    if (p < end && *p == c) {
+      p++;
+      return true;
+    }
+    return false;
+  }
+
+  bool expect(char c) { return consume(c) || fail("malformed json"); }
+
+  /**
+   * @brief 读取字符串到 out, 超出容量时失败; \uXXXX 只支持基本平面
+   */
+  bool string(char *out, size_t capacity, const char *tooLong) {
+    if (!consume('"')) {
+      return fail("expected string");
+    }
+    size_t length = 0;
+    while (p < end && *p != '"') {
+      char c = *p++;
+      char utf8[3];
+      size_t count = 1;
+      utf8[0] = c;
+      if ((unsigned char)c < 0x20) {
+        return fail("malformed json");
+      }
+      if (c == '\\') {
+        if (p >= end) {
+          return fail("malformed json");
+        }
+        char escaped = *p++;
+        switch (escaped) {
+        case '"':
+        case '\\':
+        case '/':
+          utf8[0] = escaped;
+          break;
+        case 'b':
+          utf8[0] = '\b';
+          break;
+        case 'f':
+          utf8[0] = '\f';
+          break;
+        case 'n':
+          utf8[0] = '\n';
+          break;
+        case 'r':
+          utf8[0] = '\r';
+          break;
+        case 't':
+          utf8[0] = '\t';
+          break;
+        case 'u': {
+          if (end - p < 4) {
+            return fail("malformed json");
+          }
+          char hex[5] = {p[0], p[1], p[2], p[3], '\0'};
+          char *hexEnd;
+          unsigned long code = strtoul(hex, &hexEnd, 16);
+          if (hexEnd != hex + 4 || code == 0 ||
+              (code >= 0xD800 && code <= 0xDFFF)) {
+            return fail("unsupported escape");
+          }
+          p += 4;
+          if (code < 0x80) {
+            utf8[0] = code;
+          } else if (code < 0x800) {
+            utf8[0] = 0xC0 | (code >> 6);
+            utf8[1] = 0x80 | (code & 0x3F);
+            count = 2;
+          } else {
+            utf8[0] = 0xE0 | (code >> 12);
+            utf8[1] = 0x80 | ((code >> 6) & 0x3F);
+            utf8[2] = 0x80 | (code & 0x3F);
+            count = 3;
+          }
+          break;
+        }
+        default:
+          return fail("malformed json");
+        }
+      }
+      if (length + count >= capacity) {
+        return fail(tooLong);
+      }
+      memcpy(out + length, utf8, count);
+      length += count;
+    }
+    if (p >= end) {
+      return fail("malformed json");
+    }
+    p++;
+    out[length] = '\0';
+    return true;
+  }
+
+  bool number(double &value) {
+    skipSpace();
+    // strtod 需要'\0'结尾, 数字不会超过32字节
+    char buffer[32];
+    size_t length = 0;
+    while (p + length < end && length < sizeof(buffer) - 1 &&
+           strchr("+-0123456789.eE", p[length])) {
+      buffer[length] = p[length];
+      length++;
+    }
+    buffer[length] = '\0';
+    char *numberEnd;
+    value = strtod(buffer, &numberEnd);
+    if (length == 0 || numberEnd != buffer + length || !isfinite(value)) {
+      return fail("expected number");
+    }
+    p += length;
+    return true;
+  }
+
+  bool integer(int &value, int min, int max, const char *outOfRange) {
+    double number;
+    if (!this->number(number)) {
+      return false;
+    }
+    if (number != floor(number) || number < min || number > max) {
+      return fail(outOfRange);
+    }
+    value = (int)number;
+    return true;
+  }
+};
+
+/**
+ * @brief 解析 "#RRGGBB" 格式的颜色
+ */
+static bool parseColor(Reader &reader, int &color) {
+  char text[8];
+  if (!reader.string(text, sizeof(text), "invalid color")) {
+    return false;
+  }
+  if (text[0] != '#' || strlen(text) != 7 ||
+      strspn(text + 1, "0123456789abcdefABCDEF") != 6) {
+    return reader.fail("invalid color");
+  }
+  color = strtol(text + 1, nullptr, 16);
+  return true;
+}
+
+static bool parseSpawn(Reader &reader, Location &location) {
+  if (!reader.expect('{')) {
+    return false;
+  }
+  bool hasLatitude = false, hasLongitude = false;
+  if (!reader.consume('}')) {
+    do {
+      char key[16];
+      double value;
+      if (!reader.string(key, sizeof(key), "unknown key") ||
+          !reader.expect(':') || !reader.number(value)) {
+        return false;
+      }
+      if (strcmp(key, "latitude") == 0) {
+        location.latitude = value;
+        hasLatitude = true;
+      } else if (strcmp(key, "longitude") == 0) {
+        location.longitude = value;
+        hasLongitude = true;
+      } else {
+        return reader.fail("unknown key");
+      }
+    } while (reader.consume(','));
+    if (!reader.expect('}')) {
+      return false;
+    }
+  }
+  if (!hasLatitude || !hasLongitude || !gps::isValidGPSLocation(location)) {
+    return reader.fail("invalid spawn");
+  }
+  return true;
+}
+
+static bool parseField(Reader &reader, const char *key, config::Change &change,
+                       bool &hasSsid, bool &hasPassword) {
+  int value;
+  if (strcmp(key, "brightness") == 0) {
+    if (!reader.integer(value, 0, 255, "invalid brightness")) {
+      return false;
+    }
+    change.brightness = value;
+    change.fields |= config::FIELD_BRIGHTNESS;
+  } else if (strcmp(key, "spawnColor") == 0) {
+    if (!parseColor(reader, change.color.spawnColor)) {
+      return false;
+    }
+    change.fields |= config::FIELD_SPAWN_COLOR;
+  } else if (strcmp(key, "southColor") == 0) {
+    if (!parseColor(reader, change.color.southColor)) {
+      return false;
+    }
+    change.fields |= config::FIELD_SOUTH_COLOR;
+  } else if (strcmp(key, "spawn") == 0) {
+    if (!parseSpawn(reader, change.spawn)) {
+      return false;
+    }
+    change.fields |= config::FIELD_SPAWN;
+  } else if (strcmp(key, "serverMode") == 0) {
+    if (!reader.integer(value, 0, 1, "invalid serverMode")) {
+      return false;
+    }
+    change.serverMode = static_cast<ServerMode>(value);
+    change.fields |= config::FIELD_SERVER_MODE;
+  } else if (strcmp(key, "model") == 0) {
+    if (!reader.integer(value, 0, 1, "invalid model")) {
+      return false;
+    }
+    change.model = static_cast<Model>(value);
+    change.fields |= config::FIELD_MODEL;
+  } else if (strcmp(key, "ssid") == 0) {
+    hasSsid = true;
+    return reader.string(change.ssid, sizeof(change.ssid), "ssid too long");
+  } else if (strcmp(key, "password") == 0) {
+    hasPassword = true;
+    return reader.string(change.password, sizeof(change.password),
+                         "password too long");
+  } else {
+    return reader.fail("unknown key");
+  }
+  return true;
+}
+
+void config::init(Context *context) { ctx = context; }
+
+bool config::parse(const char *json, size_t length, Change &change,
+                   const char *&error) {
+  memset(&change, 0, sizeof(change));
+  Reader reader = {json, json + length, nullptr};
+  bool hasSsid = false, hasPassword = false;
+  if (reader.expect('{') && !reader.consume('}')) {
+    do {
+      char key[16];
+      if (!reader.string(key, sizeof(key), "unknown key") ||
+          !reader.expect(':') ||
+          !parseField(reader, key, change, hasSsid, hasPassword)) {
+        break;
+      }
+    } while (reader.consume(','));
+    if (!reader.error) {
+      reader.expect('}');
+    }
+  }
+  reader.skipSpace();
+  if (!reader.error && reader.p != reader.end) {
+    reader.fail("malformed json");
+  }
+  if (!reader.error && hasSsid != hasPassword) {
+    reader.fail("ssid and password must be set together");
+  }
+  if (!reader.error && hasSsid) {
+    change.fields |= FIELD_WIFI;
+  }
+  if (!reader.error && change.fields == 0) {
+    reader.fail("empty config");
+  }
+  error = reader.error;
+  return error == nullptr;
+}
+
+bool config::apply(const Change &change) {
+  if (!preference::saveConfig(change)) {
+    ESP_LOGE(TAG, "Failed to save config, fields %02X", change.fields);
+    return false;
+  }
+  if (change.fields & (FIELD_SPAWN_COLOR | FIELD_SOUTH_COLOR)) {
+    PointerColor color = ctx->getColor();
+    if (change.fields & FIELD_SPAWN_COLOR) {
+      color.spawnColor = change.color.spawnColor;
+    }
+    if (change.fields & FIELD_SOUTH_COLOR) {
+      color.southColor = change.color.southColor;
+    }
+    ctx->setColor(color);
+  }
+  if (change.fields & FIELD_BRIGHTNESS) {
+    ctx->setBrightness(change.brightness);
+    pixel::setBrightness(change.brightness);
+  }
+  if (change.fields & FIELD_SPAWN) {
+    ctx->setSpawnLocation(change.spawn);
+    // 设置出生点后不再指向航点
+    waypoint::select(waypoint::SELECT_SPAWN);
+  }
+  if (change.fields & FIELD_SERVER_MODE) {
+    ctx->setServerMode(change.serverMode);
+  }
+  if (change.fields & FIELD_MODEL) {
+    ctx->setModel(change.model);
+  }
+  if (change.fields & FIELD_WIFI) {
+    ctx->setSsid(change.ssid);
+    ctx->setPassword(change.password);
+  }
+  ESP_LOGI(TAG, "Applied config, fields %02X", change.fields);
+  return true;
+}
+
+void config::toJson(utils::FixedString<CONFIG_JSON_CAPACITY> &buffer,
+                    bool restart) {
+  PointerColor color = ctx->getColor();
+  Location spawn = ctx->getSpawnLocation();
+  buffer.clear();
+  utils::JsonWriter<utils::FixedString<CONFIG_JSON_CAPACITY>> json(buffer);
+  json.beginObject()
+      .field("brightness", ctx->getBrightness())
+      .fieldf("spawnColor", "\"#%06X\"", color.spawnColor & 0xFFFFFF)
+      .fieldf("southColor", "\"#%06X\"", color.southColor & 0xFFFFFF)
+      .beginObject("spawn")
+      .field("latitude", spawn.latitude, 6)
+      .field("longitude", spawn.longitude, 6)
+      .endObject()
+      .field("serverMode", ctx->getServerMode() == ServerMode::BLE ? 1 : 0)
+      .field("model", ctx->isGPSModel() ? 1 : 0)
+      .field("ssid", ctx->getSsid().c_str());
+  if (restart) {
+    json.field("restart", true);
+  }
+  json.endObject();
+}
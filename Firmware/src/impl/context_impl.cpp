@@ -51,10 +51,10 @@ void Context::setServerMode(ServerMode mode) { serverMode = mode; }
 uint8_t Context::getBrightness() const { return brightness; }
 void Context::setBrightness(uint8_t bright) { brightness = bright; }
 
-String Context::getSsid() const { return ssid; }
+const String &Context::getSsid() const { return ssid; }
 void Context::setSsid(const String &id) { ssid = id; }
 
-String Context::getPassword() const { return password; }
+const String &Context::getPassword() const { return password; }
 void Context::setPassword(const String &pass) { password = pass; }
 
 Event::Source Context::getSubscribeSource() const { return subscribeSource; }
@@ -85,12 +85,22 @@ void Context::logSelf(char *buffer) {
           this->getServerMode(), this->getColor().spawnColor,
           this->getColor().southColor, this->getBrightness(),
           this->getSpawnLocation().latitude, this->getSpawnLocation().longitude,
-          this->getSsid(), this->getModel() == Model::GPS ? "GPS" : "LITE",
+          this->getSsid().c_str(), this->getModel() == Model::GPS ? "GPS" : "LITE",
           this->getHasSensor(),
-          utils::sensorModel2Str(this->getSensorModel()).c_str(),
+          utils::sensorModel2Str(this->getSensorModel()),
           this->getDetectGPS());
 }
 
+void Context::infoJson(utils::FixedString<INFO_JSON_CAPACITY> &json) {
+  json.clear();
+  json.appendf("{\"buildDate\":\"" __DATE__ "\",\"buildTime\":\"" __TIME__
+               "\",\"buildVersion\":\"" BUILD_VERSION "\",\"gitBranch\":\"" GIT_BRANCH
+               "\",\"gpsStatus\":\"%d\",\"model\":\"%d\",\"sensorStatus\":\"%d\","
+               "\"gitCommit\":\"" GIT_COMMIT "\"}",
+               this->getDetectGPS() ? 1 : 0, this->isGPSModel() ? 1 : 0,
+               this->getHasSensor() ? 1 : 0);
+}
+
 void Context::setIsGPSFixed(bool isFixed) { isGPSFixed = isFixed; }
 bool Context::getIsGPSFixed() const { return isGPSFixed; }
 
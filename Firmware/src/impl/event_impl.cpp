@@ -1,6 +1,19 @@
 #include "event.h"
+
+#include <atomic>
 using namespace Event;
 
+ESP_EVENT_DEFINE_BASE(MCOMPASS_AZIMUTH_EVENT);
+ESP_EVENT_DEFINE_BASE(MCOMPASS_GPS_EVENT);
+
+// 方位角邮箱, 每个消息源只保留最新值
+struct AzimuthSlot {
+  std::atomic<int> angle{0};
+  std::atomic<bool> pending{false};
+};
+
+static AzimuthSlot azimuthSlots[Source::SOURCE_MAX];
+
 const char* Event::SourceToString(Source source) {
   switch (source) {
     case Source::BUTTON:
@@ -15,6 +28,8 @@ const char* Event::SourceToString(Source source) {
       return "BLE";
     case Source::OTHER:
       return "Other";
+    case Source::NETHER:
+      return "Nether";
     default:
       return "Unknown Source";
   }
@@ -29,4 +44,35 @@ const char* Event::TypeToString(Type type) {
     default:
       return "Unknown EventType";
   }
-}
\ No newline at end of file
+}
+
+bool Event::postAzimuth(esp_event_loop_handle_t loop, Source source,
+                        int angle) {
+  if (source < 0 || source >= Source::SOURCE_MAX) {
+    return false;
+  }
+  AzimuthSlot &slot = azimuthSlots[source];
+  slot.angle.store(angle, std::memory_order_relaxed);
+  // 上一个值还没有被取走, 直接覆盖即可
+  if (slot.pending.exchange(true, std::memory_order_acq_rel)) {
+    return false;
+  }
+  if (esp_event_post_to(loop, MCOMPASS_AZIMUTH_EVENT, source, NULL, 0, 0) !=
+      ESP_OK) {
+    slot.pending.store(false, std::memory_order_release);
+    return false;
+  }
+  return true;
+}
+
+void Event::takeAzimuth(Source source, Body* evt) {
+  AzimuthSlot &slot = azimuthSlots[source];
+  slot.pending.store(false, std::memory_order_release);
+  evt->type = Type::AZIMUTH;
+  evt->source = source;
+  evt->azimuth.angle = slot.angle.load(std::memory_order_relaxed);
+}
+
+int Event::peekAzimuth(Source source) {
+  return azimuthSlots[source].angle.load(std::memory_order_relaxed);
+}
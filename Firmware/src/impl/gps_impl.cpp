@@ -1,162 +1,125 @@
-#include "board.h"
 #include "context.h"
+#include "event.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "gps_def.h"
+#include "gps_power_def.h"
+#include "gps_replay.h"
 #include "nmea_parser.h"
+#include "position_filter_def.h"
 #include "utils.h"
+#include "waypoint_def.h"
 
 using namespace mcompass;
 
 static const char *TAG = "GPS";
-// GPS休眠配置表
-static const SleepConfig sleepConfigs[] = {
-    {10.0f, 0, true},         // 在10KM距离内，不休眠
-    {50.0f, 5 * 60, false},   // 超过50KM，休眠5分钟
-    {100.0f, 10 * 60, false}, // 超过100KM，休眠10分钟
-    {200.0f, 15 * 60, false}, // 超过200KM，休眠15分钟
-};
-
-// GPS休眠时间
-static uint32_t gpsSleepInterval = 60 * 60; // 单位:秒
 static uint8_t logCounter = 0;
 static nmea_parser_handle_t nmea_hdl = NULL;
+// 保护 nmea_hdl 的创建和释放, /gpsStats 在 async_tcp 任务中读取统计,
+// gps::disable 在定时器任务中释放解析器
+static SemaphoreHandle_t parserLock = NULL;
+
+// 定位邮箱, 只保留最新的定位记录, 由NMEA解析任务写入
+static gps_fix_record_t latestFix;
+static bool hasFix = false;
+static bool fixPending = false;
+static portMUX_TYPE fixMux = portMUX_INITIALIZER_UNLOCKED;
 
 /**
- * @brief GPS Event Handler
+ * @brief 定位记录回调, 运行在NMEA解析任务中
+ *
+ * 记录写入邮箱, 只有旧记录已被取走时才向事件循环投递唤醒事件
  *
- * @param event_handler_arg handler specific arguments
- * @param event_base event base, here is fixed to ESP_NMEA_EVENT
- * @param event_id event id
- * @param event_data event specific arguments
+ * @param fix 定位记录
+ * @param arg Context
  */
-static void gps_event_handler(void *event_handler_arg,
-                              esp_event_base_t event_base, int32_t event_id,
-                              void *event_data) {
-  Context &context = Context::getInstance();
-  gps_t *gpsParser = NULL;
-  switch (event_id) {
-  case GPS_UPDATE: {
-    logCounter++;
-    // 检测到任何串口数据,则说明GPS已经接入;
-    context.setDetectGPS(true);
-    gpsParser = (gps_t *)event_data;
-    /* print information parsed from GPS statements */
-    if (logCounter % 10 == 0) // 每10次打印一次日志
-    {
-      ESP_LOGI(
-          TAG,
-          "GPS Data Valid: %s, Date: %04d-%02d-%02d, Time: %02d:%02d:%02d "
-          "(UTC+%d)\r\n"
-          "--------------------------------------------------------------------"
-          "--\r\n"
-          "\tLocation:  (%.06f, %.06f)\r\n" // 纬度, 经度 (通常用6位小数更准)
-          "\tAltitude:  %.02f m\r\n"
-          "\tSpeed:     %.02f m/s\r\n"
-          "\tCourse:    %.02f° (Course Over Ground)\r\n"
-          "\r\n"
-          "\tFix Info:  Fix: %d, Fix Mode: %d\r\n"
-          "\tSatellites: %d in use / %d in view\r\n"
-          "\tPrecision: HDOP=%.01f, PDOP=%.01f, VDOP=%.01f\r\n"
-          "--------------------------------------------------------------------"
-          "--",
-
-          // 对应上面的格式字符串:
-          gpsParser->valid ? "true" : "false", // %s (GPS Data Valid)
-          gpsParser->date.year + YEAR_BASE,    // %04d (Date Year)
-          gpsParser->date.month,               // %02d (Date Month)
-          gpsParser->date.day,                 // %02d (Date Day)
-          gpsParser->tim.hour + TIME_ZONE,     // %02d (Time Hour)
-          gpsParser->tim.minute,               // %02d (Time Minute)
-          gpsParser->tim.second,               // %02d (Time Second)
-          TIME_ZONE,                           // %d (Time Zone)
-
-          gpsParser->latitude,  // %.06f (Location Lat)
-          gpsParser->longitude, // %.06f (Location Lon)
-
-          gpsParser->altitude, // %.02f (Altitude)
-
-          gpsParser->speed, // %.02f (Speed)
-
-          gpsParser->cog, // %.02f (Course)
-
-          (int)gpsParser->fix,      // %d (Fix Info: Fix)
-          (int)gpsParser->fix_mode, // %d (Fix Info: Fix Mode)
-
-          gpsParser->sats_in_use,  // %d (Satellites: in use)
-          gpsParser->sats_in_view, // %d (Satellites: in view)
-
-          gpsParser->dop_h, // %.01f (Precision: HDOP)
-          gpsParser->dop_p, // %.01f (Precision: PDOP)
-          gpsParser->dop_v  // %.01f (Precision: VDOP)
-      );
-    }
+static void gps_fix_callback(const gps_fix_record_t *fix, void *arg) {
+  auto context = static_cast<Context *>(arg);
+  portENTER_CRITICAL(&fixMux);
+  latestFix = *fix;
+  latestFix.timestamp_us = gps_replay::toVirtual(fix->timestamp_us);
+  hasFix = true;
+  bool wakeUp = !fixPending;
+  fixPending = true;
+  portEXIT_CRITICAL(&fixMux);
+  if (wakeUp && esp_event_post_to(context->getEventLoop(), MCOMPASS_GPS_EVENT,
+                                  0, NULL, 0, 0) != ESP_OK) {
+    portENTER_CRITICAL(&fixMux);
+    fixPending = false;
+    portEXIT_CRITICAL(&fixMux);
+  }
+}
 
-    if (gpsParser->fix == 0) {
-      if (logCounter % 10 == 0) // 每10次打印一次日志
-      {
-        ESP_LOGD(TAG, "INVALID GPS DATA");
-      }
-      return;
+/**
+ * @brief GPS定位事件处理, 运行在主事件循环中
+ *
+ * @param event_handler_arg Context
+ * @param event_base MCOMPASS_GPS_EVENT
+ * @param event_id 未使用
+ * @param event_data 未使用
+ */
+static void gps_fix_handler(void *event_handler_arg,
+                            esp_event_base_t event_base, int32_t event_id,
+                            void *event_data) {
+  Context &context = Context::getInstance();
+  gps_fix_record_t fix;
+  portENTER_CRITICAL(&fixMux);
+  fix = latestFix;
+  fixPending = false;
+  portEXIT_CRITICAL(&fixMux);
+
+  logCounter++;
+  // 检测到任何串口数据,则说明GPS已经接入;
+  context.setDetectGPS(true);
+  if (logCounter % 10 == 0) // 每10次打印一次日志
+  {
+    uint32_t seconds = fix.utc_ms / 1000;
+    ESP_LOGI(TAG,
+             "Fix: %d, Satellites: %d, Time: %02d:%02d:%02d (UTC+%d), "
+             "Location: (%.06f, %.06f), Speed: %.02f m/s, Course: %.02f, "
+             "HDOP: %.02f",
+             fix.fix, fix.sats_in_use,
+             (int)((seconds / 3600 + 24 + TIME_ZONE) % 24),
+             (int)(seconds / 60 % 60), (int)(seconds % 60), TIME_ZONE,
+             fix.latitude_e7 / 1e7, fix.longitude_e7 / 1e7,
+             fix.speed_mmps / 1000.0, fix.course_x100 / 100.0,
+             fix.hdop_x100 / 100.0);
+    nmea_parser_stats_t stats;
+    if (gps::getParserStats(&stats)) {
+      ESP_LOGD(TAG,
+               "NMEA: %u bytes, %u lines, crc %u, format %u, overflow %u, "
+               "resync %u",
+               stats.bytes, stats.lines, stats.crc_errors, stats.format_errors,
+               stats.overflows, stats.resyncs);
     }
-    // GPS坐标有效
-    context.setIsGPSFixed(true);
-    Location lastestLocation;
-    lastestLocation.latitude = gpsParser->latitude;
-    lastestLocation.longitude = gpsParser->longitude;
+  }
 
-    ESP_LOGD(TAG, "Location:  %f, %f", lastestLocation.latitude,
-             lastestLocation.longitude);
-    // 坐标有效情况下更新本地坐标
-    context.setCurrentLocation(lastestLocation);
-    // 设置订阅源
-    context.setSubscribeSource(Event::Source::SENSOR);
-    // 计算两地距离
-    auto currentLoc = context.getCurrentLocation();
-    auto targetLoc = context.getSpawnLocation();
-    double distance =
-        utils::complexDistance(currentLoc.latitude, currentLoc.longitude,
-                               targetLoc.latitude, targetLoc.longitude);
-    ESP_LOGI(TAG, "%f km to target.\n", distance);
-    // 获取最接近的临界值
-    float threshholdDistance = 0;
-    size_t sleepConfigSize = sizeof(sleepConfigs) / sizeof(SleepConfig);
-    for (int i = sleepConfigSize - 1; i >= 0; i--) {
-      if (distance >= sleepConfigs[i].distanceThreshold) {
-        threshholdDistance = sleepConfigs[i].distanceThreshold;
-        ESP_LOGI(TAG, "use threshold %f km", threshholdDistance);
-        break;
-      }
-    }
-    float modDistance = fmod(distance, threshholdDistance);
-    // 根据距离调整GPS休眠时间,
-    for (int i = 0; i < sleepConfigSize; i++) {
-      if (modDistance <= sleepConfigs[i].distanceThreshold) {
-        gpsSleepInterval = sleepConfigs[i].sleepInterval;
-        if (sleepConfigs[i].gpsPowerEn) {
-          digitalWrite(GPS_EN_PIN, LOW);
-        } else {
-          digitalWrite(GPS_EN_PIN, HIGH);
-          // 设置一个休眠定时器
-          esp_timer_handle_t gpsSleepTimer;
-          esp_timer_create_args_t gpsSleepTimerArgs = {
-              .callback = [](void *arg) { digitalWrite(GPS_EN_PIN, LOW); },
-              .arg = NULL,
-          };
-          ESP_ERROR_CHECK(esp_timer_create(&gpsSleepTimerArgs, &gpsSleepTimer));
-          esp_timer_start_once(gpsSleepTimer, gpsSleepInterval * 1000000);
-          ESP_LOGI(TAG, "GPS Sleep %d seconds\n", gpsSleepInterval);
-        }
-        break;
-      }
+  if (fix.fix == GPS_FIX_INVALID) {
+    if (logCounter % 10 == 0) // 每10次打印一次日志
+    {
+      ESP_LOGD(TAG, "INVALID GPS DATA");
     }
-  } break;
-  case GPS_UNKNOWN:
-    /* print unknown statements */
-    // ESP_LOGW(TAG, "Unknown statement:%s", (char *)event_data);
-    break;
-  default:
-    break;
+    return;
   }
+  // GPS坐标有效
+  context.setIsGPSFixed(true);
+  // 滤波后的坐标作为当前位置, 减小近距离时GPS噪声对方位的影响
+  auto estimate = position_filter::update(fix);
+  Location lastestLocation = estimate.location;
+
+  ESP_LOGD(TAG, "Location:  %f, %f (sigma %.1f m)", lastestLocation.latitude,
+           lastestLocation.longitude, estimate.sigma);
+  // 坐标有效情况下更新本地坐标
+  context.setCurrentLocation(lastestLocation);
+  gps_replay::onFix(fix, estimate);
+  // 选中最近航点时切换目标
+  waypoint::update(lastestLocation);
+  position_filter::updateArrival(context.getSpawnLocation());
+  // 设置订阅源
+  context.setSubscribeSource(Event::Source::SENSOR);
+  // 根据到目标的距离和速度决定是否休眠
+  gps_power::onFix(fix, context.getSpawnLocation());
 }
 
 void gps::init(Context *context) {
@@ -164,15 +127,25 @@ void gps::init(Context *context) {
   // GPSSerial.begin(9600, SERIAL_8N1, RX, TX);
   // 设置串口缓冲区大小
   // GPSSerial.setRxBufferSize(1024);
-  // 启动GPS,用于GPS存在性检测
-  digitalWrite(GPS_EN_PIN, LOW);
-
   /* NMEA parser configuration */
   nmea_parser_config_t config = NMEA_PARSER_CONFIG_DEFAULT();
+  // 回放模式下轨迹通过串口回环送入解析器
+  gps_replay::init(config);
+  // 启动GPS,用于GPS存在性检测
+  gps_power::init();
+
   /* init NMEA parser library */
+  parserLock = xSemaphoreCreateMutex();
+  xSemaphoreTake(parserLock, portMAX_DELAY);
   nmea_hdl = nmea_parser_init(&config);
-  /* register event handler for NMEA parser library */
-  nmea_parser_add_handler(nmea_hdl, gps_event_handler, context);
+  xSemaphoreGive(parserLock);
+  gps_replay::start(config.uart.uart_port);
+  /* GPS定位事件在主事件循环中处理 */
+  ESP_ERROR_CHECK(esp_event_handler_register_with(
+      context->getEventLoop(), MCOMPASS_GPS_EVENT, ESP_EVENT_ANY_ID,
+      gps_fix_handler, context));
+  /* 定位记录直接写入定位邮箱 */
+  nmea_parser_set_fix_callback(nmea_hdl, gps_fix_callback, context);
   // 检测不到GPS, 关闭GPS的Timer
   esp_timer_handle_t gpsDisableTimer;
   esp_timer_create_args_t gpsDisableTimerArgs = {
@@ -192,8 +165,8 @@ void gps::init(Context *context) {
       .skip_unhandled_events = true};
   ESP_ERROR_CHECK(esp_timer_create(&gpsDisableTimerArgs, &gpsDisableTimer));
   esp_timer_start_once(gpsDisableTimer,
-                       DEFAULT_GPS_DETECT_TIMEOUT *
-                           1000000); // 检测不到GPS, 关闭GPS的Timer
+                       gps_replay::scale(DEFAULT_GPS_DETECT_TIMEOUT *
+                                         1000000)); // 检测不到GPS, 关闭GPS的Timer
 }
 
 /**
@@ -201,13 +174,43 @@ void gps::init(Context *context) {
  */
 void gps::disable() {
   /* unregister event handler */
-  nmea_parser_remove_handler(nmea_hdl, gps_event_handler);
+  nmea_parser_set_fix_callback(nmea_hdl, NULL, NULL);
+  gps_replay::stop();
+  esp_event_handler_unregister_with(
+      Context::getInstance().getEventLoop(), MCOMPASS_GPS_EVENT,
+      ESP_EVENT_ANY_ID, gps_fix_handler);
   /* deinit NMEA parser library */
+  xSemaphoreTake(parserLock, portMAX_DELAY);
   nmea_parser_deinit(nmea_hdl);
-  digitalWrite(GPS_EN_PIN, HIGH);
+  nmea_hdl = NULL;
+  xSemaphoreGive(parserLock);
+  gps_power::shutdown();
+}
+
+bool gps::getLatestFix(gps_fix_record_t *fix) {
+  portENTER_CRITICAL(&fixMux);
+  *fix = latestFix;
+  bool valid = hasFix;
+  portEXIT_CRITICAL(&fixMux);
+  return valid;
+}
+
+bool gps::getParserStats(nmea_parser_stats_t *stats) {
+  if (parserLock == NULL) {
+    return false;
+  }
+  xSemaphoreTake(parserLock, portMAX_DELAY);
+  bool running =
+      nmea_hdl && nmea_parser_get_stats(nmea_hdl, stats) == ESP_OK;
+  xSemaphoreGive(parserLock);
+  return running;
 }
 
 bool gps::isValidGPSLocation(Location location) {
+  // (0,0) 是未定位/未设置时的默认值, 不作为有效坐标
+  if (location.latitude == 0 && location.longitude == 0) {
+    return false;
+  }
   if (location.latitude >= -90 && location.latitude <= 90 &&
       location.longitude >= -180 && location.longitude <= 180) {
     return true;
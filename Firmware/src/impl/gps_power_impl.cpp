@@ -0,0 +1,256 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <math.h>
+
+#include "gps_power_def.h"
+#include "gps_replay.h"
+#include "macro_def.h"
+#include "utils.h"
+
+using namespace mcompass;
+
+static const char *TAG = "GPSPower";
+
+// 距离区间表, 按区间下界升序排列, sleepInterval 为该区间内的最长休眠时间
+static const SleepConfig sleepConfigs[] = {
+    {0.0f, 0, true},           // 10KM以内，不休眠
+    {10.0f, 5 * 60, false},    // 10~50KM，最多休眠5分钟
+    {50.0f, 10 * 60, false},   // 50~100KM，最多休眠10分钟
+    {100.0f, 15 * 60, false},  // 超过100KM，最多休眠15分钟
+};
+
+using PowerState = gps_power::State;
+
+static PowerState state = PowerState::OFF;
+static esp_timer_handle_t wakeTimer = nullptr;
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t startUs = 0;     // 统计开始时间
+static int64_t powerOnUs = 0;   // 最近一次上电时间
+static int64_t powerOffUs = 0;  // 最近一次断电时间, 0表示从未休眠
+static uint64_t onTimeUs = 0;   // 累计上电时间(不含本次)
+static uint32_t wakeCount = 0;
+static uint32_t fixesSinceWake = 0;
+static uint32_t lastTtffMs = 0;
+static uint32_t hotTtffMs = GPS_DEFAULT_HOT_TTFF_MS;
+static uint32_t warmTtffMs = GPS_DEFAULT_WARM_TTFF_MS;
+static uint32_t lastSleepSec = 0;
+static bool lastWakeHot = false;
+
+/**
+ * @brief 上电, 由 init 和唤醒定时器调用
+ */
+static void powerOn() {
+  int64_t now = gps_replay::now();
+  portENTER_CRITICAL(&mux);
+  if (state == PowerState::ACQUIRING || state == PowerState::TRACKING) {
+    portEXIT_CRITICAL(&mux);
+    return;
+  }
+  // 断电时间在星历有效期内视为热启动
+  lastWakeHot = powerOffUs != 0 &&
+                now - powerOffUs < (int64_t)GPS_HOT_START_WINDOW * 1000000;
+  state = PowerState::ACQUIRING;
+  powerOnUs = now;
+  fixesSinceWake = 0;
+  wakeCount++;
+  portEXIT_CRITICAL(&mux);
+  digitalWrite(GPS_EN_PIN, LOW);
+  gps_replay::onPower(true);
+}
+
+/**
+ * @brief 断电
+ *
+ * @param next 断电后的状态
+ */
+static void powerOff(PowerState next) {
+  int64_t now = gps_replay::now();
+  portENTER_CRITICAL(&mux);
+  if (state == PowerState::ACQUIRING || state == PowerState::TRACKING) {
+    onTimeUs += now - powerOnUs;
+  }
+  state = next;
+  powerOffUs = now;
+  portEXIT_CRITICAL(&mux);
+  digitalWrite(GPS_EN_PIN, HIGH);
+  gps_replay::onPower(false);
+}
+
+/**
+ * @brief 更新定位时间估计(指数滑动平均)
+ */
+static void updateTtff(uint32_t &estimate, uint32_t sample) {
+  estimate = (estimate * 3 + sample) / 4;
+}
+
+/**
+ * @brief 计算休眠时长
+ *
+ * @return 休眠秒数, 0表示不休眠
+ */
+static uint32_t planSleep(const gps_fix_record_t &fix, const Location &target) {
+  float latitude = fix.latitude_e7 / 1e7f;
+  float longitude = fix.longitude_e7 / 1e7f;
+  float distance = utils::complexDistance(latitude, longitude, target.latitude,
+                                          target.longitude);
+  // 找到当前所在的距离区间
+  const SleepConfig *band = &sleepConfigs[0];
+  for (const auto &config : sleepConfigs) {
+    if (distance >= config.distanceThreshold) {
+      band = &config;
+    }
+  }
+  if (band->gpsPowerEn) {
+    return 0;
+  }
+  // 到更近区间边界的距离(米)
+  float margin = (distance - band->distanceThreshold) * 1000.0f;
+  // 假设用户随时可能以当前地速转向目标, 正在接近目标时再留出加速余量
+  float speed = fix.has_velocity ? fix.speed_mmps / 1000.0f : 0.0f;
+  if (fix.has_velocity) {
+    float bearing = utils::calculateBearingF(latitude, longitude,
+                                             target.latitude, target.longitude);
+    float delta = fabsf(fix.course_x100 / 100.0f - bearing);
+    if (delta > 180.0f) {
+      delta = 360.0f - delta;
+    }
+    if (delta < 90.0f) {
+      speed *= GPS_APPROACH_SPEED_FACTOR;
+    }
+  }
+  if (speed < GPS_MIN_ASSUMED_SPEED) {
+    speed = GPS_MIN_ASSUMED_SPEED;
+  }
+  float crossing = margin / speed;
+  portENTER_CRITICAL(&mux);
+  float hotTtff = hotTtffMs / 1000.0f;
+  float warmTtff = warmTtffMs / 1000.0f;
+  portEXIT_CRITICAL(&mux);
+  // 扣除下次唤醒后的定位时间, 休眠超过星历有效期时按温启动估计
+  float sleep = crossing - hotTtff;
+  if (sleep > GPS_HOT_START_WINDOW) {
+    sleep = crossing - warmTtff;
+  }
+  if (sleep > band->sleepInterval) {
+    sleep = band->sleepInterval;
+  }
+  ESP_LOGI(TAG,
+           "%.2f km to target, %.0f m to next band, %.1f m/s, crossing in "
+           "%.0f s",
+           distance, margin, speed, crossing);
+  if (sleep < GPS_MIN_SLEEP_INTERVAL) {
+    return 0;
+  }
+  return (uint32_t)sleep;
+}
+
+void gps_power::init() {
+  if (!wakeTimer) {
+    esp_timer_create_args_t wakeTimerArgs = {
+        .callback =
+            [](void *arg) {
+              ESP_LOGI(TAG, "Wake up GPS");
+              powerOn();
+            },
+        .arg = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "gpsWakeTimer",
+        .skip_unhandled_events = true};
+    ESP_ERROR_CHECK(esp_timer_create(&wakeTimerArgs, &wakeTimer));
+  }
+  startUs = gps_replay::now();
+  powerOn();
+}
+
+void gps_power::onFix(const gps_fix_record_t &fix, const Location &target) {
+  int64_t now = gps_replay::now();
+  portENTER_CRITICAL(&mux);
+  PowerState current = state;
+  if (current == PowerState::ACQUIRING) {
+    // 首次定位, 记录定位时间
+    lastTtffMs = (now - powerOnUs) / 1000;
+    if (powerOffUs != 0) {
+      updateTtff(lastWakeHot ? hotTtffMs : warmTtffMs, lastTtffMs);
+    }
+    state = PowerState::TRACKING;
+  }
+  fixesSinceWake++;
+  uint32_t fixes = fixesSinceWake;
+  uint32_t ttffMs = lastTtffMs;
+  bool cold = powerOffUs == 0;
+  bool hot = lastWakeHot;
+  portEXIT_CRITICAL(&mux);
+
+  if (current == PowerState::ACQUIRING) {
+    ESP_LOGI(TAG, "Fixed %u ms after power on (%s start)", ttffMs,
+             cold ? "cold" : (hot ? "hot" : "warm"));
+  }
+  if (current == PowerState::OFF || current == PowerState::SLEEPING) {
+    return;
+  }
+  // 等待RMC/VTG给出地速, 若模块不输出则按最低速度估计.
+  // ATGM336H 出厂配置就输出 RMC 和 VTG, 板上只接了模块的TX(见
+  // NMEA_PARSER_CONFIG_DEFAULT 的 rx_pin), 无法也不需要发送 $PCAS03 配置语句
+  if (!fix.has_velocity && fixes < GPS_MIN_TRACK_FIXES) {
+    return;
+  }
+  uint32_t sleepSec = planSleep(fix, target);
+  if (sleepSec == 0) {
+    return;
+  }
+  powerOff(PowerState::SLEEPING);
+  portENTER_CRITICAL(&mux);
+  lastSleepSec = sleepSec;
+  portEXIT_CRITICAL(&mux);
+  esp_timer_stop(wakeTimer);
+  ESP_ERROR_CHECK(esp_timer_start_once(
+      wakeTimer, gps_replay::scale((uint64_t)sleepSec * 1000000)));
+  gps_replay::onSleep(sleepSec);
+  Stats stats = getStats();
+  ESP_LOGI(TAG, "GPS Sleep %u seconds, on time %llu/%llu s, %u wakes",
+           sleepSec, stats.onTimeMs / 1000, stats.uptimeMs / 1000,
+           stats.wakeCount);
+}
+
+void gps_power::shutdown() {
+  if (wakeTimer) {
+    esp_timer_stop(wakeTimer);
+  }
+  powerOff(PowerState::OFF);
+}
+
+gps_power::Stats gps_power::getStats() {
+  int64_t now = gps_replay::now();
+  Stats stats;
+  portENTER_CRITICAL(&mux);
+  stats.state = state;
+  stats.wakeCount = wakeCount;
+  uint64_t onTime = onTimeUs;
+  if (state == PowerState::ACQUIRING || state == PowerState::TRACKING) {
+    onTime += now - powerOnUs;
+  }
+  stats.onTimeMs = onTime / 1000;
+  stats.uptimeMs = (now - startUs) / 1000;
+  stats.lastTtffMs = lastTtffMs;
+  stats.hotTtffMs = hotTtffMs;
+  stats.warmTtffMs = warmTtffMs;
+  stats.lastSleepSec = lastSleepSec;
+  portEXIT_CRITICAL(&mux);
+  return stats;
+}
+
+const char *gps_power::stateToString(State state) {
+  switch (state) {
+  case State::OFF:
+    return "Off";
+  case State::ACQUIRING:
+    return "Acquiring";
+  case State::TRACKING:
+    return "Tracking";
+  case State::SLEEPING:
+    return "Sleeping";
+  default:
+    return "Unknown";
+  }
+}
@@ -0,0 +1,165 @@
+#include "gps_replay.h"
+
+#if defined(MCOMPASS_GPS_REPLAY)
+#include <LittleFS.h>
+#include <esp_log.h>
+
+#include "board.h"
+
+using namespace mcompass;
+
+static const char *TAG = "replay";
+
+static File track;
+static uart_port_t uartPort;
+static int64_t startUs = 0;
+static volatile bool powered = false;
+static volatile bool stopped = false;
+// 串口写入和删除串口驱动互斥
+static SemaphoreHandle_t writeLock = nullptr;
+
+static uint32_t linesSent = 0;
+static uint32_t linesDropped = 0;
+static uint32_t fixes = 0;
+static uint32_t powerToggles = 0;
+
+/**
+ * @brief 读取GGA/RMC语句中的UTC时间
+ *
+ * @return 当天的毫秒数, 其他语句返回-1
+ */
+static int32_t sentenceTime(const char *line, size_t len) {
+  if (len < 14 || line[0] != '$' ||
+      (memcmp(line + 3, "GGA,", 4) != 0 && memcmp(line + 3, "RMC,", 4) != 0)) {
+    return -1;
+  }
+  const char *p = line + 7;
+  for (int i = 0; i < 6; i++) {
+    if (p[i] < '0' || p[i] > '9') {
+      return -1;
+    }
+  }
+  int32_t ms = ((p[0] - '0') * 10 + (p[1] - '0')) * 3600000 +
+               ((p[2] - '0') * 10 + (p[3] - '0')) * 60000 +
+               ((p[4] - '0') * 10 + (p[5] - '0')) * 1000;
+  if (p[6] == '.') {
+    int32_t scale = 100;
+    for (const char *q = p + 7; *q >= '0' && *q <= '9' && scale > 0; q++) {
+      ms += (*q - '0') * scale;
+      scale /= 10;
+    }
+  }
+  return ms;
+}
+
+static void replayTask(void *arg) {
+  static char line[128];
+  int32_t lastMs = -1;
+  while (!stopped && track.available()) {
+    size_t len = track.readBytesUntil('\n', line, sizeof(line) - 2);
+    line[len++] = '\n';
+    // 按轨迹中的UTC时间推进, 同一历元内的语句连续发送
+    int32_t ms = sentenceTime(line, len);
+    if (ms >= 0) {
+      if (lastMs >= 0) {
+        int32_t delta = ms - lastMs;
+        if (delta < 0) {
+          delta += 24 * 3600 * 1000;
+        }
+        vTaskDelay(pdMS_TO_TICKS(delta / GPS_REPLAY_SPEED));
+      }
+      lastMs = ms;
+    }
+    if (!powered) {
+      linesDropped++;
+      continue;
+    }
+    xSemaphoreTake(writeLock, portMAX_DELAY);
+    if (!stopped) {
+      uart_write_bytes(uartPort, line, len);
+      linesSent++;
+    }
+    xSemaphoreGive(writeLock);
+  }
+  track.close();
+  auto stats = gps_power::getStats();
+  ESP_LOGI(TAG,
+           "done,%lld,lines=%u,dropped=%u,fixes=%u,toggles=%u,wakes=%u,"
+           "on=%llu,uptime=%llu,hot_ttff=%u,warm_ttff=%u",
+           now(), linesSent, linesDropped, fixes, powerToggles,
+           stats.wakeCount, stats.onTimeMs, stats.uptimeMs, stats.hotTtffMs,
+           stats.warmTtffMs);
+  vTaskDelete(NULL);
+}
+
+bool gps_replay::init(nmea_parser_config_t &config) {
+  if (!LittleFS.begin(false, "/littlefs", 32)) {
+    ESP_LOGE(TAG, "Failed to mount LittleFS");
+    return false;
+  }
+  track = LittleFS.open(GPS_REPLAY_FILE, "r");
+  if (!track) {
+    ESP_LOGE(TAG, "%s not found", GPS_REPLAY_FILE);
+    return false;
+  }
+  config.uart.baud_rate = GPS_REPLAY_BAUD_RATE;
+  startUs = esp_timer_get_time();
+  ESP_LOGI(TAG, "start,%s,%u bytes,x%d", GPS_REPLAY_FILE, track.size(),
+           GPS_REPLAY_SPEED);
+  return true;
+}
+
+void gps_replay::start(uart_port_t port) {
+  if (!track) {
+    return;
+  }
+  uartPort = port;
+  writeLock = xSemaphoreCreateMutex();
+  ESP_ERROR_CHECK(uart_set_loop_back(port, true));
+  xTaskCreate(replayTask, "gps_replay", 4096, nullptr, 1, nullptr);
+}
+
+void gps_replay::stop() {
+  if (!writeLock) {
+    return;
+  }
+  xSemaphoreTake(writeLock, portMAX_DELAY);
+  stopped = true;
+  xSemaphoreGive(writeLock);
+  ESP_LOGI(TAG, "stop,%lld", now());
+}
+
+int64_t gps_replay::toVirtual(int64_t us) {
+  if (startUs == 0) {
+    return us;
+  }
+  return startUs + (us - startUs) * GPS_REPLAY_SPEED;
+}
+
+int64_t gps_replay::now() { return toVirtual(esp_timer_get_time()); }
+
+uint64_t gps_replay::scale(uint64_t us) {
+  return startUs == 0 ? us : us / GPS_REPLAY_SPEED;
+}
+
+void gps_replay::onPower(bool on) {
+  if (powered != on) {
+    powerToggles++;
+  }
+  powered = on;
+  ESP_LOGI(TAG, "power,%lld,%s", now(), on ? "on" : "off");
+}
+
+void gps_replay::onSleep(uint32_t seconds) {
+  ESP_LOGI(TAG, "sleep,%lld,%u", now(), seconds);
+}
+
+void gps_replay::onFix(const gps_fix_record_t &fix,
+                       const position_filter::Estimate &estimate) {
+  fixes++;
+  ESP_LOGI(TAG, "fix,%lld,%u,%.7f,%.7f,%.7f,%.7f,%.1f,%.2f", fix.timestamp_us,
+           fix.fix, fix.latitude_e7 / 1e7, fix.longitude_e7 / 1e7,
+           estimate.location.latitude, estimate.location.longitude,
+           estimate.sigma, estimate.speed);
+}
+#endif
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include "board.h"
+#include "context.h"
+#include "ingest_def.h"
+
+using namespace mcompass;
+
+/// @brief 令牌桶, 令牌数放大1000倍以免整数除法丢精度
+struct Bucket {
+  uint32_t tokens;
+  int64_t lastRefillUs;
+  ingest::Stats stats;
+};
+
+static Context *ctx = nullptr;
+// HTTP和WebSocket在 async_tcp 任务, UDP在 async_udp 任务
+static portMUX_TYPE ingestMux = portMUX_INITIALIZER_UNLOCKED;
+static Bucket buckets[ingest::CHANNEL_MAX];
+
+void ingest::init(Context *context) {
+  ctx = context;
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&ingestMux);
+  for (Bucket &bucket : buckets) {
+    bucket.tokens = INGEST_BURST * 1000;
+    bucket.lastRefillUs = now;
+    bucket.stats = {};
+  }
+  portEXIT_CRITICAL(&ingestMux);
+}
+
+ingest::Result ingest::submit(Channel channel, int angle) {
+  if (channel < 0 || channel >= CHANNEL_MAX || !ctx) {
+    return REJECTED;
+  }
+  Bucket &bucket = buckets[channel];
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&ingestMux);
+  // 每微秒补充 INGEST_RATE_LIMIT / 1000 个千分之一令牌
+  int64_t refill = (now - bucket.lastRefillUs) * INGEST_RATE_LIMIT / 1000;
+  if (refill > 0) {
+    bucket.tokens = (uint32_t)std::min<int64_t>(bucket.tokens + refill,
+                                                INGEST_BURST * 1000);
+    bucket.lastRefillUs = now;
+  }
+  bool allowed = bucket.tokens >= 1000;
+  if (allowed) {
+    bucket.tokens -= 1000;
+  } else {
+    bucket.stats.rejected++;
+  }
+  portEXIT_CRITICAL(&ingestMux);
+  if (!allowed) {
+    return REJECTED;
+  }
+
+  ctx->setSubscribeSource(Event::Source::WEB_SERVER);
+  ctx->setWorkType(WorkType::MOD);
+  bool posted = Event::postAzimuth(ctx->getEventLoop(),
+                                   Event::Source::WEB_SERVER, angle);
+  portENTER_CRITICAL(&ingestMux);
+  if (posted) {
+    bucket.stats.accepted++;
+  } else {
+    bucket.stats.coalesced++;
+  }
+  portEXIT_CRITICAL(&ingestMux);
+  return posted ? ACCEPTED : COALESCED;
+}
+
+ingest::Stats ingest::getStats(Channel channel) {
+  if (channel < 0 || channel >= CHANNEL_MAX) {
+    return {};
+  }
+  portENTER_CRITICAL(&ingestMux);
+  Stats stats = buckets[channel].stats;
+  portEXIT_CRITICAL(&ingestMux);
+  return stats;
+}
+
+const char *ingest::channelName(Channel channel) {
+  switch (channel) {
+  case HTTP:
+    return "http";
+  case WEB_SOCKET:
+    return "ws";
+  case UDP:
+    return "udp";
+  default:
+    return "unknown";
+  }
+}
@@ -0,0 +1,269 @@
+#include <AsyncTCP.h>
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <nimconfig.h>
+
+#include "board.h"
+#include "monitor_def.h"
+#include "nmea_parser.h"
+
+using namespace mcompass;
+
+static const char *TAG = "Monitor";
+
+// 最多记录的任务数量
+#define MONITOR_MAX_TASKS 24
+// RTC内存中数据的校验魔数
+#define MONITOR_MAGIC 0x4D4F4E31 // "MON1"
+// 推荐栈大小的安全余量: 已用栈 * 5 / 4 + 512字节, 按256字节对齐
+#define STACK_MARGIN_BYTES 512
+#define STACK_ALIGN_BYTES 256
+
+/// @brief 单个任务的历史最小剩余栈
+struct TaskWatermark {
+  char name[configMAX_TASK_NAME_LEN];
+  uint32_t minFreeStack;
+};
+
+/// @brief 保存在RTC内存中的历史水位, 软件重启和异常重启后依然保留
+struct Watermarks {
+  uint32_t magic;
+  uint32_t bootCount;
+  uint32_t minFreeHeap;
+  uint32_t minLargestBlock;
+  uint32_t maxFragmentation;
+  TaskWatermark tasks[MONITOR_MAX_TASKS];
+  uint32_t checksum;
+};
+
+/// @brief 已知任务的配置栈大小(字节), 用于计算已用栈和推荐值
+struct TaskStackConfig {
+  const char *name;
+  uint32_t stackSize;
+};
+
+static const TaskStackConfig knownTasks[] = {
+    {"event_loop", EVENT_LOOP_TASK_STACK_SIZE},
+    {"calibrate", CALIBRATE_TASK_STACK_SIZE},
+    {"nmea_parser", NMEA_PARSER_TASK_STACK_SIZE},
+    {"async_tcp", CONFIG_ASYNC_TCP_STACK_SIZE},
+    {"nimble_host", CONFIG_BT_NIMBLE_HOST_TASK_STACK_SIZE},
+#if defined(CONFIG_ESP_TIMER_TASK_STACK_SIZE)
+    {"esp_timer", CONFIG_ESP_TIMER_TASK_STACK_SIZE},
+#endif
+#if defined(CONFIG_ARDUINO_LOOP_STACK_SIZE)
+    {"loopTask", CONFIG_ARDUINO_LOOP_STACK_SIZE},
+#endif
+#if defined(CONFIG_LWIP_TCPIP_TASK_STACK_SIZE)
+    {"tiT", CONFIG_LWIP_TCPIP_TASK_STACK_SIZE},
+#endif
+#if defined(CONFIG_FREERTOS_IDLE_TASK_STACKSIZE)
+    {"IDLE", CONFIG_FREERTOS_IDLE_TASK_STACKSIZE},
+#endif
+};
+
+static RTC_NOINIT_ATTR Watermarks watermarks;
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+static HeapStats heapStats;
+
+static uint32_t checksum(const Watermarks &w) {
+  const uint32_t *words = reinterpret_cast<const uint32_t *>(&w);
+  size_t count = offsetof(Watermarks, checksum) / sizeof(uint32_t);
+  uint32_t sum = 0x811C9DC5;
+  for (size_t i = 0; i < count; i++) {
+    sum = (sum ^ words[i]) * 0x01000193;
+  }
+  return sum;
+}
+
+static uint32_t configuredStackSize(const char *name) {
+  for (const auto &task : knownTasks) {
+    if (strcmp(task.name, name) == 0) {
+      return task.stackSize;
+    }
+  }
+  return 0;
+}
+
+static void recordTask(const char *name, uint32_t freeStack) {
+  TaskWatermark *slot = nullptr;
+  for (int i = 0; i < MONITOR_MAX_TASKS; i++) {
+    if (watermarks.tasks[i].name[0] == '\0') {
+      slot = &watermarks.tasks[i];
+      strncpy(slot->name, name, sizeof(slot->name) - 1);
+      slot->minFreeStack = freeStack;
+      return;
+    }
+    if (strncmp(watermarks.tasks[i].name, name, sizeof(slot->name)) == 0) {
+      slot = &watermarks.tasks[i];
+      break;
+    }
+  }
+  if (slot && freeStack < slot->minFreeStack) {
+    slot->minFreeStack = freeStack;
+  }
+}
+
+static void clearWatermarks() {
+  memset(&watermarks, 0, sizeof(watermarks));
+  watermarks.magic = MONITOR_MAGIC;
+  watermarks.minFreeHeap = UINT32_MAX;
+  watermarks.minLargestBlock = UINT32_MAX;
+}
+
+void monitor::init() {
+  esp_reset_reason_t reason = esp_reset_reason();
+  // 上电或者数据损坏时RTC内存内容无效
+  if (reason == ESP_RST_POWERON || watermarks.magic != MONITOR_MAGIC ||
+      watermarks.checksum != checksum(watermarks)) {
+    ESP_LOGI(TAG, "No valid watermarks in RTC memory, reason=%d", reason);
+    clearWatermarks();
+  }
+  watermarks.bootCount++;
+  watermarks.checksum = checksum(watermarks);
+  ESP_LOGI(TAG, "Boot count since power on: %u", watermarks.bootCount);
+
+  sample();
+
+  esp_timer_handle_t timer;
+  esp_timer_create_args_t timer_args = {
+      .callback =
+          [](void *) {
+            static uint32_t ticks = 0;
+            monitor::sample();
+            ticks += MONITOR_SAMPLE_INTERVAL;
+            if (ticks >= MONITOR_REPORT_INTERVAL) {
+              ticks = 0;
+              monitor::report();
+            }
+          },
+      .arg = nullptr,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "monitor_timer",
+      .skip_unhandled_events = true};
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer));
+  ESP_ERROR_CHECK(
+      esp_timer_start_periodic(timer, MONITOR_SAMPLE_INTERVAL * 1000000));
+}
+
+void monitor::sample() {
+  HeapStats current;
+  current.freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  current.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  current.fragmentation =
+      current.freeBytes == 0
+          ? 0
+          : 100 - (uint64_t)current.largestBlock * 100 / current.freeBytes;
+
+#if configUSE_TRACE_FACILITY
+  static TaskStatus_t status[MONITOR_MAX_TASKS];
+  UBaseType_t taskCount =
+      uxTaskGetSystemState(status, MONITOR_MAX_TASKS, nullptr);
+#else
+  // 没有开启Trace Facility时, 只能采样已知名称的任务
+  UBaseType_t taskCount = 0;
+  struct {
+    const char *pcTaskName;
+    TaskHandle_t xHandle;
+  } status[MONITOR_MAX_TASKS];
+  for (const auto &task : knownTasks) {
+    TaskHandle_t handle = xTaskGetHandle(task.name);
+    if (handle && taskCount < MONITOR_MAX_TASKS) {
+      status[taskCount].pcTaskName = task.name;
+      status[taskCount].xHandle = handle;
+      taskCount++;
+    }
+  }
+#endif
+
+  portENTER_CRITICAL(&mux);
+  for (UBaseType_t i = 0; i < taskCount; i++) {
+#if configUSE_TRACE_FACILITY
+    uint32_t freeStack = status[i].usStackHighWaterMark;
+#else
+    uint32_t freeStack = uxTaskGetStackHighWaterMark(status[i].xHandle);
+#endif
+    recordTask(status[i].pcTaskName, freeStack);
+  }
+  if (current.freeBytes < watermarks.minFreeHeap) {
+    watermarks.minFreeHeap = current.freeBytes;
+  }
+  if (current.largestBlock < watermarks.minLargestBlock) {
+    watermarks.minLargestBlock = current.largestBlock;
+  }
+  if (current.fragmentation > watermarks.maxFragmentation) {
+    watermarks.maxFragmentation = current.fragmentation;
+  }
+  watermarks.checksum = checksum(watermarks);
+  current.minFreeBytes = watermarks.minFreeHeap;
+  current.minLargestBlock = watermarks.minLargestBlock;
+  current.maxFragmentation = watermarks.maxFragmentation;
+  heapStats = current;
+  portEXIT_CRITICAL(&mux);
+}
+
+void monitor::report() {
+  Watermarks snapshot;
+  portENTER_CRITICAL(&mux);
+  snapshot = watermarks;
+  portEXIT_CRITICAL(&mux);
+
+  HeapStats stats = getHeapStats();
+  ESP_LOGI(TAG, "Heap free=%u (min %u) largest=%u (min %u) frag=%u%% (max %u%%)",
+           stats.freeBytes, stats.minFreeBytes, stats.largestBlock,
+           stats.minLargestBlock, stats.fragmentation, stats.maxFragmentation);
+  ESP_LOGI(TAG, "%-16s %8s %8s %8s %10s", "task", "stack", "minFree", "used",
+           "recommend");
+  for (int i = 0; i < MONITOR_MAX_TASKS && snapshot.tasks[i].name[0]; i++) {
+    const TaskWatermark &task = snapshot.tasks[i];
+    uint32_t stackSize = configuredStackSize(task.name);
+    if (stackSize == 0) {
+      // 栈大小未知, 只能给出最小剩余栈
+      ESP_LOGI(TAG, "%-16s %8s %8u %8s %10s", task.name, "?", task.minFreeStack,
+               "?", "-");
+      continue;
+    }
+    uint32_t used =
+        stackSize > task.minFreeStack ? stackSize - task.minFreeStack : 0;
+    uint32_t recommend = used * 5 / 4 + STACK_MARGIN_BYTES;
+    recommend = (recommend + STACK_ALIGN_BYTES - 1) / STACK_ALIGN_BYTES *
+                STACK_ALIGN_BYTES;
+    ESP_LOGI(TAG, "%-16s %8u %8u %8u %10u%s", task.name, stackSize,
+             task.minFreeStack, used, recommend,
+             recommend > stackSize ? " (grow)" : "");
+  }
+}
+
+monitor::HeapStats monitor::getHeapStats() {
+  portENTER_CRITICAL(&mux);
+  HeapStats stats = heapStats;
+  portEXIT_CRITICAL(&mux);
+  return stats;
+}
+
+uint32_t monitor::getMinFreeStack(const char *taskName) {
+  uint32_t result = 0;
+  portENTER_CRITICAL(&mux);
+  for (int i = 0; i < MONITOR_MAX_TASKS && watermarks.tasks[i].name[0]; i++) {
+    if (strncmp(watermarks.tasks[i].name, taskName,
+                sizeof(watermarks.tasks[i].name)) == 0) {
+      result = watermarks.tasks[i].minFreeStack;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&mux);
+  return result;
+}
+
+void monitor::reset() {
+  portENTER_CRITICAL(&mux);
+  uint32_t bootCount = watermarks.bootCount;
+  clearWatermarks();
+  watermarks.bootCount = bootCount;
+  watermarks.checksum = checksum(watermarks);
+  portEXIT_CRITICAL(&mux);
+}
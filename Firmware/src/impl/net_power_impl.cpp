@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <string.h>
+
+#include "net_power_def.h"
+
+using namespace mcompass;
+
+static const char *TAG = "NetPower";
+
+// 网页请求在 async_tcp 任务, UDP在 async_udp 任务, 评估在 esp_timer 任务
+static portMUX_TYPE powerMux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t tickTimer = nullptr;
+static uint32_t (*streamClients)() = nullptr;
+static net_power::Mode current = net_power::UNMANAGED;
+static uint32_t switches = 0;
+static uint32_t timeMs[net_power::MODE_MAX];
+static int64_t modeSinceMs = 0;
+static int64_t lastRequestMs = 0;
+static int64_t lastStreamMs = 0;
+
+static int64_t nowMs() { return esp_timer_get_time() / 1000; }
+
+static wifi_ps_type_t psType(net_power::Mode mode) {
+  switch (mode) {
+  case net_power::INTERACTIVE:
+    return WIFI_PS_MIN_MODEM;
+  case net_power::IDLE:
+    return WIFI_PS_MAX_MODEM;
+  default:
+    return WIFI_PS_NONE;
+  }
+}
+
+/**
+ * @brief 只有STA模式连接上路由器时才能使用省电模式
+ */
+static bool stationAssociated() {
+  wifi_mode_t mode;
+  wifi_ap_record_t ap;
+  return esp_wifi_get_mode(&mode) == ESP_OK && mode == WIFI_MODE_STA &&
+         esp_wifi_sta_get_ap_info(&ap) == ESP_OK;
+}
+
+/**
+ * @brief 切换档位并累计上一个档位的时间, 档位没有变化时什么都不做
+ */
+static void switchMode(net_power::Mode mode) {
+  int64_t now = nowMs();
+  portENTER_CRITICAL(&powerMux);
+  net_power::Mode previous = current;
+  if (mode != previous) {
+    timeMs[previous] += now - modeSinceMs;
+    modeSinceMs = now;
+    current = mode;
+    switches++;
+  }
+  portEXIT_CRITICAL(&powerMux);
+  if (mode == previous) {
+    return;
+  }
+  if (mode != net_power::UNMANAGED) {
+    esp_wifi_set_ps(psType(mode));
+  }
+  ESP_LOGI(TAG, "%s -> %s", net_power::modeName(previous),
+           net_power::modeName(mode));
+}
+
+/**
+ * @brief 按最近的活动计算应处的档位
+ */
+static net_power::Mode evaluate() {
+  if (!stationAssociated()) {
+    return net_power::UNMANAGED;
+  }
+  int64_t now = nowMs();
+  portENTER_CRITICAL(&powerMux);
+  int64_t request = lastRequestMs;
+  int64_t stream = lastStreamMs;
+  portEXIT_CRITICAL(&powerMux);
+  if ((streamClients && streamClients() > 0) ||
+      now - stream < NET_POWER_STREAM_HOLD * 1000) {
+    return net_power::STREAMING;
+  }
+  if (now - request < NET_POWER_INTERACTIVE_TIMEOUT * 1000) {
+    return net_power::INTERACTIVE;
+  }
+  return net_power::IDLE;
+}
+
+static void onTick(void *) {
+  net_power::Mode mode = evaluate();
+  switchMode(mode);
+  // 重连路由器后驱动会恢复默认省电模式, 不同任务同时切换也可能留下旧的设置,
+  // 这里按当前档位纠正
+  wifi_ps_type_t type;
+  if (mode != net_power::UNMANAGED && esp_wifi_get_ps(&type) == ESP_OK &&
+      type != psType(mode)) {
+    esp_wifi_set_ps(psType(mode));
+  }
+}
+
+void net_power::init(uint32_t (*clients)()) {
+  int64_t now = nowMs();
+  portENTER_CRITICAL(&powerMux);
+  streamClients = clients;
+  current = UNMANAGED;
+  switches = 0;
+  memset(timeMs, 0, sizeof(timeMs));
+  modeSinceMs = now;
+  // 刚启动时按有网页请求处理, 避免连接路由器后马上进入深度省电
+  lastRequestMs = now;
+  lastStreamMs = now - NET_POWER_STREAM_HOLD * 1000;
+  portEXIT_CRITICAL(&powerMux);
+  if (!tickTimer) {
+    esp_timer_create_args_t timerArgs = {.callback = onTick,
+                                         .arg = nullptr,
+                                         .dispatch_method = ESP_TIMER_TASK,
+                                         .name = "netPowerTimer",
+                                         .skip_unhandled_events = true};
+    ESP_ERROR_CHECK(esp_timer_create(&timerArgs, &tickTimer));
+  }
+  esp_timer_stop(tickTimer);
+  esp_timer_start_periodic(tickTimer, NET_POWER_TICK_INTERVAL * 1000);
+}
+
+void net_power::deinit() {
+  if (tickTimer) {
+    esp_timer_stop(tickTimer);
+  }
+  if (current != UNMANAGED) {
+    esp_wifi_set_ps(WIFI_PS_NONE);
+  }
+  switchMode(UNMANAGED);
+  Stats stats = getStats();
+  ESP_LOGI(TAG, "streaming %u ms, interactive %u ms, idle %u ms, %u switches",
+           stats.timeMs[STREAMING], stats.timeMs[INTERACTIVE],
+           stats.timeMs[IDLE], stats.switches);
+}
+
+void net_power::notifyRequest() {
+  portENTER_CRITICAL(&powerMux);
+  lastRequestMs = nowMs();
+  bool wake = current == IDLE;
+  portEXIT_CRITICAL(&powerMux);
+  // 只在从深度省电唤醒时切换, 其余情况由定时评估处理
+  if (wake) {
+    switchMode(INTERACTIVE);
+  }
+}
+
+void net_power::notifyStream() {
+  portENTER_CRITICAL(&powerMux);
+  lastStreamMs = nowMs();
+  bool wake = current == IDLE || current == INTERACTIVE;
+  portEXIT_CRITICAL(&powerMux);
+  if (wake) {
+    switchMode(STREAMING);
+  }
+}
+
+net_power::Stats net_power::getStats() {
+  int64_t now = nowMs();
+  Stats stats;
+  portENTER_CRITICAL(&powerMux);
+  stats.mode = current;
+  stats.switches = switches;
+  stats.idleSeconds = (now - std::max(lastRequestMs, lastStreamMs)) / 1000;
+  memcpy(stats.timeMs, timeMs, sizeof(timeMs));
+  stats.timeMs[current] += now - modeSinceMs;
+  portEXIT_CRITICAL(&powerMux);
+  return stats;
+}
+
+const char *net_power::modeName(Mode mode) {
+  switch (mode) {
+  case UNMANAGED:
+    return "unmanaged";
+  case STREAMING:
+    return "streaming";
+  case INTERACTIVE:
+    return "interactive";
+  case IDLE:
+    return "idle";
+  default:
+    return "unknown";
+  }
+}
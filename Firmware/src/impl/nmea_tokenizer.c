@@ -0,0 +1,423 @@
+#include <string.h>
+
+#include "nmea_tokenizer.h"
+
+/**
+ * @brief Field view into the caller's line buffer
+ *
+ */
+typedef struct {
+    const char *ptr; /*!< First character of the field */
+    uint8_t len;     /*!< Number of characters */
+} nmea_field_t;
+
+static const uint32_t pow10_table[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000,
+};
+
+static inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Parse an unsigned decimal integer field
+ *
+ * @return true if the field is non-empty and only contains digits
+ */
+static bool parse_uint(const nmea_field_t *f, uint32_t *out)
+{
+    if (f->len == 0 || f->len > 9) {
+        return false;
+    }
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < f->len; i++) {
+        if (!is_digit(f->ptr[i])) {
+            return false;
+        }
+        value = value * 10 + (f->ptr[i] - '0');
+    }
+    *out = value;
+    return true;
+}
+
+/**
+ * @brief Parse "[-]int[.frac]" into an integer scaled by 10^decimals
+ *
+ * Extra fractional digits are truncated.
+ *
+ * @return true if the field is a valid number
+ */
+static bool parse_fixed(const nmea_field_t *f, uint8_t decimals, int32_t *out)
+{
+    uint8_t i = 0;
+    bool negative = false;
+    if (f->len == 0) {
+        return false;
+    }
+    if (f->ptr[0] == '-') {
+        negative = true;
+        i++;
+    }
+    int64_t value = 0;
+    uint8_t digits = 0;
+    uint8_t frac_digits = 0;
+    bool in_frac = false;
+    for (; i < f->len; i++) {
+        char c = f->ptr[i];
+        if (c == '.' && !in_frac) {
+            in_frac = true;
+            continue;
+        }
+        if (!is_digit(c) || ++digits > 12) {
+            return false;
+        }
+        if (in_frac) {
+            if (frac_digits == decimals) {
+                continue;
+            }
+            frac_digits++;
+        }
+        value = value * 10 + (c - '0');
+    }
+    if (digits == 0) {
+        return false;
+    }
+    value *= pow10_table[decimals - frac_digits];
+    if (value > INT32_MAX) {
+        return false;
+    }
+    *out = negative ? -(int32_t)value : (int32_t)value;
+    return true;
+}
+
+/**
+ * @brief Parse latitude "ddmm.mmmm" or longitude "dddmm.mmmm" with hemisphere
+ *
+ * The minutes are kept as an integer with 7 fractional digits, so a
+ * 5 decimal minute field is decoded without any rounding loss.
+ *
+ * @param value coordinate field
+ * @param hemisphere N/S or E/W field
+ * @param max_degree 90 for latitude, 180 for longitude
+ * @return true if both fields are valid
+ */
+static bool parse_coordinate(const nmea_field_t *value, const nmea_field_t *hemisphere,
+                             int32_t max_degree, int32_t *out_e7)
+{
+    if (value->len < 4 || hemisphere->len != 1) {
+        return false;
+    }
+    uint8_t dot = 0;
+    while (dot < value->len && value->ptr[dot] != '.') {
+        dot++;
+    }
+    if (dot < 3) {
+        return false;
+    }
+    int32_t degree = 0;
+    for (uint8_t i = 0; i < dot - 2; i++) {
+        if (!is_digit(value->ptr[i])) {
+            return false;
+        }
+        degree = degree * 10 + (value->ptr[i] - '0');
+        /* stop before a long run of digits overflows */
+        if (degree > max_degree) {
+            return false;
+        }
+    }
+    if (!is_digit(value->ptr[dot - 2]) || !is_digit(value->ptr[dot - 1])) {
+        return false;
+    }
+    int64_t minute_e7 = (int64_t)((value->ptr[dot - 2] - '0') * 10 + (value->ptr[dot - 1] - '0')) * 10000000;
+    uint32_t scale = 1000000;
+    for (uint8_t i = dot + 1; i < value->len; i++) {
+        if (!is_digit(value->ptr[i])) {
+            return false;
+        }
+        minute_e7 += (value->ptr[i] - '0') * scale;
+        scale /= 10;
+    }
+    if (degree > max_degree || minute_e7 >= 600000000LL) {
+        return false;
+    }
+    int64_t result = (int64_t)degree * 10000000 + (minute_e7 + 30) / 60;
+    if (result > (int64_t)max_degree * 10000000) {
+        return false;
+    }
+    switch (hemisphere->ptr[0]) {
+    case 'N':
+    case 'E':
+        break;
+    case 'S':
+    case 'W':
+        result = -result;
+        break;
+    default:
+        return false;
+    }
+    *out_e7 = (int32_t)result;
+    return true;
+}
+
+/**
+ * @brief Parse UTC time "hhmmss[.sss]" into millisecond of day
+ *
+ */
+static bool parse_time(const nmea_field_t *f, uint32_t *out_ms)
+{
+    if (f->len < 6) {
+        return false;
+    }
+    for (uint8_t i = 0; i < 6; i++) {
+        if (!is_digit(f->ptr[i])) {
+            return false;
+        }
+    }
+    uint32_t hour = (f->ptr[0] - '0') * 10 + (f->ptr[1] - '0');
+    uint32_t minute = (f->ptr[2] - '0') * 10 + (f->ptr[3] - '0');
+    uint32_t second = (f->ptr[4] - '0') * 10 + (f->ptr[5] - '0');
+    uint32_t millis = 0;
+    if (f->len > 7 && f->ptr[6] == '.') {
+        uint32_t scale = 100;
+        for (uint8_t i = 7; i < f->len && scale > 0; i++) {
+            if (!is_digit(f->ptr[i])) {
+                return false;
+            }
+            millis += (f->ptr[i] - '0') * scale;
+            scale /= 10;
+        }
+    }
+    if (hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+    *out_ms = ((hour * 60 + minute) * 60 + second) * 1000 + millis;
+    return true;
+}
+
+static void parse_gga(nmea_data_t *data, const nmea_field_t *f, uint8_t count)
+{
+    uint32_t value;
+    int32_t fixed;
+    int32_t latitude, longitude;
+    if (count < 12) {
+        return;
+    }
+    parse_time(&f[1], &data->time_ms);
+    if (parse_coordinate(&f[2], &f[3], 90, &latitude) &&
+            parse_coordinate(&f[4], &f[5], 180, &longitude)) {
+        data->latitude_e7 = latitude;
+        data->longitude_e7 = longitude;
+    }
+    data->fix = parse_uint(&f[6], &value) ? (uint8_t)value : 0;
+    if (parse_uint(&f[7], &value)) {
+        data->sats_in_use = (uint8_t)value;
+    }
+    if (parse_fixed(&f[8], 2, &fixed) && fixed >= 0 && fixed <= UINT16_MAX) {
+        data->hdop_x100 = (uint16_t)fixed;
+    }
+    if (parse_fixed(&f[9], 3, &fixed)) {
+        int32_t separation = 0;
+        parse_fixed(&f[11], 3, &separation);
+        data->altitude_mm = fixed + separation;
+    }
+}
+
+static void parse_gsa(nmea_data_t *data, const nmea_field_t *f, uint8_t count)
+{
+    uint32_t value;
+    int32_t fixed;
+    if (count < 18) {
+        return;
+    }
+    if (parse_uint(&f[2], &value)) {
+        data->fix_mode = (uint8_t)value;
+    }
+    for (uint8_t i = 0; i < NMEA_TOKENIZER_MAX_SATS_IN_USE; i++) {
+        data->sats_id_in_use[i] = parse_uint(&f[3 + i], &value) ? (uint8_t)value : 0;
+    }
+    if (parse_fixed(&f[15], 2, &fixed) && fixed >= 0 && fixed <= UINT16_MAX) {
+        data->pdop_x100 = (uint16_t)fixed;
+    }
+    if (parse_fixed(&f[16], 2, &fixed) && fixed >= 0 && fixed <= UINT16_MAX) {
+        data->hdop_x100 = (uint16_t)fixed;
+    }
+    if (parse_fixed(&f[17], 2, &fixed) && fixed >= 0 && fixed <= UINT16_MAX) {
+        data->vdop_x100 = (uint16_t)fixed;
+    }
+}
+
+/**
+ * @brief knots * 1000 to millimetre per second
+ *
+ */
+static inline uint32_t knots_x1000_to_mmps(int32_t knots_x1000)
+{
+    return (uint32_t)(((int64_t)knots_x1000 * 1852 + 1800) / 3600);
+}
+
+static void parse_rmc(nmea_data_t *data, const nmea_field_t *f, uint8_t count)
+{
+    uint32_t value;
+    int32_t fixed;
+    int32_t latitude, longitude;
+    if (count < 10) {
+        return;
+    }
+    parse_time(&f[1], &data->time_ms);
+    data->valid = f[2].len == 1 && f[2].ptr[0] == 'A';
+    if (parse_coordinate(&f[3], &f[4], 90, &latitude) &&
+            parse_coordinate(&f[5], &f[6], 180, &longitude)) {
+        data->latitude_e7 = latitude;
+        data->longitude_e7 = longitude;
+    }
+    if (parse_fixed(&f[7], 3, &fixed) && fixed >= 0) {
+        data->speed_mmps = knots_x1000_to_mmps(fixed);
+    }
+    if (parse_fixed(&f[8], 2, &fixed) && fixed >= 0 && fixed < 36000) {
+        data->course_x100 = (uint16_t)fixed;
+    }
+    if (f[9].len == 6 && parse_uint(&f[9], &value)) {
+        data->day = value / 10000;
+        data->month = value / 100 % 100;
+        data->year = value % 100;
+    }
+}
+
+static void parse_vtg(nmea_data_t *data, const nmea_field_t *f, uint8_t count)
+{
+    int32_t fixed;
+    if (count < 8) {
+        return;
+    }
+    if (parse_fixed(&f[1], 2, &fixed) && fixed >= 0 && fixed < 36000) {
+        data->course_x100 = (uint16_t)fixed;
+    }
+    if (parse_fixed(&f[7], 3, &fixed) && fixed >= 0) {
+        /* km/h * 1000 is metre per hour */
+        data->speed_mmps = (uint32_t)(((int64_t)fixed * 1000 + 1800) / 3600);
+    } else if (parse_fixed(&f[5], 3, &fixed) && fixed >= 0) {
+        data->speed_mmps = knots_x1000_to_mmps(fixed);
+    }
+}
+
+static nmea_sentence_t identify(const nmea_field_t *address)
+{
+    /* Talker ID (GP, GN, BD, GL...) followed by the three letter type */
+    if (address->len != 5) {
+        return NMEA_SENTENCE_UNKNOWN;
+    }
+    const char *type = address->ptr + 2;
+    if (memcmp(type, "GGA", 3) == 0) {
+        return NMEA_SENTENCE_GGA;
+    }
+    if (memcmp(type, "RMC", 3) == 0) {
+        return NMEA_SENTENCE_RMC;
+    }
+    if (memcmp(type, "GSA", 3) == 0) {
+        return NMEA_SENTENCE_GSA;
+    }
+    if (memcmp(type, "VTG", 3) == 0) {
+        return NMEA_SENTENCE_VTG;
+    }
+    return NMEA_SENTENCE_UNKNOWN;
+}
+
+void nmea_tokenizer_init(nmea_tokenizer_t *tok)
+{
+    memset(tok, 0, sizeof(*tok));
+}
+
+nmea_result_t nmea_tokenizer_parse(nmea_tokenizer_t *tok, const char *line, size_t len, nmea_sentence_t *sentence)
+{
+    nmea_field_t fields[NMEA_TOKENIZER_MAX_FIELDS];
+    uint8_t count = 0;
+    uint8_t crc = 0;
+    nmea_sentence_t type = NMEA_SENTENCE_UNKNOWN;
+
+    tok->lines++;
+    if (sentence) {
+        *sentence = NMEA_SENTENCE_UNKNOWN;
+    }
+    const char *start = memchr(line, '$', len);
+    if (!start) {
+        tok->format_errors++;
+        return NMEA_ERR_FORMAT;
+    }
+    const char *end = line + len;
+    const char *p = start + 1;
+    fields[0].ptr = p;
+    /* Single pass: accumulate the checksum and cut fields until '*' */
+    for (; p < end && *p != '*'; p++) {
+        char c = *p;
+        if (c == '\r' || c == '\n' || c == '$') {
+            break;
+        }
+        crc ^= (uint8_t)c;
+        if (c == ',') {
+            fields[count].len = (uint8_t)(p - fields[count].ptr);
+            if (++count == NMEA_TOKENIZER_MAX_FIELDS) {
+                tok->format_errors++;
+                return NMEA_ERR_FORMAT;
+            }
+            fields[count].ptr = p + 1;
+        } else if ((size_t)(p - fields[count].ptr) >= UINT8_MAX) {
+            tok->format_errors++;
+            return NMEA_ERR_FORMAT;
+        }
+    }
+    if (p + 2 >= end || *p != '*') {
+        tok->format_errors++;
+        return NMEA_ERR_FORMAT;
+    }
+    fields[count].len = (uint8_t)(p - fields[count].ptr);
+    count++;
+    int high = hex_value(p[1]);
+    int low = hex_value(p[2]);
+    if (high < 0 || low < 0) {
+        tok->format_errors++;
+        return NMEA_ERR_FORMAT;
+    }
+    if (crc != (uint8_t)((high << 4) | low)) {
+        tok->crc_errors++;
+        return NMEA_ERR_CRC;
+    }
+
+    type = identify(&fields[0]);
+    if (sentence) {
+        *sentence = type;
+    }
+    switch (type) {
+    case NMEA_SENTENCE_GGA:
+        parse_gga(&tok->data, fields, count);
+        break;
+    case NMEA_SENTENCE_GSA:
+        parse_gsa(&tok->data, fields, count);
+        break;
+    case NMEA_SENTENCE_RMC:
+        parse_rmc(&tok->data, fields, count);
+        break;
+    case NMEA_SENTENCE_VTG:
+        parse_vtg(&tok->data, fields, count);
+        break;
+    default:
+        tok->unsupported++;
+        return NMEA_ERR_UNSUPPORTED;
+    }
+    tok->updated |= 1u << type;
+    return NMEA_OK;
+}
@@ -1,9 +1,11 @@
 #include <FastLED.h>
 
-#include "board.h"
 #include "compass_frames.h"
 #include "context.h"
 #include "font.h"
+#include "macro_def.h"
+#include "pixel_def.h"
+#include "preference_def.h"
 #include "utils.h"
 
 using namespace mcompass;
@@ -199,7 +201,9 @@ void pixel::showFrameByBearing(float bearing, int azimuth) {
 
 void pixel::showFrameByLocation(float latA, float lonA, float latB, float lonB,
                                 int azimuth) {
-  float bearing = utils::calculateBearing(latA, lonA, latB, lonB);
+  // 位置大约每秒才变化一次, 缓存方位角避免每帧重复计算三角函数
+  static utils::NavigationCache navigation;
+  float bearing = navigation.bearing({latA, lonA}, {latB, lonB});
 
   // 由于我们的0度定义为正南方, 而calculateBearing是以正北方为0度计算的
   // 所以需要对这个结果进行调整
@@ -212,6 +216,12 @@ void pixel::showFrameByLocation(float latA, float lonA, float latB, float lonB,
   showFrameByBearing(bearing, azimuth);
 }
 
+void pixel::showArrived() {
+  fill_solid(leds, NUM_LEDS, CRGB(pColor));
+  fadeToBlackBy(leds, NUM_LEDS, 255 - beatsin8(30, 32, 255));
+  FastLED.show();
+}
+
 void pixel::showSolid(int color) {
   fill_solid(leds, NUM_LEDS, CRGB(color));
   FastLED.show();
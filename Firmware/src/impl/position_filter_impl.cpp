@@ -0,0 +1,199 @@
+#include <esp_log.h>
+#include <math.h>
+
+#include "position_filter_def.h"
+
+using namespace mcompass;
+
+static const char *TAG = "PositionFilter";
+
+// 1e-7度对应的经线长度(米)
+static const float METERS_PER_E7 =
+    (float)(EARTH_RADIUS * 1000.0 * M_PI / 180.0 / 1e7);
+
+/// @brief 单个方向的匀速模型, 状态为位置和速度
+struct Axis {
+  float p;   // 位置(米)
+  float v;   // 速度(米/秒)
+  float p00; // 位置方差
+  float p01; // 位置速度协方差
+  float p11; // 速度方差
+};
+
+static Axis north, east;
+static int32_t originLatE7 = 0;
+static int32_t originLonE7 = 0;
+static float originCosLat = 1.0f;
+static int64_t lastUs = 0;
+static bool valid = false;
+static bool arrived = false;
+static uint8_t rejects = 0;
+
+static void initAxis(Axis &axis, float variance) {
+  axis.p = 0.0f;
+  axis.v = 0.0f;
+  axis.p00 = variance;
+  axis.p01 = 0.0f;
+  axis.p11 = GPS_FILTER_INIT_SPEED_SIGMA * GPS_FILTER_INIT_SPEED_SIGMA;
+}
+
+static void predict(Axis &axis, float dt) {
+  float dt2 = dt * dt;
+  float q = GPS_FILTER_ACCEL_NOISE * GPS_FILTER_ACCEL_NOISE;
+  axis.p += axis.v * dt;
+  axis.p00 += dt * (2.0f * axis.p01 + dt * axis.p11) + q * dt2 * dt2 / 4.0f;
+  axis.p01 += dt * axis.p11 + q * dt2 * dt / 2.0f;
+  axis.p11 += q * dt2;
+}
+
+static void correct(Axis &axis, float z, float variance) {
+  float s = axis.p00 + variance;
+  float k0 = axis.p00 / s;
+  float k1 = axis.p01 / s;
+  float y = z - axis.p;
+  axis.p += k0 * y;
+  axis.v += k1 * y;
+  axis.p11 -= k1 * axis.p01;
+  axis.p00 -= k0 * axis.p00;
+  axis.p01 -= k0 * axis.p01;
+}
+
+/**
+ * @brief 观测方差, HDOP越大或卫星越少越不可信
+ */
+static float measurementVariance(const gps_fix_record_t &fix) {
+  float hdop =
+      fix.hdop_x100 > 0 ? fix.hdop_x100 / 100.0f : GPS_FILTER_DEFAULT_HDOP;
+  float sigma = GPS_FILTER_UERE * hdop;
+  float variance = sigma * sigma;
+  if (fix.sats_in_use < GPS_FILTER_MIN_SATS) {
+    variance *= 4.0f;
+  }
+  return variance;
+}
+
+static void toLocal(int32_t latE7, int32_t lonE7, float &n, float &e) {
+  n = (float)((int64_t)latE7 - originLatE7) * METERS_PER_E7;
+  int64_t dLon = (int64_t)lonE7 - originLonE7;
+  // 跨越180度经线
+  if (dLon > 1800000000LL) {
+    dLon -= 3600000000LL;
+  } else if (dLon < -1800000000LL) {
+    dLon += 3600000000LL;
+  }
+  e = (float)dLon * METERS_PER_E7 * originCosLat;
+}
+
+static void setOrigin(int32_t latE7, int32_t lonE7) {
+  originLatE7 = latE7;
+  originLonE7 = lonE7;
+  originCosLat = cosf(latE7 / 1e7f * (float)M_PI / 180.0f);
+  if (originCosLat < 0.01f) {
+    originCosLat = 0.01f;
+  }
+}
+
+static void restart(const gps_fix_record_t &fix, float variance) {
+  setOrigin(fix.latitude_e7, fix.longitude_e7);
+  initAxis(north, variance);
+  initAxis(east, variance);
+  rejects = 0;
+  valid = true;
+}
+
+void position_filter::reset() {
+  valid = false;
+  arrived = false;
+  rejects = 0;
+}
+
+position_filter::Estimate position_filter::update(const gps_fix_record_t &fix) {
+  float variance = measurementVariance(fix);
+  float dt = (fix.timestamp_us - lastUs) / 1e6f;
+  if (!valid || dt <= 0.0f || dt > GPS_FILTER_RESET_GAP) {
+    lastUs = fix.timestamp_us;
+    restart(fix, variance);
+    return getEstimate();
+  }
+  predict(north, dt);
+  predict(east, dt);
+  float n, e;
+  toLocal(fix.latitude_e7, fix.longitude_e7, n, e);
+  // 马氏距离门限, 剔除跳点; 连续多次被剔除说明滤波器已经跟丢
+  float yn = n - north.p;
+  float ye = e - east.p;
+  float d2 = yn * yn / (north.p00 + variance) + ye * ye / (east.p00 + variance);
+  lastUs = fix.timestamp_us;
+  if (d2 > GPS_FILTER_GATE) {
+    if (++rejects > GPS_FILTER_MAX_REJECTS) {
+      ESP_LOGI(TAG, "Lost track, restart filter");
+      restart(fix, variance);
+    } else {
+      ESP_LOGD(TAG, "Reject fix, d2=%.1f", d2);
+    }
+    return getEstimate();
+  }
+  rejects = 0;
+  correct(north, n, variance);
+  correct(east, e, variance);
+  // 离原点太远时把原点移到当前位置, 保证单精度浮点的精度
+  if (fabsf(north.p) > GPS_FILTER_ORIGIN_RANGE ||
+      fabsf(east.p) > GPS_FILTER_ORIGIN_RANGE) {
+    north.p -= n;
+    east.p -= e;
+    setOrigin(fix.latitude_e7, fix.longitude_e7);
+  }
+  return getEstimate();
+}
+
+position_filter::Estimate position_filter::getEstimate() {
+  Estimate estimate;
+  estimate.valid = valid;
+  if (!valid) {
+    estimate.location = {DEFAULT_INVALID_LOCATION_VALUE,
+                         DEFAULT_INVALID_LOCATION_VALUE};
+    estimate.speed = 0.0f;
+    estimate.sigma = 0.0f;
+    return estimate;
+  }
+  // 原点是1e-7度的整数, 换算回度时用双精度避免损失精度
+  estimate.location.latitude =
+      (originLatE7 + (double)north.p / METERS_PER_E7) / 1e7;
+  estimate.location.longitude =
+      (originLonE7 + (double)east.p / (METERS_PER_E7 * originCosLat)) / 1e7;
+  if (estimate.location.longitude > 180.0f) {
+    estimate.location.longitude -= 360.0f;
+  } else if (estimate.location.longitude < -180.0f) {
+    estimate.location.longitude += 360.0f;
+  }
+  estimate.speed = sqrtf(north.v * north.v + east.v * east.v);
+  estimate.sigma = sqrtf(north.p00 + east.p00);
+  return estimate;
+}
+
+bool position_filter::updateArrival(const Location &target) {
+  if (!valid || fabsf(target.latitude) > 90.0f ||
+      fabsf(target.longitude) > 180.0f) {
+    arrived = false;
+    return arrived;
+  }
+  float n, e;
+  toLocal(lroundf(target.latitude * 1e7f), lroundf(target.longitude * 1e7f), n,
+          e);
+  n -= north.p;
+  e -= east.p;
+  float distance = sqrtf(n * n + e * e);
+  float radius = GPS_ARRIVED_RADIUS + 2.0f * sqrtf(north.p00 + east.p00);
+  if (arrived) {
+    radius *= GPS_ARRIVED_HYSTERESIS;
+  }
+  bool nowArrived = distance < radius;
+  if (nowArrived != arrived) {
+    ESP_LOGI(TAG, "%s target, %.1f m (radius %.1f m)",
+             nowArrived ? "Arrived at" : "Left", distance, radius);
+    arrived = nowArrived;
+  }
+  return arrived;
+}
+
+bool position_filter::isArrived() { return arrived; }
@@ -1,4 +1,5 @@
 #include <Preferences.h>
+#include <nvs.h>
 
 #include "board.h"
 #include "macro_def.h"
@@ -200,4 +201,72 @@ preference::CalibrationData preference::getCalibration() {
   preferences.getBytes(CALIBRATION_KEY, &data, sizeof(preference::CalibrationData));
   preferences.end();
   return data;
-}
\ No newline at end of file
+}
+
+void preference::saveWaypoints(const void *data, size_t length) {
+  Preferences preferences;
+  preferences.begin(PREFERENCE_NAME, false);
+  preferences.putBytes(WAYPOINTS_KEY, data, length);
+  preferences.end();
+}
+
+size_t preference::getWaypoints(void *data, size_t length) {
+  Preferences preferences;
+  preferences.begin(PREFERENCE_NAME, true);
+  size_t result = 0;
+  if (preferences.isKey(WAYPOINTS_KEY)) {
+    result = preferences.getBytes(WAYPOINTS_KEY, data, length);
+  }
+  preferences.end();
+  return result;
+}
+
+bool preference::saveConfig(const config::Change &change) {
+  // Preferences 每次 put 都会单独提交, 这里直接使用NVS接口, 全部写完后提交一次
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(PREFERENCE_NAME, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "nvs_open failed: %s", esp_err_to_name(err));
+    return false;
+  }
+  if (err == ESP_OK && (change.fields & config::FIELD_SPAWN_COLOR)) {
+    err = nvs_set_i32(handle, SPAWN_COLOR_KEY, change.color.spawnColor);
+  }
+  if (err == ESP_OK && (change.fields & config::FIELD_SOUTH_COLOR)) {
+    err = nvs_set_i32(handle, SOUTH_COLOR_KEY, change.color.southColor);
+  }
+  if (err == ESP_OK && (change.fields & config::FIELD_BRIGHTNESS)) {
+    err = nvs_set_u8(handle, BRIGHTNESS_KEY, change.brightness);
+  }
+  if (err == ESP_OK && (change.fields & config::FIELD_SPAWN)) {
+    // 与 Preferences::putFloat 的存储格式保持一致
+    err = nvs_set_blob(handle, LATITUDE_KEY, &change.spawn.latitude,
+                       sizeof(float));
+    if (err == ESP_OK) {
+      err = nvs_set_blob(handle, LONGTITUDE_KEY, &change.spawn.longitude,
+                         sizeof(float));
+    }
+  }
+  if (err == ESP_OK && (change.fields & config::FIELD_SERVER_MODE)) {
+    err = nvs_set_i32(handle, SERVER_MODE_KEY,
+                      static_cast<int>(change.serverMode));
+  }
+  if (err == ESP_OK && (change.fields & config::FIELD_MODEL)) {
+    err = nvs_set_i32(handle, MODEL_KEY, static_cast<int>(change.model));
+  }
+  if (err == ESP_OK && (change.fields & config::FIELD_WIFI)) {
+    err = nvs_set_str(handle, WIFI_SSID_KEY, change.ssid);
+    if (err == ESP_OK) {
+      err = nvs_set_str(handle, WIFI_PWD_KEY, change.password);
+    }
+  }
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "saveConfig failed: %s", esp_err_to_name(err));
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,168 @@
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "route_def.h"
+
+using namespace mcompass;
+
+static const char *TAG = "Route";
+
+static const uint32_t LATENCY_BOUNDS[route::LATENCY_BUCKETS - 1] = {
+    100, 300, 1000, 3000, 10000, 30000, 100000};
+
+static route::Route routes[ROUTE_MAX];
+static size_t routeCount = 0;
+static bool built = false;
+
+static int compareRoute(const void *a, const void *b) {
+  const route::Route *left = static_cast<const route::Route *>(a);
+  const route::Route *right = static_cast<const route::Route *>(b);
+  int result = strcmp(left->path, right->path);
+  if (result != 0) {
+    return result;
+  }
+  return (int)left->method - (int)right->method;
+}
+
+static route::Route *lookup(const char *path,
+                            WebRequestMethodComposite method) {
+  // 找到第一个路径不小于 path 的项, 同一路径的不同方法排在一起
+  size_t low = 0, high = routeCount;
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    if (strcmp(routes[middle].path, path) < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  for (size_t i = low; i < routeCount && strcmp(routes[i].path, path) == 0;
+       i++) {
+    if (routes[i].method & method) {
+      return &routes[i];
+    }
+  }
+  return nullptr;
+}
+
+static void record(route::Stats &stats, uint32_t elapsedUs) {
+  stats.count++;
+  stats.totalUs += elapsedUs;
+  if (elapsedUs > stats.maxUs) {
+    stats.maxUs = elapsedUs;
+  }
+  int bucket = 0;
+  while (bucket < route::LATENCY_BUCKETS - 1 &&
+         elapsedUs > LATENCY_BOUNDS[bucket]) {
+    bucket++;
+  }
+  stats.histogram[bucket]++;
+}
+
+/**
+ * @brief 路由表的分发处理器
+ *
+ * canHandle 查找一次, 把匹配的路由记在请求的 _handlerData 中, handleRequest
+ * 和每一段 handleBody 直接取用; _tempObject 留给处理函数拼接请求体
+ */
+class RouteHandler : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) override {
+    route::Route *route =
+        lookup(request->url().c_str(), request->method());
+    if (!route) {
+      return false;
+    }
+    if (route->header) {
+      request->addInterestingHeader(route->header);
+    }
+    request->_handlerData = route;
+    return true;
+  }
+
+  void handleRequest(AsyncWebServerRequest *request) override {
+    route::Route *route = static_cast<route::Route *>(request->_handlerData);
+    if (!route) {
+      return request->send(500);
+    }
+    int64_t start = esp_timer_get_time();
+    route->onRequest(request);
+    // 处理函数返回后 request 可能已经释放, 之后只访问路由表
+    record(route->stats, (uint32_t)(esp_timer_get_time() - start));
+  }
+
+  void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len,
+                  size_t index, size_t total) override {
+    route::Route *route = static_cast<route::Route *>(request->_handlerData);
+    if (route && route->onBody) {
+      route->onBody(request, data, len, index, total);
+    }
+  }
+
+  // 需要框架解析 urlencoded 请求体中的参数
+  bool isRequestHandlerTrivial() override { return false; }
+};
+
+static RouteHandler routeHandler;
+
+bool route::add(const char *path, WebRequestMethodComposite method,
+                RequestHandler onRequest, BodyHandler onBody,
+                const char *header) {
+  if (built || routeCount >= ROUTE_MAX) {
+    ESP_LOGE(TAG, "Failed to add route %s", path);
+    return false;
+  }
+  Route &route = routes[routeCount++];
+  route = {};
+  route.path = path;
+  route.method = method;
+  route.onRequest = onRequest;
+  route.onBody = onBody;
+  route.header = header;
+  return true;
+}
+
+AsyncWebHandler *route::build() {
+  if (!built) {
+    qsort(routes, routeCount, sizeof(Route), compareRoute);
+    built = true;
+    ESP_LOGI(TAG, "%u routes", routeCount);
+  }
+  return &routeHandler;
+}
+
+const route::Route *route::find(const char *path,
+                                WebRequestMethodComposite method) {
+  return lookup(path, method);
+}
+
+size_t route::count() { return routeCount; }
+
+const route::Route &route::at(size_t index) { return routes[index]; }
+
+uint32_t route::latencyBound(int bucket) {
+  return bucket < LATENCY_BUCKETS - 1 ? LATENCY_BOUNDS[bucket] : UINT32_MAX;
+}
+
+const char *route::methodName(WebRequestMethodComposite method) {
+  switch (method) {
+  case HTTP_GET:
+    return "GET";
+  case HTTP_POST:
+    return "POST";
+  case HTTP_DELETE:
+    return "DELETE";
+  case HTTP_PUT:
+    return "PUT";
+  case HTTP_PATCH:
+    return "PATCH";
+  case HTTP_HEAD:
+    return "HEAD";
+  case HTTP_OPTIONS:
+    return "OPTIONS";
+  default:
+    return "ANY";
+  }
+}
@@ -4,7 +4,6 @@
 #include <iomanip>
 #include <sstream>
 #include <string>
-#include <vector>
 
 #include "common.h"
 #include "macro_def.h"
@@ -52,19 +51,20 @@ bool utils::isPluggedUSB(void) {
   return (*aa - first) != 0;
 }
 
-std::vector<std::string> utils::split(std::string &s,
-                                      const std::string &delimiter) {
-  std::vector<std::string> tokens;
-  size_t pos = 0;
-  std::string token;
-  while ((pos = s.find(delimiter)) != std::string::npos) {
-    token = s.substr(0, pos);
-    tokens.push_back(token);
-    s.erase(0, pos + delimiter.length());
+size_t utils::split(char *s, char delimiter, char **tokens,
+                    size_t maxTokens) {
+  if (maxTokens == 0) {
+    return 0;
   }
-  tokens.push_back(s);
-
-  return tokens;
+  size_t count = 0;
+  tokens[count++] = s;
+  for (char *p = s; *p && count < maxTokens; p++) {
+    if (*p == delimiter) {
+      *p = '\0';
+      tokens[count++] = p + 1;
+    }
+  }
+  return count;
 }
 
 /// https://johnnyqian.net/blog/gps-locator.html
@@ -131,6 +131,56 @@ double utils::complexDistance(double lat1, double lon1, double lat2,
   return 2 * EARTH_RADIUS * atan2(sqrt(a), sqrt(1 - a));
 }
 
+float utils::calculateBearingF(float lat1, float lon1, float lat2,
+                              float lon2) {
+  const float toRad = (float)(PI / 180.0);
+  float radLat1 = lat1 * toRad;
+  float radLat2 = lat2 * toRad;
+  float deltaLon = (lon2 - lon1) * toRad;
+  float halfSin = sinf(deltaLon / 2);
+  float cosLat2 = cosf(radLat2);
+
+  float numerator = sinf(deltaLon) * cosLat2;
+  // 先对角度做差再转弧度, 两个浮点坐标相减是精确的
+  float denominator = sinf((lat2 - lat1) * toRad) +
+                      2 * sinf(radLat1) * cosLat2 * halfSin * halfSin;
+  if (numerator == 0 && denominator == 0) {
+    return 0;
+  }
+  float result = atan2f(numerator, denominator) * (float)(180.0 / PI);
+  if (result < 0) {
+    result += 360.0f;
+  }
+  return result;
+}
+
+void utils::NavigationCache::update(const mcompass::Location &from,
+                                    const mcompass::Location &to) {
+  if (m_valid && from.latitude == m_fromLat && from.longitude == m_fromLon &&
+      to.latitude == m_toLat && to.longitude == m_toLon) {
+    return;
+  }
+  m_fromLat = from.latitude;
+  m_fromLon = from.longitude;
+  m_toLat = to.latitude;
+  m_toLon = to.longitude;
+  m_bearing = calculateBearingF(m_fromLat, m_fromLon, m_toLat, m_toLon);
+  m_distance = complexDistance(m_fromLat, m_fromLon, m_toLat, m_toLon);
+  m_valid = true;
+}
+
+float utils::NavigationCache::bearing(const mcompass::Location &from,
+                                      const mcompass::Location &to) {
+  update(from, to);
+  return m_bearing;
+}
+
+float utils::NavigationCache::distance(const mcompass::Location &from,
+                                       const mcompass::Location &to) {
+  update(from, to);
+  return m_distance;
+}
+
 double utils::simplifiedDistance(double lat1, double lon1, double lat2,
                                  double lon2) {
   double avgLat = toRadians(lat1 + lat2) / 2.0;
@@ -140,36 +190,26 @@ double utils::simplifiedDistance(double lat1, double lon1, double lat2,
   return sqrt(disLat * disLat + disLon * disLon);
 }
 
-std::string utils::workType2Str(mcompass::WorkType workType) {
-  std::string workTypeStr;
+const char *utils::workType2Str(mcompass::WorkType workType) {
   switch (workType) {
   case mcompass::WorkType::SPAWN:
-    workTypeStr = "Spawn";
-    break;
+    return "Spawn";
   case mcompass::WorkType::SOUTH:
-    workTypeStr = "South";
-    break;
+    return "South";
   default:
-    workTypeStr = "Unknown";
-    break;
+    return "Unknown";
   }
-  return workTypeStr.c_str();
 }
 
-std::string utils::sensorModel2Str(mcompass::SensorModel model) {
-  std::string sensorModel2Str;
+const char *utils::sensorModel2Str(mcompass::SensorModel model) {
   switch (model) {
   case mcompass::SensorModel::QMC5883L:
-    sensorModel2Str = "QMC5883L";
-    break;
+    return "QMC5883L";
   case mcompass::SensorModel::QMC5883P:
-    sensorModel2Str = "QMC5883P";
-    break;
+    return "QMC5883P";
   case mcompass::SensorModel::MMC5883MA:
-    sensorModel2Str = "MMC5883MA";
-    break;
+    return "MMC5883MA";
   default:
-    sensorModel2Str = "Unknown";
+    return "Unknown";
   }
-  return sensorModel2Str;
-}
\ No newline at end of file
+}
@@ -0,0 +1,359 @@
+#include <esp_log.h>
+#include <math.h>
+
+#include "context.h"
+#include "gps_def.h"
+#include "preference_def.h"
+#include "waypoint_def.h"
+
+using namespace mcompass;
+
+static const char *TAG = "Waypoint";
+
+// NVS中航点表的格式版本
+#define WAYPOINT_BLOB_VERSION 1
+
+/// @brief ECEF单位向量
+struct Vector3 {
+  float x, y, z;
+};
+
+/// @brief NVS中保存的航点表, 只保存 count 条记录
+struct WaypointBlob {
+  uint8_t version;
+  uint8_t count;
+  int8_t selection;
+  uint8_t reserved;
+  waypoint::Waypoint waypoints[WAYPOINT_MAX];
+};
+
+static Context *ctx;
+static waypoint::Waypoint waypoints[WAYPOINT_MAX];
+// 与 waypoints 一一对应的单位向量
+static Vector3 vectors[WAYPOINT_MAX];
+static size_t waypointCount = 0;
+static int selection = waypoint::SELECT_SPAWN;
+static int active = -1;
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief 坐标转换为单位向量
+ *
+ * 只在添加航点和每次查询时各算一次, 用双精度换算弧度和三角函数:
+ * 单精度的弧度在经度100多度时分辨率约1.5米, 存为单精度后约0.2米
+ */
+static Vector3 toVector(const Location &location) {
+  double lat = location.latitude * (M_PI / 180.0);
+  double lon = location.longitude * (M_PI / 180.0);
+  double cosLat = cos(lat);
+  return {(float)(cosLat * cos(lon)), (float)(cosLat * sin(lon)),
+          (float)sin(lat)};
+}
+
+static float dot(const Vector3 &a, const Vector3 &b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static Vector3 cross(const Vector3 &a, const Vector3 &b) {
+  return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+static void sanitizeName(char *dest, const char *name) {
+  size_t i = 0;
+  for (; name[i] && i < WAYPOINT_NAME_LENGTH - 1; i++) {
+    char c = name[i];
+    dest[i] = (c < 0x20 || c > 0x7e || c == '"' || c == '\\' || c == ',')
+                  ? '_'
+                  : c;
+  }
+  dest[i] = '\0';
+}
+
+/**
+ * @brief 在锁内按名称查找航点
+ */
+static int findLocked(const char *name) {
+  for (size_t i = 0; i < waypointCount; i++) {
+    if (strncmp(waypoints[i].name, name, WAYPOINT_NAME_LENGTH) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief 在锁内查找最近的航点
+ *
+ * 按弦长的平方 |p-q|^2 排序, 它随球面距离单调增加. 不能比较点积:
+ * 点积接近1时单精度的分辨率约为6e-8, 相当于2公里的弧长, 几公里内的航点
+ * 无法区分; 先做差再平方在近距离仍有米级分辨率
+ */
+static int nearestLocked(const Vector3 &from) {
+  int index = -1;
+  // 单位球上弦长的平方不超过4
+  float best = 5.0f;
+  for (size_t i = 0; i < waypointCount; i++) {
+    Vector3 d = {from.x - vectors[i].x, from.y - vectors[i].y,
+                 from.z - vectors[i].z};
+    float chord = dot(d, d);
+    if (chord < best) {
+      best = chord;
+      index = i;
+    }
+  }
+  return index;
+}
+
+/**
+ * @brief 保存航点表, 所有航点作为一个blob写入
+ */
+static void save() {
+  static WaypointBlob blob;
+  portENTER_CRITICAL(&mux);
+  blob.version = WAYPOINT_BLOB_VERSION;
+  blob.count = waypointCount;
+  blob.selection = selection;
+  blob.reserved = 0;
+  memcpy(blob.waypoints, waypoints, sizeof(waypoint::Waypoint) * waypointCount);
+  portEXIT_CRITICAL(&mux);
+  size_t length = offsetof(WaypointBlob, waypoints) +
+                  sizeof(waypoint::Waypoint) * blob.count;
+  preference::saveWaypoints(&blob, length);
+}
+
+/**
+ * @brief 切换目标, 目标变化时更新 Context 的出生点
+ */
+static void applyTarget(int index) {
+  Location target;
+  portENTER_CRITICAL(&mux);
+  bool changed = index != active;
+  active = index;
+  if (index >= 0) {
+    target = waypoints[index].location;
+  }
+  portEXIT_CRITICAL(&mux);
+  if (index < 0) {
+    if (changed) {
+      // 恢复原有的出生点
+      preference::getSpawnLocation(target);
+      ctx->setSpawnLocation(target);
+    }
+    return;
+  }
+  ctx->setSpawnLocation(target);
+  if (changed) {
+    ESP_LOGI(TAG, "Target waypoint %d {%.6f,%.6f}", index, target.latitude,
+             target.longitude);
+  }
+}
+
+void waypoint::init(Context *context) {
+  ctx = context;
+  static WaypointBlob blob;
+  size_t length = preference::getWaypoints(&blob, sizeof(blob));
+  if (length < offsetof(WaypointBlob, waypoints) ||
+      blob.version != WAYPOINT_BLOB_VERSION || blob.count > WAYPOINT_MAX ||
+      length != offsetof(WaypointBlob, waypoints) +
+                    sizeof(waypoint::Waypoint) * blob.count) {
+    if (length > 0) {
+      ESP_LOGW(TAG, "Invalid waypoint blob, length=%u", length);
+    }
+    return;
+  }
+  portENTER_CRITICAL(&mux);
+  waypointCount = blob.count;
+  for (size_t i = 0; i < waypointCount; i++) {
+    waypoints[i] = blob.waypoints[i];
+    waypoints[i].name[WAYPOINT_NAME_LENGTH - 1] = '\0';
+    vectors[i] = toVector(waypoints[i].location);
+  }
+  selection = blob.selection;
+  if (selection >= (int)waypointCount || selection < SELECT_NEAREST) {
+    selection = SELECT_SPAWN;
+  }
+  portEXIT_CRITICAL(&mux);
+  ESP_LOGI(TAG, "Loaded %u waypoints, selection=%d", waypointCount, selection);
+  if (selection >= 0) {
+    applyTarget(selection);
+  }
+}
+
+size_t waypoint::count() {
+  portENTER_CRITICAL(&mux);
+  size_t result = waypointCount;
+  portEXIT_CRITICAL(&mux);
+  return result;
+}
+
+bool waypoint::get(size_t index, Waypoint &waypoint) {
+  portENTER_CRITICAL(&mux);
+  bool valid = index < waypointCount;
+  if (valid) {
+    waypoint = waypoints[index];
+  }
+  portEXIT_CRITICAL(&mux);
+  return valid;
+}
+
+int waypoint::add(const char *name, const Location &location) {
+  if (!gps::isValidGPSLocation(location)) {
+    return -1;
+  }
+  char sanitized[WAYPOINT_NAME_LENGTH];
+  sanitizeName(sanitized, name);
+  Vector3 vector = toVector(location);
+  // 查重和插入在同一次加锁中完成, 否则同名的两次添加可能都插入新项
+  portENTER_CRITICAL(&mux);
+  int index = findLocked(sanitized);
+  if (index < 0 && waypointCount < WAYPOINT_MAX) {
+    index = waypointCount++;
+  }
+  if (index >= 0) {
+    memcpy(waypoints[index].name, sanitized, sizeof(sanitized));
+    waypoints[index].location = location;
+    vectors[index] = vector;
+  }
+  int currentSelection = selection;
+  portEXIT_CRITICAL(&mux);
+  if (index < 0) {
+    return -1;
+  }
+  save();
+  if (currentSelection == index) {
+    applyTarget(index);
+  }
+  ESP_LOGI(TAG, "Waypoint %d %s {%.6f,%.6f}", index, sanitized,
+           location.latitude, location.longitude);
+  return index;
+}
+
+bool waypoint::remove(size_t index) {
+  portENTER_CRITICAL(&mux);
+  if (index >= waypointCount) {
+    portEXIT_CRITICAL(&mux);
+    return false;
+  }
+  for (size_t i = index; i + 1 < waypointCount; i++) {
+    waypoints[i] = waypoints[i + 1];
+    vectors[i] = vectors[i + 1];
+  }
+  waypointCount--;
+  // 删除的是选中的航点时退回出生点, 之后的序号前移
+  if (selection == (int)index) {
+    selection = SELECT_SPAWN;
+  } else if (selection > (int)index) {
+    selection--;
+  }
+  if (active == (int)index) {
+    active = -2;
+  } else if (active > (int)index) {
+    active--;
+  }
+  int currentSelection = selection;
+  portEXIT_CRITICAL(&mux);
+  save();
+  if (currentSelection == SELECT_SPAWN) {
+    applyTarget(-1);
+  }
+  return true;
+}
+
+int waypoint::find(const char *name) {
+  portENTER_CRITICAL(&mux);
+  int index = findLocked(name);
+  portEXIT_CRITICAL(&mux);
+  return index;
+}
+
+bool waypoint::select(int newSelection) {
+  portENTER_CRITICAL(&mux);
+  bool valid = newSelection >= SELECT_NEAREST &&
+               newSelection < (int)waypointCount;
+  bool changed = valid && newSelection != selection;
+  if (valid) {
+    selection = newSelection;
+  }
+  portEXIT_CRITICAL(&mux);
+  if (!valid) {
+    return false;
+  }
+  // 选择没有变化时不写NVS
+  if (changed) {
+    save();
+  }
+  if (newSelection == SELECT_NEAREST) {
+    update(ctx->getCurrentLocation());
+  } else {
+    applyTarget(newSelection);
+  }
+  return true;
+}
+
+int waypoint::getSelection() {
+  portENTER_CRITICAL(&mux);
+  int result = selection;
+  portEXIT_CRITICAL(&mux);
+  return result;
+}
+
+int waypoint::getActive() {
+  portENTER_CRITICAL(&mux);
+  int result = active < 0 ? -1 : active;
+  portEXIT_CRITICAL(&mux);
+  return result;
+}
+
+int waypoint::nearest(const Location &from) {
+  Vector3 vector = toVector(from);
+  portENTER_CRITICAL(&mux);
+  int index = nearestLocked(vector);
+  portEXIT_CRITICAL(&mux);
+  return index;
+}
+
+bool waypoint::navigate(const Location &from, size_t index, float &bearing,
+                        float &distance) {
+  Vector3 p = toVector(from);
+  Vector3 q;
+  portENTER_CRITICAL(&mux);
+  bool valid = index < waypointCount;
+  if (valid) {
+    q = vectors[index];
+  }
+  portEXIT_CRITICAL(&mux);
+  if (!valid) {
+    return false;
+  }
+  // 球面夹角 = atan2(|p×q|, p·q)
+  Vector3 c = cross(p, q);
+  float angle = atan2f(sqrtf(dot(c, c)), dot(p, q));
+  distance = angle * EARTH_RADIUS;
+  // 在当前位置的东/北方向上投影目标向量
+  float cosLat = sqrtf(p.x * p.x + p.y * p.y);
+  if (cosLat < 1e-6f) {
+    // 极点处没有东/北方向
+    bearing = 0;
+    return true;
+  }
+  float cosLon = p.x / cosLat;
+  float sinLon = p.y / cosLat;
+  float east = -sinLon * q.x + cosLon * q.y;
+  float north = -p.z * cosLon * q.x - p.z * sinLon * q.y + cosLat * q.z;
+  bearing = atan2f(east, north) * (float)(180.0 / M_PI);
+  if (bearing < 0) {
+    bearing += 360.0f;
+  }
+  return true;
+}
+
+void waypoint::update(const Location &current) {
+  int currentSelection = getSelection();
+  if (currentSelection != SELECT_NEAREST) {
+    return;
+  }
+  if (!gps::isValidGPSLocation(current)) {
+    return;
+  }
+  applyTarget(nearest(current));
+}
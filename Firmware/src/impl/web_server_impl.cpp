@@ -1,4 +1,5 @@
 #include <AsyncTCP.h>
+#include <AsyncUDP.h>
 #include <ESPAsyncWebServer.h>
 #include <ESPmDNS.h>
 #include <FS.h>
@@ -9,21 +10,618 @@
 #include <esp_event.h>
 #include <esp_wifi.h>
 
+#include <atomic>
+
+#include "alloc_tracker.h"
 #include "board.h"
 #include "context.h"
+#include "route_def.h"
 
 using namespace mcompass;
 
 static AsyncWebServer server(80);
+// 方位角推送通道, 代替逐帧的 POST /setAzimuth
+static AsyncWebSocket ws("/ws");
+// 实时遥测, 代替网页轮询
+static AsyncEventSource events("/events");
+static esp_timer_handle_t eventsTimer = nullptr;
+// 已交给 async_tcp 任务但还没有执行的推送, 任务繁忙时合并为一次
+static std::atomic<bool> eventsPushQueued{false};
+// 实时流(WebSocket 和 SSE)客户端数量, 在 async_tcp 任务中维护,
+// 其他任务读取时不必遍历库中的客户端链表
+static std::atomic<uint32_t> streamClients{0};
+// 无人使用时关闭WiFi
+static esp_timer_handle_t wifiDisableTimer = nullptr;
+// 低延迟方位角通道, 不经过TCP和HTTP解析
+static AsyncUDP udp;
+static uint32_t eventsId = 0;
+// 最近一次推送的配置, 变化时才推送
+static utils::FixedString<256> lastConfig;
 const char *PARAM_MESSAGE = "message";
+// 之前使用的 text/json 不是标准类型
+static const char *JSON_CONTENT_TYPE = "application/json";
 const char *TAG = "WEBServer";
 
 // 是否有客户端进行连接, 1分钟没有客户端连接关闭Server
 static bool clientConnected = false;
 // 网页服务工作状态
 static bool serverEnable = false;
+// 网页资源来自资源包, 不需要挂载 LittleFS
+static bool assetBundled = false;
 static Context *ctx = nullptr;
 
+// WebSocket方位角统计, 每个客户端一份, 只在 async_tcp 任务中访问.
+// 新连接在 cleanupClients 关闭最老的连接之前就已加入, 所以多留一个位置
+struct WsClientStats {
+  uint32_t id; // 客户端ID, 0表示空闲
+  uint32_t received;
+  uint32_t lost;
+  uint16_t lastSequence;
+  uint32_t lastTelemetryMs;
+};
+static WsClientStats wsClients[WEB_SOCKET_MAX_CLIENTS + 1];
+
+/**
+ * @brief 查找客户端的统计, 不存在时返回 nullptr
+ */
+static WsClientStats *findWsClient(uint32_t id) {
+  for (WsClientStats &stats : wsClients) {
+    if (stats.id == id) {
+      return &stats;
+    }
+  }
+  return nullptr;
+}
+
+// UDP方位角状态, 只在 async_udp 任务中修改
+static uint32_t udpReceived = 0;
+static uint32_t udpDropped = 0;
+static uint16_t udpLastSequence = 0;
+static uint32_t udpLastMs = 0;
+static uint32_t udpLastColor = 0;
+// 等待生效的指针颜色, 高8位为 UDP_FLAG_COLOR 时有效, 在 event_loop 任务中取走,
+// LED 只在 event_loop 中刷新
+static std::atomic<uint32_t> udpPendingColor{0};
+// 等待LED刷新后回送的包, 在 event_loop 任务中取走
+static portMUX_TYPE udpEchoMux = portMUX_INITIALIZER_UNLOCKED;
+static bool udpEchoPending = false;
+static web_server::UdpAzimuthPacket udpEchoPacket;
+static IPAddress udpEchoAddress;
+static uint16_t udpEchoPort = 0;
+
+/**
+ * @brief 处理一个方位角帧, 按间隔回送遥测帧
+ */
+static void onAzimuthFrame(AsyncWebSocketClient *client,
+                           const web_server::AzimuthFrame &frame) {
+  WsClientStats *stats = findWsClient(client->id());
+  if (frame.angleX100 >= 36000 || !stats) {
+    return;
+  }
+  // 序号回绕后差值仍然正确, 乱序或重复的帧不计入丢帧
+  uint16_t gap = frame.sequence - stats->lastSequence;
+  if (stats->received > 0 && gap > 1 && gap < 0x8000) {
+    stats->lost += gap - 1;
+  }
+  stats->lastSequence = frame.sequence;
+  stats->received++;
+  // 超过限速的帧直接丢弃, 遥测照常回送
+  ingest::submit(ingest::WEB_SOCKET, (frame.angleX100 + 50) / 100 % 360);
+
+  uint32_t now = millis();
+  if (now - stats->lastTelemetryMs < WEB_SOCKET_TELEMETRY_INTERVAL ||
+      !client->canSend()) {
+    return;
+  }
+  stats->lastTelemetryMs = now;
+  web_server::TelemetryFrame telemetry = {
+      .type = web_server::FRAME_TELEMETRY,
+      .flags = (uint8_t)(ctx->getIsGPSFixed() ? 1 : 0),
+      .sequence = frame.sequence,
+      .timestampMs = frame.timestampMs,
+      .received = stats->received,
+      .lost = stats->lost,
+      .azimuth = (uint16_t)ctx->getAzimuth(),
+      .freeHeap = esp_get_free_heap_size(),
+  };
+  client->binary((uint8_t *)&telemetry, sizeof(telemetry));
+}
+
+static void onWebSocketEvent(AsyncWebSocket *server,
+                             AsyncWebSocketClient *client, AwsEventType type,
+                             void *arg, uint8_t *data, size_t len) {
+  switch (type) {
+  case WS_EVT_CONNECT: {
+    clientConnected = true;
+    ESP_LOGI(TAG, "WebSocket client #%u connected from %s", client->id(),
+             client->remoteIP().toString().c_str());
+    streamClients++;
+    WsClientStats *stats = findWsClient(0);
+    if (stats) {
+      *stats = {client->id(), 0, 0, 0, 0};
+    }
+    ws.cleanupClients(WEB_SOCKET_MAX_CLIENTS);
+    break;
+  }
+  case WS_EVT_DISCONNECT: {
+    streamClients--;
+    WsClientStats *stats = findWsClient(client->id());
+    if (stats) {
+      ESP_LOGI(TAG, "WebSocket client #%u disconnected, %u frames, %u lost",
+               client->id(), stats->received, stats->lost);
+      *stats = {};
+    }
+    break;
+  }
+  case WS_EVT_DATA: {
+    // 只接受单个完整的二进制帧
+    AwsFrameInfo *info = static_cast<AwsFrameInfo *>(arg);
+    if (!info->final || info->index != 0 || info->len != len ||
+        info->opcode != WS_BINARY || len != sizeof(web_server::AzimuthFrame) ||
+        data[0] != web_server::FRAME_AZIMUTH) {
+      ESP_LOGD(TAG, "Ignore WebSocket frame, opcode %u, %u bytes",
+               info->opcode, len);
+      return;
+    }
+    web_server::AzimuthFrame frame;
+    memcpy(&frame, data, sizeof(frame));
+    onAzimuthFrame(client, frame);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief 处理一个UDP方位角包
+ *
+ * 只保留最新的值: 序号不比上一个新的包直接丢弃, 通过邮箱投递的方位角
+ * 在 event_loop 取走之前会被后来的包覆盖
+ */
+static void onUdpPacket(AsyncUDPPacket &packet) {
+  if (packet.length() != sizeof(web_server::UdpAzimuthPacket)) {
+    return;
+  }
+  web_server::UdpAzimuthPacket frame;
+  memcpy(&frame, packet.data(), sizeof(frame));
+  if (frame.angleX100 >= 36000) {
+    return;
+  }
+  uint32_t now = millis();
+  // 序号回绕后差值仍然正确; 长时间没有收到包时认为发送端重启过
+  int16_t delta = (int16_t)(frame.sequence - udpLastSequence);
+  if (udpReceived > 0 && delta <= 0 &&
+      now - udpLastMs < UDP_AZIMUTH_RESYNC_INTERVAL) {
+    udpDropped++;
+    return;
+  }
+  udpLastSequence = frame.sequence;
+  udpLastMs = now;
+  udpReceived++;
+  net_power::notifyStream();
+
+  uint8_t flags = frame.color >> 24;
+  if ((flags & web_server::UDP_FLAG_COLOR) &&
+      (frame.color & 0xFFFFFF) != udpLastColor) {
+    udpLastColor = frame.color & 0xFFFFFF;
+    udpPendingColor =
+        (uint32_t)web_server::UDP_FLAG_COLOR << 24 | udpLastColor;
+  }
+  bool echo = flags & web_server::UDP_FLAG_ECHO;
+  IPAddress address = echo ? packet.remoteIP() : IPAddress();
+  uint16_t port = echo ? packet.remotePort() : 0;
+  portENTER_CRITICAL(&udpEchoMux);
+  udpEchoPending = echo;
+  if (echo) {
+    udpEchoPacket = frame;
+    udpEchoAddress = address;
+    udpEchoPort = port;
+  }
+  portEXIT_CRITICAL(&udpEchoMux);
+
+  if (ingest::submit(ingest::UDP, (frame.angleX100 + 50) / 100 % 360) ==
+      ingest::REJECTED) {
+    // 被限速丢弃的包不会刷新LED, 也就不回送
+    portENTER_CRITICAL(&udpEchoMux);
+    udpEchoPending = false;
+    portEXIT_CRITICAL(&udpEchoMux);
+  }
+}
+
+static void startUdp() {
+  if (!udp.listen(UDP_AZIMUTH_PORT)) {
+    ESP_LOGE(TAG, "Failed to listen UDP port %d", UDP_AZIMUTH_PORT);
+    return;
+  }
+  udpReceived = 0;
+  udpDropped = 0;
+  udpLastColor = 0;
+  udp.onPacket(onUdpPacket);
+  // 客户端通过 _mcompass._udp 发现端口和包格式
+  MDNS.addService("mcompass", "udp", UDP_AZIMUTH_PORT);
+  MDNS.addServiceTxt("mcompass", "udp", "proto", "azimuth8");
+  MDNS.addServiceTxt("mcompass", "udp", "version", "1");
+  ESP_LOGI(TAG, "UDP azimuth listening on %d", UDP_AZIMUTH_PORT);
+}
+
+void web_server::applyPendingColor() {
+  uint32_t color = udpPendingColor.exchange(0);
+  if (color >> 24 == web_server::UDP_FLAG_COLOR) {
+    pixel::setPointerColor(color & 0xFFFFFF);
+  }
+}
+
+void web_server::onAzimuthShown() {
+  portENTER_CRITICAL(&udpEchoMux);
+  bool pending = udpEchoPending;
+  web_server::UdpAzimuthPacket frame = udpEchoPacket;
+  IPAddress address = udpEchoAddress;
+  uint16_t port = udpEchoPort;
+  udpEchoPending = false;
+  portEXIT_CRITICAL(&udpEchoMux);
+  if (pending) {
+    udp.writeTo((uint8_t *)&frame, sizeof(frame), address, port);
+  }
+}
+
+/**
+ * @brief 按资源清单提供静态文件
+ *
+ * 资源来自 webui 分区的资源包, 没有资源包时来自 LittleFS.
+ * 查找只访问内存中的清单, 命中 If-None-Match 时直接返回304, 不打开文件;
+ * 带内容哈希的 _next/static 文件允许浏览器永久缓存.
+ * 清单中没有的路径交给后面的 serveStatic 处理
+ */
+class AssetHandler : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) override {
+    if (request->method() != HTTP_GET) {
+      return false;
+    }
+    char path[ASSET_PATH_MAX];
+    if (!resolve(request->url(), path)) {
+      return false;
+    }
+    request->addInterestingHeader("If-None-Match");
+    return true;
+  }
+
+  void handleRequest(AsyncWebServerRequest *request) override {
+    clientConnected = true;
+    char path[ASSET_PATH_MAX];
+    const asset::Entry *entry = resolve(request->url(), path);
+    if (!entry) {
+      request->send(404);
+      return;
+    }
+    const char *cacheControl = entry->immutable
+                                   ? "public, max-age=31536000, immutable"
+                                   : "no-cache";
+    AsyncWebView ifNoneMatch = request->headerView("If-None-Match");
+    if (ifNoneMatch.equals("*") || strstr(ifNoneMatch.c_str(), entry->etag)) {
+      AsyncWebServerResponse *response = request->beginResponse(304);
+      response->addHeader("ETag", entry->etag);
+      response->addHeader("Cache-Control", cacheControl);
+      request->send(response);
+      return;
+    }
+    AsyncWebServerResponse *response;
+    if (entry->data) {
+      // 资源包中的内容直接从映射的flash拷贝到发送缓冲区
+      response = request->beginResponse_P(200, entry->contentType, entry->data,
+                                          entry->size);
+      if (entry->gzip) {
+        response->addHeader("Content-Encoding", "gzip");
+      }
+    } else {
+      File file = LittleFS.open(entry->file, "r");
+      if (!file) {
+        request->send(404);
+        return;
+      }
+      // 文件名以 .gz 结尾时 AsyncFileResponse 会自动加上 Content-Encoding
+      response = request->beginResponse(file, entry->path, entry->contentType);
+    }
+    response->addHeader("ETag", entry->etag);
+    response->addHeader("Cache-Control", cacheControl);
+    request->send(response);
+  }
+
+private:
+  /**
+   * @brief 请求路径映射到资源: 目录取 index.html, 无扩展名的页面补 .html
+   */
+  static const asset::Entry *resolve(const String &url,
+                                     char (&path)[ASSET_PATH_MAX]) {
+    const char *suffix = url.endsWith("/") ? "index.html" : "";
+    if (url.length() + strlen(suffix) >= ASSET_PATH_MAX) {
+      return nullptr;
+    }
+    snprintf(path, ASSET_PATH_MAX, "%s%s", url.c_str(), suffix);
+    const asset::Entry *entry = asset::find(path);
+    if (entry || suffix[0] || url.length() + 5 >= ASSET_PATH_MAX) {
+      return entry;
+    }
+    strcat(path, ".html");
+    return asset::find(path);
+  }
+};
+
+static AssetHandler assetHandler;
+
+/**
+ * @brief 当前配置JSON
+ */
+static void configJson(utils::FixedString<256> &json) {
+  PointerColor color = ctx->getColor();
+  Location spawn = ctx->getSpawnLocation();
+  json.clear();
+  json.appendf("{\"brightness\":%u,\"spawnColor\":\"#%06X\","
+               "\"southColor\":\"#%06X\",\"spawn\":{\"latitude\":%.6f,"
+               "\"longitude\":%.6f},\"waypoint\":%d,\"serverMode\":%d,"
+               "\"model\":%d}",
+               ctx->getBrightness(), color.spawnColor & 0xFFFFFF,
+               color.southColor & 0xFFFFFF, spawn.latitude, spawn.longitude,
+               waypoint::getSelection(),
+               ctx->getServerMode() == ServerMode::BLE ? 1 : 0,
+               ctx->isGPSModel() ? 1 : 0);
+}
+
+/**
+ * @brief 遥测JSON: 方位角, GPS, 堆和栈水位, 传感器状态
+ */
+static void telemetryJson(utils::FixedString<512> &json) {
+  Location current = ctx->getCurrentLocation();
+  gps_fix_record_t fix;
+  bool hasFix = gps::getLatestFix(&fix);
+  monitor::HeapStats heap = monitor::getHeapStats();
+  json.clear();
+  json.appendf("{\"azimuth\":%d,\"workType\":%d,", ctx->getAzimuth(),
+               static_cast<int>(ctx->getWorkType()));
+  json.appendf("\"gps\":{\"detected\":%d,\"fixed\":%d,\"arrived\":%d,"
+               "\"latitude\":%.6f,\"longitude\":%.6f,\"sats\":%u,"
+               "\"hdop\":%.2f},",
+               ctx->getDetectGPS() ? 1 : 0, ctx->getIsGPSFixed() ? 1 : 0,
+               position_filter::isArrived() ? 1 : 0, current.latitude,
+               current.longitude, hasFix ? fix.sats_in_use : 0,
+               hasFix ? fix.hdop_x100 / 100.0 : 0.0);
+  json.appendf("\"heap\":{\"free\":%u,\"minFree\":%u,\"largest\":%u,"
+               "\"fragmentation\":%u},",
+               heap.freeBytes, heap.minFreeBytes, heap.largestBlock,
+               heap.fragmentation);
+  json.appendf("\"stack\":{\"event_loop\":%u,\"async_tcp\":%u},",
+               monitor::getMinFreeStack("event_loop"),
+               monitor::getMinFreeStack("async_tcp"));
+  json.appendf("\"sensor\":{\"available\":%d,\"model\":\"%s\"},"
+               "\"clients\":%u}",
+               ctx->getHasSensor() ? 1 : 0,
+               utils::sensorModel2Str(ctx->getSensorModel()), events.count());
+}
+
+/**
+ * @brief 推送遥测, 配置变化时额外推送配置, 运行在 async_tcp 任务中
+ *
+ * 使用 try_send, 某个客户端队列已满时只丢弃发给它的这一条,
+ * 不影响其他客户端; 每条遥测都是完整快照, 丢弃不会造成状态不一致.
+ * AsyncEventSource 的客户端链表和消息队列没有锁, 由 async_tcp 任务在
+ * 断开和确认时修改, 只能在同一个任务中访问.
+ */
+static void pushEvents(void *arg) {
+  eventsPushQueued = false;
+  if (events.count() == 0) {
+    return;
+  }
+  utils::FixedString<256> config;
+  configJson(config);
+  if (strcmp(config.c_str(), lastConfig.c_str()) != 0) {
+    events.try_send(config.c_str(), "config", ++eventsId);
+    lastConfig.clear();
+    lastConfig.append(config.c_str());
+  }
+  utils::FixedString<512> telemetry;
+  telemetryJson(telemetry);
+  events.try_send(telemetry.c_str(), "telemetry", ++eventsId);
+}
+
+static void startEvents(uint32_t intervalMs) {
+  if (!eventsTimer) {
+    esp_timer_create_args_t eventsTimerArgs = {
+        .callback =
+            [](void *arg) {
+              // 定时器只负责把推送交给 async_tcp 任务
+              if (streamClients == 0 || eventsPushQueued.exchange(true)) {
+                return;
+              }
+              if (!asyncTcpCall(pushEvents, nullptr)) {
+                eventsPushQueued = false;
+              }
+            },
+        .arg = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "eventsTimer",
+        .skip_unhandled_events = true};
+    ESP_ERROR_CHECK(esp_timer_create(&eventsTimerArgs, &eventsTimer));
+  }
+  esp_timer_stop(eventsTimer);
+  ESP_ERROR_CHECK(
+      esp_timer_start_periodic(eventsTimer, (uint64_t)intervalMs * 1000));
+}
+
+/**
+ * @brief 写入航点表, GPS定位有效时附带方位角和距离
+ */
+template <typename Output>
+static void writeWaypoints(utils::JsonWriter<Output> &json) {
+  Location current = ctx->getCurrentLocation();
+  bool fixed = ctx->getIsGPSFixed() && gps::isValidGPSLocation(current);
+  json.beginArray("waypoints");
+  waypoint::Waypoint item;
+  for (size_t i = 0; waypoint::get(i, item); i++) {
+    json.beginObject()
+        .field("name", item.name)
+        .field("latitude", item.location.latitude, 6)
+        .field("longitude", item.location.longitude, 6);
+    float bearing, distance;
+    if (fixed && waypoint::navigate(current, i, bearing, distance)) {
+      json.field("bearing", bearing, 1).field("distance", distance, 3);
+    }
+    json.endObject();
+  }
+  json.endArray();
+}
+
+/// @brief /state 使用的状态快照, 计算ETag和发送内容两次写入结果一致
+struct StateSnapshot {
+  PointerColor color;
+  Location spawn;
+  Location current;
+  uint8_t brightness;
+  int azimuth;
+  int workType;
+  int selection;
+  int active;
+  bool gpsModel;
+  bool bleMode;
+  bool detectGPS;
+  bool gpsFixed;
+  bool arrived;
+  bool hasSensor;
+  SensorModel sensorModel;
+  char ssid[33]; // SSID最长32字节
+};
+
+static void takeSnapshot(StateSnapshot &state) {
+  state.color = ctx->getColor();
+  state.spawn = ctx->getSpawnLocation();
+  state.current = ctx->getCurrentLocation();
+  state.brightness = ctx->getBrightness();
+  state.azimuth = ctx->getAzimuth();
+  state.workType = static_cast<int>(ctx->getWorkType());
+  state.selection = waypoint::getSelection();
+  state.active = waypoint::getActive();
+  state.gpsModel = ctx->isGPSModel();
+  state.bleMode = ctx->getServerMode() == ServerMode::BLE;
+  state.detectGPS = ctx->getDetectGPS();
+  state.gpsFixed = ctx->getIsGPSFixed();
+  state.arrived = position_filter::isArrived();
+  state.hasSensor = ctx->getHasSensor();
+  state.sensorModel = ctx->getSensorModel();
+  strncpy(state.ssid, ctx->getSsid().c_str(), sizeof(state.ssid) - 1);
+  state.ssid[sizeof(state.ssid) - 1] = '\0';
+}
+
+/**
+ * @brief 写入全部设备信息, 配置和状态, 网页加载时一次请求取回
+ */
+template <typename Output>
+static void writeState(utils::JsonWriter<Output> &json,
+                       const StateSnapshot &state) {
+  json.beginObject();
+  json.beginObject("info")
+      .field("buildVersion", BUILD_VERSION)
+      .field("buildDate", __DATE__)
+      .field("buildTime", __TIME__)
+      .field("gitBranch", GIT_BRANCH)
+      .field("gitCommit", GIT_COMMIT)
+      .field("model", state.gpsModel ? 1 : 0)
+      .field("gpsStatus", state.detectGPS ? 1 : 0)
+      .field("sensorStatus", state.hasSensor ? 1 : 0)
+      .field("sensorModel", utils::sensorModel2Str(state.sensorModel))
+      .endObject();
+  json.beginObject("config")
+      .field("brightness", state.brightness)
+      .fieldf("spawnColor", "\"#%06X\"", state.color.spawnColor & 0xFFFFFF)
+      .fieldf("southColor", "\"#%06X\"", state.color.southColor & 0xFFFFFF)
+      .beginObject("spawn")
+      .field("latitude", state.spawn.latitude, 6)
+      .field("longitude", state.spawn.longitude, 6)
+      .endObject()
+      .field("serverMode", state.bleMode ? 1 : 0)
+      .field("ssid", state.ssid)
+      .endObject();
+  json.beginObject("state")
+      .field("azimuth", state.azimuth)
+      .field("workType", state.workType)
+      .beginObject("gps")
+      .field("fixed", state.gpsFixed)
+      .field("arrived", state.arrived)
+      .field("latitude", state.current.latitude, 6)
+      .field("longitude", state.current.longitude, 6)
+      .endObject()
+      .endObject();
+  json.beginObject("waypoint")
+      .field("selected", state.selection)
+      .field("active", state.active);
+  writeWaypoints(json);
+  json.endObject();
+  json.endObject();
+}
+
+/**
+ * @brief GET /state
+ *
+ * 先把JSON写入 HashSink 计算ETag, 这一步不产生堆分配; 命中 If-None-Match
+ * 时返回304, 否则再写入按实际长度分配的 AsyncResponseStream.
+ * 注册路由时要求保留 If-None-Match 请求头
+ */
+static void handleState(AsyncWebServerRequest *request) {
+  clientConnected = true;
+  uint32_t allocations = alloc_tracker::count();
+  StateSnapshot state;
+  takeSnapshot(state);
+  utils::HashSink hash;
+  {
+    ALLOC_GUARD("state_etag");
+    utils::JsonWriter<utils::HashSink> json(hash);
+    writeState(json, state);
+  }
+  char etag[12];
+  snprintf(etag, sizeof(etag), "\"%08x\"", hash.hash());
+  AsyncWebView ifNoneMatch = request->headerView("If-None-Match");
+  AsyncWebServerResponse *response;
+  if (strstr(ifNoneMatch.c_str(), etag)) {
+    response = request->beginResponse(304);
+  } else {
+    AsyncResponseStream *stream =
+        request->beginResponseStream(JSON_CONTENT_TYPE, hash.length());
+    utils::JsonWriter<AsyncResponseStream> json(*stream);
+    writeState(json, state);
+    response = stream;
+  }
+#if defined(MCOMPASS_ALLOC_TRACKER)
+  // 调试固件中回报本次请求生成响应时的堆分配次数
+  char count[12];
+  snprintf(count, sizeof(count), "%u", alloc_tracker::count() - allocations);
+  response->addHeader("X-Allocations", count);
+#else
+  (void)allocations;
+#endif
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+/**
+ * @brief 不处理请求, 只记录网络活动, 深度省电时收到请求立即唤醒
+ *
+ * AsyncWebServer 按注册顺序询问处理器, 所以必须最先注册
+ */
+class ActivityHandler : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) override {
+    net_power::notifyRequest();
+    return false;
+  }
+};
+
+static ActivityHandler activityHandler;
+
+/**
+ * @brief 实时流客户端数量, 有客户端时射频常开
+ */
+static uint32_t streamClientCount() { return streamClients; }
+
 static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                                int32_t event_id, void *event_data) {
   if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
@@ -48,56 +646,60 @@ static void notFound(AsyncWebServerRequest *request) {
   request->send(404, "text/plain", "Not found");
 }
 
+/**
+ * @brief 注册HTTP接口
+ *
+ * JSON 在栈上的 FixedString 中生成, 省去了 String 拼接的反复扩容, 但HTTP请求
+ * 并不是零分配的: request->send 会把内容复制成 String, 响应对象和响应头也在
+ * 堆上. 零分配只针对 传感器->渲染 路径(见 alloc_tracker.h), 调试固件中
+ * /state 的 X-Allocations 响应头给出一次请求的实际分配次数.
+ */
 static void apis(void) {
   // 获取STA模式下本机IP
-  server.on("/ip", HTTP_GET, [](AsyncWebServerRequest *request) {
+  route::add("/ip", HTTP_GET, [](AsyncWebServerRequest *request) {
     clientConnected = true;
     request->send(200, "text/plain", WiFi.localIP().toString());
   });
 
   // 重启设备
-  server.on("/restart", HTTP_POST, [](AsyncWebServerRequest *request) {
+  route::add("/restart", HTTP_POST, [](AsyncWebServerRequest *request) {
     request->send(200, "Bye");
     delay(3000);
     esp_restart();
   });
 
   // 获取设备信息
-  server.on("/info", HTTP_GET, [](AsyncWebServerRequest *request) {
+  route::add("/info", HTTP_GET, [](AsyncWebServerRequest *request) {
     clientConnected = true;
-    String json = "{\"buildDate\":\"" + String(__DATE__) +
-                  "\",\"buildTime\":\"" + String(__TIME__) +
-                  "\",\"buildVersion\":\"" + String(BUILD_VERSION) +
-                  "\",\"gitBranch\":\"" + String(GIT_BRANCH) +
-                  "\",\"gpsStatus\":\"" + (ctx->getDetectGPS() ? "1" : "0") +
-                  "\",\"model\":\"" + (ctx->isGPSModel() ? "1" : "0") +
-                  "\",\"sensorStatus\":\"" + (ctx->getHasSensor() ? "1" : "0") +
-                  "\",\"gitCommit\":\"" + String(GIT_COMMIT) + "\"}";
-    request->send(200, "text/json", json);
+    utils::FixedString<INFO_JSON_CAPACITY> json;
+    ctx->infoJson(json);
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
   });
 
   // 获取目标出生点
-  server.on("/spawn", HTTP_GET, [](AsyncWebServerRequest *request) {
+  route::add("/spawn", HTTP_GET, [](AsyncWebServerRequest *request) {
     clientConnected = true;
     Location location = ctx->getSpawnLocation();
-    request->send(200, "text/json",
-                  "{\"latitude\":\"" + String(location.latitude, 6) +
-                      "\",\"longitude\":\"" + String(location.longitude, 6) +
-                      "\"}");
+    utils::FixedString<64> json;
+    json.appendf("{\"latitude\":\"%.6f\",\"longitude\":\"%.6f\"}",
+                 location.latitude, location.longitude);
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
   });
 
   // 设置目标出生点
-  server.on("/spawn", HTTP_POST, [](AsyncWebServerRequest *request) {
+  route::add("/spawn", HTTP_POST, [](AsyncWebServerRequest *request) {
     clientConnected = true;
-    if (request->hasParam("latitude") && request->hasParam("longitude")) {
-      float latitude = request->getParam("latitude")->value().toFloat();
-      float longitude = request->getParam("longitude")->value().toFloat();
+    AsyncWebView latitude = request->paramView("latitude");
+    AsyncWebView longitude = request->paramView("longitude");
+    if (latitude.valid() && longitude.valid()) {
       Location location;
-      location.latitude = latitude;
-      location.longitude = longitude;
+      location.latitude = latitude.toFloat();
+      location.longitude = longitude.toFloat();
       if (gps::isValidGPSLocation(location)) {
         ctx->setSpawnLocation(location);
         preference::saveSpawnLocation(location);
+        // 设置出生点后不再指向航点
+        waypoint::select(waypoint::SELECT_SPAWN);
         request->send(200);
         return;
       }
@@ -105,17 +707,83 @@ static void apis(void) {
     }
   });
 
+  // 获取航点表, GPS定位有效时附带方位角和距离
+  route::add("/waypoints", HTTP_GET, [](AsyncWebServerRequest *request) {
+    clientConnected = true;
+    AsyncResponseStream *response =
+        request->beginResponseStream(JSON_CONTENT_TYPE);
+    utils::JsonWriter<AsyncResponseStream> json(*response);
+    json.beginObject()
+        .field("selected", waypoint::getSelection())
+        .field("active", waypoint::getActive());
+    writeWaypoints(json);
+    json.endObject();
+    request->send(response);
+  });
+
+  // 添加或更新航点
+  route::add("/waypoints", HTTP_POST, [](AsyncWebServerRequest *request) {
+    clientConnected = true;
+    AsyncWebView name = request->paramView("name");
+    AsyncWebView latitude = request->paramView("latitude");
+    AsyncWebView longitude = request->paramView("longitude");
+    if (!name.valid() || !latitude.valid() || !longitude.valid()) {
+      request->send(400);
+      return;
+    }
+    Location location;
+    location.latitude = latitude.toFloat();
+    location.longitude = longitude.toFloat();
+    int index = waypoint::add(name.c_str(), location);
+    if (index < 0) {
+      request->send(400);
+      return;
+    }
+    utils::FixedString<32> json;
+    json.appendf("{\"index\":%d}", index);
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
+  });
+
+  // 按名称删除航点
+  route::add("/waypoints", HTTP_DELETE, [](AsyncWebServerRequest *request) {
+    clientConnected = true;
+    AsyncWebView name = request->paramView("name");
+    if (!name.valid()) {
+      request->send(400);
+      return;
+    }
+    int index = waypoint::find(name.c_str());
+    if (index < 0) {
+      request->send(404);
+      return;
+    }
+    waypoint::remove(index);
+    request->send(200);
+  });
+
+  // 选择目标: -1 出生点, -2 最近的航点, 其他为航点序号
+  route::add("/selectWaypoint", HTTP_POST, [](AsyncWebServerRequest *request) {
+    clientConnected = true;
+    AsyncWebView index = request->paramView("index");
+    if (index.valid() && waypoint::select(index.toInt())) {
+      request->send(200);
+      return;
+    }
+    request->send(400);
+  });
+
   // 设置指针颜色
-  server.on("/pointColors", HTTP_POST, [](AsyncWebServerRequest *request) {
+  route::add("/pointColors", HTTP_POST, [](AsyncWebServerRequest *request) {
     clientConnected = true;
     ESP_LOGE(TAG, "pointColors!!!!!!!");
     PointerColor pointColor = ctx->getColor();
-    if (request->hasParam("southColor")) {
-      String color = request->getParam("southColor")->value();
+    AsyncWebView southColor = request->paramView("southColor");
+    if (southColor.valid()) {
+      const char *color = southColor.c_str();
       char *endptr;
-      int hexRgb = strtol(color.c_str() + 1, &endptr, 16);
+      int hexRgb = strtol(color + 1, &endptr, 16);
       // 检查解析是否成功
-      if (endptr == color.c_str() + 1) {
+      if (endptr == color + 1) {
         request->send(400, "text/plain", "Failed to parse southColor value.");
         return;
       }
@@ -124,12 +792,13 @@ static void apis(void) {
     } else {
       ESP_LOGE(TAG, "not found southColor");
     }
-    if (request->hasParam("spawnColor")) {
-      String color = request->getParam("spawnColor")->value();
+    AsyncWebView spawnColor = request->paramView("spawnColor");
+    if (spawnColor.valid()) {
+      const char *color = spawnColor.c_str();
       char *endptr;
-      int hexRgb = strtol(color.c_str() + 1, &endptr, 16);
+      int hexRgb = strtol(color + 1, &endptr, 16);
       // 检查解析是否成功
-      if (endptr == color.c_str() + 1) {
+      if (endptr == color + 1) {
         request->send(400, "text/plain", "Failed to parse spawnColor value.");
         return;
       }
@@ -144,34 +813,31 @@ static void apis(void) {
   });
 
   // 获取指针颜色
-  server.on("/pointColors", HTTP_GET, [](AsyncWebServerRequest *request) {
+  route::add("/pointColors", HTTP_GET, [](AsyncWebServerRequest *request) {
     clientConnected = true;
     PointerColor pointColor = ctx->getColor();
-    std::string spawnColor = utils::toHexString(pointColor.spawnColor);
-    std::string southColor = utils::toHexString(pointColor.southColor);
-    request->send(200, "text/json",
-                  "{\"spawnColor\":\"" + String(spawnColor.c_str()) +
-                      "\",\"southColor\":\"" + String(southColor.c_str()) +
-                      "\"}");
+    utils::FixedString<64> json;
+    json.appendf("{\"spawnColor\":\"#%06X\",\"southColor\":\"#%06X\"}",
+                 pointColor.spawnColor & 0xFFFFFF,
+                 pointColor.southColor & 0xFFFFFF);
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
   });
 
   // 获取亮度
-  server.on("/brightness", HTTP_GET, [](AsyncWebServerRequest *request) {
+  route::add("/brightness", HTTP_GET, [](AsyncWebServerRequest *request) {
     clientConnected = true;
-    uint8_t brightness = ctx->getBrightness();
-    String response = "{\"brightness\":" + String(brightness) + "}";
-    request->send(200, "text/json", response);
+    utils::FixedString<32> json;
+    json.appendf("{\"brightness\":%u}", ctx->getBrightness());
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
   });
 
   // 设置亮度
-  server.on("/brightness", HTTP_POST, [](AsyncWebServerRequest *request) {
+  route::add("/brightness", HTTP_POST, [](AsyncWebServerRequest *request) {
     clientConnected = true;
-    if (request->hasParam("brightness")) {
-      // 获取 brightness 参数的值（String 类型）
-      String brightnessStr = request->getParam("brightness")->value();
-
-      // 将 String 转换为整数
-      int brightnessInt = brightnessStr.toInt();
+    AsyncWebView brightnessParam = request->paramView("brightness");
+    if (brightnessParam.valid()) {
+      // 将参数转换为整数
+      int brightnessInt = brightnessParam.toInt();
 
       // 检查 brightness 是否在 0 到 255 范围内
       if (brightnessInt >= 0 && brightnessInt <= 255) {
@@ -196,36 +862,149 @@ static void apis(void) {
     }
   });
 
+  // 设置实时遥测推送间隔
+  route::add("/eventsInterval", HTTP_POST, [](AsyncWebServerRequest *request) {
+    clientConnected = true;
+    AsyncWebView intervalParam = request->paramView("interval");
+    if (intervalParam.valid()) {
+      long interval = intervalParam.toInt();
+      if (interval >= MIN_EVENTS_INTERVAL && interval <= MAX_EVENTS_INTERVAL) {
+        startEvents(interval);
+        request->send(200);
+        return;
+      }
+    }
+    request->send(400);
+  });
+
+  // 外部方位角接入计数
+  route::add("/ingestStats", HTTP_GET, [](AsyncWebServerRequest *request) {
+    clientConnected = true;
+    utils::FixedString<256> json;
+    json.append("{");
+    for (int i = 0; i < ingest::CHANNEL_MAX; i++) {
+      ingest::Channel channel = static_cast<ingest::Channel>(i);
+      ingest::Stats stats = ingest::getStats(channel);
+      json.appendf("%s\"%s\":{\"accepted\":%u,\"coalesced\":%u,"
+                   "\"rejected\":%u}",
+                   i == 0 ? "" : ",", ingest::channelName(channel),
+                   stats.accepted, stats.coalesced, stats.rejected);
+    }
+    json.append("}");
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
+  });
+
+  // HTTP连接复用计数
+  route::add("/httpStats", HTTP_GET, [](AsyncWebServerRequest *request) {
+    const AsyncWebServerStats &stats = server.stats();
+    async_tcp_event_stats_t events = asyncTcpEventStats();
+    utils::FixedString<256> json;
+    // pipelineOverflows: 流水线请求超过 WEBSERVER_PIPELINE_BUFFER, 被拒绝(503)
+    // 后关闭的连接数
+    json.appendf("{\"connections\":%u,\"requests\":%u,\"reused\":%u,"
+                 "\"pipelined\":%u,\"idleClosed\":%u,"
+                 "\"pipelineOverflows\":%u,",
+                 stats.connections, stats.requests, stats.reused,
+                 stats.pipelined, stats.idleClosed, stats.pipelineOverflows);
+    // AsyncTCP 事件包池, overflows 不为0说明池太小
+    json.appendf("\"eventPool\":{\"size\":%u,\"used\":%u,\"highWater\":%u,"
+                 "\"queued\":%u,\"overflows\":%u}}",
+                 events.size, events.used, events.highWater, events.queued,
+                 events.overflows);
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
+  });
+
+  // GPS串口和NMEA解析计数, 解析器未运行(没有GPS或检测超时已关闭)时
+  // running 为0
+  route::add("/gpsStats", HTTP_GET, [](AsyncWebServerRequest *request) {
+    nmea_parser_stats_t stats = {};
+    bool running = gps::getParserStats(&stats);
+    utils::FixedString<192> json;
+    json.appendf("{\"running\":%d,\"bytes\":%u,\"sentences\":%u,"
+                 "\"checksumErrors\":%u,\"formatErrors\":%u,"
+                 "\"overflows\":%u,\"resyncs\":%u}",
+                 running ? 1 : 0, stats.bytes, stats.lines, stats.crc_errors,
+                 stats.format_errors, stats.overflows, stats.resyncs);
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
+  });
+
+  // 各接口的请求次数和处理时间分布
+  route::add("/routeStats", HTTP_GET, [](AsyncWebServerRequest *request) {
+    AsyncResponseStream *response =
+        request->beginResponseStream(JSON_CONTENT_TYPE);
+    utils::JsonWriter<AsyncResponseStream> json(*response);
+    json.beginObject().beginArray("bucketsUs");
+    for (int i = 0; i < route::LATENCY_BUCKETS - 1; i++) {
+      json.field(nullptr, route::latencyBound(i));
+    }
+    json.endArray().beginArray("routes");
+    for (size_t i = 0; i < route::count(); i++) {
+      const route::Route &item = route::at(i);
+      json.beginObject()
+          .field("path", item.path)
+          .field("method", route::methodName(item.method))
+          .field("count", item.stats.count)
+          .field("maxUs", item.stats.maxUs)
+          .fieldf("totalUs", "%llu",
+                  (unsigned long long)item.stats.totalUs)
+          .beginArray("histogram");
+      for (int j = 0; j < route::LATENCY_BUCKETS; j++) {
+        json.field(nullptr, item.stats.histogram[j]);
+      }
+      json.endArray().endObject();
+    }
+    json.endArray().endObject();
+    request->send(response);
+  });
+
+  // WiFi省电档位和各档位累计时间
+  route::add("/netPower", HTTP_GET, [](AsyncWebServerRequest *request) {
+    net_power::Stats stats = net_power::getStats();
+    utils::FixedString<192> json;
+    json.appendf("{\"mode\":\"%s\",\"switches\":%u,\"idleSeconds\":%u",
+                 net_power::modeName(stats.mode), stats.switches,
+                 stats.idleSeconds);
+    for (int i = 0; i < net_power::MODE_MAX; i++) {
+      net_power::Mode mode = static_cast<net_power::Mode>(i);
+      json.appendf(",\"%sMs\":%u", net_power::modeName(mode),
+                   stats.timeMs[i]);
+    }
+    json.append("}");
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
+  });
+
   // 设置罗盘显示指定方位角度
-  server.on("/setAzimuth", HTTP_POST, [](AsyncWebServerRequest *request) {
+  route::add("/setAzimuth", HTTP_POST, [](AsyncWebServerRequest *request) {
     clientConnected = true;
-    if (request->hasParam("azimuth")) {
-      float azimuth = request->getParam("azimuth")->value().toFloat();
-      ctx->setSubscribeSource(Event::Source::WEB_SERVER);
-      ctx->setWorkType(WorkType::MOD);
-      auto eventLoop = ctx->getEventLoop();
-      Event::Body event;
-      event.type = Event::Type::AZIMUTH;
-      event.source = Event::Source::WEB_SERVER;
-      event.azimuth.angle = azimuth;
-      ESP_LOGI(TAG, "esp_event_post_to %p", eventLoop);
-      ESP_ERROR_CHECK(esp_event_post_to(eventLoop, MCOMPASS_EVENT, 0, &event,
-                                        sizeof(event), 0));
+    AsyncWebView azimuthParam = request->paramView("azimuth");
+    if (azimuthParam.valid()) {
+      float azimuth = azimuthParam.toFloat();
+      if (ingest::submit(ingest::HTTP, azimuth) == ingest::REJECTED) {
+        return request->send(429, "text/plain", "Too many requests");
+      }
       return request->send(200);
     }
     request->send(400);
   });
 
+  // 罗盘状态, 带ETag
+  route::add("/state", HTTP_GET, handleState, nullptr, "If-None-Match");
+
   // 获取WiFi配置
-  server.on("/wifi", HTTP_GET, [](AsyncWebServerRequest *request) {
+  route::add("/wifi", HTTP_GET, [](AsyncWebServerRequest *request) {
     clientConnected = true;
-    request->send(200, "text/json",
-                  "{\"ssid\":\"" + ctx->getSsid() + "\",\"password\":\"" +
-                      ctx->getPassword() + "\"}");
+    // SSID最长32字节, 密码最长64字节, 每个字节转义后最多6字节
+    utils::FixedString<640> buffer;
+    utils::JsonWriter<utils::FixedString<640>> json(buffer);
+    json.beginObject()
+        .field("ssid", ctx->getSsid().c_str())
+        .field("password", ctx->getPassword().c_str())
+        .endObject();
+    request->send(200, JSON_CONTENT_TYPE, buffer.c_str());
   });
 
   // 设置WiFi配置
-  server.on("/wifi", HTTP_POST, [](AsyncWebServerRequest *request) {
+  route::add("/wifi", HTTP_POST, [](AsyncWebServerRequest *request) {
     clientConnected = true;
     if (request->hasParam("ssid") && request->hasParam("password")) {
       String ssid = request->getParam("ssid")->value();
@@ -240,18 +1019,18 @@ static void apis(void) {
   });
 
   // 设置高级配置
-  server.on("/advancedConfig", HTTP_POST, [](AsyncWebServerRequest *request) {
+  route::add("/advancedConfig", HTTP_POST, [](AsyncWebServerRequest *request) {
     clientConnected = true;
-    if (request->hasParam("serverMode")) {
-      String serverMode = request->getParam("serverMode")->value();
+    AsyncWebView serverMode = request->paramView("serverMode");
+    if (serverMode.valid()) {
       ServerMode mode =
-          (serverMode == "1") ? ServerMode::BLE : ServerMode::WIFI;
+          serverMode.equals("1") ? ServerMode::BLE : ServerMode::WIFI;
       preference::setServerMode(mode);
       ctx->setServerMode(mode);
     }
-    if (request->hasParam("model")) {
-      String model = request->getParam("model")->value();
-      Model compassModel = model == "0" ? Model::LITE : Model::GPS;
+    AsyncWebView model = request->paramView("model");
+    if (model.valid()) {
+      Model compassModel = model.equals("0") ? Model::LITE : Model::GPS;
       preference::setCustomDeviceModel(compassModel);
       ctx->setModel(compassModel);
     }
@@ -260,18 +1039,64 @@ static void apis(void) {
   });
 
   // 获取高级配置
-  server.on("/advancedConfig", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String modelStr = ctx->isGPSModel() ? "1" : "0";
-    ServerMode serverMode = ctx->getServerMode();
-    String serverModeStr = serverMode == ServerMode::BLE ? "1" : "0";
-    request->send(200, "text/json",
-                  "{\"model\":\"" + modelStr + "\",\"serverMode\":\"" +
-                      serverModeStr + "\"}");
+  route::add("/advancedConfig", HTTP_GET, [](AsyncWebServerRequest *request) {
+    utils::FixedString<48> json;
+    json.appendf("{\"model\":\"%d\",\"serverMode\":\"%d\"}",
+                 ctx->isGPSModel() ? 1 : 0,
+                 ctx->getServerMode() == ServerMode::BLE ? 1 : 0);
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
+  });
+
+  // 获取全部配置
+  route::add("/config", HTTP_GET, [](AsyncWebServerRequest *request) {
+    clientConnected = true;
+    utils::FixedString<CONFIG_JSON_CAPACITY> json;
+    config::toJson(json);
+    request->send(200, JSON_CONTENT_TYPE, json.c_str());
   });
 
+  // 批量设置配置, 请求体为JSON, 全部校验通过后一次保存
+  route::add(
+      "/config", HTTP_POST,
+      [](AsyncWebServerRequest *request) {
+        clientConnected = true;
+        if (request->contentLength() > CONFIG_JSON_CAPACITY) {
+          return request->send(413);
+        }
+        const char *body = static_cast<const char *>(request->_tempObject);
+        config::Change change;
+        const char *error = "empty config";
+        if (!body || !config::parse(body, request->contentLength(), change,
+                                    error)) {
+          utils::FixedString<64> json;
+          json.appendf("{\"error\":\"%s\"}", error);
+          return request->send(400, JSON_CONTENT_TYPE, json.c_str());
+        }
+        if (!config::apply(change)) {
+          return request->send(500);
+        }
+        utils::FixedString<CONFIG_JSON_CAPACITY> json;
+        config::toJson(json, change.fields & config::RESTART_FIELDS);
+        request->send(200, JSON_CONTENT_TYPE, json.c_str());
+      },
+      [](AsyncWebServerRequest *request, uint8_t *data, size_t length,
+         size_t index, size_t total) {
+        // 请求体可能分多次到达, 拼接到 _tempObject, 请求结束时由框架释放
+        if (total > CONFIG_JSON_CAPACITY) {
+          return;
+        }
+        if (index == 0) {
+          request->_tempObject = malloc(total);
+        }
+        if (request->_tempObject && index + length <= total) {
+          memcpy(static_cast<uint8_t *>(request->_tempObject) + index, data,
+                 length);
+        }
+      });
+
   //////////////////////////// 旧API ////////////////////////////
   // 兼容性保留setWiFi
-  server.on("/setWiFi", HTTP_POST, [](AsyncWebServerRequest *request) {
+  route::add("/setWiFi", HTTP_POST, [](AsyncWebServerRequest *request) {
     clientConnected = true;
     if (request->hasParam("ssid") && request->hasParam("password")) {
       String ssid = request->getParam("ssid")->value();
@@ -282,14 +1107,15 @@ static void apis(void) {
     }
   });
   // 所有LED显示指定颜色
-  server.on("/setColor", HTTP_POST, [](AsyncWebServerRequest *request) {
+  route::add("/setColor", HTTP_POST, [](AsyncWebServerRequest *request) {
     clientConnected = true;
-    if (request->hasParam("color")) {
-      String color = request->getParam("color")->value();
+    AsyncWebView colorParam = request->paramView("color");
+    if (colorParam.valid()) {
+      const char *color = colorParam.c_str();
       char *endptr;
-      int hexRgb = strtol(color.c_str() + 1, &endptr, 16);
+      int hexRgb = strtol(color + 1, &endptr, 16);
       // 检查解析是否成功
-      if (endptr == color.c_str() + 1) {
+      if (endptr == color + 1) {
         request->send(400, "text/plain", "Failed to parse color value.");
         return;
       }
@@ -300,22 +1126,24 @@ static void apis(void) {
     }
   });
   // 设置指针显示指定帧
-  server.on("/setIndex", HTTP_POST, [](AsyncWebServerRequest *request) {
+  route::add("/setIndex", HTTP_POST, [](AsyncWebServerRequest *request) {
     clientConnected = true;
-    if (request->hasParam("index")) {
-      int index = request->getParam("index")->value().toInt();
+    AsyncWebView indexParam = request->paramView("index");
+    if (indexParam.valid()) {
+      int index = indexParam.toInt();
       if (index < 0 || index > MAX_FRAME_INDEX) {
         request->send(400, "text/plain", "index parameter invalid");
         return;
       }
       int hexRgb = DEFAULT_POINTER_COLOR;
-      if (request->getParam("color") != nullptr) {
-        String color = request->getParam("color")->value();
+      AsyncWebView colorParam = request->paramView("color");
+      if (colorParam.valid()) {
+        const char *color = colorParam.c_str();
         char *endptr;
-        hexRgb = strtol(color.c_str() + 1, &endptr, 16);
+        hexRgb = strtol(color + 1, &endptr, 16);
         ESP_LOGI(TAG, "setIndex(%d) with color(%06X)\n", index, hexRgb);
         // 解析失败还原指针颜色
-        if (endptr == color.c_str() + 1) {
+        if (endptr == color + 1) {
           hexRgb = DEFAULT_POINTER_COLOR;
         }
       }
@@ -351,9 +1179,33 @@ static void launchServer(const char *defaultFile) {
     return;
   }
   ESP_LOGI(TAG, "Launching server");
+  server.addHandler(&activityHandler);
   apis();
-  server.serveStatic("/", LittleFS, "/").setDefaultFile(defaultFile);
+  // 接口按 (path, method) 排序后一次查找分发, 不匹配时交给后面的处理器
+  server.addHandler(route::build());
+  ws.onEvent(onWebSocketEvent);
+  server.addHandler(&ws);
+  // 新连接的客户端先收到完整配置
+  events.onConnect([](AsyncEventSourceClient *client) {
+    clientConnected = true;
+    streamClients++;
+    utils::FixedString<256> config;
+    configJson(config);
+    client->send(config.c_str(), "config", ++eventsId, 1000);
+  });
+  events.onDisconnect([](AsyncEventSource *source,
+                         AsyncEventSourceClient *client) { streamClients--; });
+  server.addHandler(&events);
+  startEvents(DEFAULT_EVENTS_INTERVAL);
+  startUdp();
+  server.addHandler(&assetHandler);
+  if (!assetBundled) {
+    asset::init(LittleFS);
+    server.serveStatic("/", LittleFS, "/").setDefaultFile(defaultFile);
+  }
   server.onNotFound(notFound);
+  // 轮询和推送的客户端复用连接, 省去每个请求的TCP握手
+  server.setKeepAlive(HTTP_KEEP_ALIVE_TIMEOUT, HTTP_KEEP_ALIVE_MAX);
   server.begin();
   ESP_LOGI(TAG, "Server launched");
 }
@@ -361,9 +1213,17 @@ static void launchServer(const char *defaultFile) {
 void web_server::init(Context *context) {
   ctx = context;
   ESP_LOGI(TAG, "Setting up server %p", ctx);
+  ingest::init(ctx);
+  config::init(ctx);
   String ssid, password;
   preference::getWiFiCredentials(ssid, password);
-  bool fileSystemMounted = LittleFS.begin(false, "/littlefs", 32);
+  // 有资源包时跳过挂载文件系统
+  assetBundled = asset::initBundle();
+  if (!assetBundled) {
+    ESP_LOGW(TAG, "No web UI bundle, serving the fallback page from LittleFS");
+  }
+  bool fileSystemMounted =
+      assetBundled || LittleFS.begin(false, "/littlefs", 32);
   // 文件系统挂载失败
   if (!fileSystemMounted) {
     ESP_LOGE(TAG, "Failed to mount LittleFS");
@@ -389,6 +1249,7 @@ void web_server::init(Context *context) {
   WiFi.mode(WIFI_STA);
   WiFi.setAutoConnect(true);
   WiFi.begin(ssid, password);
+  net_power::init(streamClientCount);
   ctx->setDeviceState(State::COMPASS);
   launchServer("index.html");
   MDNS.addService("http", "tcp", 80);
@@ -414,7 +1275,6 @@ void web_server::init(Context *context) {
   esp_timer_start_once(localAccessPointTimer,
                        DEFAULT_WIFI_CONNECT_TIME * 1000000);
   // 则开启热点15秒后没有设备连接, 则关闭热点.
-  esp_timer_handle_t wifiDisableTimer;
   esp_timer_create_args_t wifiDisableTimerArgs = {
       .callback =
           [](void *arg) {
@@ -430,6 +1290,16 @@ void web_server::init(Context *context) {
               ESP_LOGI(TAG, "Spawn Location is not set, skip disbale AP");
               return;
             }
+            // 连接了路由器时以深度省电继续提供服务, 长时间没有网络活动再关闭
+            net_power::Stats power = net_power::getStats();
+            if (power.mode != net_power::UNMANAGED &&
+                power.idleSeconds < NET_POWER_IDLE_SHUTDOWN) {
+              esp_timer_start_once(
+                  wifiDisableTimer,
+                  (uint64_t)(NET_POWER_IDLE_SHUTDOWN - power.idleSeconds) *
+                      1000000);
+              return;
+            }
             ESP_LOGI(TAG, "No client connected, disbale AP");
             endServer();
             if (WiFi.getMode() == WIFI_AP) {
@@ -455,6 +1325,17 @@ void web_server::endServer() {
     return;
   }
   ESP_LOGW(TAG, "endWebServer");
+  ws.closeAll();
+  if (eventsTimer) {
+    esp_timer_stop(eventsTimer);
+  }
+  // 与推送一样在 async_tcp 任务中遍历客户端
+  if (!asyncTcpCall([](void *arg) { events.close(); }, nullptr)) {
+    events.close();
+  }
+  ESP_LOGI(TAG, "UDP azimuth %u packets, %u dropped", udpReceived, udpDropped);
+  udp.close();
+  net_power::deinit();
   server.end();
   serverEnable = false;
 }
@@ -5,6 +5,7 @@
 #include <esp_log.h>
 #include <esp_task_wdt.h>
 
+#include "alloc_tracker.h"
 #include "board.h"
 #include "context.h"
 #include "event.h"
@@ -25,6 +26,18 @@ void dispatcher(void *handler_arg, esp_event_base_t base, int32_t id,
   }
 }
 
+void azimuth_dispatcher(void *handler_arg, esp_event_base_t base, int32_t id,
+                        void *event_data) {
+  ALLOC_GUARD("azimuth_dispatcher");
+  Event::Body evt;
+  Event::takeAzimuth(static_cast<Event::Source>(id), &evt);
+  Context &context = Context::getInstance();
+
+  if (context.getCurrentState()) {
+    context.getCurrentState()->handleEvent(context, &evt);
+  }
+}
+
 void setup() {
   // 延时,用于一些特殊情况下能够重新烧录
   delay(1000);
@@ -33,13 +46,16 @@ void setup() {
       .queue_size = 128,
       .task_name = "event_loop",
       .task_priority = configMAX_PRIORITIES - 1,
-      .task_stack_size = 1024 * 8,
+      .task_stack_size = EVENT_LOOP_TASK_STACK_SIZE,
   };
   ESP_ERROR_CHECK(esp_event_loop_create(&loop_args, &eventLoop));
   context.setEventLoop(eventLoop);
   // 注册事件处理程序
   ESP_ERROR_CHECK(esp_event_handler_register_with(eventLoop, MCOMPASS_EVENT, 0,
                                                   dispatcher, NULL));
+  ESP_ERROR_CHECK(esp_event_handler_register_with(
+      eventLoop, MCOMPASS_AZIMUTH_EVENT, ESP_EVENT_ANY_ID, azimuth_dispatcher,
+      NULL));
   ESP_LOGI(TAG, "Event loop created %p", eventLoop);
 
   // 初始化硬件
@@ -28,7 +28,7 @@ void CalibratingState::handleEvent(Context &context, Event::Body *evt) {
         ESP_LOGI("", "Calibrate Done.");
         vTaskDelete(NULL);
       },
-      "calibrate", 8192, &context, configMAX_PRIORITIES - 1, NULL);
+      "calibrate", CALIBRATE_TASK_STACK_SIZE, &context, configMAX_PRIORITIES - 1, NULL);
 
   int x = 0;
   size_t length = text.length();
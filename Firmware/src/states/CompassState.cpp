@@ -5,7 +5,10 @@
 
 #include "gps_def.h"
 #include "pixel_def.h"
+#include "position_filter_def.h"
+#include "waypoint_def.h"
 #include "preference_def.h"
+#include "web_server_def.h"
 #include <esp_log.h>
 
 void CompassState::onEnter(Context &context) {
@@ -46,6 +49,8 @@ void CompassState::handleEvent(Context &context, Event::Body *evt) {
       if (gps::isValidGPSLocation(currentLoc)) {
         preference::saveSpawnLocation(currentLoc);
         context.setSpawnLocation(currentLoc);
+        waypoint::select(waypoint::SELECT_SPAWN);
+        position_filter::updateArrival(currentLoc);
         ESP_LOGI(getName(), "Set spawn location to {%.2f,%.2f}",
                  currentLoc.latitude, currentLoc.longitude);
       } else {
@@ -77,7 +82,13 @@ void CompassState::handleEvent(Context &context, Event::Body *evt) {
           pixel::showByAzimuth(evt->azimuth.angle);
         }
       } else {
-        if (evt->source == Event::Source::SENSOR) {
+        if (evt->source != Event::Source::SENSOR) {
+          return;
+        }
+        if (position_filter::isArrived()) {
+          // 已到达目标, 方位没有意义
+          pixel::showArrived();
+        } else {
           // 当前位置有效, 使用SENSOR数据计算目标位置方位角
           pixel::showFrameByLocation(context.getCurrentLocation().latitude,
                                      context.getCurrentLocation().longitude,
@@ -106,7 +117,9 @@ void CompassState::handleEvent(Context &context, Event::Body *evt) {
     } else {
       // MOD 模式, 只显示来自服务器的数据
       if (evt->source == Event::Source::WEB_SERVER) {
+        web_server::applyPendingColor();
         pixel::showByAzimuth(evt->azimuth.angle);
+        web_server::onAzimuthShown();
       }
     }
 
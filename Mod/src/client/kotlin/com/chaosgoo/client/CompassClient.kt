@@ -7,10 +7,15 @@ import net.fabricmc.api.ClientModInitializer
 import net.fabricmc.fabric.api.client.event.lifecycle.v1.ClientTickEvents
 import net.minecraft.text.Text
 import okhttp3.*
+import okio.ByteString
+import okio.ByteString.Companion.toByteString
 import retrofit2.Retrofit
 import retrofit2.http.GET
 import retrofit2.http.POST
 import retrofit2.http.Query
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.concurrent.TimeUnit
 
 interface CompassApiService {
     @GET("ip")
@@ -21,11 +26,31 @@ interface CompassApiService {
 }
 
 class CompassClient : ClientModInitializer {
-    private var lastAzimuth = 0f
+    companion object {
+        private const val BASE_URL = "http://esp32.local"
+        private const val WEB_SOCKET_URL = "ws://esp32.local/ws"
+
+        // 与固件 web_server::AzimuthFrame / TelemetryFrame 一致
+        private const val FRAME_AZIMUTH: Byte = 0x01
+        private const val FRAME_TELEMETRY: Byte = 0x81.toByte()
+        private const val AZIMUTH_FRAME_SIZE = 10
+        private const val TELEMETRY_FRAME_SIZE = 22
+
+        // 发送队列超过这个字节数说明设备来不及接收, 跳过本次更新
+        private const val MAX_QUEUED_BYTES = AZIMUTH_FRAME_SIZE * 4L
+        private const val RECONNECT_INTERVAL_MS = 3000L
+    }
+
+    private var lastAzimuth = -1f
+    private val httpClient by lazy {
+        OkHttpClient.Builder()
+            .pingInterval(15, TimeUnit.SECONDS)
+            .build()
+    }
     private val retrofit by lazy {
         Retrofit.Builder()
-            .baseUrl("http://esp32.local")
-            .client(OkHttpClient())
+            .baseUrl(BASE_URL)
+            .client(httpClient)
             .build()
     }
     private val apiService by lazy { retrofit.create(CompassApiService::class.java) }
@@ -34,6 +59,41 @@ class CompassClient : ClientModInitializer {
     private val dispatcher = Dispatchers.IO.limitedParallelism(8)
     private val scope = CoroutineScope(SupervisorJob() + dispatcher)
 
+    @Volatile
+    private var webSocket: WebSocket? = null
+
+    @Volatile
+    private var connecting = false
+    private var lastConnectAttempt = 0L
+    private var sequence = 0
+
+    /** 最近一次遥测帧测得的往返延迟(毫秒) */
+    @Volatile
+    var roundTripMs = 0
+        private set
+
+    private val listener = object : WebSocketListener() {
+        override fun onOpen(webSocket: WebSocket, response: Response) {
+            this@CompassClient.webSocket = webSocket
+            connecting = false
+        }
+
+        override fun onMessage(webSocket: WebSocket, bytes: ByteString) {
+            if (bytes.size != TELEMETRY_FRAME_SIZE || bytes[0] != FRAME_TELEMETRY) return
+            val buffer = ByteBuffer.wrap(bytes.toByteArray()).order(ByteOrder.LITTLE_ENDIAN)
+            val timestamp = buffer.getInt(4)
+            roundTripMs = nowMs() - timestamp
+        }
+
+        override fun onClosed(webSocket: WebSocket, code: Int, reason: String) {
+            disconnected(webSocket)
+        }
+
+        override fun onFailure(webSocket: WebSocket, t: Throwable, response: Response?) {
+            disconnected(webSocket)
+        }
+    }
+
     override fun onInitializeClient() {
         ClientTickEvents.END_CLIENT_TICK.register(
             ClientTickEvents.EndTick { client ->
@@ -52,7 +112,7 @@ class CompassClient : ClientModInitializer {
                         true
                     )*/
                     if (lastAzimuth != azimuth) {
-                        setAzimuth(lastAzimuth)
+                        setAzimuth(azimuth)
                         lastAzimuth = azimuth
                     }
                 }
@@ -60,11 +120,47 @@ class CompassClient : ClientModInitializer {
         )
     }
 
+    private fun nowMs(): Int = (System.nanoTime() / 1_000_000).toInt()
+
+    private fun disconnected(socket: WebSocket) {
+        if (webSocket === socket) {
+            webSocket = null
+        }
+        connecting = false
+    }
+
+    private fun connect() {
+        val now = System.currentTimeMillis()
+        if (connecting || now - lastConnectAttempt < RECONNECT_INTERVAL_MS) return
+        connecting = true
+        lastConnectAttempt = now
+        httpClient.newWebSocket(Request.Builder().url(WEB_SOCKET_URL).build(), listener)
+    }
+
     private fun setAzimuth(azimuth: Float) {
+        val angle = (360.0f - azimuth) % 360.0f
+        val socket = webSocket
+        if (socket == null) {
+            // WebSocket未连接时退回HTTP, 同时尝试建立连接
+            connect()
+            postAzimuth(angle)
+            return
+        }
+        if (socket.queueSize() > MAX_QUEUED_BYTES) return
+        val frame = ByteBuffer.allocate(AZIMUTH_FRAME_SIZE).order(ByteOrder.LITTLE_ENDIAN)
+            .put(FRAME_AZIMUTH)
+            .put(0)
+            .putShort((sequence++).toShort())
+            .putShort((angle * 100).toInt().coerceIn(0, 35999).toShort())
+            .putInt(nowMs())
+        socket.send(frame.array().toByteString())
+    }
+
+    private fun postAzimuth(azimuth: Float) {
         if (mutex.isLocked) return
         scope.launch {
             mutex.withLock {
-                apiService.setAzimuth(360.0f - azimuth)
+                runCatching { apiService.setAzimuth(azimuth) }
             }
         }
     }
@@ -1,5 +1,6 @@
 import { Button } from "@heroui/button";
 import { useEffect, useState } from "react";
+import { loadState } from "./state";
 import { Slider } from "@heroui/slider";
 
 import { Select, SelectItem } from "@heroui/select";
@@ -41,17 +42,11 @@ export default function ColorsPanel() {
     // }, [debounceValue]);
     // 获取初始数据
     useEffect(() => {
-        fetch("/pointColors")
-            .then(response => response.json())
-            .then(data => {
-                setSouthColor(data.southColor || "#FF1414");
-                setSpawnColor(data.spawnColor || "#FF1414");
-                fetch("/brightness")
-                    .then(response => response.json())
-                    .then(data => {
-                        setBrightness(data.brightness || 56);
-                    });
-            });
+        loadState().then(({ config }) => {
+            setSouthColor(config.southColor || "#FF1414");
+            setSpawnColor(config.spawnColor || "#FF1414");
+            setBrightness(config.brightness || 56);
+        });
 
 
     }, []);
@@ -1,30 +1,53 @@
 import { Switch } from "@heroui/switch";
-import { useState } from "react";
+import { useEffect, useState } from "react";
+
+type Telemetry = {
+    azimuth: number;
+    workType: number;
+    gps: { detected: number; fixed: number; arrived: number; latitude: number; longitude: number; sats: number; hdop: number };
+    heap: { free: number; minFree: number; largest: number; fragmentation: number };
+    stack: { event_loop: number; async_tcp: number };
+    sensor: { available: number; model: string };
+    clients: number;
+};
 
 export default function DebugPanel() {
 
     const [fill, setFill] = useState(false);
+    const [connected, setConnected] = useState(false);
+    const [telemetry, setTelemetry] = useState<Telemetry | null>(null);
+    const [config, setConfig] = useState<Record<string, unknown> | null>(null);
+
+    // 一个 /events 长连接代替逐个接口轮询
+    useEffect(() => {
+        const source = new EventSource("/events");
+        source.onopen = () => setConnected(true);
+        source.onerror = () => setConnected(false);
+        source.addEventListener("telemetry", event => {
+            setTelemetry(JSON.parse((event as MessageEvent).data));
+        });
+        source.addEventListener("config", event => {
+            setConfig(JSON.parse((event as MessageEvent).data));
+        });
+        return () => source.close();
+    }, [])
 
     function onFillChange(value: boolean) {
         setFill(value);
     }
 
-    function queryWifiList() {
-        console.log("Query WiFi List");
-        // 发起一个请求，获取WiFi列表
-        // fetch("/get")
-        //     .then(response => response.json())
-        //     .then(data => {
-        //         console.log(data);
-        //     })
-        //     .catch(error => {
-        //         console.error("Error fetching WiFi list:", error);
-        //     });
-        // 把color post出去
-
-    }
-
     return <div className="w-full flex flex-col flex-wrap gap-4">
         <Switch className="w-full text-start " checked={fill} onValueChange={onFillChange}>Should we arrive the nether?</Switch>
+        <ul>
+            <li>实时连接: {connected ? "已连接" : "未连接"}</li>
+            {telemetry && <>
+                <li>方位角: {telemetry.azimuth}°</li>
+                <li>GPS: {telemetry.gps.fixed ? `已定位 (${telemetry.gps.latitude.toFixed(6)}, ${telemetry.gps.longitude.toFixed(6)}) 卫星 ${telemetry.gps.sats} HDOP ${telemetry.gps.hdop}` : (telemetry.gps.detected ? "未定位" : "不可用")}{telemetry.gps.arrived ? " 已到达" : ""}</li>
+                <li>地磁传感器: {telemetry.sensor.available ? telemetry.sensor.model : "不可用"}</li>
+                <li>堆内存: 空闲 {telemetry.heap.free} 最小 {telemetry.heap.minFree} 最大块 {telemetry.heap.largest} 碎片 {telemetry.heap.fragmentation}%</li>
+                <li>最小剩余栈: event_loop {telemetry.stack.event_loop} async_tcp {telemetry.stack.async_tcp}</li>
+            </>}
+            {config && <li>配置: {JSON.stringify(config)}</li>}
+        </ul>
     </div>;
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 import { Button } from "@heroui/button";
 import { useEffect, useState } from "react";
+import { loadState } from "./state";
 
 export default function InfoPanel() {
     const [deviceInfo, setDeviceInfo] = useState({
@@ -13,13 +14,13 @@ export default function InfoPanel() {
     });
 
     useEffect(() => {
-        fetch("/info")
-            .then(response => response.json())
-            .then(data => {
-                if (data) {
-                    setDeviceInfo(data);
-                }
+        loadState().then(({ info }) => {
+            setDeviceInfo({
+                ...info,
+                gpsStatus: String(info.gpsStatus),
+                sensorStatus: String(info.sensorStatus),
             });
+        });
     }, [])
 
     function reboot() {
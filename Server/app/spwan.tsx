@@ -1,4 +1,5 @@
 import { useEffect, useState } from "react";
+import { loadState } from "./state";
 import { Button } from "@heroui/button";
 import { Input } from "@heroui/input";
 import { Popover, PopoverTrigger, PopoverContent } from "@heroui/popover";
@@ -15,12 +16,11 @@ export default function SpawnPanel() {
     useEffect(() => {
         setIsSaving(true);
         // 获取当前的经纬度
-        fetch("/spawn")
-            .then(response => response.json())
-            .then(data => {
-                if (data.latitude && data.longitude) {
-                    setLatitude(data.latitude);
-                    setLongitude(data.longitude);
+        loadState()
+            .then(({ config }) => {
+                if (config.spawn.latitude && config.spawn.longitude) {
+                    setLatitude(config.spawn.latitude.toFixed(6));
+                    setLongitude(config.spawn.longitude.toFixed(6));
                     setCanSave(true);
                 }
             }).finally(() => {
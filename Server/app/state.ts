@@ -0,0 +1,46 @@
+export type DeviceState = {
+    info: {
+        buildVersion: string;
+        buildDate: string;
+        buildTime: string;
+        gitBranch: string;
+        gitCommit: string;
+        model: number;
+        gpsStatus: number;
+        sensorStatus: number;
+        sensorModel: string;
+    };
+    config: {
+        brightness: number;
+        spawnColor: string;
+        southColor: string;
+        spawn: { latitude: number; longitude: number };
+        serverMode: number;
+        ssid: string;
+    };
+    state: {
+        azimuth: number;
+        workType: number;
+        gps: { fixed: boolean; arrived: boolean; latitude: number; longitude: number };
+    };
+    waypoint: {
+        selected: number;
+        active: number;
+        waypoints: { name: string; latitude: number; longitude: number; bearing?: number; distance?: number }[];
+    };
+};
+
+let pending: Promise<DeviceState> | null = null;
+
+// 页面加载时各个面板共用一次 /state 请求
+export function loadState(): Promise<DeviceState> {
+    if (!pending) {
+        pending = fetch("/state")
+            .then(response => response.json())
+            .catch(error => {
+                pending = null;
+                throw error;
+            });
+    }
+    return pending;
+}